@@ -46,7 +46,15 @@
  * and BU_PLUGIN_CMD_ARGS macros before including this header. All core functionality
  * (registration, lookup, loading, iteration) works with any signature. The only
  * limitation is that bu_plugin_cmd_run() is only available for the default signature;
- * applications using custom signatures should provide their own wrapper functions.
+ * for custom signatures, C++ hosts use bu_plugin::invoke<Sig>() and C hosts
+ * generate wrappers with BU_PLUGIN_DEFINE_INVOKE.
+ *
+ * The signature a host is built for is its native one, but its registry is
+ * not limited to it: every command is tagged with a signature ID, plugins
+ * report the signature they were built for, and invoke<Sig>() and the
+ * generated C wrappers look commands up by signature. A default-signature
+ * host can load argc/argv plugins (and the other way round) and run both
+ * from one registry; see bu_plugin_cmd_lookup_sig().
  *
  * See Scenario 4 and tests/alt_signature for complete examples.
  *
@@ -150,7 +158,8 @@
  *
  * Applications can customize the command function signature by defining macros
  * before including bu_plugin.h. Note that bu_plugin_cmd_run() is only available
- * for the default signature; custom signatures require application-specific wrappers.
+ * for the default signature; custom signatures are run through bu_plugin::invoke()
+ * or a wrapper generated by BU_PLUGIN_DEFINE_INVOKE (or written by hand, as here).
  *
  * @code
  * // host_with_custom_sig.cpp
@@ -173,6 +182,9 @@
  *     }
  * }
  *
+ * // Or, with the same status convention and output handling:
+ * //   int n = bu_plugin::invoke<int(int, const char**)>("mycommand", argc, argv);
+ *
  * // Now commands use: int (*)(int argc, const char** argv)
  * static int my_command(int argc, const char** argv) {
  *     printf("Received %d arguments\n", argc);
@@ -332,10 +344,56 @@
  *
  * - **Thread Safety**: All registry operations are protected by mutex
  * - **ABI Safety**: Version and struct size validation prevent incompatible loads
- * - **Exception Handling**: C++ exceptions in commands are caught and logged
+ * - **Exception Handling**: C++ exceptions in commands are caught and logged;
+ *   commands flagged BU_PLUGIN_CMD_NOEXCEPT are called without a try block,
+ *   and any command can fail without throwing through bu_plugin_cmd_fail()
+ *   (the only way in a host built with -fno-exceptions)
  * - **Duplicate Detection**: First-wins policy with warnings for duplicates
  * - **Name Normalization**: Leading/trailing whitespace automatically trimmed
  * - **Lifecycle Management**: Plugins kept loaded for process lifetime
+ * - **Dependencies**: bu_plugin_manifest_v2 declares dependencies and init/fini
+ *   hooks; bu_plugin_load_graph() loads a set of plugins in dependency order,
+ *   running independent branches in parallel
+ * - **Fork Servers**: bu_plugin_freeze() makes the registry read-only and
+ *   lock-free for lookups; bu_plugin_zygote_serve() (POSIX) forks ready
+ *   workers from a fully loaded process
+ * - **Host Services**: a v2 plugin's bind hook receives a table of host
+ *   functions (logging, lookup, command handles, allocation, stats), so the
+ *   plugin does not need to link the host library
+ * - **Allocation**: the host installs a bu_plugin_allocator; the default one
+ *   gives each thread a bump arena so a command's temporaries can be
+ *   released in one step when it returns
+ * - **Batches**: bu_plugin_cmd_run_batch() resolves a list of names in one
+ *   pass and runs them in one exception frame, splitting the list across
+ *   the executor when every command is flagged BU_PLUGIN_CMD_THREADSAFE;
+ *   a command may also export a batched (structure-of-arrays) entry point
+ *   that the batch runs once per chunk of items (submitted calls are not
+ *   coalesced into it)
+ * - **Command Lines**: bu_plugin_line_word() splits a line into words in
+ *   place with shell-like quoting; with the argc/argv signature,
+ *   bu_plugin_cmd_run_line() parses and dispatches a line without
+ *   allocating, using per-thread buffers
+ * - **Command DAGs**: bu_plugin_dag_run() runs a graph of dependent commands
+ *   on the executor, cancelling only what is downstream of a failure, and
+ *   reports the critical path
+ * - **Strands**: commands of plugins that are not thread-safe are funneled
+ *   through a per-plugin (or per-group) serial queue on the executor, while
+ *   thread-safe commands run freely
+ * - **Priority Lanes**: interactive/normal/bulk admission with bounded
+ *   queues, per-lane concurrency limits and wait-time metrics
+ * - **Call Contexts**: per-request cancellation and deadlines that skip
+ *   queued work and can be polled by running commands
+ * - **Worker Pool**: plugins loaded with BU_PLUGIN_LOAD_OUT_OF_PROCESS run
+ *   in restartable worker processes behind shared-memory call rings (POSIX)
+ * - **Command Output**: commands write through bu_plugin_output_write() /
+ *   bu_plugin_output_printf() into a per-invocation buffer that the host
+ *   flushes in one piece, captures for the caller or discards
+ * - **Record Channels**: bounded single-producer/single-consumer rings of
+ *   typed fixed-layout records, written and read in place, with
+ *   backpressure and end of stream; bu_plugin_pipeline_run() connects
+ *   commands into concurrent stages
+ * - **Result Cache**: opt-in, sharded CLOCK cache of results of commands
+ *   flagged BU_PLUGIN_CMD_PURE, dropped whenever a command is unregistered
  */
 
 #ifndef BU_PLUGIN_H
@@ -451,6 +509,49 @@ extern "C" {
      */
     BU_PLUGIN_API void bu_plugin_set_path_allow(bu_plugin_path_allow_cb cb);
 
+    /*
+     * Load flags (see bu_plugin_set_load_flags).
+     */
+#define BU_PLUGIN_LOAD_PREFAULT   0x1u  /* Prefault the module's executable segments */
+#define BU_PLUGIN_LOAD_HUGEPAGES  0x2u  /* Also move large text onto transparent huge pages (implies PREFAULT) */
+#define BU_PLUGIN_LOAD_OUT_OF_PROCESS 0x4u  /* Open the plugin in the worker pool, not in this process */
+
+    /**
+     * bu_plugin_set_load_flags - Set flags applied to every subsequent plugin load.
+     * @param flags  Bitwise OR of BU_PLUGIN_LOAD_* values (0 = defaults).
+     *
+     * Even with RTLD_NOW, the first call into each page of a plugin's code takes
+     * a page fault (and an iTLB miss), which shows up as first-request latency.
+     *
+     * BU_PLUGIN_LOAD_PREFAULT finds the module's executable PT_LOAD segments
+     * with dl_iterate_phdr() and populates their page table entries right
+     * after loading (madvise(MADV_WILLNEED) plus MADV_POPULATE_READ where
+     * available, otherwise by touching each page).
+     *
+     * BU_PLUGIN_LOAD_HUGEPAGES additionally copies every 2 MiB-aligned range
+     * inside a text segment onto anonymous memory advised with MADV_HUGEPAGE,
+     * so transparent huge pages can back it. Only segments spanning a full
+     * aligned 2 MiB range are affected; smaller plugins are just prefaulted.
+     * The copy is made right after dlopen() returns, before the host calls
+     * into the module, and only when this load mapped it: a module that was
+     * already loaded (by another context, say) may be running and is only
+     * prefaulted. Do not use it for plugins whose constructors start
+     * threads that run the plugin's own code.
+     *
+     * Both flags are Linux-only and ignored (with an info log) elsewhere.
+     *
+     * BU_PLUGIN_LOAD_OUT_OF_PROCESS opens the plugin in the worker processes
+     * of bu_plugin_worker_pool_start() and registers proxies for its
+     * commands here (POSIX, default signature only; the load fails
+     * elsewhere). Set globally, it moves every later load out of process.
+     */
+    BU_PLUGIN_API void bu_plugin_set_load_flags(unsigned int flags);
+
+    /**
+     * bu_plugin_get_load_flags - Get the flags set by bu_plugin_set_load_flags().
+     */
+    BU_PLUGIN_API unsigned int bu_plugin_get_load_flags(void);
+
     /*
      * Type definitions for plugin commands.
      * Applications can define BU_PLUGIN_CMD_RET and BU_PLUGIN_CMD_ARGS before
@@ -479,6 +580,29 @@ extern "C" {
 #undef BU_PLUGIN_CMD_RET_IS_DEFAULT
 #undef BU_PLUGIN_CMD_ARGS_IS_DEFAULT
 
+    /*
+     * Signature names. One registry holds commands of several signatures,
+     * each tagged with the ID of its signature's name (see bu_plugin_sig_id).
+     * Names are compared after dropping parameter names and the whitespace
+     * between tokens, so "int (int argc, const char **argv)" and
+     * BU_PLUGIN_SIG_ARGV are the same signature, and "int()" is "int(void)".
+     * A parameter's last word counts as its name only when a type word
+     * comes before it and it does not continue a qualified or elaborated
+     * name: "ns::T", "const T" and "struct s" keep every word.
+     * BU_PLUGIN_CMD_SIGNATURE names the signature this file is compiled
+     * for; plugins report it to the host from BU_PLUGIN_DECLARE_MANIFEST.
+     * Define it before including this header if the parameter list holds
+     * something the comparison cannot see through, such as a function
+     * pointer or array parameter.
+     */
+#define BU_PLUGIN_SIG_VOID "int(void)"
+#define BU_PLUGIN_SIG_ARGV "int(int, const char**)"
+#define BU_PLUGIN_SIG_STR1(...) #__VA_ARGS__
+#define BU_PLUGIN_SIG_STR(...) BU_PLUGIN_SIG_STR1(__VA_ARGS__)
+#ifndef BU_PLUGIN_CMD_SIGNATURE
+#define BU_PLUGIN_CMD_SIGNATURE BU_PLUGIN_SIG_STR(BU_PLUGIN_CMD_RET) "(" BU_PLUGIN_SIG_STR(BU_PLUGIN_CMD_ARGS) ")"
+#endif
+
     /**
      * bu_plugin_cmd_impl - Function pointer type for a plugin command implementation.
      * This is a default implementation; the host can define its own typedef
@@ -490,6 +614,12 @@ extern "C" {
 #define BU_PLUGIN_CMD_IMPL_DEFINED
 #endif
 
+    /**
+     * bu_plugin_any_fn - A command implementation of any signature, as stored
+     * by the registry. Cast it back to the signature it was registered with.
+     */
+    typedef void (*bu_plugin_any_fn)(void);
+
     /**
      * bu_plugin_cmd - Descriptor for a single plugin command.
      */
@@ -498,6 +628,31 @@ extern "C" {
 	bu_plugin_cmd_impl impl;    /* Function pointer to implementation */
     } bu_plugin_cmd;
 
+    /**
+     * bu_plugin_cmd_batch_impl - Optional batched entry point of a command.
+     *
+     * Runs n invocations of the command in one call, in structure-of-arrays
+     * form: item i takes the i-th element of each input array and writes
+     * results[i]. For the default signature there are no inputs; with the
+     * argc/argv signature (BU_PLUGIN_CMD_ARGV_SIGNATURE) item i gets
+     * argcs[i] and argvs[i]. Other signatures define BU_PLUGIN_CMD_BATCH_ARGS
+     * themselves. Return 0 once every item has run; a non-zero return or an
+     * exception fails all n items. Declared per command in
+     * bu_plugin_manifest_v2.cmd_batch, next to the scalar impl.
+     *
+     * Only bu_plugin_cmd_run_batch() (and its _argv and context variants)
+     * calls it. Runs, submits and DAG nodes always use the scalar impl, one
+     * call each, however many calls of the command are queued.
+     */
+#ifndef BU_PLUGIN_CMD_BATCH_ARGS
+#if defined(BU_PLUGIN_CMD_ARGV_SIGNATURE)
+#define BU_PLUGIN_CMD_BATCH_ARGS size_t n, const int *argcs, const char **const *argvs, BU_PLUGIN_CMD_RET *results
+#else
+#define BU_PLUGIN_CMD_BATCH_ARGS size_t n, BU_PLUGIN_CMD_RET *results
+#endif
+#endif
+    typedef int (*bu_plugin_cmd_batch_impl)(BU_PLUGIN_CMD_BATCH_ARGS);
+
     /**
      * ABI version for bu_plugin_manifest. Increment when making breaking changes.
      */
@@ -521,6 +676,530 @@ extern "C" {
 	size_t struct_size;         /* Size of this struct, for forward compatibility */
     } bu_plugin_manifest;
 
+    /**
+     * Version of the bu_plugin_manifest_v2 extension fields.
+     */
+#define BU_PLUGIN_MANIFEST_EXT_VERSION 4
+
+    /*
+     * Per-command flags (bu_plugin_manifest_v2.cmd_flags, bu_plugin_cmd_set_flags).
+     */
+#define BU_PLUGIN_CMD_THREADSAFE  0x1u  /* May run concurrently with itself and other commands */
+#define BU_PLUGIN_CMD_PURE        0x2u  /* Result depends only on the arguments, no side effects (cacheable) */
+#define BU_PLUGIN_CMD_NOEXCEPT    0x4u  /* Never throws; called without an exception frame */
+
+    /**
+     * bu_plugin_init_fn - Plugin initialization hook.
+     * @return 0 on success, non-zero to reject the plugin.
+     *
+     * Called after the plugin's commands are registered, and only once every
+     * plugin it depends on has been registered and initialized.
+     */
+    typedef int (*bu_plugin_init_fn)(void);
+
+    /**
+     * bu_plugin_fini_fn - Plugin finalization hook, called by bu_plugin_shutdown()
+     * before the module is unloaded (reverse load order).
+     */
+    typedef void (*bu_plugin_fini_fn)(void);
+
+    /**
+     * bu_plugin_cmd_handle - Opaque, stable reference to a registry entry.
+     *
+     * A handle resolves a command name once; invoking through it skips the
+     * name hashing and registry lock. Handles stay valid for the life of the
+     * process: if the command is unregistered (e.g. by bu_plugin_shutdown())
+     * the handle resolves to NULL, and re-registering the same name revives it.
+     */
+    typedef struct bu_plugin_cmd_entry *bu_plugin_cmd_handle;
+
+    /**
+     * bu_plugin_allocator - Allocator vtable installed by the host.
+     *
+     * Every function receives ctx as its first argument. Blocks must be
+     * released through the same allocator that returned them.
+     *
+     *   - mem_alloc:   allocate size bytes (aligned like malloc), NULL on failure
+     *   - mem_realloc: resize a block (ptr may be NULL), NULL on failure
+     *   - mem_free:    release a block (ptr may be NULL)
+     *   - arena_push:  open an arena scope on the calling thread and return a
+     *                  mark for it; until the matching pop, mem_alloc on this
+     *                  thread may serve blocks from the arena
+     *   - arena_pop:   release every arena block allocated on this thread
+     *                  since the push that returned mark (inner scopes too)
+     *
+     * The default allocator serves arena scopes from a per-thread bump arena
+     * whose chunks are reused by later scopes and freed at thread exit;
+     * mem_free of an arena block is a no-op. Outside an arena scope it uses
+     * the system heap.
+     */
+    typedef struct bu_plugin_allocator {
+	size_t struct_size;         /* sizeof(bu_plugin_allocator) */
+	void *ctx;                  /* Passed to every function */
+	void *(*mem_alloc)(void *ctx, size_t size);
+	void *(*mem_realloc)(void *ctx, void *ptr, size_t size);
+	void (*mem_free)(void *ctx, void *ptr);
+	size_t (*arena_push)(void *ctx);
+	void (*arena_pop)(void *ctx, size_t mark);
+    } bu_plugin_allocator;
+
+    /**
+     * bu_plugin_host_stats - Registry statistics reported through the host services table.
+     */
+    typedef struct bu_plugin_host_stats {
+	size_t struct_size;         /* sizeof(bu_plugin_host_stats) */
+	size_t cmd_count;           /* Registered commands */
+	size_t module_count;        /* Retained plugin modules */
+	int frozen;                 /* Non-zero after bu_plugin_freeze() */
+    } bu_plugin_host_stats;
+
+    /**
+     * bu_plugin_call_ctx - Cancellation token and deadline for command calls.
+     *
+     * A host creates a context per request and makes it current on the
+     * calling thread with bu_plugin_call_ctx_set_current(). Work started
+     * while it is current carries it along: synchronous runs, batches
+     * (including their ranges on executor workers), DAG runs and submitted
+     * commands, which keep it for the life of the job. Once the context is
+     * cancelled or its deadline passes, work that has not started yet is
+     * skipped with BU_PLUGIN_CALL_CANCELLED, and running commands can stop
+     * early by polling bu_plugin_call_ctx_stopped() on
+     * bu_plugin_call_ctx_current() (or the host services call_ctx_current).
+     *
+     * Deadlines are enforced by a host timer thread that sets stop, so a
+     * poll is a single load and never reads the clock. Treat the struct as
+     * read-only; the host allocates it with private state after stop.
+     */
+    typedef struct bu_plugin_call_ctx {
+	volatile int stop;          /* Non-zero once cancelled or past the deadline */
+    } bu_plugin_call_ctx;
+
+#define BU_PLUGIN_CALL_CANCELLED   -5   /* Status: the call's context had stopped before it started */
+
+    /**
+     * bu_plugin_call_ctx_stopped - Cheap inline poll for long-running commands.
+     * @return Non-zero if ctx is non-NULL and cancelled or past its deadline.
+     */
+    static inline int bu_plugin_call_ctx_stopped(const bu_plugin_call_ctx *ctx) {
+#if defined(__GNUC__) || defined(__clang__)
+	return ctx && __atomic_load_n(&ctx->stop, __ATOMIC_RELAXED) != 0;
+#else
+	return ctx && ctx->stop != 0;
+#endif
+    }
+
+    /**
+     * bu_plugin_call_ctx_create - New context, not cancelled and without a deadline.
+     * @return The context (release with bu_plugin_call_ctx_destroy()), or NULL.
+     */
+    BU_PLUGIN_API bu_plugin_call_ctx *bu_plugin_call_ctx_create(void);
+
+    /**
+     * bu_plugin_call_ctx_destroy - Release the caller's reference.
+     *
+     * Queued jobs that carry the context keep it alive until they finish.
+     */
+    BU_PLUGIN_API void bu_plugin_call_ctx_destroy(bu_plugin_call_ctx *ctx);
+
+    /**
+     * bu_plugin_call_ctx_cancel - Stop the context. Safe from any thread; cannot be undone.
+     */
+    BU_PLUGIN_API void bu_plugin_call_ctx_cancel(bu_plugin_call_ctx *ctx);
+
+    /**
+     * bu_plugin_call_ctx_set_deadline - Stop the context timeout_us from now.
+     * @param timeout_us  Microseconds from now; 0 removes a pending deadline.
+     * @return 0 on success, -1 if ctx is NULL.
+     */
+    BU_PLUGIN_API int bu_plugin_call_ctx_set_deadline(bu_plugin_call_ctx *ctx, unsigned long long timeout_us);
+
+    /**
+     * bu_plugin_call_ctx_current - The context of the calling thread, or NULL.
+     *
+     * Inside a command this is the context the command was started under.
+     */
+    BU_PLUGIN_API bu_plugin_call_ctx *bu_plugin_call_ctx_current(void);
+
+    /**
+     * bu_plugin_call_ctx_set_current - Make ctx (or NULL) current on the calling thread.
+     * @return The previously current context, to be restored by the caller.
+     *
+     * The thread does not hold a reference: keep ctx alive while it is current.
+     */
+    BU_PLUGIN_API bu_plugin_call_ctx *bu_plugin_call_ctx_set_current(bu_plugin_call_ctx *ctx);
+
+    /**
+     * Command output.
+     *
+     * Commands write their text output with bu_plugin_output_write() and
+     * bu_plugin_output_printf() (or the host services table's output_write
+     * and output_printf) instead of stdio. Output written while a command
+     * runs goes into a per-thread buffer; when the outermost invocation on
+     * the thread returns, the whole buffer is handed to the output writer in
+     * one call. Concurrent commands therefore never interleave their output
+     * and take the stdio lock once per invocation, not once per write.
+     * Output written outside any invocation goes to the writer directly.
+     *
+     * The host decides where output ends up:
+     *   - flush:   the writer set with bu_plugin_set_output_writer() (stdout
+     *              by default) receives each invocation's output
+     *   - capture: while a bu_plugin_output buffer is current on a thread
+     *              (bu_plugin_output_set_current()), output of commands run
+     *              on that thread accumulates in it for the caller
+     *   - discard: with bu_plugin_output_discard as the writer, output is
+     *              dropped without being buffered
+     *
+     * Batches flush once per range rather than once per item. Hosts with
+     * their own run wrappers bracket each call with bu_plugin_output_begin()
+     * and bu_plugin_output_end().
+     */
+    typedef void (*bu_plugin_output_fn)(void *user, const char *data, size_t len);
+
+    /**
+     * bu_plugin_output - Growable capture buffer owned by the host.
+     */
+    typedef struct bu_plugin_output bu_plugin_output;
+
+    /**
+     * bu_plugin_output_write - Append len bytes to the running command's output.
+     */
+    BU_PLUGIN_API void bu_plugin_output_write(const char *data, size_t len);
+
+    /**
+     * bu_plugin_output_printf - Append formatted text to the running command's output.
+     */
+    BU_PLUGIN_API void bu_plugin_output_printf(const char *fmt, ...);
+
+    /**
+     * bu_plugin_set_output_writer - Receive the output of each invocation.
+     * @param fn    Called with one invocation's complete output; NULL restores
+     *              the default, which writes to stdout. Must not throw.
+     * @param user  Passed to fn.
+     *
+     * Set this before running commands; fn may be called from any thread
+     * that runs commands, concurrently.
+     */
+    BU_PLUGIN_API void bu_plugin_set_output_writer(bu_plugin_output_fn fn, void *user);
+
+    /**
+     * bu_plugin_output_discard - Output writer that drops everything.
+     *
+     * Installed with bu_plugin_set_output_writer(), it also stops output
+     * from being buffered at all.
+     */
+    BU_PLUGIN_API void bu_plugin_output_discard(void *user, const char *data, size_t len);
+
+    /**
+     * bu_plugin_output_create - New, empty capture buffer.
+     * @return The buffer (release with bu_plugin_output_destroy()), or NULL.
+     */
+    BU_PLUGIN_API bu_plugin_output *bu_plugin_output_create(void);
+
+    /**
+     * bu_plugin_output_destroy - Release a capture buffer. It must not be current on any thread.
+     */
+    BU_PLUGIN_API void bu_plugin_output_destroy(bu_plugin_output *out);
+
+    /**
+     * bu_plugin_output_data - Captured bytes.
+     * @param len  Receives the number of bytes (may be NULL).
+     * @return The bytes, NUL-terminated; valid until the buffer next changes.
+     */
+    BU_PLUGIN_API const char *bu_plugin_output_data(const bu_plugin_output *out, size_t *len);
+
+    /**
+     * bu_plugin_output_clear - Empty a capture buffer, keeping its capacity.
+     */
+    BU_PLUGIN_API void bu_plugin_output_clear(bu_plugin_output *out);
+
+    /**
+     * bu_plugin_output_set_current - Capture output on the calling thread into out (or stop, with NULL).
+     * @return The previously current buffer, to be restored by the caller.
+     *
+     * Only commands run on the calling thread are captured; batch ranges and
+     * jobs on executor workers use the writer.
+     */
+    BU_PLUGIN_API bu_plugin_output *bu_plugin_output_set_current(bu_plugin_output *out);
+
+    /**
+     * bu_plugin_output_begin - Open an invocation's output scope on the calling thread.
+     *
+     * For hosts with their own run wrappers; the bu_plugin_cmd_* run paths
+     * do this themselves. Scopes nest, and only the outermost one flushes.
+     */
+    BU_PLUGIN_API void bu_plugin_output_begin(void);
+
+    /**
+     * bu_plugin_output_end - Close the scope opened by bu_plugin_output_begin(), flushing if outermost.
+     */
+    BU_PLUGIN_API void bu_plugin_output_end(void);
+
+    /**
+     * Record channels.
+     *
+     * A bu_plugin_channel is a bounded single-producer, single-consumer ring
+     * of fixed-layout records, tagged with a record type name and size so
+     * both ends can check they agree on the layout. The producer reserves
+     * slots, writes records into them in place and commits them; the
+     * consumer reads them in place and releases them, so records are never
+     * copied or serialized on the way through.
+     *
+     * A full ring blocks the producer (backpressure) and an empty one blocks
+     * the consumer; each side yields a few times before sleeping.
+     * bu_plugin_channel_close() ends the stream: the consumer drains what
+     * was committed and then gets no more records.
+     * bu_plugin_channel_cancel() aborts it from either side: both ends stop
+     * waiting and get no more slots. A wait also ends when the calling
+     * thread's call context stops.
+     *
+     * Commands find their channels with bu_plugin_channel_input() and
+     * bu_plugin_channel_output(); bu_plugin_pipeline_run() sets them for
+     * each stage of a pipeline.
+     */
+    typedef struct bu_plugin_channel bu_plugin_channel;
+
+    /**
+     * bu_plugin_channel_create - New, empty channel.
+     * @param type         Record type name (copied); e.g. "myapp.segment".
+     * @param record_size  Size of one record in bytes (slots are malloc-aligned at this stride).
+     * @param capacity     Records the ring holds; rounded up to a power of two.
+     * @return The channel (release with bu_plugin_channel_destroy()), or NULL on invalid arguments.
+     */
+    BU_PLUGIN_API bu_plugin_channel *bu_plugin_channel_create(const char *type, size_t record_size, size_t capacity);
+
+    /**
+     * bu_plugin_channel_destroy - Release a channel. Neither end may still be using it.
+     */
+    BU_PLUGIN_API void bu_plugin_channel_destroy(bu_plugin_channel *ch);
+
+    /**
+     * bu_plugin_channel_check - Does ch carry records of this type and size?
+     * @return 0 if it does, -1 otherwise (or if ch is NULL).
+     */
+    BU_PLUGIN_API int bu_plugin_channel_check(const bu_plugin_channel *ch, const char *type, size_t record_size);
+
+    /**
+     * bu_plugin_channel_type - The channel's record type name and (optionally) record size.
+     */
+    BU_PLUGIN_API const char *bu_plugin_channel_type(const bu_plugin_channel *ch, size_t *record_size);
+
+    /**
+     * bu_plugin_channel_reserve - Producer: wait for free slots.
+     * @param max  Most slots wanted.
+     * @param got  Receives the number of contiguous slots returned (1..max), or 0.
+     * @return The first slot, or NULL once the channel is closed or cancelled
+     *         (or the call context stops).
+     */
+    BU_PLUGIN_API void *bu_plugin_channel_reserve(bu_plugin_channel *ch, size_t max, size_t *got);
+
+    /**
+     * bu_plugin_channel_commit - Producer: publish the first n reserved slots.
+     */
+    BU_PLUGIN_API void bu_plugin_channel_commit(bu_plugin_channel *ch, size_t n);
+
+    /**
+     * bu_plugin_channel_peek - Consumer: wait for records.
+     * @param max  Most records wanted.
+     * @param got  Receives the number of contiguous records returned (1..max), or 0.
+     * @return The first record, or NULL at the end of the stream or once cancelled.
+     */
+    BU_PLUGIN_API const void *bu_plugin_channel_peek(bu_plugin_channel *ch, size_t max, size_t *got);
+
+    /**
+     * bu_plugin_channel_release - Consumer: done with the first n peeked records.
+     */
+    BU_PLUGIN_API void bu_plugin_channel_release(bu_plugin_channel *ch, size_t n);
+
+    /**
+     * bu_plugin_channel_push - Producer: copy one record in.
+     * @return 0 on success, -1 if the channel is closed or cancelled.
+     */
+    BU_PLUGIN_API int bu_plugin_channel_push(bu_plugin_channel *ch, const void *record);
+
+    /**
+     * bu_plugin_channel_pop - Consumer: copy one record out.
+     * @return 1 with a record, 0 at the end of the stream, -1 if cancelled.
+     */
+    BU_PLUGIN_API int bu_plugin_channel_pop(bu_plugin_channel *ch, void *record);
+
+    /**
+     * bu_plugin_channel_close - Producer: end of stream. Records already committed are still delivered.
+     */
+    BU_PLUGIN_API void bu_plugin_channel_close(bu_plugin_channel *ch);
+
+    /**
+     * bu_plugin_channel_cancel - Abort the stream from either end, waking both.
+     */
+    BU_PLUGIN_API void bu_plugin_channel_cancel(bu_plugin_channel *ch);
+
+    /**
+     * bu_plugin_channel_cancelled - Non-zero once the channel has been cancelled.
+     */
+    BU_PLUGIN_API int bu_plugin_channel_cancelled(const bu_plugin_channel *ch);
+
+    typedef struct bu_plugin_channel_stats {
+	size_t struct_size;                 /* sizeof(bu_plugin_channel_stats), set by the caller */
+	size_t capacity;                    /* Slots in the ring */
+	unsigned long long records;         /* Records committed */
+	unsigned long long producer_waits;  /* Times the producer slept on a full ring */
+	unsigned long long consumer_waits;  /* Times the consumer slept on an empty ring */
+    } bu_plugin_channel_stats;
+
+    /**
+     * bu_plugin_channel_get_stats - Snapshot the channel's counters.
+     * @return 0 on success, -1 if ch or stats is NULL.
+     */
+    BU_PLUGIN_API int bu_plugin_channel_get_stats(const bu_plugin_channel *ch, bu_plugin_channel_stats *stats);
+
+    /**
+     * bu_plugin_channel_set_current - Make in and out the calling thread's channels (either may be NULL).
+     */
+    BU_PLUGIN_API void bu_plugin_channel_set_current(bu_plugin_channel *in, bu_plugin_channel *out);
+
+    /**
+     * bu_plugin_channel_input - The running command's input channel, or NULL.
+     */
+    BU_PLUGIN_API bu_plugin_channel *bu_plugin_channel_input(void);
+
+    /**
+     * bu_plugin_channel_output - The running command's output channel, or NULL.
+     */
+    BU_PLUGIN_API bu_plugin_channel *bu_plugin_channel_output(void);
+
+    /**
+     * Version of the bu_plugin_host_services table.
+     */
+#define BU_PLUGIN_HOST_SERVICES_VERSION 6
+
+    /**
+     * bu_plugin_host_services - Host functions handed to a plugin at load time.
+     *
+     * A plugin that only calls the host through this table needs no link-time
+     * dependency on the host library, and its calls into the host are plain
+     * indirect calls instead of PLT stubs bound by the dynamic linker.
+     *
+     * Fields are appended in later versions; check struct_size before using
+     * a field added after the version the plugin was built against.
+     * cmd_invoke is only meaningful for the default command signature and is
+     * NULL otherwise; custom signatures call through cmd_handle_impl().
+     */
+    typedef struct bu_plugin_host_services {
+	size_t struct_size;         /* sizeof(bu_plugin_host_services) */
+	unsigned int version;       /* BU_PLUGIN_HOST_SERVICES_VERSION */
+
+	/* Logging */
+	void (*log_printf)(int level, const char *fmt, ...);
+
+	/* Lookup */
+	int (*cmd_exists)(const char *name);
+	bu_plugin_cmd_impl (*cmd_get)(const char *name);
+	bu_plugin_cmd_handle (*cmd_lookup)(const char *name);
+	bu_plugin_cmd_impl (*cmd_handle_impl)(bu_plugin_cmd_handle h);
+	const char *(*cmd_handle_name)(bu_plugin_cmd_handle h);
+
+	/* Handle invocation */
+#ifdef BU_PLUGIN_DEFAULT_SIGNATURE
+	int (*cmd_invoke)(bu_plugin_cmd_handle h, BU_PLUGIN_CMD_RET *result);
+#else
+	void (*cmd_invoke_unavailable)(void);   /* Always NULL */
+#endif
+
+	/* Allocation through the host's installed allocator (see bu_plugin_set_allocator) */
+	void *(*mem_alloc)(size_t size);
+	void *(*mem_realloc)(void *ptr, size_t size);
+	void (*mem_free)(void *ptr);
+
+	/* Stats */
+	void (*stats)(bu_plugin_host_stats *out);
+
+	/* Version 2: the host's installed allocator (see bu_plugin_get_allocator) */
+	const bu_plugin_allocator *(*allocator)(void);
+
+	/* Version 3: the running command's call context (see bu_plugin_call_ctx_current) */
+	bu_plugin_call_ctx *(*call_ctx_current)(void);
+
+	/* Version 4: command output (see bu_plugin_output_write) */
+	void (*output_write)(const char *data, size_t len);
+	void (*output_printf)(const char *fmt, ...);
+
+	/* Version 5: record channels (see bu_plugin_channel_create) */
+	bu_plugin_channel *(*channel_input)(void);
+	bu_plugin_channel *(*channel_output)(void);
+	int (*channel_check)(const bu_plugin_channel *ch, const char *type, size_t record_size);
+	void *(*channel_reserve)(bu_plugin_channel *ch, size_t max, size_t *got);
+	void (*channel_commit)(bu_plugin_channel *ch, size_t n);
+	const void *(*channel_peek)(bu_plugin_channel *ch, size_t max, size_t *got);
+	void (*channel_release)(bu_plugin_channel *ch, size_t n);
+	void (*channel_close)(bu_plugin_channel *ch);
+
+	/* Version 6: commands of other signatures (see bu_plugin_cmd_lookup_sig) */
+	unsigned int (*sig_id)(const char *signature);
+	bu_plugin_cmd_handle (*cmd_lookup_sig)(const char *name, unsigned int sig);
+	bu_plugin_any_fn (*cmd_handle_fn)(bu_plugin_cmd_handle h, unsigned int sig);
+    } bu_plugin_host_services;
+
+    /**
+     * bu_plugin_bind_fn - Plugin entry point receiving the host services table.
+     * @param host  The host's services table; valid for the life of the process.
+     * @return 0 on success, non-zero to reject the plugin.
+     *
+     * Called once the manifest has been validated, before the plugin's
+     * commands are registered and before its init hook.
+     */
+    typedef int (*bu_plugin_bind_fn)(const bu_plugin_host_services *host);
+
+    /**
+     * BU_PLUGIN_HAS_FIELD - True if a struct of the given type whose
+     * struct_size is size is large enough to carry field f.
+     *
+     * A bind hook checks the newest table field it calls, so it also binds
+     * to hosts with an older, shorter table:
+     *   if (!BU_PLUGIN_HAS_FIELD(bu_plugin_host_services, host->struct_size, output_printf)) return 1;
+     */
+#ifdef __cplusplus
+#define BU_PLUGIN_HAS_FIELD(type, size, f) \
+    ((size) >= offsetof(type, f) + sizeof(static_cast<const type *>(nullptr)->f))
+#else
+#define BU_PLUGIN_HAS_FIELD(type, size, f) \
+    ((size) >= offsetof(type, f) + sizeof(((const type *)0)->f))
+#endif
+
+    /**
+     * bu_plugin_manifest_v2 - Versioned manifest extension.
+     *
+     * The base manifest is embedded as the first member, so a v2 plugin passes
+     * the same abi_version and struct_size checks as a v1 plugin; the loader
+     * recognizes the extension because base.struct_size covers the extension
+     * fields. Set base.struct_size to sizeof(bu_plugin_manifest_v2) and export
+     * the manifest with BU_PLUGIN_DECLARE_MANIFEST_V2.
+     *
+     * Fields appended in later extension versions are only read when
+     * base.struct_size is large enough to contain them, so older v2 plugins
+     * keep loading.
+     *
+     *   - depends: NULL-terminated list of plugin_name values that must be
+     *              registered and initialized before this plugin (may be NULL)
+     *   - init:    optional hook run after registration, in dependency order
+     *   - fini:    optional hook run at shutdown, in reverse order
+     *   - bind:    optional entry point receiving the host services table
+     *              (extension version 2)
+     *   - cmd_flags: optional array of BU_PLUGIN_CMD_* flags, one per entry
+     *              of base.commands (extension version 3)
+     *   - cmd_batch: optional array of batched entry points, one per entry of
+     *              base.commands, NULL where a command has none (extension
+     *              version 4)
+     */
+    typedef struct bu_plugin_manifest_v2 {
+	bu_plugin_manifest base;        /* v1 manifest, struct_size = sizeof(bu_plugin_manifest_v2) */
+	unsigned int ext_version;       /* BU_PLUGIN_MANIFEST_EXT_VERSION */
+	const char * const *depends;    /* NULL-terminated dependency plugin names, or NULL */
+	bu_plugin_init_fn init;         /* Optional initialization hook */
+	bu_plugin_fini_fn fini;         /* Optional finalization hook */
+	bu_plugin_bind_fn bind;         /* Optional host services entry point */
+	const unsigned int *cmd_flags;  /* Optional flags parallel to base.commands, or NULL */
+	const bu_plugin_cmd_batch_impl *cmd_batch;  /* Optional batched entry points parallel to base.commands, or NULL */
+    } bu_plugin_manifest_v2;
+
     /*
      * Registry APIs - Declared here, implemented in the host library.
      */
@@ -569,6 +1248,8 @@ extern "C" {
      * Commands are iterated in alphabetical order by name for stable output.
      * The callback should return 0 to continue, non-zero to stop iteration.
      *
+     * Commands registered with another signature than the host's are skipped.
+     *
      * Implementation note: Uses a snapshot pattern to minimize lock duration.
      * The registry is locked only while copying command names, then unlocked
      * before sorting and calling the callback.
@@ -593,42 +1274,503 @@ extern "C" {
     BU_PLUGIN_API void bu_plugin_cmd_foreach(bu_plugin_cmd_callback callback, void *user_data);
 
     /**
-     * bu_plugin_init - Initialize the plugin registry (call once at startup).
-     * @return 0 on success.
-     *
-     * Note: All registry operations are thread-safe, protected by a mutex.
+     * bu_plugin_cmd_lookup - Resolve a command name to a stable handle.
+     * @param name  The command name (whitespace is trimmed).
+     * @return The handle, or NULL if no such command is registered. A
+     *         command of another signature gets a handle too, but only
+     *         bu_plugin_cmd_handle_fn() resolves it.
      */
-    BU_PLUGIN_API int bu_plugin_init(void);
+    BU_PLUGIN_API bu_plugin_cmd_handle bu_plugin_cmd_lookup(const char *name);
 
-#ifdef BU_PLUGIN_DEFAULT_SIGNATURE
     /**
-     * bu_plugin_cmd_run - Safely run a registered command by name.
-     * @param name  The command name to run.
-     * @param result  Output parameter for the command's return value (can be NULL).
-     * @return 0 on success, -1 if command not found, -2 if command threw an exception.
-     *
-     * On C++ builds, this function wraps the command execution in try/catch
-     * to safely handle exceptions. The exception is logged but not re-thrown.
-     *
-     * Note: This function is only available when using the default command signature
-     * int (*)(void). For custom signatures, applications should provide their own
-     * wrapper functions tailored to the specific signature (see alt_sig_cmd_run in
-     * the alternative signature test for an example).
+     * bu_plugin_cmd_handle_impl - Current implementation behind a handle.
+     * @return The function pointer, or NULL if h is NULL, the command is
+     *         no longer registered or it has another signature.
      */
-    BU_PLUGIN_API int bu_plugin_cmd_run(const char *name, BU_PLUGIN_CMD_RET *result);
-#endif /* BU_PLUGIN_DEFAULT_SIGNATURE */
+    BU_PLUGIN_API bu_plugin_cmd_impl bu_plugin_cmd_handle_impl(bu_plugin_cmd_handle h);
 
     /**
-     * bu_plugin_load - Load a dynamic plugin from a shared library path.
-     * @param path  Path to the shared library (.so, .dylib, .dll).
-     * @return Number of commands registered from the plugin, or -1 on error.
-     *
-     * This function:
-     *   - Enforces the path-allow policy (if set via bu_plugin_set_path_allow)
-     *   - Windows: Converts UTF-8 path to UTF-16; uses LoadLibraryExW with safer flags
+     * bu_plugin_cmd_handle_name - Command name a handle refers to.
+     * @return The trimmed name, or NULL if h is NULL.
+     */
+    BU_PLUGIN_API const char *bu_plugin_cmd_handle_name(bu_plugin_cmd_handle h);
+
+    /**
+     * bu_plugin_cmd_handle_flags - BU_PLUGIN_CMD_* flags of the command behind a handle.
+     * @return The flags, or 0 if h is NULL or the command is no longer registered.
+     */
+    BU_PLUGIN_API unsigned int bu_plugin_cmd_handle_flags(bu_plugin_cmd_handle h);
+
+    /**
+     * bu_plugin_cmd_set_flags - Set a registered command's BU_PLUGIN_CMD_* flags.
+     * @return 0 on success, -1 if the command is not registered or the
+     *         registry is frozen.
+     *
+     * Plugins declare flags in bu_plugin_manifest_v2.cmd_flags; this is for
+     * built-in commands. Re-registering a name clears its flags.
+     */
+    BU_PLUGIN_API int bu_plugin_cmd_set_flags(const char *name, unsigned int flags);
+
+    /**
+     * bu_plugin_cmd_get_flags - A registered command's flags (0 if unknown).
+     */
+    BU_PLUGIN_API unsigned int bu_plugin_cmd_get_flags(const char *name);
+
+    /**
+     * bu_plugin_cmd_set_batch - Attach a batched entry point to a registered command.
+     * @param batch  The entry point, or NULL to remove it.
+     * @return 0 on success, -1 if the command is not registered or the
+     *         registry is frozen.
+     *
+     * Plugins declare batched entry points in bu_plugin_manifest_v2.cmd_batch;
+     * this is for built-in commands. Re-registering a name removes it.
+     */
+    BU_PLUGIN_API int bu_plugin_cmd_set_batch(const char *name, bu_plugin_cmd_batch_impl batch);
+
+    /**
+     * bu_plugin_cmd_get_batch - A registered command's batched entry point (NULL if none).
+     */
+    BU_PLUGIN_API bu_plugin_cmd_batch_impl bu_plugin_cmd_get_batch(const char *name);
+
+    /*
+     * Commands of other signatures.
+     *
+     * Every registry entry is tagged with a signature ID. ID 0
+     * (BU_PLUGIN_SIG_NATIVE) is the signature the host library was built
+     * for; its commands are the ones bu_plugin_cmd_get(), bu_plugin_cmd_foreach(),
+     * the handle accessors and the run functions see. A plugin built for
+     * another signature (it reports BU_PLUGIN_CMD_SIGNATURE) loads into the
+     * same registry with that signature's ID, and so do commands registered
+     * with bu_plugin_cmd_register_sig(). Their names share the one namespace
+     * (first wins), bu_plugin_cmd_exists() and bu_plugin_cmd_count() include
+     * them, and they are reached through typed lookups, which hand out the
+     * implementation only to a caller asking for the signature it was
+     * registered with. bu_plugin::invoke<Sig>() and BU_PLUGIN_DEFINE_INVOKE
+     * wrappers resolve them that way, so one host runs void-style and
+     * argc/argv-style plugins side by side.
+     *
+     * Plugins built before signatures were reported are taken to have the
+     * host's signature.
+     */
+#define BU_PLUGIN_SIG_NATIVE 0u
+
+    /**
+     * bu_plugin_sig_id - ID of a signature name, assigned on first use.
+     * @param signature  The signature, e.g. BU_PLUGIN_SIG_ARGV; NULL for the host's.
+     * @return The ID; BU_PLUGIN_SIG_NATIVE for the host's own signature.
+     *         IDs stay the same for the life of the process.
+     */
+    BU_PLUGIN_API unsigned int bu_plugin_sig_id(const char *signature);
+
+    /**
+     * bu_plugin_sig_name - Name of a signature ID, in compared form.
+     * @return The name, or NULL if no signature has that ID.
+     */
+    BU_PLUGIN_API const char *bu_plugin_sig_name(unsigned int sig);
+
+    /**
+     * bu_plugin_sig_cached - bu_plugin_sig_id() remembered in *slot.
+     * @param slot  Zero-initialized storage, typically a function-local static.
+     *
+     * Run wrappers call this to pay for the name comparison once.
+     */
+    static inline unsigned int bu_plugin_sig_cached(unsigned int *slot, const char *signature) {
+	unsigned int id;
+#if defined(__GNUC__) || defined(__clang__)
+	id = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+	if (id) return id - 1;
+	id = bu_plugin_sig_id(signature);
+	__atomic_store_n(slot, id + 1, __ATOMIC_RELEASE);
+#else
+	id = *slot;
+	if (id) return id - 1;
+	id = bu_plugin_sig_id(signature);
+	*slot = id + 1;
+#endif
+	return id;
+    }
+
+    /**
+     * bu_plugin_cmd_register_sig - Register a command of any signature.
+     * @param sig  The command's signature ID (from bu_plugin_sig_id()).
+     * @param fn   The implementation, cast to bu_plugin_any_fn.
+     * @return As bu_plugin_cmd_register(); -1 also if sig is unknown.
+     */
+    BU_PLUGIN_API int bu_plugin_cmd_register_sig(const char *name, unsigned int sig, bu_plugin_any_fn fn);
+
+    /**
+     * bu_plugin_cmd_lookup_sig - Typed bu_plugin_cmd_lookup().
+     * @return The handle, or NULL if the command is not registered or was
+     *         registered with another signature (logged as a warning).
+     */
+    BU_PLUGIN_API bu_plugin_cmd_handle bu_plugin_cmd_lookup_sig(const char *name, unsigned int sig);
+
+    /**
+     * bu_plugin_cmd_handle_sig - Signature ID of the command behind a handle
+     * (BU_PLUGIN_SIG_NATIVE if h is NULL).
+     */
+    BU_PLUGIN_API unsigned int bu_plugin_cmd_handle_sig(bu_plugin_cmd_handle h);
+
+    /**
+     * bu_plugin_cmd_handle_fn - Typed bu_plugin_cmd_handle_impl().
+     * @return The implementation, or NULL if h is NULL, the command is no
+     *         longer registered or its signature is not sig.
+     */
+    BU_PLUGIN_API bu_plugin_any_fn bu_plugin_cmd_handle_fn(bu_plugin_cmd_handle h, unsigned int sig);
+
+    /*
+     * Result cache for commands flagged BU_PLUGIN_CMD_PURE.
+     *
+     * Once the host gives the cache a capacity, bu_plugin_cmd_run(),
+     * bu_plugin_cmd_invoke(), submitted commands and bu_plugin_cmd_run_line()
+     * return the cached result of a pure command called with arguments seen
+     * before instead of running it again. Entries are keyed by the command's
+     * implementation and its argument bytes: none for the default signature,
+     * the argv words for the argc/argv signature. Because the key is the
+     * implementation pointer, names registered with the same implementation
+     * share their entries. Run wrappers for other signatures call
+     * bu_plugin_memo_lookup() before the command and bu_plugin_memo_store()
+     * after it, with the argument bytes and the token from the miss.
+     *
+     * The cache is split into 16 shards by key hash, each with its own lock
+     * and CLOCK eviction. Invalidation is global: every entry, of every
+     * command, is dropped when any command is unregistered
+     * (bu_plugin_shutdown(), a plugin whose init failed) or gains or loses
+     * the PURE flag, and by bu_plugin_memo_clear(), so a reloaded plugin
+     * never sees results of the code it replaced. A call that was running
+     * across an invalidation stores nothing. Failed calls are not cached,
+     * and output a command wrote is not replayed on a hit.
+     */
+
+    /**
+     * bu_plugin_memo_stats - Counters reported by bu_plugin_memo_get_stats().
+     */
+    typedef struct bu_plugin_memo_stats {
+	size_t struct_size;             /* sizeof(bu_plugin_memo_stats), set by the caller */
+	size_t capacity;                /* Entries the cache can hold (0: disabled) */
+	size_t entries;                 /* Valid entries */
+	unsigned long long hits;
+	unsigned long long misses;
+	unsigned long long evictions;   /* Valid entries replaced to make room */
+	unsigned long long invalidations; /* Times every entry was dropped */
+    } bu_plugin_memo_stats;
+
+    /**
+     * bu_plugin_memo_set_capacity - Size the result cache.
+     * @param entries  Maximum entries, rounded up to a multiple of the shard
+     *                 count; 0 (the default) disables the cache.
+     *
+     * Drops every entry. Counters are kept.
+     */
+    BU_PLUGIN_API void bu_plugin_memo_set_capacity(size_t entries);
+
+    /**
+     * bu_plugin_memo_token - The cache epoch a miss saw, for the store that follows it.
+     *
+     * 0 is never a valid token.
+     */
+    typedef unsigned long long bu_plugin_memo_token;
+
+    /**
+     * bu_plugin_memo_lookup - Look up a cached result for a run wrapper.
+     * @param h       The command.
+     * @param args    Bytes identifying the arguments (may be NULL if len is 0).
+     * @param len     Number of bytes.
+     * @param result  Output, the cached result on a hit (can be NULL).
+     * @param token   Output (can be NULL): on a miss, the token to pass to
+     *                bu_plugin_memo_store() once the command has run; 0 on
+     *                a hit or when nothing can be cached.
+     * @return 1 on a hit, 0 on a miss or if the cache is disabled or the
+     *         command is not registered or not flagged BU_PLUGIN_CMD_PURE.
+     *
+     * Call it before running the command: the token records the cache's
+     * epoch at that point.
+     */
+    BU_PLUGIN_API int bu_plugin_memo_lookup(bu_plugin_cmd_handle h, const void *args, size_t len,
+	    BU_PLUGIN_CMD_RET *result, bu_plugin_memo_token *token);
+
+    /**
+     * bu_plugin_memo_store - Cache the result of a successful call after a miss.
+     * @param result  The result to cache (NULL stores nothing). Taken by
+     *                pointer so that a void BU_PLUGIN_CMD_RET still declares.
+     * @param token   The token bu_plugin_memo_lookup() returned for the miss.
+     *
+     * Ignored unless the cache is enabled, the command is registered and
+     * flagged BU_PLUGIN_CMD_PURE, and the cache has not been invalidated
+     * since the lookup that produced token, so a result computed by code
+     * that has since been replaced is never served.
+     */
+    BU_PLUGIN_API void bu_plugin_memo_store(bu_plugin_cmd_handle h, const void *args, size_t len,
+	    const BU_PLUGIN_CMD_RET *result, bu_plugin_memo_token token);
+
+    /**
+     * bu_plugin_memo_clear - Drop every cached result.
+     */
+    BU_PLUGIN_API void bu_plugin_memo_clear(void);
+
+    /**
+     * bu_plugin_memo_get_stats - Read the cache counters.
+     * @return 0 on success, -1 if stats is NULL.
+     */
+    BU_PLUGIN_API int bu_plugin_memo_get_stats(bu_plugin_memo_stats *stats);
+
+    /**
+     * bu_plugin_get_host_services - The host services table passed to plugin bind hooks.
+     */
+    BU_PLUGIN_API const bu_plugin_host_services *bu_plugin_get_host_services(void);
+
+    /**
+     * bu_plugin_set_allocator - Install the allocator handed to commands and plugins.
+     * @param alloc  The allocator (must outlive its use), or NULL for the default.
+     *               Rejected if any function is NULL or struct_size is too small.
+     * @return 0 on success, -1 if alloc is invalid.
+     *
+     * Install the allocator before loading plugins and running commands;
+     * blocks allocated through the previous allocator must be freed through it.
+     */
+    BU_PLUGIN_API int bu_plugin_set_allocator(const bu_plugin_allocator *alloc);
+
+    /**
+     * bu_plugin_get_allocator - The installed allocator (never NULL).
+     */
+    BU_PLUGIN_API const bu_plugin_allocator *bu_plugin_get_allocator(void);
+
+    /**
+     * bu_plugin_set_cmd_arena - Scope command allocations to the command call.
+     * @param enable  Non-zero to wrap each bu_plugin_cmd_run() and
+     *                bu_plugin_cmd_invoke() call in arena_push/arena_pop.
+     *
+     * With the default allocator, everything a command allocates through
+     * bu_plugin_get_allocator() is then released in one step when it returns,
+     * and its individual frees cost nothing. Commands must not keep such
+     * blocks past their return while this is enabled. Disabled by default.
+     */
+    BU_PLUGIN_API void bu_plugin_set_cmd_arena(int enable);
+
+    /**
+     * bu_plugin_cmd_fail - Fail the running command without throwing.
+     * @param msg  Logged with the command name (NULL for a generic message).
+     *
+     * The command returns normally after calling this; the run wrapper
+     * discards its result and reports -2, as for a thrown exception. This is
+     * how commands fail in a host built without exceptions
+     * (BU_PLUGIN_NO_EXCEPTIONS) and how C commands fail anywhere.
+     */
+    BU_PLUGIN_API void bu_plugin_cmd_fail(const char *msg);
+
+    /**
+     * bu_plugin_cmd_take_failure - Collect a failure recorded by bu_plugin_cmd_fail().
+     * @return The message recorded on this thread since the last call, or
+     *         NULL if none. Valid until the next command runs on the thread.
+     *
+     * Hosts with their own run wrappers call this after each command and
+     * treat a non-NULL return as a failed call.
+     */
+    BU_PLUGIN_API const char *bu_plugin_cmd_take_failure(void);
+
+    /**
+     * bu_plugin_init - Initialize the plugin registry (call once at startup).
+     * @return 0 on success.
+     *
+     * Note: All registry operations are thread-safe, protected by a mutex.
+     */
+    BU_PLUGIN_API int bu_plugin_init(void);
+
+    /**
+     * Largest number of items bu_plugin_cmd_run_batch() hands to one call of
+     * a batched entry point.
+     */
+#define BU_PLUGIN_BATCH_CHUNK 1024
+
+#ifdef BU_PLUGIN_DEFAULT_SIGNATURE
+    /**
+     * bu_plugin_cmd_run - Safely run a registered command by name.
+     * @param name  The command name to run.
+     * @param result  Output parameter for the command's return value (can be NULL).
+     * @return 0 on success, -1 if command not found, -2 if command threw an exception
+     *         or called bu_plugin_cmd_fail(), BU_PLUGIN_CALL_CANCELLED if the
+     *         current call context had stopped.
+     *
+     * On C++ builds, this function wraps the command execution in try/catch
+     * to safely handle exceptions. The exception is logged but not re-thrown.
+     * Commands flagged BU_PLUGIN_CMD_NOEXCEPT are called directly, and a
+     * host built without exceptions never has a try block.
+     *
+     * Note: This function is only available when using the default command signature
+     * int (*)(void). For custom signatures, use bu_plugin::invoke() from C++ or
+     * BU_PLUGIN_DEFINE_INVOKE from C, or write a wrapper tailored to the
+     * signature (see alt_sig_cmd_run in the alternative signature test).
+     */
+    BU_PLUGIN_API int bu_plugin_cmd_run(const char *name, BU_PLUGIN_CMD_RET *result);
+
+    /**
+     * bu_plugin_cmd_invoke - Run a command through a handle from bu_plugin_cmd_lookup().
+     * @param h       The command handle.
+     * @param result  Output parameter for the command's return value (can be NULL).
+     * @return 0 on success, -1 if h is NULL or no longer registered,
+     *         -2 if the command threw an exception, BU_PLUGIN_CALL_CANCELLED
+     *         if the current call context had stopped.
+     *
+     * Same semantics as bu_plugin_cmd_run() without the name lookup.
+     */
+    BU_PLUGIN_API int bu_plugin_cmd_invoke(bu_plugin_cmd_handle h, BU_PLUGIN_CMD_RET *result);
+
+    /**
+     * bu_plugin_cmd_run_batch - Run a list of independent commands.
+     * @param names    Command names (entries may repeat).
+     * @param n        Number of entries.
+     * @param results  Output, results[i] is set when status[i] is 0 (can be NULL).
+     * @param status   Output per item: 0, -1 not found, -2 threw,
+     *                 BU_PLUGIN_CALL_CANCELLED not started (can be NULL).
+     * @return Number of items that failed, or -1 if names is NULL.
+     *
+     * Equivalent to calling bu_plugin_cmd_run() on each name in order, but
+     * all names are resolved in one pass under one lock, the items run
+     * inside one exception frame (a throwing item is recorded and the batch
+     * continues with the next one) and failures are summarized in one log
+     * line per kind instead of one per item.
+     *
+     * If the executor is running, every resolved command is flagged
+     * BU_PLUGIN_CMD_THREADSAFE and the batch is large enough, the items are
+     * split into contiguous ranges run on the workers and the caller, so
+     * they may then run concurrently and out of order. Batches issued from
+     * an executor worker always run serially on that worker.
+     *
+     * Consecutive items naming the same command that has a batched entry
+     * point (bu_plugin_cmd_batch_impl) are passed to it in chunks of up to
+     * BU_PLUGIN_BATCH_CHUNK, one call per chunk instead of one per item. If
+     * the entry point fails, every item of that chunk gets status -2.
+     *
+     * The current call context is checked before each item or chunk; once
+     * it stops, the remaining items are not started.
+     */
+    BU_PLUGIN_API int bu_plugin_cmd_run_batch(const char *const *names, size_t n, BU_PLUGIN_CMD_RET *results, int *status);
+#endif /* BU_PLUGIN_DEFAULT_SIGNATURE */
+
+#ifdef BU_PLUGIN_CMD_ARGV_SIGNATURE
+    /**
+     * bu_plugin_cmd_run_batch_argv - bu_plugin_cmd_run_batch() for the
+     * argc/argv command signature.
+     * @param argcs  argcs[i] is passed to item i.
+     * @param argvs  argvs[i] is passed to item i.
+     *
+     * Define BU_PLUGIN_CMD_ARGV_SIGNATURE along with
+     *   #define BU_PLUGIN_CMD_RET int
+     *   #define BU_PLUGIN_CMD_ARGS int argc, const char **argv
+     * to declare it. Same semantics as bu_plugin_cmd_run_batch().
+     */
+    BU_PLUGIN_API int bu_plugin_cmd_run_batch_argv(const char *const *names, size_t n, const int *argcs,
+	    const char **const *argvs, BU_PLUGIN_CMD_RET *results, int *status);
+
+    /**
+     * bu_plugin_cmd_run_line - Run a command line such as "reverse abc def".
+     * @param line    The first word names the command and the rest become
+     *                its argc/argv, split as by bu_plugin_line_word(). Not
+     *                modified; anything after a newline is ignored.
+     * @param result  Output parameter for the command's return value (can be NULL).
+     * @return 0 on success, -1 if line is NULL, empty or malformed or the
+     *         command is not registered, -2 if the command threw an
+     *         exception, BU_PLUGIN_CALL_CANCELLED if the current call
+     *         context had stopped.
+     *
+     * The line is copied into a per-thread buffer and split there, and argv
+     * (NULL-terminated) is built in a per-thread array. Both are reused, so
+     * once they have grown to the longest line seen, parsing and dispatch
+     * allocate nothing. A command may call bu_plugin_cmd_run_line() itself;
+     * each nesting level has its own buffers.
+     */
+    BU_PLUGIN_API int bu_plugin_cmd_run_line(const char *line, BU_PLUGIN_CMD_RET *result);
+#endif /* BU_PLUGIN_CMD_ARGV_SIGNATURE */
+
+    /*
+     * BU_PLUGIN_DEFINE_INVOKE - Generate run wrappers for a custom signature in C.
+     *
+     *   BU_PLUGIN_DEFINE_INVOKE(my_run, int, (int argc, const char **argv), (argc, argv))
+     *
+     * defines
+     *   static inline int my_run(bu_plugin_cmd_handle h, int *result, int argc, const char **argv);
+     *   static inline int my_run_name(const char *name, int *result, int argc, const char **argv);
+     *   static inline unsigned int my_run_sig(void);   (the signature's ID)
+     *
+     * with the bu_plugin_cmd_run() status convention: -1 if the command is not
+     * registered, -2 if it called bu_plugin_cmd_fail(), BU_PLUGIN_CALL_CANCELLED
+     * if the current call context had stopped. The invocation's output is
+     * flushed in one piece. params is the parenthesized parameter list and args
+     * the matching argument names; the signature must return a value and take
+     * at least one argument. C code cannot throw, so there is no exception
+     * handling, and pure commands are not cached (C++ hosts use
+     * bu_plugin::invoke()).
+     *
+     * ret_type and params also name the signature: the wrappers run commands
+     * registered as ret_type params, whatever the host's own signature is,
+     * and treat commands of other signatures as not registered.
+     */
+#define BU_PLUGIN_UNPAREN(...) __VA_ARGS__
+#define BU_PLUGIN_DEFINE_INVOKE(fname, ret_type, params, args) \
+    static inline unsigned int fname##_sig(void) { \
+	static unsigned int bu_sig_; \
+	return bu_plugin_sig_cached(&bu_sig_, BU_PLUGIN_SIG_STR(ret_type) BU_PLUGIN_SIG_STR(params)); \
+    } \
+    static inline int fname(bu_plugin_cmd_handle bu_h_, ret_type *bu_result_, BU_PLUGIN_UNPAREN params) { \
+	ret_type (*bu_fn_) params = (ret_type (*) params)bu_plugin_cmd_handle_fn(bu_h_, fname##_sig()); \
+	ret_type bu_ret_; \
+	const char *bu_what_; \
+	if (!bu_fn_) { \
+	    bu_plugin_logf(BU_LOG_ERR, "Command '%s' not found", bu_h_ ? bu_plugin_cmd_handle_name(bu_h_) : "(null handle)"); \
+	    return -1; \
+	} \
+	if (bu_plugin_call_ctx_stopped(bu_plugin_call_ctx_current())) return BU_PLUGIN_CALL_CANCELLED; \
+	bu_plugin_output_begin(); \
+	bu_ret_ = bu_fn_ args; \
+	bu_plugin_output_end(); \
+	bu_what_ = bu_plugin_cmd_take_failure(); \
+	if (bu_what_) { \
+	    bu_plugin_logf(BU_LOG_ERR, "Command '%s' failed: %s", bu_plugin_cmd_handle_name(bu_h_), bu_what_); \
+	    return -2; \
+	} \
+	if (bu_result_) *bu_result_ = bu_ret_; \
+	return 0; \
+    } \
+    static inline int fname##_name(const char *bu_name_, ret_type *bu_result_, BU_PLUGIN_UNPAREN params) { \
+	bu_plugin_cmd_handle bu_h_ = bu_plugin_cmd_lookup_sig(bu_name_, fname##_sig()); \
+	if (!bu_h_) { \
+	    bu_plugin_logf(BU_LOG_ERR, "Command '%s' not found", bu_name_ ? bu_name_ : "(null)"); \
+	    return -1; \
+	} \
+	return fname(bu_h_, bu_result_, BU_PLUGIN_UNPAREN args); \
+    }
+
+    /**
+     * bu_plugin_line_word - Split the next word off a command line, in place.
+     * @param cursor  Position in a writable line; advanced past the word.
+     * @param word    Output, the word (set when 1 is returned).
+     * @return 1 if a word was split off, 0 at the end of the line (or if
+     *         cursor is NULL), -1 on an unterminated quote.
+     *
+     * Words are separated by blanks. '...' quotes literally, "..." quotes
+     * with \" and \\ escapes, a backslash elsewhere escapes the next
+     * character and a word starting with # comments out the rest of the
+     * line. The line ends at a NUL or a newline. Quotes are removed and the
+     * word is NUL-terminated inside the line itself (a word never outgrows
+     * its source), so words are views into the caller's buffer and nothing
+     * is allocated. The terminator after the last word may be overwritten.
+     */
+    BU_PLUGIN_API int bu_plugin_line_word(char **cursor, const char **word);
+
+    /**
+     * bu_plugin_load - Load a dynamic plugin from a shared library path.
+     * @param path  Path to the shared library (.so, .dylib, .dll).
+     * @return Number of commands registered from the plugin, or -1 on error.
+     *
+     * This function:
+     *   - Enforces the path-allow policy (if set via bu_plugin_set_path_allow)
+     *   - Windows: Converts UTF-8 path to UTF-16; uses LoadLibraryExW with safer flags
      *   - POSIX: Clears dlerror before dlsym for accurate error reporting
      *   - Validates manifest abi_version and struct_size
      *   - Detects and logs duplicate command names within a manifest
+     *   - For v2 manifests, fails if a dependency is not loaded yet and runs
+     *     the init hook after registration (the plugin is unloaded and its
+     *     commands removed if init fails)
      *
      * Note: Plugins are kept loaded for the lifetime of the process. There is
      * currently no bu_plugin_unload() function. This is intentional for simplicity
@@ -637,514 +1779,6947 @@ extern "C" {
      */
     BU_PLUGIN_API int bu_plugin_load(const char *path);
 
-    /* Additional optional APIs (handles retained for lifetime, optional unload) */
-    BU_PLUGIN_API size_t bu_plugin_loaded_modules_count(void);
-    BU_PLUGIN_API void   bu_plugin_shutdown(void);
+    /*
+     * Symbol binding and visibility modes for bu_plugin_load_opts.
+     */
+#define BU_PLUGIN_BIND_NOW    0     /* RTLD_NOW: resolve every symbol at load (default) */
+#define BU_PLUGIN_BIND_LAZY   1     /* RTLD_LAZY: resolve functions on first call */
+#define BU_PLUGIN_VIS_LOCAL   0     /* RTLD_LOCAL: keep symbols out of the global scope (default) */
+#define BU_PLUGIN_VIS_GLOBAL  1     /* RTLD_GLOBAL: make symbols available to later loads */
+
+    /**
+     * bu_plugin_load_stats - Per-load timing breakdown filled by bu_plugin_load_ex().
+     *
+     * Times are in microseconds. Set struct_size to sizeof(bu_plugin_load_stats);
+     * only fields covered by struct_size are written.
+     */
+    typedef struct bu_plugin_load_stats {
+	size_t struct_size;         /* sizeof(bu_plugin_load_stats) */
+	int registered;             /* Return value of the load */
+	double open_us;             /* dlopen/LoadLibraryExW, including relocation and eager binding */
+	double resolve_us;          /* Manifest symbol lookup and validation */
+	double prefault_us;         /* BU_PLUGIN_LOAD_PREFAULT/HUGEPAGES work */
+	double register_us;         /* Command registration */
+	double init_us;             /* v2 init hook */
+	double total_us;            /* Whole call */
+    } bu_plugin_load_stats;
+
+    /**
+     * bu_plugin_load_opts - Options for bu_plugin_load_ex().
+     *
+     * Set struct_size to sizeof(bu_plugin_load_opts); fields beyond struct_size
+     * take their defaults, so a zero-initialized struct with struct_size set
+     * behaves like bu_plugin_load().
+     *
+     * POSIX:
+     *   - binding:    BU_PLUGIN_BIND_NOW or BU_PLUGIN_BIND_LAZY. Lazy binding
+     *                 skips resolving functions that are never called, which
+     *                 dominates load time for plugins with many undefined symbols.
+     *   - visibility: BU_PLUGIN_VIS_LOCAL or BU_PLUGIN_VIS_GLOBAL.
+     *   - nodelete:   RTLD_NODELETE; bu_plugin_shutdown()'s dlclose() then
+     *                 leaves the module mapped, so it is cheap and function
+     *                 pointers still held elsewhere stay valid.
+     *   - isolate:    load into a new link-map namespace with dlmopen(LM_ID_NEWLM)
+     *                 (glibc only, incompatible with BU_PLUGIN_VIS_GLOBAL).
+     *                 The plugin gets private copies of its dependencies,
+     *                 including the host library if it links against it.
+     *
+     * Windows:
+     *   - win_flags:  LoadLibraryExW dwFlags (e.g. LOAD_LIBRARY_SEARCH_* or
+     *                 LOAD_WITH_ALTERED_SEARCH_PATH). 0 uses the default
+     *                 LOAD_LIBRARY_SEARCH_DLL_LOAD_DIR | LOAD_LIBRARY_SEARCH_DEFAULT_DIRS.
+     *   - nodelete:   pins the module (GET_MODULE_HANDLE_EX_FLAG_PIN).
+     *   - binding, visibility and isolate have no Windows equivalent and are ignored.
+     *
+     * Everywhere:
+     *   - flags:      BU_PLUGIN_LOAD_* flags, OR'ed with bu_plugin_get_load_flags().
+     *   - stats:      optional timing breakdown output.
+     */
+    typedef struct bu_plugin_load_opts {
+	size_t struct_size;         /* sizeof(bu_plugin_load_opts) */
+	int binding;                /* BU_PLUGIN_BIND_* */
+	int visibility;             /* BU_PLUGIN_VIS_* */
+	int nodelete;               /* Non-zero for RTLD_NODELETE / pinned module */
+	int isolate;                /* Non-zero to load into a new link-map namespace */
+	unsigned int flags;         /* BU_PLUGIN_LOAD_* */
+	unsigned long win_flags;    /* LoadLibraryExW flags, 0 = default */
+	bu_plugin_load_stats *stats;    /* Optional timing output */
+    } bu_plugin_load_opts;
+
+    /**
+     * bu_plugin_load_ex - Load a dynamic plugin with explicit loader options.
+     * @param path  Path to the shared library.
+     * @param opts  Loader options, or NULL for the bu_plugin_load() defaults.
+     * @return Number of commands registered from the plugin, or -1 on error.
+     *
+     * Behaves like bu_plugin_load() otherwise (path policy, ABI checks,
+     * dependencies, init hook).
+     */
+    BU_PLUGIN_API int bu_plugin_load_ex(const char *path, const bu_plugin_load_opts *opts);
+
+    /**
+     * bu_plugin_load_graph - Load a set of plugins in dependency order.
+     * @param paths     Array of plugin paths.
+     * @param count     Number of entries in paths.
+     * @param nthreads  Worker threads to use (0 = hardware concurrency).
+     * @return Total number of commands registered, or -1 if the set was rejected.
+     *
+     * All plugins are opened and validated in parallel first. The dependency
+     * graph is then built from the plugin_name/depends fields of v2 manifests
+     * (v1 manifests have no dependencies). The whole set is rejected up front,
+     * before anything is registered, if any plugin fails to open, two plugins
+     * share a plugin_name, a dependency is neither in the set nor already
+     * loaded, or the graph contains a cycle (the cycle is logged).
+     *
+     * Otherwise each plugin is registered and its init hook run as soon as all
+     * of its dependencies have finished; independent branches run in parallel
+     * on the worker pool. If a plugin's init hook fails, the plugin is unloaded
+     * and every plugin depending on it is skipped. The critical-path time
+     * (the longest chain of open + register + init times) is logged at
+     * BU_LOG_INFO together with the wall-clock time.
+     *
+     * Duplicate command names across independent plugins follow the usual
+     * first-wins policy, but which plugin wins is not deterministic when the
+     * two are registered in parallel.
+     */
+    BU_PLUGIN_API int bu_plugin_load_graph(const char * const *paths, size_t count, unsigned int nthreads);
+
+    /* Additional optional APIs (handles retained for lifetime, optional unload) */
+    BU_PLUGIN_API size_t bu_plugin_loaded_modules_count(void);
+    BU_PLUGIN_API void   bu_plugin_shutdown(void);
+
+    /**
+     * bu_plugin_freeze - Make the registry read-only.
+     * @return 0 on success (also if already frozen).
+     *
+     * Copies the registry into a single contiguous open-addressing table.
+     * Afterwards bu_plugin_cmd_register() fails with -1, and lookups
+     * (exists, get, run, count, foreach, bu_plugin_cmd_lookup) read the
+     * table without taking the registry mutex or allocating. The handle of
+     * every command is created here, so a lookup after the freeze returns
+     * the same handle as one before it. Nothing on the lookup path writes to
+     * shared memory, so a process forked after the freeze keeps sharing the
+     * registry pages with its parent instead of copying them on first use.
+     *
+     * bu_plugin_shutdown() drops the frozen table.
+     */
+    BU_PLUGIN_API int bu_plugin_freeze(void);
+
+    /**
+     * bu_plugin_is_frozen - Check whether bu_plugin_freeze() has been called.
+     * @return 1 if the registry is frozen, 0 otherwise.
+     */
+    BU_PLUGIN_API int bu_plugin_is_frozen(void);
+
+    /*
+     * Executor - a built-in work-stealing thread pool.
+     *
+     * Each worker owns a deque: jobs posted from a worker go to the back of
+     * its own deque and it takes work from the back (LIFO, cache-warm);
+     * idle workers steal from the front of other workers' deques. Jobs
+     * posted from other threads are spread round-robin over the workers.
+     * Idle workers sleep until work arrives.
+     */
+
+    /**
+     * bu_plugin_job_fn - A unit of work for bu_plugin_exec_post().
+     */
+    typedef void (*bu_plugin_job_fn)(void *arg);
+
+    /**
+     * bu_plugin_exec_start - Start the executor.
+     * @param nworkers  Number of worker threads; 0 uses the hardware concurrency.
+     * @return 0 if started, 1 if it was already running (nworkers is ignored).
+     *
+     * Optional: the first post or submit starts the executor with the
+     * default worker count.
+     */
+    BU_PLUGIN_API int bu_plugin_exec_start(unsigned int nworkers);
+
+    /**
+     * bu_plugin_exec_workers - Number of executor workers (0 when stopped).
+     */
+    BU_PLUGIN_API unsigned int bu_plugin_exec_workers(void);
+
+    /**
+     * bu_plugin_exec_post - Run fn(arg) on an executor worker.
+     * @return 0 if queued, -1 if fn is NULL or the executor is stopping.
+     *
+     * Exceptions escaping fn are caught and logged. fn runs with the
+     * caller's current call context made current.
+     */
+    BU_PLUGIN_API int bu_plugin_exec_post(bu_plugin_job_fn fn, void *arg);
+
+    /**
+     * bu_plugin_exec_drain - Wait until every queued and running job has finished.
+     *
+     * @return 0, or -1 (logged, nothing waited for) when called from an
+     *         executor worker, whose own job could never finish.
+     *
+     * Jobs posted by running jobs are waited for too.
+     */
+    BU_PLUGIN_API int bu_plugin_exec_drain(void);
+
+    /**
+     * bu_plugin_exec_stop - Drain the executor and join its workers.
+     *
+     * bu_plugin_shutdown() calls this before running fini hooks and
+     * unloading modules. Posts, submits and batches racing a stop either
+     * finish before the drain or fail with -1; the stop waits for them.
+     */
+    BU_PLUGIN_API void bu_plugin_exec_stop(void);
+
+    /*
+     * Strands - serial queues on the executor.
+     *
+     * Jobs posted to a strand run one at a time, in posting order, on
+     * whichever worker is free; different strands run in parallel. A strand
+     * is a mutex and a queue, and holds no thread of its own.
+     *
+     * Each loaded plugin gets a strand named after its plugin_name. Plugin
+     * commands that are not flagged BU_PLUGIN_CMD_THREADSAFE are funneled
+     * through their plugin's strand (or through an explicit group set with
+     * bu_plugin_cmd_set_strand()) whenever they run on the executor:
+     * bu_plugin_cmd_submit(), the C++ submit() helpers, command DAGs and
+     * the coroutine layer. Thread-safe commands, and built-in commands
+     * without a group, run freely. Synchronous calls (bu_plugin_cmd_run,
+     * bu_plugin_cmd_invoke) are not affected.
+     */
+    typedef struct bu_plugin_strand bu_plugin_strand;
+
+    /**
+     * bu_plugin_strand_get - The strand with the given name, created on first use.
+     * @return The strand (valid for the life of the process), or NULL if
+     *         name is NULL or empty.
+     */
+    BU_PLUGIN_API bu_plugin_strand *bu_plugin_strand_get(const char *name);
+
+    /**
+     * bu_plugin_strand_name - Name of a strand (NULL if s is NULL).
+     */
+    BU_PLUGIN_API const char *bu_plugin_strand_name(const bu_plugin_strand *s);
+
+    /**
+     * bu_plugin_strand_post - Run fn(arg) on the executor, serialized with
+     * everything else posted to the strand.
+     * @return 0 if queued, -1 if s or fn is NULL or the executor is stopping.
+     */
+    BU_PLUGIN_API int bu_plugin_strand_post(bu_plugin_strand *s, bu_plugin_job_fn fn, void *arg);
+
+    /**
+     * bu_plugin_cmd_set_strand - Put a command in an explicit serialization group.
+     * @param name    Registered command name.
+     * @param strand  Strand name, or NULL to go back to the plugin's own
+     *                strand (none for built-in commands).
+     * @return 0 on success, -1 if the command is not registered.
+     *
+     * The group only applies while the command is not flagged
+     * BU_PLUGIN_CMD_THREADSAFE. Re-registering a name clears it.
+     */
+    BU_PLUGIN_API int bu_plugin_cmd_set_strand(const char *name, const char *strand);
+
+    /**
+     * bu_plugin_cmd_handle_strand - The strand a command runs on, or NULL if it runs freely.
+     */
+    BU_PLUGIN_API bu_plugin_strand *bu_plugin_cmd_handle_strand(bu_plugin_cmd_handle h);
+
+    /*
+     * Priority lanes - admission control for submitted commands.
+     *
+     * Every submitted command goes through one of three lanes. Each lane
+     * has a bound on the jobs waiting to start (capacity), a limit on the
+     * jobs it may have on the executor at once (max_running) and a policy
+     * for submissions that find it full. Jobs beyond max_running wait in
+     * the lane and are released in FIFO order as the lane's jobs finish, so
+     * a lane limited to fewer jobs than there are workers can never occupy
+     * the whole pool: e.g. capping BU_PLUGIN_LANE_BULK at workers - 1 keeps
+     * a worker free for interactive commands however many bulk commands
+     * are queued. Bulk jobs also go to the far end of a worker's deque, so
+     * a worker takes its other work first. All lanes start unbounded and
+     * unlimited.
+     */
+#define BU_PLUGIN_LANE_INTERACTIVE  0
+#define BU_PLUGIN_LANE_NORMAL       1   /* bu_plugin_cmd_submit() */
+#define BU_PLUGIN_LANE_BULK         2
+#define BU_PLUGIN_LANE_COUNT        3
+
+    /* What a submission to a full lane does */
+#define BU_PLUGIN_ADMIT_BLOCK       0   /* Wait for room (rejects on an executor worker) */
+#define BU_PLUGIN_ADMIT_REJECT      1   /* Fail with BU_PLUGIN_LANE_REJECTED */
+#define BU_PLUGIN_ADMIT_SHED        2   /* Drop the oldest job held in the lane (see bu_plugin_lane_configure) */
+
+#define BU_PLUGIN_LANE_REJECTED    -3   /* Submit result: the lane was full */
+#define BU_PLUGIN_LANE_SHED        -4   /* Completion status: dropped to make room */
+
+    /**
+     * Lane limits for bu_plugin_lane_configure().
+     */
+    typedef struct bu_plugin_lane_config {
+	size_t struct_size;             /* sizeof(bu_plugin_lane_config), set by the caller */
+	size_t capacity;                /* Max jobs waiting to start, 0 = unbounded */
+	unsigned int max_running;       /* Max jobs on the executor at once, 0 = unlimited */
+	int policy;                     /* BU_PLUGIN_ADMIT_* */
+    } bu_plugin_lane_config;
+
+    /**
+     * Lane metrics from bu_plugin_lane_get_stats().
+     *
+     * Wait time is from admission until the command starts running.
+     * Percentiles come from a log-linear histogram (within 12.5%).
+     */
+    typedef struct bu_plugin_lane_stats {
+	size_t struct_size;             /* sizeof(bu_plugin_lane_stats), set by the caller */
+	size_t depth;                   /* Jobs waiting to start */
+	size_t max_depth;               /* Highest depth seen */
+	size_t running;                 /* Jobs running */
+	unsigned long long admitted;
+	unsigned long long rejected;
+	unsigned long long shed;
+	unsigned long long completed;
+	double wait_mean_us;
+	double wait_p50_us;
+	double wait_p99_us;
+	double wait_max_us;
+    } bu_plugin_lane_stats;
+
+    /**
+     * bu_plugin_lane_configure - Set a lane's limits.
+     * @return 0 on success, -1 for an invalid lane, config or policy.
+     *
+     * New limits apply to later admissions and releases; jobs already on
+     * the executor are not affected.
+     *
+     * BU_PLUGIN_ADMIT_SHED drops only jobs the lane still holds back, never
+     * one already handed to the executor, so a bounded lane can shed only
+     * if max_running is set and below capacity: then a full lane always
+     * holds a job. A bounded SHED lane with max_running 0 or at least
+     * capacity is rejected. Right after max_running is lowered, jobs handed
+     * out under the old limit may fill the lane by themselves; a submission
+     * that finds nothing to shed is then rejected.
+     */
+    BU_PLUGIN_API int bu_plugin_lane_configure(int lane, const bu_plugin_lane_config *cfg);
+
+    /**
+     * bu_plugin_lane_get_stats - Snapshot a lane's metrics.
+     * @return 0 on success, -1 for an invalid lane or stats pointer.
+     */
+    BU_PLUGIN_API int bu_plugin_lane_get_stats(int lane, bu_plugin_lane_stats *stats);
+
+    /**
+     * bu_plugin_lane_reset_stats - Zero a lane's counters, histogram and high-water mark.
+     */
+    BU_PLUGIN_API void bu_plugin_lane_reset_stats(int lane);
+
+#ifdef BU_PLUGIN_DEFAULT_SIGNATURE
+    /**
+     * bu_plugin_cmd_done_fn - Completion callback for submitted commands.
+     * @param status  0 on success, -1 if the command was unregistered before
+     *                it ran, -2 if it threw (same codes as bu_plugin_cmd_run),
+     *                BU_PLUGIN_LANE_SHED if it was dropped from a full lane,
+     *                BU_PLUGIN_CALL_CANCELLED if its call context stopped
+     *                before it started.
+     * @param result  The command's return value (0 unless status is 0).
+     * @param user    The pointer passed to the submit call.
+     *
+     * Runs on the executor worker that ran the command.
+     */
+    typedef void (*bu_plugin_cmd_done_fn)(int status, BU_PLUGIN_CMD_RET result, void *user);
+
+    /**
+     * bu_plugin_cmd_submit - Run a command on the executor.
+     * @param h     Command handle from bu_plugin_cmd_lookup().
+     * @param done  Optional completion callback.
+     * @param user  Opaque pointer passed to done.
+     * @return 0 if queued, -1 if h is NULL or the executor is stopping
+     *         (done is not called).
+     *
+     * The job carries the calling thread's current call context (see
+     * bu_plugin_call_ctx) and is skipped if the context stops first. Each
+     * job is one call of the scalar impl: queued submits of a command are
+     * not merged into its batched entry point, so hosts with many calls of
+     * one command in hand should use bu_plugin_cmd_run_batch().
+     */
+    BU_PLUGIN_API int bu_plugin_cmd_submit(bu_plugin_cmd_handle h, bu_plugin_cmd_done_fn done, void *user);
+
+    /**
+     * bu_plugin_cmd_submit_lane - bu_plugin_cmd_submit() through a priority lane.
+     * @param lane  BU_PLUGIN_LANE_* (bu_plugin_cmd_submit uses BU_PLUGIN_LANE_NORMAL).
+     * @return 0 if admitted, -1 if h or lane is invalid or the executor is
+     *         stopping, BU_PLUGIN_LANE_REJECTED if the lane is full (done is
+     *         not called unless the job was admitted).
+     */
+    BU_PLUGIN_API int bu_plugin_cmd_submit_lane(bu_plugin_cmd_handle h, int lane, bu_plugin_cmd_done_fn done, void *user);
+
+    /**
+     * bu_plugin_cmd_submit_name - bu_plugin_cmd_submit() by command name.
+     * @return 0 if queued, -1 if the command is not registered or the
+     *         executor is stopping (done is not called).
+     */
+    BU_PLUGIN_API int bu_plugin_cmd_submit_name(const char *name, bu_plugin_cmd_done_fn done, void *user);
+
+    /*
+     * Command DAGs - a fixed graph of command invocations run on the executor.
+     *
+     * Nodes are commands (by name or handle), edges are "runs after"
+     * dependencies. A run dispatches each node to the executor as soon as
+     * all of its dependencies have succeeded. A node that fails (-1 or -2)
+     * cancels every node downstream of it; independent branches keep
+     * running. Nodes whose command has a strand (see bu_plugin_strand_get)
+     * are dispatched through it, so a non-thread-safe plugin's commands
+     * never overlap.
+     *
+     * A DAG may be run any number of times, but not concurrently with
+     * itself or while nodes are being added.
+     */
+    typedef struct bu_plugin_dag bu_plugin_dag;
+
+#define BU_PLUGIN_DAG_NOT_RUN    1      /* Node status before the first run */
+#define BU_PLUGIN_DAG_CANCELLED -3      /* Node status when a dependency failed */
+
+    /**
+     * Summary of the last bu_plugin_dag_run().
+     *
+     * The critical path is the longest chain of node run times through the
+     * graph: the wall time a run would take with unlimited workers.
+     */
+    typedef struct bu_plugin_dag_report {
+	size_t struct_size;             /* sizeof(bu_plugin_dag_report), set by the caller */
+	size_t nodes;
+	size_t succeeded;
+	size_t failed;                  /* Status -1 or -2 */
+	size_t cancelled;               /* Status BU_PLUGIN_DAG_CANCELLED */
+	double wall_us;                 /* Time from the start of the run until the last node finished */
+	double work_us;                 /* Sum of node run times */
+	double critical_us;             /* Sum of node run times along the critical path */
+	size_t critical_len;            /* Nodes on the critical path */
+    } bu_plugin_dag_report;
+
+    /**
+     * One node's outcome in the last bu_plugin_dag_run().
+     */
+    typedef struct bu_plugin_dag_node_report {
+	size_t struct_size;             /* sizeof(bu_plugin_dag_node_report), set by the caller */
+	const char *name;               /* Command name, owned by the DAG */
+	int status;                     /* 0, -1, -2, BU_PLUGIN_DAG_CANCELLED or BU_PLUGIN_DAG_NOT_RUN */
+	BU_PLUGIN_CMD_RET result;       /* The command's return value when status is 0 */
+	double start_us;                /* Relative to the start of the run */
+	double end_us;
+	int critical;                   /* Non-zero if the node is on the critical path */
+    } bu_plugin_dag_node_report;
+
+    /**
+     * bu_plugin_dag_create - Create an empty DAG.
+     */
+    BU_PLUGIN_API bu_plugin_dag *bu_plugin_dag_create(void);
+
+    /**
+     * bu_plugin_dag_destroy - Free a DAG (NULL is ignored).
+     */
+    BU_PLUGIN_API void bu_plugin_dag_destroy(bu_plugin_dag *dag);
+
+    /**
+     * bu_plugin_dag_add - Add a node running the named command.
+     * @return The node id (0, 1, ... in order of addition), or -1 on error.
+     *
+     * The name is resolved when the DAG runs, so the command does not have
+     * to be registered yet.
+     */
+    BU_PLUGIN_API int bu_plugin_dag_add(bu_plugin_dag *dag, const char *name);
+
+    /**
+     * bu_plugin_dag_add_handle - Add a node running the command behind a handle.
+     * @return The node id, or -1 on error.
+     */
+    BU_PLUGIN_API int bu_plugin_dag_add_handle(bu_plugin_dag *dag, bu_plugin_cmd_handle h);
+
+    /**
+     * bu_plugin_dag_depend - Make node run after dependency.
+     * @return 0 on success, -1 if either id is invalid or they are equal.
+     *
+     * Cycles are detected when the DAG runs.
+     */
+    BU_PLUGIN_API int bu_plugin_dag_depend(bu_plugin_dag *dag, int node, int dependency);
+
+    /**
+     * bu_plugin_dag_run - Run every node, in dependency order, and wait.
+     * @param report  Optional summary of the run.
+     * @return Number of nodes that failed or were cancelled, or -1 if the
+     *         DAG is NULL or has a cycle (the cycle is logged).
+     *
+     * Starts the executor if needed. Called from an executor worker, the
+     * nodes run one at a time on the calling thread instead, so the worker
+     * never blocks waiting for jobs queued behind it. The critical path is
+     * logged at BU_LOG_INFO. Nodes that have not started when the current
+     * call context stops are cancelled.
+     */
+    BU_PLUGIN_API int bu_plugin_dag_run(bu_plugin_dag *dag, bu_plugin_dag_report *report);
+
+    /**
+     * bu_plugin_dag_node_info - Outcome of one node in the last run.
+     * @return 0 on success, -1 if the DAG, node id or info is invalid.
+     */
+    BU_PLUGIN_API int bu_plugin_dag_node_info(const bu_plugin_dag *dag, int node, bu_plugin_dag_node_report *info);
+
+    /**
+     * bu_plugin_dag_critical_path - Node ids on the last run's critical path.
+     * @param nodes  Output array, first node first (can be NULL to query the length).
+     * @param max    Capacity of nodes.
+     * @return Length of the critical path (may exceed max).
+     */
+    BU_PLUGIN_API size_t bu_plugin_dag_critical_path(const bu_plugin_dag *dag, int *nodes, size_t max);
+
+    /**
+     * bu_plugin_pipeline_run - Run commands as concurrent stages connected by channels.
+     * @param names    Stage commands, in stream order.
+     * @param n        Number of stages.
+     * @param links    n + 1 channels: links[i] is the input of stage i and
+     *                 links[i + 1] its output. links[0] and links[n] may be
+     *                 NULL (a source or sink stage); the others must not be.
+     * @param results  Optional per-stage results.
+     * @param status   Optional per-stage status: 0, -1 (not found), -2 (threw)
+     *                 or BU_PLUGIN_CALL_CANCELLED.
+     * @return Number of stages that failed, or -1 if a command is not
+     *         registered or the arguments are invalid (nothing runs).
+     *
+     * Every stage runs on its own thread (the last on the caller's) with
+     * its links current as bu_plugin_channel_input() and
+     * bu_plugin_channel_output(), under the caller's call context. When a
+     * stage returns, its output is closed and its input cancelled, so the
+     * stage downstream sees the end of the stream and the one upstream stops
+     * producing. A stage that throws cancels every link. The caller closes
+     * links[0] once it has fed it; it may also be fed and closed in advance.
+     */
+    BU_PLUGIN_API int bu_plugin_pipeline_run(const char *const *names, size_t n, bu_plugin_channel *const *links,
+	    BU_PLUGIN_CMD_RET *results, int *status);
+#endif /* BU_PLUGIN_DEFAULT_SIGNATURE */
+
+#if !defined(_WIN32)
+    /**
+     * Request that makes bu_plugin_zygote_serve() return instead of forking.
+     */
+#define BU_PLUGIN_ZYGOTE_QUIT "!quit"
+
+    /**
+     * bu_plugin_zygote_fn - Body of a forked zygote worker.
+     * @param fd       Socket connected to the client that requested the worker.
+     * @param request  The request line sent by the client (without newline).
+     * @param user     The user pointer given to bu_plugin_zygote_serve().
+     * @return The worker's exit status.
+     */
+    typedef int (*bu_plugin_zygote_fn)(int fd, const char *request, void *user);
+
+    /**
+     * bu_plugin_zygote_serve - Run a fork server (POSIX only).
+     * @param socket_path  Unix domain socket path to listen on (replaced if present).
+     * @param fn           Worker body run in each forked child.
+     * @param user         Opaque pointer passed to fn.
+     * @return Number of workers spawned, or -1 if the socket could not be set up.
+     *
+     * Call this after bu_plugin_init(), the static registrations and every
+     * bu_plugin_load() the workers need; the registry is frozen first. The
+     * server then accepts connections, reads one newline-terminated request
+     * from each and forks a worker that runs fn(fd, request, user) and exits
+     * with its return value. The worker starts with every plugin loaded and
+     * every command registered. Exited workers are reaped by the server.
+     *
+     * The server returns when it receives BU_PLUGIN_ZYGOTE_QUIT, after
+     * waiting for outstanding workers and removing the socket.
+     */
+    BU_PLUGIN_API int bu_plugin_zygote_serve(const char *socket_path, bu_plugin_zygote_fn fn, void *user);
+
+    /**
+     * bu_plugin_zygote_spawn - Ask a fork server for a worker.
+     * @param socket_path  The server's socket path.
+     * @param request      Request line handed to the worker (must not contain '\n').
+     * @return A socket connected to the new worker, or -1 on error.
+     *
+     * The caller owns the returned descriptor; the worker's output can be
+     * read from it until EOF, which is reached when the worker exits.
+     * Sending BU_PLUGIN_ZYGOTE_QUIT stops the server instead (the returned
+     * descriptor then reaches EOF immediately).
+     */
+    BU_PLUGIN_API int bu_plugin_zygote_spawn(const char *socket_path, const char *request);
+
+#ifdef BU_PLUGIN_DEFAULT_SIGNATURE
+    /**
+     * bu_plugin_worker_pool_start - Start the out-of-process worker pool (POSIX only).
+     * @param workers  Number of worker processes (0 = 2).
+     * @return 0 on success, 1 if the pool is already running, -1 on error.
+     *
+     * Plugins loaded with BU_PLUGIN_LOAD_OUT_OF_PROCESS are not opened in
+     * this process: every worker opens them, and their commands are
+     * registered here as proxies that forward each call to a worker. A
+     * plugin that crashes then takes down only a worker; the calls it had
+     * in flight fail with status -2 and the worker is restarted with every
+     * pooled plugin loaded again.
+     *
+     * Each worker shares a memory region with this process holding 64 call
+     * slots and a lock-free ring of posted slot indices. A caller claims a
+     * slot, posts it, and spins briefly before sleeping on it (a futex on
+     * Linux); an idle worker spins on the ring the same way before sleeping,
+     * so back-to-back calls make the round trip without a system call. Only
+     * the status and the return value cross over, which is why the pool is
+     * limited to the default int(void) signature.
+     *
+     * Workers are forked by a small spawner process, itself forked from this
+     * process here. A fork() child inherits every mutex in the state it was
+     * in, so the pool must start while no other thread can hold one of
+     * this library's locks: it returns -1 if the executor, the call
+     * deadline timer or any other thread this library starts is running,
+     * and it must not be called while host threads are inside bu_plugin
+     * calls. Start it early, before bu_plugin_exec_start() or any
+     * submission. The first out-of-process load starts the pool if it is
+     * not running, under the same condition.
+     * Proxies are flagged BU_PLUGIN_CMD_THREADSAFE: calls from several
+     * threads are spread over the workers, and each worker runs one command
+     * at a time.
+     */
+    BU_PLUGIN_API int bu_plugin_worker_pool_start(unsigned int workers);
+
+    /**
+     * bu_plugin_worker_pool_stop - Stop the workers and unregister the proxies.
+     *
+     * No pooled command may be running. Called by bu_plugin_shutdown().
+     */
+    BU_PLUGIN_API void bu_plugin_worker_pool_stop(void);
+
+    typedef struct bu_plugin_worker_pool_stats {
+	size_t struct_size;             /* sizeof(bu_plugin_worker_pool_stats), set by the caller */
+	unsigned int workers;           /* Worker processes (0 if the pool is not running) */
+	size_t commands;                /* Proxies registered for pooled plugins */
+	unsigned long long calls;       /* Calls answered by a worker */
+	unsigned long long crashes;     /* Workers that died */
+	unsigned long long restarts;    /* Workers started again after dying */
+    } bu_plugin_worker_pool_stats;
+
+    /**
+     * bu_plugin_worker_pool_get_stats - Snapshot the pool's counters.
+     * @return 0 on success, -1 if stats is NULL.
+     */
+    BU_PLUGIN_API int bu_plugin_worker_pool_get_stats(bu_plugin_worker_pool_stats *stats);
+#endif /* BU_PLUGIN_DEFAULT_SIGNATURE */
+#endif /* !_WIN32 */
+
+    /*
+     * Registry contexts.
+     *
+     * A context is one registry: its commands with their flags, batched
+     * entry points, signatures, strands and handles, its frozen table, its
+     * loaded plugins, and the namespace whose "<ns>_plugin_info" and
+     * "<ns>_plugin_signature" symbols it loads plugins by. The logger,
+     * allocator, load policy, executor, lanes, strands, worker pool, output,
+     * channels, call contexts and result cache are one runtime shared by
+     * every context.
+     *
+     * Every function without a context argument acts on the calling
+     * thread's current context, which is the default context (namespace
+     * BU_PLUGIN_NAME of the host build) unless bu_plugin_ctx_set_current()
+     * made another one current. Each bu_plugin_ctx_* variant below makes
+     * its context current for the call, so a plugin's init and fini hooks
+     * and the commands it runs see that context too. Jobs, submitted
+     * commands, batch ranges, DAG nodes and pipeline stages run with the
+     * context that was current where they were started.
+     *
+     * Several libraries sharing one host build each create a context for
+     * their namespace instead of compiling their own copy of the
+     * implementation with their own BU_PLUGIN_NAME.
+     */
+    typedef struct bu_plugin_ctx bu_plugin_ctx;
+
+    /**
+     * bu_plugin_ctx_create - New empty context.
+     * @param ns  Plugin symbol namespace (an identifier), or NULL for the host's BU_PLUGIN_NAME.
+     * @return The context (free with bu_plugin_ctx_destroy()), or NULL if ns is not an identifier.
+     */
+    BU_PLUGIN_API bu_plugin_ctx *bu_plugin_ctx_create(const char *ns);
+
+    /**
+     * bu_plugin_ctx_destroy - Shut a context down and free it (NULL is ignored).
+     *
+     * Behaves like bu_plugin_ctx_shutdown(), then frees the context; its
+     * handles are invalid afterwards. It must not be current on any thread.
+     * The default context cannot be destroyed (use bu_plugin_shutdown()).
+     */
+    BU_PLUGIN_API void bu_plugin_ctx_destroy(bu_plugin_ctx *ctx);
+
+    /**
+     * bu_plugin_ctx_shutdown - Unload a context's plugins and clear its registry.
+     *
+     * Waits for queued executor work (bu_plugin_exec_drain()), then runs
+     * the context's fini hooks and unloads its modules in reverse load
+     * order, as bu_plugin_shutdown() does. Handles stay valid and resolve
+     * to nothing. Unlike bu_plugin_shutdown(), the shared runtime (executor,
+     * worker pool) keeps running. Must not be called from an executor worker.
+     */
+    BU_PLUGIN_API void bu_plugin_ctx_shutdown(bu_plugin_ctx *ctx);
+
+    /* bu_plugin_ctx_default - The context of the functions without a context argument */
+    BU_PLUGIN_API bu_plugin_ctx *bu_plugin_ctx_default(void);
+
+    /* bu_plugin_ctx_current - The calling thread's current context (never NULL) */
+    BU_PLUGIN_API bu_plugin_ctx *bu_plugin_ctx_current(void);
+
+    /**
+     * bu_plugin_ctx_set_current - Make ctx (NULL: the default) current on the calling thread.
+     * @return The previously current context, to be restored by the caller.
+     */
+    BU_PLUGIN_API bu_plugin_ctx *bu_plugin_ctx_set_current(bu_plugin_ctx *ctx);
+
+    /* bu_plugin_ctx_ns - The namespace a context loads plugins by */
+    BU_PLUGIN_API const char *bu_plugin_ctx_ns(const bu_plugin_ctx *ctx);
+
+    /*
+     * Context variants of the registry functions: each behaves exactly like
+     * the function without the ctx_ prefix, on ctx (NULL: the default
+     * context). Functions that take a handle need no variant, as a handle
+     * belongs to one context; bu_plugin_dag_add() and bu_plugin_pipeline_run()
+     * resolve names in the current context.
+     */
+    BU_PLUGIN_API int bu_plugin_ctx_cmd_register(bu_plugin_ctx *ctx, const char *name, bu_plugin_cmd_impl impl);
+    BU_PLUGIN_API int bu_plugin_ctx_cmd_register_sig(bu_plugin_ctx *ctx, const char *name, unsigned int sig, bu_plugin_any_fn fn);
+    BU_PLUGIN_API int bu_plugin_ctx_cmd_exists(bu_plugin_ctx *ctx, const char *name);
+    BU_PLUGIN_API bu_plugin_cmd_impl bu_plugin_ctx_cmd_get(bu_plugin_ctx *ctx, const char *name);
+    BU_PLUGIN_API size_t bu_plugin_ctx_cmd_count(bu_plugin_ctx *ctx);
+    BU_PLUGIN_API void bu_plugin_ctx_cmd_foreach(bu_plugin_ctx *ctx, bu_plugin_cmd_callback callback, void *user_data);
+    BU_PLUGIN_API bu_plugin_cmd_handle bu_plugin_ctx_cmd_lookup(bu_plugin_ctx *ctx, const char *name);
+    BU_PLUGIN_API bu_plugin_cmd_handle bu_plugin_ctx_cmd_lookup_sig(bu_plugin_ctx *ctx, const char *name, unsigned int sig);
+    BU_PLUGIN_API int bu_plugin_ctx_cmd_set_flags(bu_plugin_ctx *ctx, const char *name, unsigned int flags);
+    BU_PLUGIN_API unsigned int bu_plugin_ctx_cmd_get_flags(bu_plugin_ctx *ctx, const char *name);
+    BU_PLUGIN_API int bu_plugin_ctx_cmd_set_batch(bu_plugin_ctx *ctx, const char *name, bu_plugin_cmd_batch_impl batch);
+    BU_PLUGIN_API bu_plugin_cmd_batch_impl bu_plugin_ctx_cmd_get_batch(bu_plugin_ctx *ctx, const char *name);
+    BU_PLUGIN_API int bu_plugin_ctx_cmd_set_strand(bu_plugin_ctx *ctx, const char *name, const char *strand);
+#ifdef BU_PLUGIN_DEFAULT_SIGNATURE
+    BU_PLUGIN_API int bu_plugin_ctx_cmd_run(bu_plugin_ctx *ctx, const char *name, BU_PLUGIN_CMD_RET *result);
+    BU_PLUGIN_API int bu_plugin_ctx_cmd_run_batch(bu_plugin_ctx *ctx, const char *const *names, size_t n,
+	    BU_PLUGIN_CMD_RET *results, int *status);
+    BU_PLUGIN_API int bu_plugin_ctx_cmd_submit_name(bu_plugin_ctx *ctx, const char *name, bu_plugin_cmd_done_fn done, void *user);
+#endif
+#ifdef BU_PLUGIN_CMD_ARGV_SIGNATURE
+    BU_PLUGIN_API int bu_plugin_ctx_cmd_run_batch_argv(bu_plugin_ctx *ctx, const char *const *names, size_t n,
+	    const int *argcs, const char **const *argvs, BU_PLUGIN_CMD_RET *results, int *status);
+    BU_PLUGIN_API int bu_plugin_ctx_cmd_run_line(bu_plugin_ctx *ctx, const char *line, BU_PLUGIN_CMD_RET *result);
+#endif
+    BU_PLUGIN_API int bu_plugin_ctx_load(bu_plugin_ctx *ctx, const char *path);
+    BU_PLUGIN_API int bu_plugin_ctx_load_ex(bu_plugin_ctx *ctx, const char *path, const bu_plugin_load_opts *opts);
+    BU_PLUGIN_API int bu_plugin_ctx_load_graph(bu_plugin_ctx *ctx, const char * const *paths, size_t count, unsigned int nthreads);
+    BU_PLUGIN_API size_t bu_plugin_ctx_loaded_modules_count(bu_plugin_ctx *ctx);
+    BU_PLUGIN_API int bu_plugin_ctx_freeze(bu_plugin_ctx *ctx);
+    BU_PLUGIN_API int bu_plugin_ctx_is_frozen(bu_plugin_ctx *ctx);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#ifdef __cplusplus
+#include <stdexcept>
+#include <string>
+
+/*
+ * BU_PLUGIN_EXCEPTIONS is 1 when the including C++ code is compiled with
+ * exceptions. Built with -fno-exceptions (or BU_PLUGIN_NO_EXCEPTIONS
+ * defined), the implementation has no try/catch: a command must not throw
+ * and fails through bu_plugin_cmd_fail() instead. The future-based executor
+ * helpers are not available then.
+ */
+#if defined(BU_PLUGIN_NO_EXCEPTIONS) || (defined(__GNUC__) && !defined(__EXCEPTIONS)) || \
+    (defined(_MSC_VER) && !defined(_CPPUNWIND))
+#define BU_PLUGIN_EXCEPTIONS 0
+#else
+#define BU_PLUGIN_EXCEPTIONS 1
+#endif
+
+namespace bu_plugin {
+
+/* Error thrown by the C++ interfaces, carrying the bu_plugin_cmd_run() status (-1, -2 or BU_PLUGIN_CALL_CANCELLED) */
+class cmd_error : public std::runtime_error {
+public:
+    cmd_error(int status, const std::string &what) : std::runtime_error(what), status_(status) {}
+    int status() const { return status_; }
+private:
+    int status_;
+};
+
+/* What a non-zero bu_plugin_cmd_run() status means, for cmd_error */
+inline const char *status_message(int status) {
+    return status == -2 ? "command failed" :
+	status == BU_PLUGIN_CALL_CANCELLED ? "command was cancelled" : "command is not registered";
+}
+
+/* Make a call context current on this thread for a scope, restoring the previous one */
+class call_scope {
+public:
+    explicit call_scope(bu_plugin_call_ctx *ctx) : prev_(bu_plugin_call_ctx_set_current(ctx)) {}
+    ~call_scope() { bu_plugin_call_ctx_set_current(prev_); }
+    call_scope(const call_scope &) = delete;
+    call_scope &operator=(const call_scope &) = delete;
+private:
+    bu_plugin_call_ctx *prev_;
+};
+
+/* Make a registry context current on this thread for a scope, restoring the previous one */
+class ctx_scope {
+public:
+    explicit ctx_scope(bu_plugin_ctx *ctx) : prev_(bu_plugin_ctx_set_current(ctx)) {}
+    ~ctx_scope() { bu_plugin_ctx_set_current(prev_); }
+    ctx_scope(const ctx_scope &) = delete;
+    ctx_scope &operator=(const ctx_scope &) = delete;
+private:
+    bu_plugin_ctx *prev_;
+};
+
+} /* namespace bu_plugin */
+#endif /* __cplusplus */
+
+#if defined(__cplusplus) && defined(BU_PLUGIN_DEFAULT_SIGNATURE) && BU_PLUGIN_EXCEPTIONS
+#include <functional>
+#include <future>
+#include <memory>
+
+/*
+ * C++ interface to the executor.
+ *
+ * submit() returns a std::future for the command's result; a command that
+ * was unregistered before it ran or that threw makes the future throw
+ * bu_plugin::cmd_error. The continuation overload calls fn(status, result)
+ * on the worker instead.
+ */
+namespace bu_plugin {
+
+namespace detail {
+inline void future_done(int status, BU_PLUGIN_CMD_RET result, void *user) {
+    std::unique_ptr<std::promise<BU_PLUGIN_CMD_RET> > p(static_cast<std::promise<BU_PLUGIN_CMD_RET> *>(user));
+    if (status == 0) {
+	p->set_value(result);
+    } else {
+	p->set_exception(std::make_exception_ptr(cmd_error(status, status_message(status))));
+    }
+}
+
+inline void continuation_done(int status, BU_PLUGIN_CMD_RET result, void *user) {
+    std::unique_ptr<std::function<void(int, BU_PLUGIN_CMD_RET)> > fn(
+	static_cast<std::function<void(int, BU_PLUGIN_CMD_RET)> *>(user));
+    (*fn)(status, result);
+}
+} /* namespace detail */
+
+/* Submit h; the future yields its result or throws cmd_error */
+inline std::future<BU_PLUGIN_CMD_RET> submit(bu_plugin_cmd_handle h) {
+    std::unique_ptr<std::promise<BU_PLUGIN_CMD_RET> > p(new std::promise<BU_PLUGIN_CMD_RET>());
+    std::future<BU_PLUGIN_CMD_RET> f = p->get_future();
+    if (bu_plugin_cmd_submit(h, detail::future_done, p.get()) != 0) {
+	throw cmd_error(-1, "command could not be submitted");
+    }
+    p.release();
+    return f;
+}
+
+inline std::future<BU_PLUGIN_CMD_RET> submit(const char *name) {
+    bu_plugin_cmd_handle h = bu_plugin_cmd_lookup(name);
+    if (!h) throw cmd_error(-1, std::string("command not found: ") + (name ? name : "(null)"));
+    return submit(h);
+}
+
+/* Submit h and call fn(status, result) on the worker when it completes */
+inline void submit(bu_plugin_cmd_handle h, std::function<void(int, BU_PLUGIN_CMD_RET)> fn) {
+    std::unique_ptr<std::function<void(int, BU_PLUGIN_CMD_RET)> > cb(
+	new std::function<void(int, BU_PLUGIN_CMD_RET)>(std::move(fn)));
+    if (bu_plugin_cmd_submit(h, detail::continuation_done, cb.get()) != 0) {
+	throw cmd_error(-1, "command could not be submitted");
+    }
+    cb.release();
+}
+
+inline void submit(const char *name, std::function<void(int, BU_PLUGIN_CMD_RET)> fn) {
+    bu_plugin_cmd_handle h = bu_plugin_cmd_lookup(name);
+    if (!h) throw cmd_error(-1, std::string("command not found: ") + (name ? name : "(null)"));
+    submit(h, std::move(fn));
+}
+
+} /* namespace bu_plugin */
+#endif /* __cplusplus && BU_PLUGIN_DEFAULT_SIGNATURE && BU_PLUGIN_EXCEPTIONS */
+
+#ifdef __cplusplus
+#include <exception>
+#include <type_traits>
+#include <utility>
+
+/*
+ * Generic run wrapper for any command signature.
+ *
+ *   int n = bu_plugin::invoke<int(int, const char **)>("sum", argc, argv);
+ *
+ * invoke<Sig>() runs a command given by name, handle or resolved
+ * bu_plugin::cmd with the semantics of bu_plugin_cmd_run(), whatever
+ * BU_PLUGIN_CMD_RET and BU_PLUGIN_CMD_ARGS are: status -1 if the command is
+ * not registered (or has another signature than Sig), -2 if it throws or
+ * calls bu_plugin_cmd_fail(), BU_PLUGIN_CALL_CANCELLED if the current call
+ * context has stopped. Its output is flushed in one piece, commands flagged
+ * BU_PLUGIN_CMD_NOEXCEPT are called without a try block, and results of
+ * pure commands of the host's signature are cached when it takes no
+ * arguments (wrappers that can key arguments call bu_plugin_memo_lookup()
+ * themselves). The arguments are forwarded to the command as given.
+ *
+ * Sig is matched against the signature the command was registered with
+ * through bu_plugin::signature<Sig>, which knows BU_PLUGIN_CMD_RET(
+ * BU_PLUGIN_CMD_ARGS), int() and int(int, const char **); specialize it
+ * for other signatures:
+ *
+ *   template <> struct bu_plugin::signature<double(double)> {
+ *       static const char *name() { return "double(double)"; }
+ *   };
+ *
+ * The error policy, the second template argument, decides how a failure
+ * reaches the caller:
+ *   - throw_on_error (default): return the result, throw cmd_error
+ *   - return_status:            return a call_result with status and value
+ *   - unchecked:                the bare call through the implementation;
+ *                               nothing is checked, scoped or reported
+ *
+ * Through a resolved cmd, the unchecked policy compiles to the same code as
+ * calling the function pointer directly.
+ */
+namespace bu_plugin {
+
+/* Status and value of a call under the return_status policy */
+template <typename R>
+struct call_result {
+    int status;     /* bu_plugin_cmd_run() convention */
+    R value;        /* Only meaningful when status is 0 */
+};
+
+/* A void command has only a status */
+template <>
+struct call_result<void> {
+    int status;
+};
+
+struct throw_on_error {};
+struct return_status {};
+struct unchecked {};
+
+/* signature<Sig>::name() - The registry's name for Sig (see bu_plugin_sig_id) */
+template <typename Sig>
+struct signature {
+    static_assert(std::is_same<Sig, BU_PLUGIN_CMD_RET(BU_PLUGIN_CMD_ARGS)>::value,
+	"bu_plugin::signature<Sig>: specialize it with the name of this signature");
+    static const char *name() { return BU_PLUGIN_CMD_SIGNATURE; }
+};
+
+template <>
+struct signature<int()> {
+    static const char *name() { return BU_PLUGIN_SIG_VOID; }
+};
+
+template <>
+struct signature<int(int, const char **)> {
+    static const char *name() { return BU_PLUGIN_SIG_ARGV; }
+};
+
+namespace detail {
+
+/* Signature ID of Sig, looked up once */
+template <typename Sig>
+unsigned int sig_id() {
+    static const unsigned int id = bu_plugin_sig_id(signature<Sig>::name());
+    return id;
+}
+
+template <typename Sig> struct fn_ptr;
+
+template <typename R, typename... A>
+struct fn_ptr<R(A...)> {
+    typedef R (*type)(A...);
+};
+
+/* The implementation behind h if it was registered as Sig, else NULL */
+template <typename Sig>
+typename fn_ptr<Sig>::type resolve(bu_plugin_cmd_handle h) {
+    return reinterpret_cast<typename fn_ptr<Sig>::type>(bu_plugin_cmd_handle_fn(h, sig_id<Sig>()));
+}
+
+} /* namespace detail */
+
+/*
+ * A handle together with its implementation, resolved once and typed as
+ * Sig; empty if the command has another signature. Calling it is a direct
+ * call. The implementation is not re-read: resolve again after the
+ * command is unregistered or re-registered.
+ */
+template <typename Sig> class cmd;
+
+template <typename R, typename... A>
+class cmd<R(A...)> {
+public:
+    typedef R (*fn_type)(A...);
+
+    cmd() : h_(nullptr), fn_(nullptr) {}
+    explicit cmd(bu_plugin_cmd_handle h) : h_(h), fn_(detail::resolve<R(A...)>(h)) {}
+    explicit cmd(const char *name) : cmd(bu_plugin_cmd_lookup_sig(name, detail::sig_id<R(A...)>())) {}
+
+    bu_plugin_cmd_handle handle() const { return h_; }
+    fn_type get() const { return fn_; }
+    explicit operator bool() const { return fn_ != nullptr; }
+
+    template <typename... Args>
+    R operator()(Args &&...args) const {
+	return fn_(std::forward<Args>(args)...);
+    }
+
+private:
+    bu_plugin_cmd_handle h_;
+    fn_type fn_;
+};
+
+namespace detail {
+
+inline const char *cmd_name(bu_plugin_cmd_handle h, const char *name) {
+    if (name) return name;
+    return h ? bu_plugin_cmd_handle_name(h) : "(null handle)";
+}
+
+/* Sets a call_result's value from the call; call_result<void> has none */
+template <typename R>
+struct result_of_call {
+    template <typename Fn, typename... Args>
+    static void call(call_result<R> &r, Fn fn, Args &&...args) {
+	r.value = fn(std::forward<Args>(args)...);
+    }
+    static R take(call_result<R> &r) { return std::move(r.value); }
+};
+
+template <>
+struct result_of_call<void> {
+    template <typename Fn, typename... Args>
+    static void call(call_result<void> &, Fn fn, Args &&...args) {
+	fn(std::forward<Args>(args)...);
+    }
+    static void take(call_result<void> &) {}
+};
+
+/* The result cache holds a non-void BU_PLUGIN_CMD_RET; other return types are never cached */
+template <typename R>
+struct memo_cached : std::integral_constant<bool,
+	std::is_same<R, BU_PLUGIN_CMD_RET>::value && !std::is_void<R>::value> {};
+
+template <typename R>
+bool memo_get(bu_plugin_cmd_handle h, call_result<R> &r, bu_plugin_memo_token &token, std::true_type) {
+    return bu_plugin_memo_lookup(h, nullptr, 0, &r.value, &token) != 0;
+}
+
+template <typename R>
+bool memo_get(bu_plugin_cmd_handle, call_result<R> &, bu_plugin_memo_token &token, std::false_type) {
+    token = 0;
+    return false;
+}
+
+template <typename R>
+void memo_put(bu_plugin_cmd_handle h, const call_result<R> &r, bu_plugin_memo_token token, std::true_type) {
+    bu_plugin_memo_store(h, nullptr, 0, &r.value, token);
+}
+
+template <typename R>
+void memo_put(bu_plugin_cmd_handle, const call_result<R> &, bu_plugin_memo_token, std::false_type) {}
+
+/* The checked call: bu_plugin_cmd_run() conventions, result in r.value; name may be NULL */
+template <typename R, typename... A, typename... Args>
+int invoke_status(bu_plugin_cmd_handle h, const char *name, R (*fn)(A...), call_result<R> &r, Args &&...args) {
+    if (!fn) {
+	bu_plugin_logf(BU_LOG_ERR, "Command '%s' not found", cmd_name(h, name));
+	return -1;
+    }
+    if (bu_plugin_call_ctx_stopped(bu_plugin_call_ctx_current())) return BU_PLUGIN_CALL_CANCELLED;
+    unsigned int flags = bu_plugin_cmd_handle_flags(h);
+    bool memo = sizeof...(A) == 0 && (flags & BU_PLUGIN_CMD_PURE);
+    bu_plugin_memo_token token = 0;
+    if (memo && memo_get(h, r, token, memo_cached<R>())) return 0;
+
+    int status = 0;
+    call_result<R> ret = call_result<R>();
+    bu_plugin_output_begin();
+#if BU_PLUGIN_EXCEPTIONS
+    if (flags & BU_PLUGIN_CMD_NOEXCEPT) {
+	result_of_call<R>::call(ret, fn, std::forward<Args>(args)...);
+    } else {
+	try {
+	    result_of_call<R>::call(ret, fn, std::forward<Args>(args)...);
+	} catch (const std::exception &e) {
+	    bu_plugin_logf(BU_LOG_ERR, "Command '%s' threw exception: %s", cmd_name(h, name), e.what());
+	    status = -2;
+	} catch (...) {
+	    bu_plugin_logf(BU_LOG_ERR, "Command '%s' threw unknown exception", cmd_name(h, name));
+	    status = -2;
+	}
+    }
+#else
+    result_of_call<R>::call(ret, fn, std::forward<Args>(args)...);
+#endif
+    bu_plugin_output_end();
+    /* Taken on every path, so a failure recorded before a throw does not outlive the call */
+    const char *what = bu_plugin_cmd_take_failure();
+    if (status != 0) return status;
+    if (what) {
+	bu_plugin_logf(BU_LOG_ERR, "Command '%s' failed: %s", cmd_name(h, name), what);
+	return -2;
+    }
+    if (memo) memo_put(h, ret, token, memo_cached<R>());
+    r = ret;
+    return 0;
+}
+
+/* invoker<Sig, Policy>::call() applies the policy; unknown policies leave it undefined */
+template <typename Sig, typename Policy> struct invoker;
+
+#if BU_PLUGIN_EXCEPTIONS
+template <typename R, typename... A>
+struct invoker<R(A...), throw_on_error> {
+    typedef R type;
+    template <typename... Args>
+    static R call(bu_plugin_cmd_handle h, const char *name, R (*fn)(A...), Args &&...args) {
+	call_result<R> r = call_result<R>();
+	int status = invoke_status(h, name, fn, r, std::forward<Args>(args)...);
+	if (status != 0) throw cmd_error(status, std::string(status_message(status)) + ": " + cmd_name(h, name));
+	return result_of_call<R>::take(r);
+    }
+};
+#endif
+
+template <typename R, typename... A>
+struct invoker<R(A...), return_status> {
+    typedef call_result<R> type;
+    template <typename... Args>
+    static type call(bu_plugin_cmd_handle h, const char *name, R (*fn)(A...), Args &&...args) {
+	type r = type();
+	r.status = invoke_status(h, name, fn, r, std::forward<Args>(args)...);
+	return r;
+    }
+};
+
+template <typename R, typename... A>
+struct invoker<R(A...), unchecked> {
+    typedef R type;
+    template <typename... Args>
+    static R call(bu_plugin_cmd_handle, const char *, R (*fn)(A...), Args &&...args) {
+	return fn(std::forward<Args>(args)...);
+    }
+};
+
+} /* namespace detail */
+
+/* Run a command by handle */
+template <typename Sig, typename Policy = throw_on_error, typename... Args>
+typename detail::invoker<Sig, Policy>::type invoke(bu_plugin_cmd_handle h, Args &&...args) {
+    return detail::invoker<Sig, Policy>::call(h, nullptr, detail::resolve<Sig>(h), std::forward<Args>(args)...);
+}
+
+/* Run a command by name; resolves it on every call, so prefer a handle or cmd on hot paths */
+template <typename Sig, typename Policy = throw_on_error, typename... Args>
+typename detail::invoker<Sig, Policy>::type invoke(const char *name, Args &&...args) {
+    bu_plugin_cmd_handle h = bu_plugin_cmd_lookup_sig(name, detail::sig_id<Sig>());
+    return detail::invoker<Sig, Policy>::call(h, name ? name : "(null)", detail::resolve<Sig>(h),
+	std::forward<Args>(args)...);
+}
+
+/* Run a resolved command; Sig is deduced */
+template <typename Sig, typename Policy = throw_on_error, typename... Args>
+typename detail::invoker<Sig, Policy>::type invoke(const cmd<Sig> &c, Args &&...args) {
+    return detail::invoker<Sig, Policy>::call(c.handle(), nullptr, c.get(), std::forward<Args>(args)...);
+}
+
+} /* namespace bu_plugin */
+#endif /* __cplusplus */
+
+/*
+ * C++ helper macro for registering built-in commands at static initialization time.
+ * Usage: REGISTER_BU_PLUGIN_COMMAND("cmdname", my_cmd_func);
+ * This creates a static object whose constructor registers the command.
+ * Uses __COUNTER__ for unique variable names to avoid collisions.
+ */
+#ifdef __cplusplus
+
+/* Helper macros for unique identifier generation */
+#define BU_PLUGIN_CONCAT_IMPL(a, b) a##b
+#define BU_PLUGIN_CONCAT(a, b) BU_PLUGIN_CONCAT_IMPL(a, b)
+
+#ifdef __COUNTER__
+#define BU_PLUGIN_UNIQUE_ID BU_PLUGIN_CONCAT(_bu_plugin_cmd_registrar_, __COUNTER__)
+#else
+#define BU_PLUGIN_UNIQUE_ID BU_PLUGIN_CONCAT(_bu_plugin_cmd_registrar_, __LINE__)
+#endif
+
+namespace bu_plugin_detail {
+struct CommandRegistrar {
+    CommandRegistrar(const char *name, bu_plugin_cmd_impl impl) {
+	bu_plugin_cmd_register(name, impl);
+    }
+};
+}
+
+#define REGISTER_BU_PLUGIN_COMMAND(name, impl) \
+    static ::bu_plugin_detail::CommandRegistrar \
+    BU_PLUGIN_UNIQUE_ID(name, impl)
+#endif
+
+/*
+ * Macro for declaring the plugin manifest symbol in a dynamic plugin.
+ * This exports a function that returns a pointer to the plugin's manifest.
+ * Usage in plugin source:
+ *   static bu_plugin_cmd s_commands[] = { {"example", example_impl}, ... };
+ *   static bu_plugin_manifest s_manifest = { "myplugin", 1, 1, s_commands };
+ *   BU_PLUGIN_DECLARE_MANIFEST(s_manifest)
+ *
+ * The host will dlsym() for a namespaced symbol "<host>_plugin_info".
+ * To set the host namespace, define BU_PLUGIN_NAME (e.g., 'ged') before including.
+ */
+#ifndef BU_PLUGIN_NAME
+#define BU_PLUGIN_NAME bu
+#endif
+#define BU_PLUGIN_CAT2_IMPL(a,b) a##b
+#define BU_PLUGIN_CAT2(a,b) BU_PLUGIN_CAT2_IMPL(a,b)
+#define BU_PLUGIN_STR1(x) #x
+#define BU_PLUGIN_STR(x) BU_PLUGIN_STR1(x)
+#define BU_PLUGIN_MANIFEST_FN  BU_PLUGIN_CAT2(BU_PLUGIN_NAME, _plugin_info)
+#define BU_PLUGIN_MANIFEST_SYM BU_PLUGIN_STR(BU_PLUGIN_MANIFEST_FN)
+
+/* "<host>_plugin_signature" reports the plugin's BU_PLUGIN_CMD_SIGNATURE; the host reads it if present */
+#define BU_PLUGIN_SIGNATURE_FN  BU_PLUGIN_CAT2(BU_PLUGIN_NAME, _plugin_signature)
+#define BU_PLUGIN_SIGNATURE_SYM BU_PLUGIN_STR(BU_PLUGIN_SIGNATURE_FN)
+
+#ifdef __cplusplus
+#define BU_PLUGIN_DECLARE_MANIFEST(manifest_var) \
+    extern "C" BU_PLUGIN_EXPORT const bu_plugin_manifest* BU_PLUGIN_MANIFEST_FN(void) { \
+	return &(manifest_var); \
+    } \
+    extern "C" BU_PLUGIN_EXPORT const char* BU_PLUGIN_SIGNATURE_FN(void) { \
+	return BU_PLUGIN_CMD_SIGNATURE; \
+    }
+#else
+#define BU_PLUGIN_DECLARE_MANIFEST(manifest_var) \
+    BU_PLUGIN_EXPORT const bu_plugin_manifest* BU_PLUGIN_MANIFEST_FN(void) { \
+	return &(manifest_var); \
+    } \
+    BU_PLUGIN_EXPORT const char* BU_PLUGIN_SIGNATURE_FN(void) { \
+	return BU_PLUGIN_CMD_SIGNATURE; \
+    }
+#endif
+
+/*
+ * Macro for declaring a bu_plugin_manifest_v2 (see above). The exported
+ * symbol is the same as for BU_PLUGIN_DECLARE_MANIFEST; it returns the
+ * embedded base manifest.
+ */
+#define BU_PLUGIN_DECLARE_MANIFEST_V2(manifest_var) \
+    BU_PLUGIN_DECLARE_MANIFEST((manifest_var).base)
+
+/*
+ * Built-in registry implementation (C++ only).
+ * This is included in the host library when BU_PLUGIN_IMPLEMENTATION is defined.
+ */
+#if defined(BU_PLUGIN_IMPLEMENTATION) && defined(__cplusplus)
+
+#include <unordered_map>
+#include <unordered_set>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdarg>
+#include <cstring>
+#include <cctype>
+#include <cstdint>
+#include <climits>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <exception>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <new>
+#include <memory>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#include <cerrno>
+#include <csignal>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <link.h>
+#include <linux/futex.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+/* Stable registry entry behind a bu_plugin_cmd_handle */
+struct bu_plugin_cmd_entry {
+    std::string name;
+    std::atomic<bu_plugin_cmd_impl> impl;       /* NULL for commands of another signature */
+    std::atomic<bu_plugin_strand *> strand;     /* NULL: runs freely on the executor */
+    std::atomic<unsigned int> flags;            /* BU_PLUGIN_CMD_* */
+    std::atomic<unsigned int> sig;              /* Signature ID */
+    std::atomic<bu_plugin_any_fn> fn;           /* The implementation, whatever its signature */
+    explicit bu_plugin_cmd_entry(const std::string &n)
+	: name(n), impl(nullptr), strand(nullptr), flags(0), sig(0), fn(nullptr) {}
+};
+
+namespace bu_plugin_impl {
+
+/*
+ * Commands of another signature than the host's: the signature ID and the
+ * implementation. Their get_registry() value is NULL, so everything typed
+ * as bu_plugin_cmd_impl passes them by.
+ */
+struct CmdSig {
+    unsigned int sig;
+    bu_plugin_any_fn fn;
+};
+
+/* Strands of a registered command: the owning plugin's and an explicit group */
+struct CmdStrands {
+    bu_plugin_strand *module;
+    bu_plugin_strand *group;
+};
+
+/**
+ * Read-only copy of the registry built by bu_plugin_freeze().
+ * Open addressing over a power-of-two slot array; names live in one
+ * contiguous buffer. Lookups only read from it.
+ */
+struct FrozenSlot {
+    uint64_t hash;
+    const char *name;           /* NULL for an empty slot */
+    size_t len;
+    bu_plugin_cmd_impl impl;
+    unsigned int flags;
+    bu_plugin_cmd_batch_impl batch;
+    bu_plugin_cmd_entry *handle;
+};
+
+struct FrozenTable {
+    std::vector<FrozenSlot> slots;
+    std::vector<char> names;
+    std::vector<size_t> sorted; /* slot indices in name order, for foreach */
+    size_t mask;
+};
+
+/* Retained module handles (kept loaded for lifetime unless bu_plugin_shutdown is called) */
+#if defined(_WIN32)
+typedef HMODULE bu_plugin_module_handle_t;
+#else
+typedef void*   bu_plugin_module_handle_t;
+#endif
+
+/* A loaded plugin, kept in load order so shutdown can run fini hooks in reverse */
+struct LoadedModule {
+    bu_plugin_module_handle_t handle;
+    std::string name;           /* manifest plugin_name (may be empty) */
+    bu_plugin_fini_fn fini;
+};
+
+} /* namespace bu_plugin_impl */
+
+/**
+ * A registry context: everything bu_plugin_cmd_register() and
+ * bu_plugin_load() write to. Each map is keyed by trimmed command name and
+ * protected by mtx; a command with no flags, batched entry point, other
+ * signature or strand has no entry in the corresponding map.
+ */
+struct bu_plugin_ctx {
+    std::string ns;
+    std::string info_sym;       /* "<ns>_plugin_info" */
+    std::string sig_sym;        /* "<ns>_plugin_signature" */
+    std::mutex mtx;
+    std::unordered_map<std::string, bu_plugin_cmd_impl> registry;
+    std::unordered_map<std::string, unsigned int> cmd_flags;
+    std::unordered_map<std::string, bu_plugin_cmd_batch_impl> cmd_batch;
+    std::unordered_map<std::string, bu_plugin_impl::CmdSig> cmd_sigs;
+    std::unordered_map<std::string, bu_plugin_impl::CmdStrands> cmd_strands;
+
+    /*
+     * Handle entries, created on first bu_plugin_cmd_lookup() of a name and
+     * never freed before the context is, so handles survive unregistration.
+     * The deque keeps entry addresses stable.
+     */
+    std::deque<bu_plugin_cmd_entry> handle_pool;
+    std::unordered_map<std::string, bu_plugin_cmd_entry *> handles;
+
+    std::atomic<const bu_plugin_impl::FrozenTable *> frozen;
+    std::mutex modules_mtx;     /* Protects modules */
+    std::vector<bu_plugin_impl::LoadedModule> modules;
+
+    explicit bu_plugin_ctx(const std::string &n)
+	: ns(n), info_sym(n + "_plugin_info"), sig_sym(n + "_plugin_signature"), frozen(nullptr) {}
+};
+
+namespace bu_plugin_impl {
+
+/* The calling thread's current context; NULL stands for the default one */
+static thread_local bu_plugin_ctx *tls_registry = nullptr;
+
+/* The context of the functions without a context argument, named by BU_PLUGIN_NAME */
+static bu_plugin_ctx& default_registry() {
+    static bu_plugin_ctx reg(BU_PLUGIN_STR(BU_PLUGIN_NAME));
+    return reg;
+}
+
+static bu_plugin_ctx& current_registry() {
+    bu_plugin_ctx *r = tls_registry;
+    return r ? *r : default_registry();
+}
+
+/* Make a registry context current for a scope (a bu_plugin_ctx_* call, a job, a loader thread) */
+struct RegistryScope {
+    bu_plugin_ctx *prev;
+    explicit RegistryScope(bu_plugin_ctx *r) : prev(tls_registry) {
+	tls_registry = r;
+    }
+    ~RegistryScope() {
+	tls_registry = prev;
+    }
+};
+
+/*
+ * The current context's members. Everything below but the frozen table
+ * and the modules is protected by get_mutex().
+ */
+static std::unordered_map<std::string, bu_plugin_cmd_impl>& get_registry() {
+    return current_registry().registry;
+}
+
+static std::mutex& get_mutex() {
+    return current_registry().mtx;
+}
+
+/* BU_PLUGIN_CMD_* flags of registered commands; absent means 0 */
+static std::unordered_map<std::string, unsigned int>& get_cmd_flags() {
+    return current_registry().cmd_flags;
+}
+
+/* Batched entry points of registered commands; absent means none */
+static std::unordered_map<std::string, bu_plugin_cmd_batch_impl>& get_cmd_batch() {
+    return current_registry().cmd_batch;
+}
+
+static std::unordered_map<std::string, CmdSig>& get_cmd_sigs() {
+    return current_registry().cmd_sigs;
+}
+
+static std::unordered_map<std::string, CmdStrands>& get_cmd_strands() {
+    return current_registry().cmd_strands;
+}
+
+static std::deque<bu_plugin_cmd_entry>& get_handle_pool() {
+    return current_registry().handle_pool;
+}
+
+static std::unordered_map<std::string, bu_plugin_cmd_entry *>& get_handles() {
+    return current_registry().handles;
+}
+
+static std::atomic<const FrozenTable *>& get_frozen() {
+    return current_registry().frozen;
+}
+
+static std::vector<LoadedModule>& get_modules() {
+    return current_registry().modules;
+}
+
+static std::mutex& get_modules_mutex() {
+    return current_registry().modules_mtx;
+}
+
+/* Caller holds r.mtx */
+static unsigned int cmd_flags_of(const bu_plugin_ctx &r, const std::string &name) {
+    if (r.cmd_flags.empty()) return 0;
+    auto it = r.cmd_flags.find(name);
+    return it != r.cmd_flags.end() ? it->second : 0;
+}
+
+/* Caller holds get_mutex() */
+static unsigned int cmd_flags_of(const std::string &name) {
+    return cmd_flags_of(current_registry(), name);
+}
+
+/* Caller holds r.mtx */
+static bu_plugin_cmd_batch_impl cmd_batch_of(const bu_plugin_ctx &r, const std::string &name) {
+    if (r.cmd_batch.empty()) return nullptr;
+    auto it = r.cmd_batch.find(name);
+    return it != r.cmd_batch.end() ? it->second : nullptr;
+}
+
+/* Caller holds get_mutex() */
+static bu_plugin_cmd_batch_impl cmd_batch_of(const std::string &name) {
+    return cmd_batch_of(current_registry(), name);
+}
+
+static bool sig_word_char(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+/* Qualifiers, which never name a type on their own */
+static bool sig_cv_word(const std::string &w) {
+    return w == "const" || w == "volatile";
+}
+
+/* Words after which the next word is a type name, as in "struct s" */
+static bool sig_elaborated_word(const std::string &w) {
+    return w == "struct" || w == "union" || w == "enum" || w == "class" || w == "typename";
+}
+
+static bool sig_builtin_type(const std::string &w) {
+    static const char *const words[] = {
+	"void", "bool", "_Bool", "char", "wchar_t", "char16_t", "char32_t", "short", "int",
+	"long", "float", "double", "signed", "unsigned"
+    };
+    for (const char *k : words) {
+	if (w == k) return true;
+    }
+    return false;
+}
+
+static bool sig_identifier(const std::string &t) {
+    return sig_word_char(t[0]) && !std::isdigit(static_cast<unsigned char>(t[0]));
+}
+
+/*
+ * Whether toks[b, e) - one top-level parameter - ends in its name: an
+ * identifier that is not a type word, not part of a qualified name (after
+ * "::") or an elaborated one (after "struct"), and that follows a token
+ * which already names a type. "T", "const T", "ns::T" and "struct s" have
+ * no name; "T x", "const T x", "ns::T x" and "char *p" do.
+ */
+static bool sig_param_named(const std::vector<std::string> &toks, size_t b, size_t e) {
+    if (e < b + 2) return false;
+    const std::string &last = toks[e - 1];
+    const std::string &prev = toks[e - 2];
+    if (!sig_identifier(last) || sig_builtin_type(last) || sig_cv_word(last)) return false;
+    if (prev == ":" || sig_elaborated_word(prev)) return false;
+    for (size_t j = b; j < e - 1; j++) {
+	const std::string &t = toks[j];
+	if (sig_identifier(t) && !sig_cv_word(t) && !sig_elaborated_word(t)) return true;
+    }
+    return false;
+}
+
+/*
+ * Compared form of a signature name: tokens separated by a blank only
+ * between two words, the names of the top-level parameters dropped and
+ * "()" written "(void)".
+ */
+static std::string normalize_signature(const char *sig) {
+    std::vector<std::string> toks;
+    for (const char *p = sig; *p;) {
+	if (std::isspace(static_cast<unsigned char>(*p))) {
+	    ++p;
+	} else if (sig_word_char(*p)) {
+	    const char *b = p;
+	    while (sig_word_char(*p)) ++p;
+	    toks.push_back(std::string(b, static_cast<size_t>(p - b)));
+	} else {
+	    toks.push_back(std::string(1, *p++));
+	}
+    }
+
+    /* Drop the name of each top-level parameter; commas inside <> do not end one */
+    std::vector<bool> keep(toks.size(), true);
+    int depth = 0;
+    int angle = 0;
+    size_t param = 0;
+    for (size_t i = 0; i < toks.size(); i++) {
+	const std::string t = toks[i];     /* a copy: inserting "void" moves toks */
+	if (t == "(" && ++depth == 1) {
+	    angle = 0;
+	    param = i + 1;
+	    if (param < toks.size() && toks[param] == ")") {
+		toks.insert(toks.begin() + static_cast<std::ptrdiff_t>(param), "void");
+		keep.insert(keep.begin() + static_cast<std::ptrdiff_t>(param), true);
+	    }
+	} else if (depth == 1 && t == "<") {
+	    ++angle;
+	} else if (depth == 1 && t == ">" && angle > 0) {
+	    --angle;
+	} else if (depth == 1 && angle == 0 && (t == ")" || t == ",")) {
+	    if (sig_param_named(toks, param, i)) keep[i - 1] = false;
+	    param = i + 1;
+	}
+	if (t == ")" && depth > 0) --depth;
+    }
+
+    std::string out;
+    bool prev_word = false;
+    for (size_t i = 0; i < toks.size(); i++) {
+	if (!keep[i]) continue;
+	bool word = sig_word_char(toks[i][0]);
+	if (word && prev_word) out += ' ';
+	out += toks[i];
+	prev_word = word && sig_word_char(toks[i].back());
+    }
+    return out;
+}
+
+/*
+ * Signature names by ID, in compared form; entry 0 is the host's. Shared
+ * by every context. Never shrinks. Protected by get_sig_mutex().
+ */
+static std::deque<std::string>& get_sig_names() {
+    static std::deque<std::string> names(1, normalize_signature(BU_PLUGIN_CMD_SIGNATURE));
+    return names;
+}
+
+static std::mutex& get_sig_mutex() {
+    static std::mutex mtx;
+    return mtx;
+}
+
+/* The ID of a signature name, assigned on first use */
+static unsigned int sig_intern(const char *sig) {
+    if (!sig) return 0;
+    std::string norm = normalize_signature(sig);
+    std::lock_guard<std::mutex> lock(get_sig_mutex());
+    auto &names = get_sig_names();
+    for (size_t i = 0; i < names.size(); i++) {
+	if (names[i] == norm) return static_cast<unsigned int>(i);
+    }
+    names.push_back(norm);
+    return static_cast<unsigned int>(names.size() - 1);
+}
+
+/* The compared form of signature ID sig, or NULL if it has not been assigned */
+static const char *sig_name_of(unsigned int sig) {
+    std::lock_guard<std::mutex> lock(get_sig_mutex());
+    auto &names = get_sig_names();
+    return sig < names.size() ? names[sig].c_str() : nullptr;
+}
+
+/* Strand a command is funneled through on the executor (NULL: none); caller holds get_mutex() */
+static bu_plugin_strand *cmd_strand_of(const std::string &name) {
+    if (cmd_flags_of(name) & BU_PLUGIN_CMD_THREADSAFE) return nullptr;
+    auto &strands = get_cmd_strands();
+    auto it = strands.find(name);
+    if (it == strands.end()) return nullptr;
+    return it->second.group ? it->second.group : it->second.module;
+}
+
+/* Store a registry entry into its handle; fn is published last, so a reader that sees it sees its sig */
+static void fill_handle(bu_plugin_cmd_entry *entry, bu_plugin_cmd_impl impl, unsigned int sig, bu_plugin_any_fn fn) {
+    entry->fn.store(nullptr, std::memory_order_release);
+    entry->impl.store(impl, std::memory_order_release);
+    entry->sig.store(sig, std::memory_order_release);
+    entry->fn.store(fn, std::memory_order_release);
+}
+
+/* The registry entry of name as a handle would hold it; caller holds get_mutex() */
+static void cmd_entry_of(const std::string &name, bu_plugin_cmd_impl impl, unsigned int &sig, bu_plugin_any_fn &fn) {
+    sig = 0;
+    fn = reinterpret_cast<bu_plugin_any_fn>(impl);
+    auto &sigs = get_cmd_sigs();
+    if (impl || sigs.empty()) return;
+    auto it = sigs.find(name);
+    if (it == sigs.end()) return;
+    sig = it->second.sig;
+    fn = it->second.fn;
+}
+
+/* Point an existing handle for name at impl (NULL on unregister); caller holds get_mutex() */
+static void update_handle(const std::string &name, bu_plugin_cmd_impl impl) {
+    auto &handles = get_handles();
+    if (handles.empty()) return;
+    auto it = handles.find(name);
+    if (it == handles.end()) return;
+    unsigned int sig;
+    bu_plugin_any_fn fn;
+    cmd_entry_of(name, impl, sig, fn);
+    fill_handle(it->second, impl, sig, fn);
+}
+
+/* Recompute the strand and flags of an existing handle after a flag or strand change; caller holds get_mutex() */
+static void update_handle_strand(const std::string &name) {
+    auto &handles = get_handles();
+    if (handles.empty()) return;
+    auto it = handles.find(name);
+    if (it == handles.end()) return;
+    it->second->strand.store(cmd_strand_of(name), std::memory_order_release);
+    it->second->flags.store(cmd_flags_of(name), std::memory_order_release);
+}
+
+/* The handle for a registered name, created on first use; caller holds get_mutex() */
+static bu_plugin_cmd_entry *handle_of(const std::string &name, bu_plugin_cmd_impl impl) {
+    auto &handles = get_handles();
+    auto hit = handles.find(name);
+    if (hit != handles.end()) return hit->second;
+    auto &pool = get_handle_pool();
+    pool.emplace_back(name);
+    bu_plugin_cmd_entry *entry = &pool.back();
+    unsigned int sig;
+    bu_plugin_any_fn fn;
+    cmd_entry_of(name, impl, sig, fn);
+    fill_handle(entry, impl, sig, fn);
+    entry->strand.store(cmd_strand_of(name), std::memory_order_release);
+    entry->flags.store(cmd_flags_of(name), std::memory_order_release);
+    handles[name] = entry;
+    return entry;
+}
+
+/* FNV-1a over a name span */
+static uint64_t hash_name(const char *s, size_t len) {
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < len; i++) {
+	h ^= static_cast<unsigned char>(s[i]);
+	h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/* Find the trimmed span of str without allocating; len is 0 if nothing is left */
+static const char *trim_span(const char *str, size_t &len) {
+    while (*str && std::isspace(static_cast<unsigned char>(*str))) ++str;
+    len = std::strlen(str);
+    while (len > 0 && std::isspace(static_cast<unsigned char>(str[len - 1]))) --len;
+    return str;
+}
+
+/* Command line syntax for bu_plugin_line_word(): blanks separate words */
+static bool line_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static bool line_end(char c) {
+    return c == '\0' || c == '\n';
+}
+
+static int line_word(char **cursor, const char **word) {
+    char *p = *cursor;
+    while (line_blank(*p)) ++p;
+    *cursor = p;
+    if (line_end(*p) || *p == '#') return 0;
+
+    /* Unquote in place: w trails p */
+    char *w = p;
+    *word = w;
+    while (!line_end(*p) && !line_blank(*p)) {
+	char c = *p++;
+	if (c == '\'') {
+	    while (!line_end(*p) && *p != '\'') *w++ = *p++;
+	    if (*p++ != '\'') return -1;
+	} else if (c == '"') {
+	    while (!line_end(*p) && *p != '"') {
+		if (*p == '\\' && (p[1] == '"' || p[1] == '\\')) ++p;
+		*w++ = *p++;
+	    }
+	    if (*p++ != '"') return -1;
+	} else if (c == '\\' && !line_end(*p)) {
+	    *w++ = *p++;
+	} else {
+	    *w++ = c;
+	}
+    }
+    /* Step over a separating blank, but never past the end of the line */
+    bool blank = line_blank(*p);
+    *w = '\0';
+    *cursor = blank ? p + 1 : p;
+    return 1;
+}
+
+static const FrozenSlot *frozen_find(const FrozenTable *t, const char *name) {
+    size_t len = 0;
+    const char *key = trim_span(name, len);
+    if (len == 0) return nullptr;
+    uint64_t h = hash_name(key, len);
+    for (size_t i = static_cast<size_t>(h) & t->mask;; i = (i + 1) & t->mask) {
+	const FrozenSlot &slot = t->slots[i];
+	if (!slot.name) return nullptr;
+	if (slot.hash == h && slot.len == len && std::memcmp(slot.name, key, len) == 0) return &slot;
+    }
+}
+
+/* Logger callback storage */
+static bu_plugin_logger_cb& get_logger() {
+    static bu_plugin_logger_cb logger = nullptr;
+    return logger;
+}
+
+/* Path allow callback storage */
+static bu_plugin_path_allow_cb& get_path_allow() {
+    static bu_plugin_path_allow_cb cb = nullptr;
+    return cb;
+}
+
+/* Flags applied to every plugin load */
+static std::atomic<unsigned int>& get_load_flags() {
+    static std::atomic<unsigned int> flags(0);
+    return flags;
+}
+
+/*
+ * Held across opening a module and moving its text onto huge pages, so no
+ * other load can run code of a module being remapped. dlopen() serializes
+ * on the loader's own lock anyway.
+ */
+static std::mutex& get_open_mutex() {
+    static std::mutex mtx;
+    return mtx;
+}
+
+/* Internal implementation detail - buffered startup log storage.
+   Avoids writing to STDOUT/STDERR during early startup. */
+struct BufferedLogEntry {
+    int level;
+    std::string msg;
+};
+
+static std::vector<BufferedLogEntry>& get_log_buffer() {
+    static std::vector<BufferedLogEntry> buffer;
+    return buffer;
+}
+
+static std::mutex& get_log_buffer_mutex() {
+    static std::mutex mtx;
+    return mtx;
+}
+
+static void close_module(bu_plugin_module_handle_t handle) {
+#if defined(_WIN32)
+    if (handle) FreeLibrary(handle);
+#else
+    if (handle) dlclose(handle);
+#endif
+}
+
+/* True if v2 manifest m is large enough to carry the extension field f */
+#define BU_PLUGIN_V2_HAS(m, f) BU_PLUGIN_HAS_FIELD(bu_plugin_manifest_v2, (m)->base.struct_size, f)
+
+static double elapsed_us(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+/* Loader options resolved from bu_plugin_load_opts (defaults = bu_plugin_load) */
+struct LoadSettings {
+    int binding;
+    int visibility;
+    int nodelete;
+    int isolate;
+    unsigned int flags;
+    unsigned long win_flags;
+};
+
+/* Timing of one load, see bu_plugin_load_stats */
+struct LoadTiming {
+    double open_us;
+    double resolve_us;
+    double prefault_us;
+    double register_us;
+    double init_us;
+};
+
+/* Trim leading/trailing whitespace from a string, returns trimmed copy */
+static std::string trim_whitespace(const char *str) {
+    if (!str) return "";
+    const char *start = str;
+    while (*start && std::isspace(static_cast<unsigned char>(*start))) {
+	++start;
+    }
+    if (*start == '\0') return "";
+    const char *end = str + std::strlen(str) - 1;
+    while (end > start && std::isspace(static_cast<unsigned char>(*end))) {
+	--end;
+    }
+    return std::string(start, static_cast<size_t>(end - start + 1));
+}
+
+/* Check if string contains internal whitespace */
+static bool has_internal_whitespace(const std::string& s) {
+    for (size_t i = 0; i < s.size(); ++i) {
+	if (std::isspace(static_cast<unsigned char>(s[i]))) {
+	    return true;
+	}
+    }
+    return false;
+}
+
+#ifdef BU_PLUGIN_DEFAULT_SIGNATURE
+/* bu_plugin_cmd_get() that also reports the command's flags */
+static bu_plugin_cmd_impl cmd_resolve(const char *name, unsigned int &flags) {
+    flags = 0;
+    if (!name) return nullptr;
+    bu_plugin_ctx &r = current_registry();
+    const FrozenTable *frozen = r.frozen.load(std::memory_order_acquire);
+    if (frozen) {
+	const FrozenSlot *slot = frozen_find(frozen, name);
+	if (!slot) return nullptr;
+	flags = slot->flags;
+	return slot->impl;
+    }
+    std::string trimmed = trim_whitespace(name);
+    if (trimmed.empty()) return nullptr;
+    std::lock_guard<std::mutex> lock(r.mtx);
+    auto it = r.registry.find(trimmed);
+    if (it == r.registry.end()) return nullptr;
+    flags = cmd_flags_of(r, trimmed);
+    return it->second;
+}
+#endif /* BU_PLUGIN_DEFAULT_SIGNATURE */
+
+#if defined(__linux__)
+/* Executable PT_LOAD ranges of one module, collected by dl_iterate_phdr */
+struct TextSegments {
+    uintptr_t base;                     /* link_map l_addr of the module */
+    std::vector<std::pair<uintptr_t, size_t> > ranges;
+};
+
+static int collect_text_segments(struct dl_phdr_info *info, size_t, void *data) {
+    TextSegments *segs = static_cast<TextSegments *>(data);
+    if (static_cast<uintptr_t>(info->dlpi_addr) != segs->base) return 0;
+    for (ElfW(Half) i = 0; i < info->dlpi_phnum; i++) {
+	const ElfW(Phdr) &ph = info->dlpi_phdr[i];
+	if (ph.p_type == PT_LOAD && (ph.p_flags & PF_X) && ph.p_memsz > 0) {
+	    segs->ranges.push_back(std::make_pair(static_cast<uintptr_t>(info->dlpi_addr + ph.p_vaddr),
+			static_cast<size_t>(ph.p_memsz)));
+	}
+    }
+    return 1;
+}
+
+/**
+ * Move the 2 MiB-aligned part of a text range onto anonymous memory that
+ * transparent huge pages can back. Returns the number of bytes moved.
+ * Must only run while no code in the range can execute; see remap_module_huge().
+ *
+ * Hosts that forbid executable anonymous memory (SELinux deny_execmem,
+ * PaX MPROTECT) refuse the final mprotect(). The copy of the text is made
+ * executable first, as a probe, so such hosts are detected before the text
+ * is touched; should the mprotect() of the new mapping still fail, the
+ * executable copy is moved into its place.
+ */
+static size_t remap_text_huge(uintptr_t start, size_t len, const char *path) {
+    const uintptr_t huge = 2u * 1024u * 1024u;
+    uintptr_t hstart = (start + huge - 1) & ~(huge - 1);
+    uintptr_t hend = (start + len) & ~(huge - 1);
+    if (hend <= hstart) return 0;
+    size_t n = static_cast<size_t>(hend - hstart);
+    void *text = reinterpret_cast<void *>(hstart);
+
+    void *copy = mmap(nullptr, n, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (copy == MAP_FAILED) return 0;
+    std::memcpy(copy, text, n);
+    if (mprotect(copy, n, PROT_READ | PROT_EXEC) != 0) {
+	bu_plugin_logf(BU_LOG_WARN, "Not moving the text of %s onto huge pages: executable anonymous memory is not allowed (%s)",
+		path, std::strerror(errno));
+	munmap(copy, n);
+	return 0;
+    }
+    void *fresh = mmap(text, n, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+    if (fresh == MAP_FAILED) {
+	/* The original mapping is intact only if MAP_FIXED failed before unmapping it */
+	munmap(copy, n);
+	return 0;
+    }
+#if defined(MADV_HUGEPAGE)
+    madvise(fresh, n, MADV_HUGEPAGE);
+#endif
+    std::memcpy(fresh, copy, n);
+    if (mprotect(fresh, n, PROT_READ | PROT_EXEC) != 0) {
+	int err = errno;
+	if (mremap(copy, n, n, MREMAP_MAYMOVE | MREMAP_FIXED, text) == MAP_FAILED) {
+	    bu_plugin_logf(BU_LOG_ERR, "Cannot restore the text of %s after a failed huge page move (%s)",
+		    path, std::strerror(errno));
+	    std::abort();
+	}
+	bu_plugin_logf(BU_LOG_WARN, "Not moving the text of %s onto huge pages: %s; kept it on small pages",
+		path, std::strerror(err));
+	return 0;
+    }
+    munmap(copy, n);
+    __builtin___clear_cache(static_cast<char *>(fresh), static_cast<char *>(fresh) + n);
+    return n;
+}
+#endif /* __linux__ */
+
+#if defined(__linux__)
+/* The executable page ranges of a loaded module; false if it has no link map */
+static bool module_text_ranges(bu_plugin_module_handle_t handle, TextSegments &segs) {
+    struct link_map *lm = nullptr;
+    if (dlinfo(handle, RTLD_DI_LINKMAP, &lm) != 0 || !lm) return false;
+    segs.base = static_cast<uintptr_t>(lm->l_addr);
+    dl_iterate_phdr(collect_text_segments, &segs);
+    const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    for (auto &r : segs.ranges) {
+	uintptr_t start = r.first & ~(page - 1);
+	r.second = static_cast<size_t>(((r.first + r.second + page - 1) & ~(page - 1)) - start);
+	r.first = start;
+    }
+    return true;
+}
+
+/*
+ * Move a module's text onto huge pages. Only called for a module this
+ * load mapped (not one dlopen() handed back already loaded), right after
+ * dlopen() and under get_open_mutex(): its constructors have returned
+ * and nothing has called into it yet.
+ */
+static size_t remap_module_huge(bu_plugin_module_handle_t handle, const char *path) {
+    TextSegments segs;
+    if (!module_text_ranges(handle, segs)) return 0;
+    size_t huge = 0;
+    for (const auto &r : segs.ranges) huge += remap_text_huge(r.first, r.second, path);
+    return huge;
+}
+#endif /* __linux__ */
+
+/* Prefault a freshly loaded module's text; huge is what remap_module_huge() moved */
+static void prefault_module(bu_plugin_module_handle_t handle, const char *path, unsigned int flags, size_t huge) {
+    if (!(flags & (BU_PLUGIN_LOAD_PREFAULT | BU_PLUGIN_LOAD_HUGEPAGES))) return;
+#if defined(__linux__)
+    TextSegments segs;
+    if (!module_text_ranges(handle, segs)) {
+	bu_plugin_logf(BU_LOG_WARN, "Cannot prefault %s: no link map", path);
+	return;
+    }
+
+    const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    size_t faulted = 0;
+    for (const auto &r : segs.ranges) {
+	uintptr_t start = r.first;
+	size_t len = r.second;
+	void *addr = reinterpret_cast<void *>(start);
+	madvise(addr, len, MADV_WILLNEED);
+#if defined(MADV_POPULATE_READ)
+	if (madvise(addr, len, MADV_POPULATE_READ) != 0)
+#endif
+	{
+	    /* Touch one byte per page to map it */
+	    for (uintptr_t p = start; p < start + len; p += page) {
+		(void)*reinterpret_cast<const volatile char *>(p);
+	    }
+	}
+	faulted += len;
+    }
+    bu_plugin_logf(BU_LOG_INFO, "Prefaulted %zu KiB of text in %s (%zu KiB on huge pages)",
+	    faulted / 1024, path, huge / 1024);
+#else
+    (void)handle;
+    (void)huge;
+    bu_plugin_logf(BU_LOG_INFO, "Prefault load flags are not supported on this platform (%s)", path);
+#endif
+}
+
+/**
+ * Default allocator. Every block carries a 16-byte header recording its
+ * size and whether it came from the heap or a thread arena, so free and
+ * realloc work on both kinds.
+ */
+struct BlockHeader {
+    size_t size;
+    size_t arena;               /* Non-zero for arena blocks */
+};
+static const size_t BLOCK_ALIGN = 16;
+static const size_t ARENA_CHUNK = 64 * 1024;
+
+static size_t align_up(size_t n) {
+    return (n + BLOCK_ALIGN - 1) & ~(BLOCK_ALIGN - 1);
+}
+
+/* Per-thread bump arena; chunks are kept for reuse until the thread exits */
+struct ThreadArena {
+    struct Chunk {
+	char *base;
+	size_t cap;
+    };
+    std::vector<Chunk> chunks;
+    size_t cur = 0;             /* Chunk currently bumped */
+    size_t used = 0;            /* Bytes used in chunks[cur] */
+    std::vector<std::pair<size_t, size_t> > marks;  /* (cur, used) at each push */
+
+    ~ThreadArena() {
+	for (auto &c : chunks) std::free(c.base);
+    }
+
+    void *bump(size_t n) {
+	while (cur < chunks.size()) {
+	    if (chunks[cur].cap - used >= n) {
+		void *p = chunks[cur].base + used;
+		used += n;
+		return p;
+	    }
+	    if (cur + 1 >= chunks.size()) break;
+	    cur++;
+	    used = 0;
+	}
+	Chunk c;
+	c.cap = std::max(ARENA_CHUNK, n);
+	c.base = static_cast<char *>(std::malloc(c.cap));
+	if (!c.base) return nullptr;
+	chunks.push_back(c);
+	cur = chunks.size() - 1;
+	used = n;
+	return c.base;
+    }
+};
+
+static ThreadArena& thread_arena() {
+    static thread_local ThreadArena arena;
+    return arena;
+}
+
+static void *default_alloc(void *, size_t size) {
+    size_t total = align_up(size) + sizeof(BlockHeader);
+    ThreadArena &arena = thread_arena();
+    BlockHeader *h = nullptr;
+    if (!arena.marks.empty()) {
+	h = static_cast<BlockHeader *>(arena.bump(total));
+	if (h) h->arena = 1;
+    } else {
+	h = static_cast<BlockHeader *>(std::malloc(total));
+	if (h) h->arena = 0;
+    }
+    if (!h) return nullptr;
+    h->size = size;
+    return h + 1;
+}
+
+static void default_free(void *, void *ptr) {
+    if (!ptr) return;
+    BlockHeader *h = static_cast<BlockHeader *>(ptr) - 1;
+    if (!h->arena) std::free(h);
+}
+
+static void *default_realloc(void *ctx, void *ptr, size_t size) {
+    if (!ptr) return default_alloc(ctx, size);
+    BlockHeader *h = static_cast<BlockHeader *>(ptr) - 1;
+    if (!h->arena) {
+	BlockHeader *n = static_cast<BlockHeader *>(std::realloc(h, align_up(size) + sizeof(BlockHeader)));
+	if (!n) return nullptr;
+	n->size = size;
+	return n + 1;
+    }
+    if (size <= h->size) {
+	h->size = size;
+	return ptr;
+    }
+    void *n = default_alloc(ctx, size);
+    if (!n) return nullptr;
+    std::memcpy(n, ptr, h->size);
+    return n;
+}
+
+static size_t default_arena_push(void *) {
+    ThreadArena &arena = thread_arena();
+    arena.marks.push_back(std::make_pair(arena.cur, arena.used));
+    return arena.marks.size();
+}
+
+static void default_arena_pop(void *, size_t mark) {
+    ThreadArena &arena = thread_arena();
+    if (mark == 0 || mark > arena.marks.size()) return;
+    arena.cur = arena.marks[mark - 1].first;
+    arena.used = arena.marks[mark - 1].second;
+    arena.marks.resize(mark - 1);
+}
+
+static const bu_plugin_allocator& default_allocator() {
+    static const bu_plugin_allocator a = {
+	sizeof(bu_plugin_allocator), nullptr,
+	default_alloc, default_realloc, default_free, default_arena_push, default_arena_pop
+    };
+    return a;
+}
+
+static std::atomic<const bu_plugin_allocator *>& get_allocator() {
+    static std::atomic<const bu_plugin_allocator *> alloc(&default_allocator());
+    return alloc;
+}
+
+static std::atomic<bool>& get_cmd_arena() {
+    static std::atomic<bool> enabled(false);
+    return enabled;
+}
+
+/* Arena scope around one command call when bu_plugin_set_cmd_arena() is on */
+struct CmdArenaScope {
+    const bu_plugin_allocator *alloc;
+    size_t mark;
+    CmdArenaScope() : alloc(nullptr), mark(0) {
+	if (get_cmd_arena().load(std::memory_order_relaxed)) {
+	    alloc = get_allocator().load(std::memory_order_acquire);
+	    mark = alloc->arena_push(alloc->ctx);
+	}
+    }
+    ~CmdArenaScope() {
+	if (alloc) alloc->arena_pop(alloc->ctx, mark);
+    }
+    CmdArenaScope(const CmdArenaScope &) = delete;
+    CmdArenaScope& operator=(const CmdArenaScope &) = delete;
+};
+
+static const bu_plugin_allocator *host_allocator() {
+    return get_allocator().load(std::memory_order_acquire);
+}
+
+/* The table's allocation entries go through whichever allocator is installed */
+static void *host_alloc(size_t size) {
+    const bu_plugin_allocator *a = host_allocator();
+    return a->mem_alloc(a->ctx, size);
+}
+
+static void *host_realloc(void *ptr, size_t size) {
+    const bu_plugin_allocator *a = host_allocator();
+    return a->mem_realloc(a->ctx, ptr, size);
+}
+
+static void host_free(void *ptr) {
+    const bu_plugin_allocator *a = host_allocator();
+    a->mem_free(a->ctx, ptr);
+}
+
+static void host_stats(bu_plugin_host_stats *out) {
+    if (!out) return;
+    size_t sz = out->struct_size;
+    if (BU_PLUGIN_HAS_FIELD(bu_plugin_host_stats, sz, cmd_count)) out->cmd_count = bu_plugin_cmd_count();
+    if (BU_PLUGIN_HAS_FIELD(bu_plugin_host_stats, sz, module_count)) out->module_count = bu_plugin_loaded_modules_count();
+    if (BU_PLUGIN_HAS_FIELD(bu_plugin_host_stats, sz, frozen)) out->frozen = bu_plugin_is_frozen();
+}
+
+static bu_plugin_host_services make_host_services() {
+    bu_plugin_host_services s = bu_plugin_host_services();
+    s.struct_size = sizeof(bu_plugin_host_services);
+    s.version = BU_PLUGIN_HOST_SERVICES_VERSION;
+    s.log_printf = bu_plugin_logf;
+    s.cmd_exists = bu_plugin_cmd_exists;
+    s.cmd_get = bu_plugin_cmd_get;
+    s.cmd_lookup = bu_plugin_cmd_lookup;
+    s.cmd_handle_impl = bu_plugin_cmd_handle_impl;
+    s.cmd_handle_name = bu_plugin_cmd_handle_name;
+#ifdef BU_PLUGIN_DEFAULT_SIGNATURE
+    s.cmd_invoke = bu_plugin_cmd_invoke;
+#endif
+    s.mem_alloc = host_alloc;
+    s.mem_realloc = host_realloc;
+    s.mem_free = host_free;
+    s.stats = host_stats;
+    s.allocator = host_allocator;
+    s.call_ctx_current = bu_plugin_call_ctx_current;
+    s.output_write = bu_plugin_output_write;
+    s.output_printf = bu_plugin_output_printf;
+    s.channel_input = bu_plugin_channel_input;
+    s.channel_output = bu_plugin_channel_output;
+    s.channel_check = bu_plugin_channel_check;
+    s.channel_reserve = bu_plugin_channel_reserve;
+    s.channel_commit = bu_plugin_channel_commit;
+    s.channel_peek = bu_plugin_channel_peek;
+    s.channel_release = bu_plugin_channel_release;
+    s.channel_close = bu_plugin_channel_close;
+    s.sig_id = bu_plugin_sig_id;
+    s.cmd_lookup_sig = bu_plugin_cmd_lookup_sig;
+    s.cmd_handle_fn = bu_plugin_cmd_handle_fn;
+    return s;
+}
+
+static const bu_plugin_host_services& get_host_services() {
+    static const bu_plugin_host_services services = make_host_services();
+    return services;
+}
+
+/**
+ * Call contexts. The public struct is the first base of a refcounted
+ * CallCtx; every queued job carrying it holds a reference. Deadlines are
+ * kept in one timer thread's map, which also holds a reference until the
+ * deadline fires or is removed.
+ */
+struct CallCtx : bu_plugin_call_ctx {
+    std::atomic<int> refs{1};
+    uint64_t deadline_ns = 0;           /* Scheduled deadline, 0 if none; protected by the timer mutex */
+};
+
+static thread_local CallCtx *tls_call_ctx = nullptr;
+
+static void ctx_retain(CallCtx *c) {
+    if (c) c->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void ctx_release(CallCtx *c) {
+    if (c && c->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete c;
+}
+
+static void ctx_stop(CallCtx *c) {
+#if defined(__GNUC__) || defined(__clang__)
+    __atomic_store_n(&c->stop, 1, __ATOMIC_RELAXED);
+#else
+    c->stop = 1;
+#endif
+}
+
+/* Make a context current for a scope (a job, a batch range, a DAG node) */
+struct CallCtxScope {
+    CallCtx *prev;
+    explicit CallCtxScope(CallCtx *c) : prev(tls_call_ctx) {
+	tls_call_ctx = c;
+    }
+    ~CallCtxScope() {
+	tls_call_ctx = prev;
+    }
+};
+
+static uint64_t now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+struct DeadlineTimer {
+    std::mutex m;
+    std::condition_variable cv;
+    std::multimap<uint64_t, CallCtx *> due;
+    std::thread thread;
+    bool running = false;       /* thread is in run(); it returns once nothing is due */
+    bool quit = false;
+
+    ~DeadlineTimer() {
+	{
+	    std::lock_guard<std::mutex> lock(m);
+	    quit = true;
+	}
+	cv.notify_all();
+	if (thread.joinable()) thread.join();
+    }
+
+    void run() {
+	std::unique_lock<std::mutex> lock(m);
+	while (!quit && !due.empty()) {
+	    uint64_t now = now_ns();
+	    auto first = due.begin();
+	    if (first->first > now) {
+		cv.wait_for(lock, std::chrono::nanoseconds(first->first - now));
+		continue;
+	    }
+	    CallCtx *c = first->second;
+	    due.erase(first);
+	    c->deadline_ns = 0;
+	    ctx_stop(c);
+	    ctx_release(c);
+	}
+	running = false;
+    }
+
+    /* Remove c's pending deadline; caller holds m. Returns true if there was one */
+    bool unschedule(CallCtx *c) {
+	if (!c->deadline_ns) return false;
+	auto range = due.equal_range(c->deadline_ns);
+	for (auto it = range.first; it != range.second; ++it) {
+	    if (it->second == c) {
+		due.erase(it);
+		break;
+	    }
+	}
+	c->deadline_ns = 0;
+	return true;
+    }
+};
+
+static DeadlineTimer& get_deadline_timer() {
+    static DeadlineTimer timer;
+    return timer;
+}
+
+static void ctx_set_deadline(CallCtx *c, unsigned long long timeout_us) {
+    DeadlineTimer &t = get_deadline_timer();
+    std::lock_guard<std::mutex> lock(t.m);
+    bool held = t.unschedule(c);
+    if (!timeout_us) {
+	if (!held) return;
+	ctx_release(c);
+	if (t.due.empty()) t.cv.notify_all();   /* Let the thread exit */
+	return;
+    }
+    if (!held) ctx_retain(c);
+    c->deadline_ns = now_ns() + static_cast<uint64_t>(timeout_us) * 1000;
+    t.due.insert(std::make_pair(c->deadline_ns, c));
+    if (!t.running) {
+	/* A previous thread has left run() and released m; only its exit is left */
+	if (t.thread.joinable()) t.thread.join();
+	t.thread = std::thread(&DeadlineTimer::run, &t);
+	t.running = true;
+    }
+    t.cv.notify_all();
+}
+
+/*
+ * Give a fork() child a timer of its own. The parent's timer thread is not
+ * there, and another parent thread may have held m or waited on cv at the
+ * fork, so none of the inherited state is touched: a fresh timer is built
+ * over it (the old one's memory is left behind) and starts its thread on
+ * the next deadline. Deadlines pending at the fork do not fire in the child.
+ */
+static void reset_deadlines_after_fork() {
+    new (&get_deadline_timer()) DeadlineTimer();
+}
+
+/* Growable byte buffer, kept NUL-terminated; appends of a few bytes stay inline */
+struct OutputBuffer {
+    char *data = nullptr;
+    size_t len = 0;
+    size_t cap = 0;
+
+    OutputBuffer() = default;
+    OutputBuffer(const OutputBuffer &) = delete;
+    OutputBuffer& operator=(const OutputBuffer &) = delete;
+    ~OutputBuffer() {
+	std::free(data);
+    }
+
+    /* Output is best effort: if the buffer cannot grow, the bytes are dropped */
+    void append(const char *p, size_t n) {
+	if (cap - len <= n && !grow(n)) return;
+	std::memcpy(data + len, p, n);
+	len += n;
+	data[len] = '\0';
+    }
+
+    /* Room for n more bytes and the terminator */
+    bool grow(size_t n) {
+	size_t want = std::max(std::max<size_t>(cap * 2, 256), len + n + 1);
+	char *p = static_cast<char *>(std::realloc(data, want));
+	if (!p) return false;
+	data = p;
+	cap = want;
+	return true;
+    }
+
+    void clear() {
+	len = 0;
+	if (data) data[0] = '\0';
+    }
+};
+
+} /* namespace bu_plugin_impl */
+
+/* Capture buffer behind a bu_plugin_output */
+struct bu_plugin_output {
+    bu_plugin_impl::OutputBuffer buf;
+};
+
+namespace bu_plugin_impl {
+
+/**
+ * Command output. Each thread keeps the output of its outermost running
+ * invocation in one buffer, whose capacity is reused by later invocations;
+ * nested invocations append to it, so output stays in call order.
+ */
+struct OutputState {
+    OutputBuffer pending;               /* Output of the running invocation */
+    bu_plugin_output *capture = nullptr;
+    int depth = 0;                      /* Open invocation scopes */
+};
+
+/* Plain pointer to the thread's state, so a write costs one TLS access */
+static thread_local OutputState *tls_output = nullptr;
+
+static OutputState *output_state_init() {
+    static thread_local OutputState state;
+    tls_output = &state;
+    return &state;
+}
+
+static inline OutputState& output_state() {
+    OutputState *st = tls_output;
+    return st ? *st : *output_state_init();
+}
+
+/* A writer and its user pointer, published together so an emitter never pairs one with the other's */
+struct OutputWriter {
+    bu_plugin_output_fn fn;     /* NULL: stdout */
+    void *user;
+};
+
+static std::atomic<const OutputWriter *>& get_output_writer() {
+    static const OutputWriter to_stdout = { nullptr, nullptr };
+    static std::atomic<const OutputWriter *> w(&to_stdout);
+    return w;
+}
+
+/* Every pair ever installed, kept because an emitter may still hold an older one; repeats reuse theirs */
+static std::deque<OutputWriter>& get_output_writers() {
+    static std::deque<OutputWriter> writers;
+    return writers;
+}
+
+static std::mutex& get_output_writers_mutex() {
+    static std::mutex m;
+    return m;
+}
+
+static void output_emit(const char *data, size_t len) {
+    const OutputWriter *w = get_output_writer().load(std::memory_order_acquire);
+    if (w->fn) {
+	w->fn(w->user, data, len);
+    } else {
+	fwrite(data, 1, len, stdout);
+    }
+}
+
+/* Where output written now goes: a buffer, or NULL to emit it directly. Sets drop when discarding */
+static OutputBuffer *output_target(OutputState &st, bool &drop) {
+    drop = false;
+    if (st.capture) return &st.capture->buf;
+    if (get_output_writer().load(std::memory_order_acquire)->fn == bu_plugin_output_discard) {
+	drop = true;
+	return nullptr;
+    }
+    return st.depth ? &st.pending : nullptr;
+}
+
+static void output_vprintf(const char *fmt, va_list args) {
+    OutputState &st = output_state();
+    bool drop;
+    OutputBuffer *t = output_target(st, drop);
+    if (drop) return;
+
+    /* Most writes fit the stack buffer; longer ones are formatted again in place */
+    char buf[256];
+    va_list again;
+    va_copy(again, args);
+    int n = vsnprintf(buf, sizeof(buf), fmt, args);
+    size_t len = (n > 0) ? static_cast<size_t>(n) : 0;
+    if (len < sizeof(buf)) {
+	if (t) {
+	    t->append(buf, len);
+	} else if (len) {
+	    output_emit(buf, len);
+	}
+    } else {
+	OutputBuffer tmp;
+	OutputBuffer &dst = t ? *t : tmp;
+	if (dst.cap - dst.len > len || dst.grow(len)) {
+	    vsnprintf(dst.data + dst.len, len + 1, fmt, again);
+	    dst.len += len;
+	    if (!t) output_emit(tmp.data, tmp.len);
+	}
+    }
+    va_end(again);
+}
+
+static void output_begin() {
+    output_state().depth++;
+}
+
+static void output_end() {
+    OutputState &st = output_state();
+    if (st.depth == 0) return;
+    if (--st.depth == 0 && st.pending.len) {
+	output_emit(st.pending.data, st.pending.len);
+	st.pending.clear();
+    }
+}
+
+/* Output scope around one command call (or one batch range) */
+struct CmdOutputScope {
+    CmdOutputScope() {
+	output_begin();
+    }
+    ~CmdOutputScope() {
+	output_end();
+    }
+    CmdOutputScope(const CmdOutputScope &) = delete;
+    CmdOutputScope& operator=(const CmdOutputScope &) = delete;
+};
+
+} /* namespace bu_plugin_impl */
+
+/*
+ * SPSC ring. head and tail count records ever committed and released; the
+ * producer owns head and the consumer owns tail, and each keeps a cached
+ * copy of the other's counter so most calls touch only its own line. The
+ * side that publishes a counter wakes the other only if it is sleeping;
+ * both sleeper registration and publication are sequentially consistent,
+ * so a sleeper either sees the new counter or is seen and woken.
+ */
+struct bu_plugin_channel {
+    std::string type;
+    size_t record_size;
+    size_t capacity;                    /* Power of two */
+    char *slots;
+
+    char pad0[64];
+    std::atomic<size_t> head{0};        /* Committed; written by the producer */
+    size_t tail_cache = 0;              /* Producer's view of tail */
+    size_t reserved = 0;                /* Slots handed out by the last reserve */
+    char pad1[64];
+    std::atomic<size_t> tail{0};        /* Released; written by the consumer */
+    size_t head_cache = 0;              /* Consumer's view of head */
+    char pad2[64];
+
+    std::atomic<int> state{0};          /* CHANNEL_* */
+    std::atomic<int> sleepers{0};
+    std::mutex m;
+    std::condition_variable cv;
+    std::atomic<unsigned long long> producer_waits{0};
+    std::atomic<unsigned long long> consumer_waits{0};
+};
+
+namespace bu_plugin_impl {
+
+enum { CHANNEL_OPEN = 0, CHANNEL_CLOSED = 1, CHANNEL_CANCELLED = 2 };
+static const unsigned CHANNEL_YIELDS = 64;     /* Yields before sleeping */
+
+static thread_local bu_plugin_channel *tls_channel_in = nullptr;
+static thread_local bu_plugin_channel *tls_channel_out = nullptr;
+
+static void channel_wake(bu_plugin_channel *ch) {
+    if (ch->sleepers.load()) {
+	std::lock_guard<std::mutex> lock(ch->m);
+	ch->cv.notify_all();
+    }
+}
+
+/* Wait until ready() or the channel is cancelled (or the call context stops); returns ready() */
+template <typename Ready>
+static bool channel_wait(bu_plugin_channel *ch, const Ready &ready, std::atomic<unsigned long long> &waits) {
+    for (unsigned k = 0; k < CHANNEL_YIELDS; k++) {
+	if (ready()) return true;
+	if (ch->state.load(std::memory_order_acquire) == CHANNEL_CANCELLED) return false;
+	std::this_thread::yield();
+    }
+    waits.fetch_add(1, std::memory_order_relaxed);
+    CallCtx *ctx = tls_call_ctx;
+    std::unique_lock<std::mutex> lock(ch->m);
+    ch->sleepers.fetch_add(1);
+    while (!ready() && ch->state.load() != CHANNEL_CANCELLED && !bu_plugin_call_ctx_stopped(ctx)) {
+	if (ctx) {
+	    /* Deadlines only set the stop flag, so poll it */
+	    ch->cv.wait_for(lock, std::chrono::milliseconds(1));
+	} else {
+	    ch->cv.wait(lock);
+	}
+    }
+    ch->sleepers.fetch_sub(1);
+    return ready();
+}
+
+static size_t channel_free(bu_plugin_channel *ch, size_t h) {
+    size_t free_slots = ch->capacity - (h - ch->tail_cache);
+    if (!free_slots) {
+	ch->tail_cache = ch->tail.load();
+	free_slots = ch->capacity - (h - ch->tail_cache);
+    }
+    return free_slots;
+}
+
+static void *channel_reserve(bu_plugin_channel *ch, size_t max, size_t *got) {
+    size_t h = ch->head.load(std::memory_order_relaxed);
+    ch->reserved = 0;
+    if (got) *got = 0;
+    if (!max || ch->state.load(std::memory_order_acquire) != CHANNEL_OPEN) return nullptr;
+    size_t free_slots = channel_free(ch, h);
+    if (!free_slots) {
+	if (!channel_wait(ch, [&]() { return channel_free(ch, h) != 0; }, ch->producer_waits)) return nullptr;
+	if (ch->state.load(std::memory_order_acquire) != CHANNEL_OPEN) return nullptr;
+	free_slots = channel_free(ch, h);
+    }
+    size_t at = h & (ch->capacity - 1);
+    size_t n = std::min(std::min(max, free_slots), ch->capacity - at);
+    ch->reserved = n;
+    if (got) *got = n;
+    return ch->slots + at * ch->record_size;
+}
+
+static void channel_commit(bu_plugin_channel *ch, size_t n) {
+    n = std::min(n, ch->reserved);
+    ch->reserved -= n;
+    if (!n) return;
+    ch->head.store(ch->head.load(std::memory_order_relaxed) + n);
+    channel_wake(ch);
+}
+
+static size_t channel_avail(bu_plugin_channel *ch, size_t t) {
+    size_t avail = ch->head_cache - t;
+    if (!avail) {
+	ch->head_cache = ch->head.load();
+	avail = ch->head_cache - t;
+    }
+    return avail;
+}
+
+static const void *channel_peek(bu_plugin_channel *ch, size_t max, size_t *got) {
+    size_t t = ch->tail.load(std::memory_order_relaxed);
+    if (got) *got = 0;
+    if (!max || ch->state.load(std::memory_order_acquire) == CHANNEL_CANCELLED) return nullptr;
+    size_t avail = channel_avail(ch, t);
+    if (!avail) {
+	/* Closing happens after the last commit, so re-check head once it is seen */
+	auto ready = [&]() {
+	    return channel_avail(ch, t) != 0 || ch->state.load() == CHANNEL_CLOSED;
+	};
+	if (!channel_wait(ch, ready, ch->consumer_waits)) return nullptr;
+	avail = channel_avail(ch, t);
+	if (!avail || ch->state.load(std::memory_order_acquire) == CHANNEL_CANCELLED) return nullptr;
+    }
+    size_t at = t & (ch->capacity - 1);
+    size_t n = std::min(std::min(max, avail), ch->capacity - at);
+    if (got) *got = n;
+    return ch->slots + at * ch->record_size;
+}
+
+static void channel_release(bu_plugin_channel *ch, size_t n) {
+    size_t t = ch->tail.load(std::memory_order_relaxed);
+    n = std::min(n, ch->head_cache - t);
+    if (!n) return;
+    ch->tail.store(t + n);
+    channel_wake(ch);
+}
+
+static void channel_finish(bu_plugin_channel *ch, int to) {
+    int open = CHANNEL_OPEN;
+    if (to == CHANNEL_CLOSED) {
+	ch->state.compare_exchange_strong(open, CHANNEL_CLOSED);
+    } else {
+	ch->state.store(CHANNEL_CANCELLED);
+    }
+    std::lock_guard<std::mutex> lock(ch->m);
+    ch->cv.notify_all();
+}
+
+/*
+ * Failure recorded by bu_plugin_cmd_fail() or by a worker pool proxy; the
+ * run wrappers take it after the call and return -2.
+ */
+static thread_local bool tls_call_failed = false;
+
+static std::string& call_failure() {
+    static thread_local std::string what;
+    return what;
+}
+
+static void set_call_failure(const char *what) {
+    call_failure() = what ? what : "command failed";
+    tls_call_failed = true;
+}
+
+/* The message of a failure recorded by the call that just returned (NULL if none); clears it */
+static const char *take_call_failure() {
+    if (!tls_call_failed) return nullptr;
+    tls_call_failed = false;
+    return call_failure().c_str();
+}
+
+#if defined(BU_PLUGIN_DEFAULT_SIGNATURE) || defined(BU_PLUGIN_CMD_ARGV_SIGNATURE)
+/* Log and clear a failure recorded by the command name that just returned */
+static bool call_failed(const char *name) {
+    const char *what = take_call_failure();
+    if (!what) return false;
+    bu_plugin_logf(BU_LOG_ERR, "Command '%s' failed: %s", name, what);
+    return true;
+}
+#endif
+
+/*
+ * Result cache for BU_PLUGIN_CMD_PURE commands. A key is the command's
+ * impl plus its argument bytes; its hash picks the shard and indexes the
+ * shard's slots, which are recycled in CLOCK order. Invalidation bumps the
+ * epoch: slots filled under an older epoch no longer match and are reused
+ * first. A call that misses remembers the epoch it started under and
+ * stores nothing if the epoch moved while it ran.
+ */
+static const size_t MEMO_SHARDS = 16;
+
+/* A cached result; with a void BU_PLUGIN_CMD_RET there is nothing to keep */
+template <typename R>
+struct MemoValue {
+    R value;
+    MemoValue() : value() {}
+    void get(R *out) const { *out = value; }
+    void set(const R *in) { value = *in; }
+};
+
+template <>
+struct MemoValue<void> {
+    void get(void *) const {}
+    void set(const void *) {}
+};
+
+struct MemoSlot {
+    uint64_t hash;
+    bu_plugin_cmd_impl impl;
+    std::string args;
+    uint64_t epoch;                     /* 0: never filled */
+    bool referenced;                    /* CLOCK bit, set by hits */
+    MemoValue<BU_PLUGIN_CMD_RET> value;
+    MemoSlot() : hash(0), impl(nullptr), epoch(0), referenced(false) {}
+};
+
+struct MemoShard {
+    std::mutex m;
+    std::vector<MemoSlot> slots;
+    std::unordered_map<uint64_t, size_t> index;     /* Key hash -> slot */
+    size_t hand = 0;
+    unsigned long long hits = 0;
+    unsigned long long misses = 0;
+    unsigned long long evictions = 0;
+    char pad[64];
+};
+
+struct MemoCache {
+    std::atomic<size_t> capacity{0};
+    std::atomic<uint64_t> epoch{1};
+    std::atomic<unsigned long long> invalidations{0};
+    MemoShard shards[MEMO_SHARDS];
+};
+
+static MemoCache& get_memo() {
+    static MemoCache memo;
+    return memo;
+}
+
+static bool memo_enabled() {
+    return get_memo().capacity.load(std::memory_order_relaxed) != 0;
+}
+
+static void memo_invalidate() {
+    MemoCache &c = get_memo();
+    c.epoch.fetch_add(1, std::memory_order_acq_rel);
+    c.invalidations.fetch_add(1, std::memory_order_relaxed);
+}
+
+static uint64_t memo_hash(bu_plugin_cmd_impl impl, const char *args, size_t len) {
+    uint64_t h = hash_name(args, len);
+    h ^= static_cast<uint64_t>(reinterpret_cast<uintptr_t>(impl)) * 0x9e3779b97f4a7c15ULL;
+    return h ^ (h >> 29);
+}
+
+static MemoShard& memo_shard(uint64_t h) {
+    return get_memo().shards[static_cast<size_t>(h >> 60) % MEMO_SHARDS];
+}
+
+/* Copy a cached result into out; false on a miss */
+static bool memo_find(bu_plugin_cmd_impl impl, const char *args, size_t len, BU_PLUGIN_CMD_RET *out) {
+    uint64_t h = memo_hash(impl, args, len);
+    uint64_t epoch = get_memo().epoch.load(std::memory_order_acquire);
+    MemoShard &s = memo_shard(h);
+    std::lock_guard<std::mutex> lock(s.m);
+    auto it = s.index.find(h);
+    if (it != s.index.end()) {
+	MemoSlot &slot = s.slots[it->second];
+	if (slot.epoch == epoch && slot.impl == impl && slot.args.size() == len &&
+		(len == 0 || std::memcmp(slot.args.data(), args, len) == 0)) {
+	    slot.referenced = true;
+	    s.hits++;
+	    if (out) slot.value.get(out);
+	    return true;
+	}
+    }
+    s.misses++;
+    return false;
+}
+
+/* Cache value for a call that started under epoch */
+static void memo_put(bu_plugin_cmd_impl impl, const char *args, size_t len, const BU_PLUGIN_CMD_RET *value, uint64_t epoch) {
+    MemoCache &c = get_memo();
+    uint64_t h = memo_hash(impl, args, len);
+    MemoShard &s = memo_shard(h);
+    std::lock_guard<std::mutex> lock(s.m);
+    if (s.slots.empty() || epoch != c.epoch.load(std::memory_order_acquire)) return;
+    size_t i;
+    auto it = s.index.find(h);
+    if (it != s.index.end()) {
+	i = it->second;
+    } else {
+	/* Sweep until a free or stale slot, or one not hit since the last pass */
+	for (;;) {
+	    i = s.hand;
+	    s.hand = (s.hand + 1) % s.slots.size();
+	    MemoSlot &cand = s.slots[i];
+	    if (cand.epoch != epoch) break;
+	    if (!cand.referenced) {
+		s.evictions++;
+		break;
+	    }
+	    cand.referenced = false;
+	}
+	MemoSlot &old = s.slots[i];
+	if (old.epoch) {
+	    auto o = s.index.find(old.hash);
+	    if (o != s.index.end() && o->second == i) s.index.erase(o);
+	}
+	s.index[h] = i;
+    }
+    MemoSlot &slot = s.slots[i];
+    slot.hash = h;
+    slot.impl = impl;
+    slot.args.assign(args ? args : "", len);
+    slot.epoch = epoch;
+    slot.referenced = false;
+    slot.value.set(value);
+}
+
+static void memo_resize(size_t entries) {
+    MemoCache &c = get_memo();
+    size_t per_shard = (entries + MEMO_SHARDS - 1) / MEMO_SHARDS;
+    c.capacity.store(0, std::memory_order_relaxed);
+    for (MemoShard &s : c.shards) {
+	std::lock_guard<std::mutex> lock(s.m);
+	std::vector<MemoSlot>(per_shard).swap(s.slots);
+	std::unordered_map<uint64_t, size_t>().swap(s.index);
+	s.hand = 0;
+    }
+    c.capacity.store(per_shard * MEMO_SHARDS, std::memory_order_relaxed);
+}
+
+#ifdef BU_PLUGIN_DEFAULT_SIGNATURE
+/* Run fn with exceptions contained; the bu_plugin_cmd_run() return convention */
+static int guarded_call(const char *name, bu_plugin_cmd_impl fn, BU_PLUGIN_CMD_RET *result) {
+    if (bu_plugin_call_ctx_stopped(tls_call_ctx)) return BU_PLUGIN_CALL_CANCELLED;
+    CmdArenaScope scope;
+    CmdOutputScope output;
+#if BU_PLUGIN_EXCEPTIONS
+    try {
+#endif
+	BU_PLUGIN_CMD_RET ret = fn();
+	if (call_failed(name)) return -2;
+	if (result) {
+	    *result = ret;
+	}
+	return 0;
+#if BU_PLUGIN_EXCEPTIONS
+    } catch (const std::exception& e) {
+	take_call_failure();    /* a bu_plugin_cmd_fail() before the throw */
+	bu_plugin_logf(BU_LOG_ERR, "Command '%s' threw exception: %s", name, e.what());
+	return -2;
+    } catch (...) {
+	take_call_failure();
+	bu_plugin_logf(BU_LOG_ERR, "Command '%s' threw unknown exception", name);
+	return -2;
+    }
+#endif
+}
+
+/* guarded_call() for commands flagged BU_PLUGIN_CMD_NOEXCEPT: nothing to catch */
+static int direct_call(const char *name, bu_plugin_cmd_impl fn, BU_PLUGIN_CMD_RET *result) noexcept {
+    if (bu_plugin_call_ctx_stopped(tls_call_ctx)) return BU_PLUGIN_CALL_CANCELLED;
+    CmdArenaScope scope;
+    CmdOutputScope output;
+    BU_PLUGIN_CMD_RET ret = fn();
+    if (call_failed(name)) return -2;
+    if (result) {
+	*result = ret;
+    }
+    return 0;
+}
+
+/* guarded_call(), or direct_call() for noexcept commands and the result cache for pure ones */
+static int cached_call(const char *name, bu_plugin_cmd_impl fn, unsigned int flags, BU_PLUGIN_CMD_RET *result) {
+    if (!(flags & BU_PLUGIN_CMD_PURE) || !memo_enabled()) {
+	return (flags & BU_PLUGIN_CMD_NOEXCEPT) ? direct_call(name, fn, result) : guarded_call(name, fn, result);
+    }
+    if (bu_plugin_call_ctx_stopped(tls_call_ctx)) return BU_PLUGIN_CALL_CANCELLED;
+    uint64_t epoch = get_memo().epoch.load(std::memory_order_acquire);
+    if (memo_find(fn, nullptr, 0, result)) return 0;
+    BU_PLUGIN_CMD_RET ret = BU_PLUGIN_CMD_RET();
+    int status = (flags & BU_PLUGIN_CMD_NOEXCEPT) ? direct_call(name, fn, &ret) : guarded_call(name, fn, &ret);
+    if (status == 0) {
+	memo_put(fn, nullptr, 0, &ret, epoch);
+	if (result) *result = ret;
+    }
+    return status;
+}
+
+/* One stage of bu_plugin_pipeline_run() */
+struct PipelineStage {
+    const char *name;
+    bu_plugin_cmd_impl fn;
+    bu_plugin_channel *in;
+    bu_plugin_channel *out;
+    BU_PLUGIN_CMD_RET result;
+    int status;
+};
+
+static void run_pipeline_stage(PipelineStage &st, CallCtx *ctx, bu_plugin_ctx *reg,
+	bu_plugin_channel *const *links, size_t nlinks) {
+    CallCtxScope ctx_scope(ctx);
+    RegistryScope reg_scope(reg);
+    bu_plugin_channel *prev_in = tls_channel_in;
+    bu_plugin_channel *prev_out = tls_channel_out;
+    tls_channel_in = st.in;
+    tls_channel_out = st.out;
+    st.status = guarded_call(st.name, st.fn, &st.result);
+    tls_channel_in = prev_in;
+    tls_channel_out = prev_out;
+    if (st.status != 0) {
+	for (size_t i = 0; i < nlinks; i++) {
+	    if (links[i]) channel_finish(links[i], CHANNEL_CANCELLED);
+	}
+	return;
+    }
+    /* Downstream sees the end of the stream; upstream stops producing */
+    if (st.out) channel_finish(st.out, CHANNEL_CLOSED);
+    if (st.in) channel_finish(st.in, CHANNEL_CANCELLED);
+}
+#endif /* BU_PLUGIN_DEFAULT_SIGNATURE */
+
+#ifdef BU_PLUGIN_CMD_ARGV_SIGNATURE
+/* bu_plugin_cmd_run_line() buffers for one nesting level on one thread */
+struct LineFrame {
+    std::vector<char> text;             /* Copy of the line, split in place */
+    std::vector<const char *> argv;     /* Command name, arguments, NULL */
+    std::string args;                   /* Result cache key: the arguments, each NUL-terminated */
+};
+
+struct LineFrames {
+    std::deque<LineFrame> frames;       /* A deque: references survive growth */
+    size_t depth;
+    std::string key;                    /* Registry lookup key, reused */
+    LineFrames() : depth(0) {}
+};
+
+static LineFrames& line_frames() {
+    static thread_local LineFrames frames;
+    return frames;
+}
+
+/* The command named by word and its flags, without allocating once key has grown */
+static bu_plugin_cmd_impl line_lookup(const char *word, std::string &key, unsigned int &flags) {
+    flags = 0;
+    bu_plugin_ctx &r = current_registry();
+    const FrozenTable *frozen = r.frozen.load(std::memory_order_acquire);
+    if (frozen) {
+	const FrozenSlot *slot = frozen_find(frozen, word);
+	if (!slot) return nullptr;
+	flags = slot->flags;
+	return slot->impl;
+    }
+    key.assign(word);
+    std::lock_guard<std::mutex> lock(r.mtx);
+    auto it = r.registry.find(key);
+    if (it == r.registry.end()) return nullptr;
+    flags = cmd_flags_of(r, key);
+    return it->second;
+}
+
+static int run_line(const char *line, BU_PLUGIN_CMD_RET *result) {
+    if (!line) return -1;
+    if (bu_plugin_call_ctx_stopped(tls_call_ctx)) return BU_PLUGIN_CALL_CANCELLED;
+    LineFrames &lf = line_frames();
+    if (lf.depth == lf.frames.size()) lf.frames.push_back(LineFrame());
+    LineFrame &f = lf.frames[lf.depth];
+    f.text.assign(line, line + std::strlen(line) + 1);
+    f.argv.clear();
+    char *cursor = f.text.data();
+    const char *word = nullptr;
+    int rc;
+    while ((rc = line_word(&cursor, &word)) == 1) f.argv.push_back(word);
+    if (rc < 0) {
+	bu_plugin_logf(BU_LOG_ERR, "Unterminated quote in command line '%s'", line);
+	return -1;
+    }
+    if (f.argv.empty()) {
+	bu_plugin_logf(BU_LOG_ERR, "Empty command line");
+	return -1;
+    }
+    unsigned int flags = 0;
+    bu_plugin_cmd_impl fn = line_lookup(f.argv[0], lf.key, flags);
+    if (!fn) {
+	bu_plugin_logf(BU_LOG_ERR, "Command '%s' not found", f.argv[0]);
+	return -1;
+    }
+
+    /* A pure command's arguments, each with its NUL, key the result cache */
+    bool memo = (flags & BU_PLUGIN_CMD_PURE) && memo_enabled();
+    uint64_t epoch = 0;
+    if (memo) {
+	f.args.clear();
+	for (size_t i = 1; i < f.argv.size(); i++) f.args.append(f.argv[i], std::strlen(f.argv[i]) + 1);
+	epoch = get_memo().epoch.load(std::memory_order_acquire);
+	if (memo_find(fn, f.args.data(), f.args.size(), result)) return 0;
+    }
+    f.argv.push_back(nullptr);
+
+    /* Nested calls from the command get the next frame */
+    struct DepthScope {
+	size_t &depth;
+	explicit DepthScope(size_t &d) : depth(d) { ++depth; }
+	~DepthScope() { --depth; }
+    } depth_scope(lf.depth);
+    CmdArenaScope scope;
+    CmdOutputScope output;
+#if BU_PLUGIN_EXCEPTIONS
+    try {
+#endif
+	BU_PLUGIN_CMD_RET ret = fn(static_cast<int>(f.argv.size() - 2), f.argv.data() + 1);
+	if (call_failed(f.argv[0])) return -2;
+	if (memo) memo_put(fn, f.args.data(), f.args.size(), &ret, epoch);
+	if (result) {
+	    *result = ret;
+	}
+	return 0;
+#if BU_PLUGIN_EXCEPTIONS
+    } catch (const std::exception& e) {
+	take_call_failure();    /* a bu_plugin_cmd_fail() before the throw */
+	bu_plugin_logf(BU_LOG_ERR, "Command '%s' threw exception: %s", f.argv[0], e.what());
+	return -2;
+    } catch (...) {
+	take_call_failure();
+	bu_plugin_logf(BU_LOG_ERR, "Command '%s' threw unknown exception", f.argv[0]);
+	return -2;
+    }
+#endif
+}
+#endif /* BU_PLUGIN_CMD_ARGV_SIGNATURE */
+
+/* A plugin that has been opened and validated but not yet registered */
+struct OpenedPlugin {
+    bu_plugin_module_handle_t handle;
+    const bu_plugin_manifest *manifest;
+    const bu_plugin_manifest_v2 *ext;   /* NULL for v1 manifests */
+    unsigned int sig;                   /* Signature ID of its commands */
+    LoadTiming timing;
+};
+
+static LoadSettings resolve_load_settings(const bu_plugin_load_opts *opts) {
+    LoadSettings ls;
+    ls.binding = BU_PLUGIN_BIND_NOW;
+    ls.visibility = BU_PLUGIN_VIS_LOCAL;
+    ls.nodelete = 0;
+    ls.isolate = 0;
+    ls.flags = get_load_flags().load();
+    ls.win_flags = 0;
+    if (opts) {
+	size_t sz = opts->struct_size;
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_load_opts, sz, binding)) ls.binding = opts->binding;
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_load_opts, sz, visibility)) ls.visibility = opts->visibility;
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_load_opts, sz, nodelete)) ls.nodelete = opts->nodelete;
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_load_opts, sz, isolate)) ls.isolate = opts->isolate;
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_load_opts, sz, flags)) ls.flags |= opts->flags;
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_load_opts, sz, win_flags)) ls.win_flags = opts->win_flags;
+    }
+    return ls;
+}
+
+static std::string plugin_name_of(const OpenedPlugin &p) {
+    return trim_whitespace(p.manifest->plugin_name);
+}
+
+/* Dependency names declared by a v2 manifest */
+static std::vector<std::string> plugin_depends_of(const OpenedPlugin &p) {
+    std::vector<std::string> deps;
+    if (p.ext && BU_PLUGIN_V2_HAS(p.ext, depends) && p.ext->depends) {
+	for (const char * const *d = p.ext->depends; *d; ++d) {
+	    std::string name = trim_whitespace(*d);
+	    if (!name.empty()) deps.push_back(name);
+	}
+    }
+    return deps;
+}
+
+static bool module_loaded(const std::string &name) {
+    if (name.empty()) return false;
+    std::lock_guard<std::mutex> lock(get_modules_mutex());
+    for (const auto &m : get_modules()) {
+	if (m.name == name) return true;
+    }
+    return false;
+}
+
+/**
+ * Open a plugin and validate its manifest without registering anything.
+ * Logs and returns false on failure (the module is closed).
+ */
+static bool open_plugin(const char *path, const LoadSettings &ls, OpenedPlugin &out) {
+    out.timing = LoadTiming();
+    const char *info_sym = current_registry().info_sym.c_str();
+    const char *sig_sym = current_registry().sig_sym.c_str();
+
+    if (!path || path[0] == '\0') {
+	bu_plugin_logf(BU_LOG_ERR, "Invalid plugin path (null or empty)");
+	return false;
+    }
+
+    /* Enforce path allow policy */
+    bu_plugin_path_allow_cb path_allow = get_path_allow();
+    if (path_allow && !path_allow(path)) {
+	bu_plugin_logf(BU_LOG_ERR, "Plugin path '%s' not allowed by policy", path);
+	return false;
+    }
+
+#if defined(_WIN32)
+    /* Convert UTF-8 path to UTF-16 for Windows */
+    int wlen = MultiByteToWideChar(CP_UTF8, 0, path, -1, NULL, 0);
+    if (wlen <= 0) {
+	bu_plugin_logf(BU_LOG_ERR, "Failed to convert plugin path to UTF-16: %s (error %lu)", path, GetLastError());
+	return false;
+    }
+    std::vector<wchar_t> wpath(static_cast<size_t>(wlen));
+    MultiByteToWideChar(CP_UTF8, 0, path, -1, wpath.data(), wlen);
+
+    /* Use LoadLibraryExW with safer flags (no DLL search path manipulation) unless overridden */
+    auto open_start = std::chrono::steady_clock::now();
+    DWORD load_flags = ls.win_flags ? static_cast<DWORD>(ls.win_flags)
+	: static_cast<DWORD>(LOAD_LIBRARY_SEARCH_DLL_LOAD_DIR | LOAD_LIBRARY_SEARCH_DEFAULT_DIRS);
+    HMODULE handle = LoadLibraryExW(wpath.data(), NULL, load_flags);
+    if (!handle && !ls.win_flags) {
+	/* Fallback to LoadLibraryW if the flags are not supported */
+	handle = LoadLibraryW(wpath.data());
+    }
+    if (!handle) {
+	DWORD err = GetLastError();
+	bu_plugin_logf(BU_LOG_ERR, "Failed to load plugin: %s (Windows error %lu)", path, err);
+	return false;
+    }
+    if (ls.nodelete) {
+	HMODULE pinned = NULL;
+	GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_PIN, wpath.data(), &pinned);
+    }
+    out.timing.open_us = elapsed_us(open_start);
+    auto resolve_start = std::chrono::steady_clock::now();
+    typedef const bu_plugin_manifest* (*info_fn)(void);
+    info_fn get_info = reinterpret_cast<info_fn>(reinterpret_cast<void*>(GetProcAddress(handle, info_sym)));
+    if (!get_info) {
+	DWORD err = GetLastError();
+	bu_plugin_logf(BU_LOG_ERR, "Plugin %s does not export %s (Windows error %lu)", path, info_sym, err);
+	FreeLibrary(handle);
+	return false;
+    }
+    typedef const char* (*sig_fn)(void);
+    sig_fn get_sig = reinterpret_cast<sig_fn>(reinterpret_cast<void*>(GetProcAddress(handle, sig_sym)));
+#else
+    int dlflags = (ls.binding == BU_PLUGIN_BIND_LAZY) ? RTLD_LAZY : RTLD_NOW;
+    dlflags |= (ls.visibility == BU_PLUGIN_VIS_GLOBAL) ? RTLD_GLOBAL : RTLD_LOCAL;
+#if defined(RTLD_NODELETE)
+    if (ls.nodelete) dlflags |= RTLD_NODELETE;
+#endif
+    auto open_start = std::chrono::steady_clock::now();
+    void *handle = nullptr;
+    size_t huge = 0;
+    double huge_us = 0.0;
+    {
+	std::lock_guard<std::mutex> open_lock(get_open_mutex());
+	/* A module that is already loaded may be running: only a fresh one is remapped */
+	bool remap = (ls.flags & BU_PLUGIN_LOAD_HUGEPAGES) != 0;
+	if (ls.isolate) {
+#if defined(__GLIBC__)
+	    handle = dlmopen(LM_ID_NEWLM, path, dlflags);
+#else
+	    bu_plugin_logf(BU_LOG_ERR, "Failed to load plugin: %s (isolated namespaces need glibc dlmopen)", path);
+	    return false;
+#endif
+	} else {
+	    if (remap) {
+		void *prior = dlopen(path, RTLD_LAZY | RTLD_NOLOAD);
+		if (prior) {
+		    bu_plugin_logf(BU_LOG_INFO, "Plugin %s is already loaded; not moving its text onto huge pages", path);
+		    dlclose(prior);
+		    remap = false;
+		}
+	    }
+	    handle = dlopen(path, dlflags);
+	}
+#if defined(__linux__)
+	if (handle && remap) {
+	    auto huge_start = std::chrono::steady_clock::now();
+	    huge = remap_module_huge(handle, path);
+	    huge_us = elapsed_us(huge_start);
+	}
+#endif
+    }
+    if (!handle) {
+	const char *err = dlerror();
+	bu_plugin_logf(BU_LOG_ERR, "Failed to load plugin: %s (%s)", path, err ? err : "unknown error");
+	return false;
+    }
+    out.timing.open_us = elapsed_us(open_start);
+    auto resolve_start = std::chrono::steady_clock::now();
+
+    /* Clear dlerror before dlsym for accurate error reporting */
+    dlerror();
+
+    typedef const bu_plugin_manifest* (*info_fn)(void);
+    info_fn get_info = reinterpret_cast<info_fn>(dlsym(handle, info_sym));
+    const char *sym_err = dlerror();
+    if (sym_err || !get_info) {
+	bu_plugin_logf(BU_LOG_ERR, "Plugin %s does not export %s (%s)",
+		path, info_sym, sym_err ? sym_err : "symbol not found");
+	dlclose(handle);
+	return false;
+    }
+    /* Optional: plugins built before signatures were reported have the host's */
+    typedef const char* (*sig_fn)(void);
+    sig_fn get_sig = reinterpret_cast<sig_fn>(dlsym(handle, sig_sym));
+    dlerror();
+#endif
+
+    const bu_plugin_manifest *manifest = get_info();
+    if (!manifest) {
+	bu_plugin_logf(BU_LOG_ERR, "Plugin %s returned NULL manifest", path);
+	close_module(handle);
+	return false;
+    }
+
+    /* Validate manifest ABI version and struct_size */
+    if (manifest->abi_version != BU_PLUGIN_ABI_VERSION) {
+	bu_plugin_logf(BU_LOG_ERR, "Plugin %s has incompatible ABI version %u (expected %u)",
+		path, manifest->abi_version, BU_PLUGIN_ABI_VERSION);
+	close_module(handle);
+	return false;
+    }
+
+    if (manifest->struct_size < sizeof(bu_plugin_manifest)) {
+	bu_plugin_logf(BU_LOG_ERR, "Plugin %s has incompatible manifest struct_size %zu (expected >= %zu)",
+		path, manifest->struct_size, sizeof(bu_plugin_manifest));
+	close_module(handle);
+	return false;
+    }
+
+    /* A struct_size covering ext_version marks a v2 manifest */
+    const bu_plugin_manifest_v2 *ext = nullptr;
+    if (manifest->struct_size >= offsetof(bu_plugin_manifest_v2, ext_version) + sizeof(unsigned int)) {
+	ext = reinterpret_cast<const bu_plugin_manifest_v2 *>(manifest);
+	if (ext->ext_version == 0) {
+	    bu_plugin_logf(BU_LOG_ERR, "Plugin %s has a v2 manifest with ext_version 0", path);
+	    close_module(handle);
+	    return false;
+	}
+    }
+
+    /* Hand the host services table to plugins that ask for it */
+    if (ext && BU_PLUGIN_V2_HAS(ext, bind) && ext->bind) {
+	if (ext->bind(&get_host_services()) != 0) {
+	    bu_plugin_logf(BU_LOG_ERR, "Plugin %s rejected the host services table", path);
+	    close_module(handle);
+	    return false;
+	}
+    }
+
+    out.timing.resolve_us = elapsed_us(resolve_start);
+
+    auto prefault_start = std::chrono::steady_clock::now();
+#if defined(_WIN32)
+    const size_t huge = 0;
+    const double huge_us = 0.0;
+#endif
+    prefault_module(handle, path, ls.flags, huge);
+    out.timing.prefault_us = huge_us + elapsed_us(prefault_start);
+
+    out.handle = handle;
+    out.manifest = manifest;
+    out.ext = ext;
+    out.sig = get_sig ? bu_plugin_sig_id(get_sig()) : BU_PLUGIN_SIG_NATIVE;
+    if (out.sig != BU_PLUGIN_SIG_NATIVE) {
+	bu_plugin_logf(BU_LOG_INFO, "Plugin %s has commands of signature %s", path, bu_plugin_sig_name(out.sig));
+    }
+    return true;
+}
+
+/* Remove commands by name (used to roll back a plugin whose init failed) */
+static void unregister_commands(const std::vector<std::string> &names) {
+    if (!names.empty()) memo_invalidate();
+    std::lock_guard<std::mutex> lock(get_mutex());
+    auto &reg = get_registry();
+    for (const auto &n : names) {
+	reg.erase(n);
+	get_cmd_flags().erase(n);
+	get_cmd_batch().erase(n);
+	get_cmd_strands().erase(n);
+	get_cmd_sigs().erase(n);
+	update_handle(n, nullptr);
+	update_handle_strand(n);
+    }
+}
+
+/**
+ * Register an opened plugin's commands, run its init hook and retain the
+ * module. Returns the number of commands registered, or -1 if init failed
+ * (the commands are removed again and the module is closed).
+ */
+static int activate_plugin(const char *path, OpenedPlugin &p) {
+    const bu_plugin_manifest *manifest = p.manifest;
+    auto register_start = std::chrono::steady_clock::now();
+    int registered = 0;
+    std::vector<std::string> registered_names;
+
+    if (!manifest->commands || manifest->cmd_count == 0) {
+	/* Not an error, just nothing to register */
+	bu_plugin_logf(BU_LOG_INFO, "Plugin %s has no commands", path);
+    } else {
+	/* Detect duplicate command names within the manifest */
+	std::unordered_set<std::string> manifest_names;
+	for (unsigned int i = 0; i < manifest->cmd_count; i++) {
+	    const bu_plugin_cmd *cmd = &manifest->commands[i];
+	    if (cmd->name) {
+		std::string trimmed = trim_whitespace(cmd->name);
+		if (!trimmed.empty() && manifest_names.find(trimmed) != manifest_names.end()) {
+		    bu_plugin_logf(BU_LOG_WARN, "Plugin %s has duplicate command name '%s' in manifest",
+			    path, trimmed.c_str());
+		}
+		manifest_names.insert(trimmed);
+	    }
+	}
+
+	const unsigned int *flags = (p.ext && BU_PLUGIN_V2_HAS(p.ext, cmd_flags)) ? p.ext->cmd_flags : nullptr;
+	const bu_plugin_cmd_batch_impl *batch = (p.ext && BU_PLUGIN_V2_HAS(p.ext, cmd_batch)) ? p.ext->cmd_batch : nullptr;
+	for (unsigned int i = 0; i < manifest->cmd_count; i++) {
+	    const bu_plugin_cmd *cmd = &manifest->commands[i];
+	    if (cmd->name && cmd->impl) {
+		int result = bu_plugin_cmd_register_sig(cmd->name, p.sig, reinterpret_cast<bu_plugin_any_fn>(cmd->impl));
+		if (result == 0) {
+		    registered++;
+		    registered_names.push_back(trim_whitespace(cmd->name));
+		    if (flags && flags[i]) bu_plugin_cmd_set_flags(cmd->name, flags[i]);
+		    /* Batched entry points take the host's argument arrays */
+		    if (batch && batch[i] && p.sig == BU_PLUGIN_SIG_NATIVE) bu_plugin_cmd_set_batch(cmd->name, batch[i]);
+		}
+		/* result == 1 means duplicate (logged by register function) */
+	    }
+	}
+    }
+
+    /* Commands that are not thread-safe run on the plugin's strand */
+    if (!registered_names.empty()) {
+	std::string key = plugin_name_of(p);
+	bu_plugin_strand *strand = bu_plugin_strand_get(key.empty() ? path : key.c_str());
+	std::lock_guard<std::mutex> lock(get_mutex());
+	for (const auto &n : registered_names) {
+	    get_cmd_strands()[n].module = strand;
+	    update_handle_strand(n);
+	}
+    }
+
+    p.timing.register_us = elapsed_us(register_start);
+
+    bu_plugin_fini_fn fini = nullptr;
+    if (p.ext) {
+	if (BU_PLUGIN_V2_HAS(p.ext, init) && p.ext->init) {
+	    auto init_start = std::chrono::steady_clock::now();
+	    int ret = p.ext->init();
+	    p.timing.init_us = elapsed_us(init_start);
+	    if (ret != 0) {
+		bu_plugin_logf(BU_LOG_ERR, "Plugin %s init hook failed (returned %d)", path, ret);
+		unregister_commands(registered_names);
+		close_module(p.handle);
+		return -1;
+	    }
+	}
+	if (BU_PLUGIN_V2_HAS(p.ext, fini)) fini = p.ext->fini;
+    }
+
+    /* Retain module handle for lifetime */
+    {
+	std::lock_guard<std::mutex> lock(get_modules_mutex());
+	get_modules().push_back({p.handle, plugin_name_of(p), fini});
+    }
+
+    return registered;
+}
+
+/* One plugin in a bu_plugin_load_graph() set */
+struct GraphNode {
+    std::string path;
+    std::string name;
+    OpenedPlugin plugin;
+    bool opened;
+    std::vector<size_t> deps;           /* indices of in-set dependencies */
+    std::vector<size_t> dependents;
+    size_t pending;                     /* unfinished in-set dependencies */
+    bool skip;                          /* a dependency failed */
+    bool ok;
+    int registered;
+    double open_us;
+    double activate_us;
+    double path_us;                     /* longest chain ending at this node */
+    size_t path_prev;                   /* predecessor on that chain, or SIZE_MAX */
+};
+
+/* Calls that have started helper threads of their own (parallel_for, pipelines, load graphs) */
+static std::atomic<int>& get_helper_calls() {
+    static std::atomic<int> n(0);
+    return n;
+}
+
+/* Marks a call as running helper threads until they are joined */
+struct HelperThreadsScope {
+    HelperThreadsScope() { get_helper_calls()++; }
+    ~HelperThreadsScope() { get_helper_calls()--; }
+    HelperThreadsScope(const HelperThreadsScope &) = delete;
+    HelperThreadsScope &operator=(const HelperThreadsScope &) = delete;
+};
+
+/* Run fn(i) for i in [0, n) on up to nthreads threads */
+template <typename Fn>
+static void parallel_for(size_t n, unsigned int nthreads, Fn fn) {
+    HelperThreadsScope helpers;
+    std::atomic<size_t> next(0);
+    bu_plugin_ctx *reg = tls_registry;
+    auto worker = [&]() {
+	RegistryScope reg_scope(reg);
+	for (size_t i = next++; i < n; i = next++) fn(i);
+    };
+    size_t extra = std::min(static_cast<size_t>(nthreads), n);
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < extra; t++) threads.emplace_back(worker);
+    worker();
+    for (auto &t : threads) t.join();
+}
+
+/* Find a cycle among nodes that never became ready, for the error message */
+template <typename Node>
+static std::string describe_cycle(const std::vector<Node> &nodes) {
+    size_t start = SIZE_MAX;
+    for (size_t i = 0; i < nodes.size(); i++) {
+	if (nodes[i].pending > 0) { start = i; break; }
+    }
+    if (start == SIZE_MAX) return "";
+    /* Walk unresolved dependencies until a node repeats */
+    std::vector<size_t> order;
+    std::vector<size_t> seen_at(nodes.size(), SIZE_MAX);
+    size_t cur = start;
+    while (seen_at[cur] == SIZE_MAX) {
+	seen_at[cur] = order.size();
+	order.push_back(cur);
+	size_t next = cur;
+	for (size_t d : nodes[cur].deps) {
+	    if (nodes[d].pending > 0) { next = d; break; }
+	}
+	cur = next;
+    }
+    std::string desc;
+    for (size_t i = seen_at[cur]; i < order.size(); i++) {
+	desc += nodes[order[i]].name;
+	desc += " -> ";
+    }
+    desc += nodes[cur].name;
+    return desc;
+}
+
+/**
+ * Work-stealing executor. A job is either a plain bu_plugin_job_fn or a
+ * command (entry + completion callback); both fit in the job itself, so
+ * posting does not allocate beyond the deque's own storage.
+ */
+struct Lane;
+
+struct Job {
+    bu_plugin_job_fn fn;
+    void *arg;                  /* fn's argument, or the command's user pointer */
+    bu_plugin_cmd_entry *cmd;   /* Non-NULL for a command job */
+#ifdef BU_PLUGIN_DEFAULT_SIGNATURE
+    bu_plugin_cmd_done_fn done;
+#endif
+    Lane *lane;                 /* Admitting lane of a submitted command, or NULL */
+    CallCtx *ctx;               /* Call context current at submission (a held reference), or NULL */
+    bu_plugin_ctx *reg;         /* Registry context current at submission (NULL: the default) */
+    bool limited;               /* Counted against the lane's max_running */
+    uint64_t admitted_ns;
+};
+
+/* One worker's deque, padded so neighbouring queues do not share a cache line */
+struct WorkerQueue {
+    std::mutex m;
+    std::deque<Job> q;
+    char pad[64];
+};
+
+struct Executor;
+static thread_local Executor *tls_executor = nullptr;
+static thread_local size_t tls_worker = 0;
+
+} /* namespace bu_plugin_impl */
+
+/* A serial queue of jobs; at most one strand runner job is on the executor at a time */
+struct bu_plugin_strand {
+    std::string name;
+    std::mutex m;
+    std::deque<bu_plugin_impl::Job> q;
+    bool running;                       /* A runner is queued or running */
+    explicit bu_plugin_strand(const std::string &n) : name(n), running(false) {}
+};
+
+namespace bu_plugin_impl {
+
+/* Strands by name, never freed. Protected by get_strands_mutex(). */
+static std::mutex& get_strands_mutex() {
+    static std::mutex m;
+    return m;
+}
+
+static std::unordered_map<std::string, std::unique_ptr<bu_plugin_strand> >& get_strands() {
+    static std::unordered_map<std::string, std::unique_ptr<bu_plugin_strand> > strands;
+    return strands;
+}
+
+static void lane_started(const Job &job);
+static void lane_finished(const Job &job);
+
+/* Run one job: a command (with its completion callback) or a plain function */
+static void execute_job(const Job &job) {
+    if (job.lane) lane_started(job);
+    CallCtxScope ctx_scope(job.ctx);
+    RegistryScope reg_scope(job.reg);
+    if (job.cmd) {
+#ifdef BU_PLUGIN_DEFAULT_SIGNATURE
+	BU_PLUGIN_CMD_RET result = BU_PLUGIN_CMD_RET();
+	int status = -1;
+	bu_plugin_cmd_impl fn = job.cmd->impl.load(std::memory_order_acquire);
+	if (fn) {
+	    status = cached_call(job.cmd->name.c_str(), fn, job.cmd->flags.load(std::memory_order_acquire), &result);
+	} else {
+	    bu_plugin_logf(BU_LOG_ERR, "Command '%s' not found", job.cmd->name.c_str());
+	}
+	if (job.done) {
+#if BU_PLUGIN_EXCEPTIONS
+	    try {
+		job.done(status, result, job.arg);
+	    } catch (...) {
+		bu_plugin_logf(BU_LOG_ERR, "Completion callback for '%s' threw an exception", job.cmd->name.c_str());
+	    }
+#else
+	    job.done(status, result, job.arg);
+#endif
+	}
+#endif
+    } else {
+#if BU_PLUGIN_EXCEPTIONS
+	try {
+	    job.fn(job.arg);
+	} catch (const std::exception &e) {
+	    bu_plugin_logf(BU_LOG_ERR, "Executor job threw exception: %s", e.what());
+	} catch (...) {
+	    bu_plugin_logf(BU_LOG_ERR, "Executor job threw unknown exception");
+	}
+#else
+	job.fn(job.arg);
+#endif
+    }
+    if (job.lane) lane_finished(job);
+    ctx_release(job.ctx);
+}
+
+struct Executor {
+    std::vector<std::unique_ptr<WorkerQueue> > queues;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> next{0};            /* Round-robin target for external posts */
+    std::atomic<size_t> queued{0};          /* Jobs sitting in a deque */
+    std::atomic<size_t> inflight{0};        /* Jobs queued or running */
+    std::atomic<unsigned int> sleepers{0};
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> closing{false};       /* Set by bu_plugin_exec_stop(): no new pins */
+    std::mutex sleep_m;
+    std::condition_variable sleep_cv;
+    std::mutex drain_m;
+    std::condition_variable drain_cv;
+
+    explicit Executor(unsigned int n) {
+	for (unsigned int i = 0; i < n; i++) queues.emplace_back(new WorkerQueue());
+	for (unsigned int i = 0; i < n; i++) threads.emplace_back(&Executor::worker_main, this, static_cast<size_t>(i));
+    }
+
+    /* Background jobs go to the front: taken last by the owner, first by thieves */
+    void post(const Job &job, bool background = false) {
+	size_t target = (tls_executor == this) ? tls_worker : next.fetch_add(1, std::memory_order_relaxed) % queues.size();
+	inflight.fetch_add(1, std::memory_order_relaxed);
+	{
+	    std::lock_guard<std::mutex> lock(queues[target]->m);
+	    if (background) {
+		queues[target]->q.push_front(job);
+	    } else {
+		queues[target]->q.push_back(job);
+	    }
+	}
+	queued.fetch_add(1, std::memory_order_seq_cst);
+	if (sleepers.load(std::memory_order_seq_cst) > 0) {
+	    std::lock_guard<std::mutex> lock(sleep_m);
+	    sleep_cv.notify_one();
+	}
+    }
+
+    /* Own deque from the back, then steal from the front of the others */
+    bool take(size_t self, Job &out) {
+	{
+	    WorkerQueue &wq = *queues[self];
+	    std::lock_guard<std::mutex> lock(wq.m);
+	    if (!wq.q.empty()) {
+		out = wq.q.back();
+		wq.q.pop_back();
+		queued.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	    }
+	}
+	for (size_t i = 1; i < queues.size(); i++) {
+	    WorkerQueue &victim = *queues[(self + i) % queues.size()];
+	    std::lock_guard<std::mutex> lock(victim.m);
+	    if (!victim.q.empty()) {
+		out = victim.q.front();
+		victim.q.pop_front();
+		queued.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	    }
+	}
+	return false;
+    }
+
+    void run(const Job &job) {
+	execute_job(job);
+	if (inflight.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+	    std::lock_guard<std::mutex> lock(drain_m);
+	    drain_cv.notify_all();
+	}
+    }
+
+    void worker_main(size_t self) {
+	tls_executor = this;
+	tls_worker = self;
+	Job job;
+	for (;;) {
+	    if (take(self, job)) {
+		run(job);
+		continue;
+	    }
+	    std::unique_lock<std::mutex> lock(sleep_m);
+	    sleepers.fetch_add(1, std::memory_order_seq_cst);
+	    while (queued.load(std::memory_order_seq_cst) == 0 && !stopping.load()) {
+		sleep_cv.wait(lock);
+	    }
+	    sleepers.fetch_sub(1, std::memory_order_seq_cst);
+	    if (stopping.load() && queued.load() == 0) return;
+	}
+    }
+
+    void drain() {
+	std::unique_lock<std::mutex> lock(drain_m);
+	drain_cv.wait(lock, [this]() { return inflight.load(std::memory_order_acquire) == 0; });
+    }
+
+    void stop() {
+	drain();
+	{
+	    std::lock_guard<std::mutex> lock(sleep_m);
+	    stopping.store(true);
+	}
+	sleep_cv.notify_all();
+	for (auto &t : threads) t.join();
+    }
+};
+
+static std::mutex& get_exec_mutex() {
+    static std::mutex m;
+    return m;
+}
+
+static std::atomic<Executor *>& get_executor() {
+    static std::atomic<Executor *> exec(nullptr);
+    return exec;
+}
+
+/* Callers outside the workers currently holding an ExecPin */
+static std::atomic<unsigned int>& get_exec_users() {
+    static std::atomic<unsigned int> users(0);
+    return users;
+}
+
+static void wait_exec_users() {
+    while (get_exec_users().load() != 0) std::this_thread::yield();
+}
+
+/*
+ * Keeps the executor alive while a caller posts to it or waits on the
+ * jobs it posted. bu_plugin_exec_stop() closes the executor to new pins
+ * and waits for the held ones before draining it, and waits again after
+ * unpublishing it before the delete. The count is raised before the
+ * executor is loaded, so a stop either sees the caller or the caller
+ * sees the stop. Workers use their own executor unpinned: a stop joins
+ * them before deleting it. e is null when the executor is closing, or
+ * not running and start is false; otherwise start runs it with the
+ * default worker count.
+ */
+struct ExecPin {
+    Executor *e = nullptr;
+    bool pinned = false;
+
+    explicit ExecPin(bool start) {
+	if (tls_executor) {
+	    e = tls_executor;
+	    return;
+	}
+	for (;;) {
+	    get_exec_users()++;
+	    Executor *cur = get_executor().load();
+	    if (cur && !cur->closing.load()) {
+		e = cur;
+		pinned = true;
+		return;
+	    }
+	    get_exec_users()--;
+	    if (cur || !start) return;
+	    bu_plugin_exec_start(0);
+	}
+    }
+    ~ExecPin() { if (pinned) get_exec_users()--; }
+    ExecPin(const ExecPin &) = delete;
+    ExecPin &operator=(const ExecPin &) = delete;
+};
+
+/* Jobs a strand runner executes before requeueing itself, so one busy strand cannot hold a worker */
+static const size_t STRAND_BATCH = 64;
+
+static void strand_run(void *arg) {
+    bu_plugin_strand *s = static_cast<bu_plugin_strand *>(arg);
+    for (size_t n = 0; ; n++) {
+	Job job;
+	{
+	    std::lock_guard<std::mutex> lock(s->m);
+	    if (s->q.empty()) {
+		s->running = false;
+		return;
+	    }
+	    if (n == STRAND_BATCH) {
+		Job runner = Job();
+		runner.fn = strand_run;
+		runner.arg = s;
+		tls_executor->post(runner);
+		return;
+	    }
+	    job = s->q.front();
+	    s->q.pop_front();
+	}
+	execute_job(job);
+    }
+}
+
+/* Queue a job on a strand, starting its runner if it is idle */
+static void strand_post(Executor *e, bu_plugin_strand *s, const Job &job) {
+    {
+	std::lock_guard<std::mutex> lock(s->m);
+	s->q.push_back(job);
+	if (s->running) return;
+	s->running = true;
+    }
+    Job runner = Job();
+    runner.fn = strand_run;
+    runner.arg = s;
+    e->post(runner);
+}
+
+/**
+ * Priority lanes. A lane admits submitted commands (bounded by capacity,
+ * with a full-lane policy) and keeps at most max_running of them on the
+ * executor; the rest are held in the lane in FIFO order and released as
+ * its jobs finish. Unbounded, unlimited lanes skip the lane mutex.
+ */
+
+/* Log-linear wait-time histogram: 8 buckets per power of two nanoseconds */
+static const size_t LANE_HIST_BUCKETS = 8 * 44;
+
+static size_t lane_bucket(uint64_t ns) {
+    if (ns < 8) return static_cast<size_t>(ns);
+    unsigned int e = 3;
+    while (e < 63 && (ns >> (e + 1)) != 0) e++;
+    size_t idx = (e - 2) * 8 + static_cast<size_t>((ns >> (e - 3)) & 7);
+    return std::min(idx, LANE_HIST_BUCKETS - 1);
+}
+
+/* Smallest value above the bucket, in ns */
+static uint64_t lane_bucket_ceiling(size_t idx) {
+    if (idx < 8) return idx + 1;
+    unsigned int e = static_cast<unsigned int>(idx / 8) + 2;
+    return (9 + static_cast<uint64_t>(idx % 8)) << (e - 3);
+}
+
+struct Lane {
+    std::mutex m;
+    std::condition_variable space_cv;
+    std::deque<Job> held;                       /* Admitted, waiting for a running slot; protected by m */
+    unsigned int dispatched = 0;                /* Limited jobs on the executor; protected by m */
+    std::atomic<size_t> capacity{0};
+    std::atomic<unsigned int> max_running{0};
+    std::atomic<int> policy{BU_PLUGIN_ADMIT_BLOCK};
+    std::atomic<unsigned int> blocked{0};       /* Submitters waiting for room */
+
+    std::atomic<size_t> depth{0};               /* Admitted, not started */
+    std::atomic<size_t> max_depth{0};
+    std::atomic<size_t> running{0};
+    std::atomic<unsigned long long> admitted{0};
+    std::atomic<unsigned long long> rejected{0};
+    std::atomic<unsigned long long> shed{0};
+    std::atomic<unsigned long long> completed{0};
+    std::atomic<unsigned long long> wait_sum_ns{0};
+    std::atomic<unsigned long long> wait_max_ns{0};
+    std::atomic<unsigned long long> hist[LANE_HIST_BUCKETS];
+
+    Lane() {
+	for (auto &h : hist) h.store(0, std::memory_order_relaxed);
+    }
+};
+
+static Lane *get_lanes() {
+    static Lane lanes[BU_PLUGIN_LANE_COUNT];
+    return lanes;
+}
+
+static void atomic_max(std::atomic<unsigned long long> &a, unsigned long long v) {
+    unsigned long long cur = a.load(std::memory_order_relaxed);
+    while (v > cur && !a.compare_exchange_weak(cur, v, std::memory_order_relaxed)) {}
+}
+
+/* Send an admitted command to its strand, or to the executor */
+static void lane_dispatch(Executor *e, const Job &job) {
+    bu_plugin_strand *strand = job.cmd ? job.cmd->strand.load(std::memory_order_acquire) : nullptr;
+    if (strand) {
+	strand_post(e, strand, job);
+    } else {
+	e->post(job, job.lane == &get_lanes()[BU_PLUGIN_LANE_BULK]);
+    }
+}
+
+/* Release held jobs while the lane is under its limit; caller holds lane.m */
+static void lane_release(Executor *e, Lane &lane) {
+    unsigned int limit = lane.max_running.load(std::memory_order_relaxed);
+    while (!lane.held.empty() && (limit == 0 || lane.dispatched < limit)) {
+	Job job = lane.held.front();
+	lane.held.pop_front();
+	job.limited = true;
+	lane.dispatched++;
+	lane_dispatch(e, job);
+    }
+}
+
+#ifdef BU_PLUGIN_DEFAULT_SIGNATURE
+/**
+ * Admit a command job into a lane. Returns 0 if admitted or
+ * BU_PLUGIN_LANE_REJECTED; a job shed to make room is returned in dropped.
+ */
+static int lane_admit(Executor *e, Lane &lane, Job job, Job &dropped, bool &has_dropped) {
+    has_dropped = false;
+    job.lane = &lane;
+    size_t cap = lane.capacity.load(std::memory_order_relaxed);
+    unsigned int limit = lane.max_running.load(std::memory_order_relaxed);
+    std::unique_lock<std::mutex> lock(lane.m, std::defer_lock);
+    if (cap || limit) {
+	lock.lock();
+	if (cap && lane.depth.load() >= cap) {
+	    int policy = lane.policy.load(std::memory_order_relaxed);
+	    if (policy == BU_PLUGIN_ADMIT_SHED && !lane.held.empty()) {
+		dropped = lane.held.front();
+		lane.held.pop_front();
+		has_dropped = true;
+		lane.depth.fetch_sub(1);
+		lane.shed.fetch_add(1, std::memory_order_relaxed);
+	    } else if (policy == BU_PLUGIN_ADMIT_BLOCK && !tls_executor) {
+		lane.blocked.fetch_add(1);
+		lane.space_cv.wait(lock, [&lane, cap]() { return lane.depth.load() < cap; });
+		lane.blocked.fetch_sub(1);
+	    } else {
+		lane.rejected.fetch_add(1, std::memory_order_relaxed);
+		return BU_PLUGIN_LANE_REJECTED;
+	    }
+	}
+    }
+    size_t depth = lane.depth.fetch_add(1) + 1;
+    size_t seen = lane.max_depth.load(std::memory_order_relaxed);
+    while (depth > seen && !lane.max_depth.compare_exchange_weak(seen, depth, std::memory_order_relaxed)) {}
+    lane.admitted.fetch_add(1, std::memory_order_relaxed);
+    job.admitted_ns = now_ns();
+    if (limit) {
+	lane.held.push_back(job);
+	lane_release(e, lane);
+    } else {
+	lane_dispatch(e, job);
+    }
+    return 0;
+}
+#endif
+
+static void lane_started(const Job &job) {
+    Lane &lane = *job.lane;
+    uint64_t wait = now_ns() - job.admitted_ns;
+    lane.depth.fetch_sub(1);
+    lane.running.fetch_add(1, std::memory_order_relaxed);
+    lane.hist[lane_bucket(wait)].fetch_add(1, std::memory_order_relaxed);
+    lane.wait_sum_ns.fetch_add(wait, std::memory_order_relaxed);
+    atomic_max(lane.wait_max_ns, wait);
+    if (lane.blocked.load() > 0) {
+	std::lock_guard<std::mutex> lock(lane.m);
+	lane.space_cv.notify_all();
+    }
+}
+
+static void lane_finished(const Job &job) {
+    Lane &lane = *job.lane;
+    lane.running.fetch_sub(1, std::memory_order_relaxed);
+    lane.completed.fetch_add(1, std::memory_order_relaxed);
+    if (job.limited) {
+	std::lock_guard<std::mutex> lock(lane.m);
+	lane.dispatched--;
+	Executor *e = tls_executor ? tls_executor : get_executor().load(std::memory_order_acquire);
+	if (e) lane_release(e, lane);
+    }
+}
+
+/* Strand queues do not survive fork(); called in a zygote worker */
+/*
+ * Make the strands usable in a fork() child. Handles keep pointing at them,
+ * so each strand stays where it is, but its mutex may have been held by a
+ * parent thread at the fork and its queue may be half updated: both are
+ * constructed afresh, leaving the parent's jobs (not the child's to run)
+ * behind, and so is the mutex guarding the strand table.
+ */
+static void reset_strands_after_fork() {
+    new (&get_strands_mutex()) std::mutex();
+    for (auto &entry : get_strands()) {
+	bu_plugin_strand *s = entry.second.get();
+	new (&s->m) std::mutex();
+	new (&s->q) std::deque<Job>();
+	s->running = false;
+    }
+}
+
+/**
+ * Batch invocation. Names are resolved up front; each contiguous range of
+ * items then runs inside a single try block that is only re-entered after
+ * an item throws.
+ */
+
+/* Failures seen by one range; the first of each kind is kept for the log */
+struct BatchErrors {
+    size_t missing = 0;
+    size_t thrown = 0;
+    size_t cancelled = 0;               /* Not started: the call context stopped */
+    size_t first_missing = 0;
+    size_t first_thrown = 0;
+    std::string what;
+
+    void merge(const BatchErrors &o) {
+	if (o.missing && (!missing || o.first_missing < first_missing)) first_missing = o.first_missing;
+	if (o.thrown && (!thrown || o.first_thrown < first_thrown)) {
+	    first_thrown = o.first_thrown;
+	    what = o.what;
+	}
+	missing += o.missing;
+	thrown += o.thrown;
+	cancelled += o.cancelled;
+    }
+};
+
+/* Below this many items per range, splitting a batch costs more than it saves */
+static const size_t BATCH_MIN_RANGE = 1024;
+
+/* Batches usually repeat a few name strings; remember recent ones by address */
+static const size_t BATCH_NAME_CACHE = 256;
+
+struct BatchCacheSlot {
+    const char *name;
+    bu_plugin_cmd_impl fn;
+    unsigned int flags;
+    bu_plugin_cmd_batch_impl batch;
+};
+
+/**
+ * Resolve every name (NULL where not registered) under one lock, looking up
+ * each distinct name pointer once; batches[i] is the command's batched entry
+ * point, if any. Returns true if every resolved command is flagged
+ * BU_PLUGIN_CMD_THREADSAFE.
+ */
+static bool resolve_batch(const char *const *names, size_t n, std::vector<bu_plugin_cmd_impl> &fns,
+	std::vector<bu_plugin_cmd_batch_impl> &batches) {
+    fns.resize(n);
+    batches.resize(n);
+    std::vector<BatchCacheSlot> cache(BATCH_NAME_CACHE, BatchCacheSlot());
+    unsigned int safe = BU_PLUGIN_CMD_THREADSAFE;
+    bu_plugin_ctx &r = current_registry();
+    const FrozenTable *frozen = r.frozen.load(std::memory_order_acquire);
+    std::string key;
+    std::unique_lock<std::mutex> lock(r.mtx, std::defer_lock);
+    if (!frozen) lock.lock();
+    for (size_t i = 0; i < n; i++) {
+	const char *name = names[i];
+	BatchCacheSlot &slot = cache[(reinterpret_cast<uintptr_t>(name) >> 3) % BATCH_NAME_CACHE];
+	if (slot.name != name) {
+	    slot = BatchCacheSlot();
+	    slot.name = name;
+	    if (name && frozen) {
+		const FrozenSlot *fs = frozen_find(frozen, name);
+		if (fs) {
+		    slot.fn = fs->impl;
+		    slot.flags = fs->flags;
+		    slot.batch = fs->batch;
+		}
+	    } else if (name) {
+		size_t len = 0;
+		const char *k = trim_span(name, len);
+		key.assign(k, len);
+		auto it = r.registry.find(key);
+		if (it != r.registry.end()) {
+		    slot.fn = it->second;
+		    slot.flags = cmd_flags_of(r, key);
+		    slot.batch = cmd_batch_of(r, key);
+		}
+	    }
+	}
+	fns[i] = slot.fn;
+	batches[i] = slot.batch;
+	if (slot.fn) safe &= slot.flags;
+    }
+    return safe != 0;
+}
+
+#if defined(BU_PLUGIN_DEFAULT_SIGNATURE) || defined(BU_PLUGIN_CMD_ARGV_SIGNATURE)
+/*
+ * Items [i, i + count) through a batched entry point: f(j, m, out) runs
+ * items [j, j + m) into out. Without a results array they run in pieces
+ * into a scratch buffer.
+ */
+template <typename F>
+static int batch_into(BU_PLUGIN_CMD_RET *results, size_t i, size_t count, const F &f) {
+    if (results) return f(i, count, results + i);
+    BU_PLUGIN_CMD_RET scratch[256];
+    for (size_t k = 0; k < count; k += 256) {
+	int rc = f(i + k, std::min<size_t>(256, count - k), scratch);
+	if (rc != 0) return rc;
+    }
+    return 0;
+}
+#endif
+
+/*
+ * Run items [begin, end). call(i, fn) runs item i through its scalar impl;
+ * batch(i, count, b) runs items [i, i + count) through their batched entry
+ * point and returns its result.
+ */
+template <typename Call, typename BatchCall>
+static void run_batch_range(const bu_plugin_cmd_impl *fns, const bu_plugin_cmd_batch_impl *batches, size_t begin,
+	size_t end, int *status, const Call &call, const BatchCall &batch, CallCtx *ctx, BatchErrors &err) {
+    CmdArenaScope scope;
+    CmdOutputScope output;
+    CallCtxScope ctx_scope(ctx);
+    size_t i = begin;
+    size_t next = begin;                /* Items [i, next) are running */
+    auto fail = [&](const char *what) {
+	if (!err.thrown) {
+	    err.first_thrown = i;
+	    err.what = what;
+	}
+	err.thrown += next - i;
+	for (; status && i < next; i++) status[i] = -2;
+	i = next;
+    };
+    while (i < end) {
+#if BU_PLUGIN_EXCEPTIONS
+	try {
+#endif
+	    for (; i < end; i = next) {
+		next = i + 1;
+		if (bu_plugin_call_ctx_stopped(ctx)) {
+		    err.cancelled += end - i;
+		    for (; status && i < end; i++) status[i] = BU_PLUGIN_CALL_CANCELLED;
+		    return;
+		}
+		if (!fns[i]) {
+		    if (!err.missing++) err.first_missing = i;
+		    if (status) status[i] = -1;
+		    continue;
+		}
+		if (batches[i]) {
+		    /* A run of the same command goes through its batched entry point */
+		    size_t limit = std::min(end, i + BU_PLUGIN_BATCH_CHUNK);
+		    while (next < limit && fns[next] == fns[i] && batches[next] == batches[i]) next++;
+		}
+		if (next - i > 1) {
+		    int rc = batch(i, next - i, batches[i]);
+		    const char *what = take_call_failure();
+		    if (rc != 0 || what) {
+			fail(what ? what : "batched entry point failed");
+			continue;
+		    }
+		} else {
+		    call(i, fns[i]);
+		    if (const char *what = take_call_failure()) {
+			fail(what);
+			continue;
+		    }
+		}
+		for (size_t k = i; status && k < next; k++) status[k] = 0;
+	    }
+#if BU_PLUGIN_EXCEPTIONS
+	} catch (const std::exception &e) {
+	    take_call_failure();    /* a bu_plugin_cmd_fail() before the throw */
+	    fail(e.what());
+	} catch (...) {
+	    take_call_failure();
+	    fail("unknown exception");
+	}
+#endif
+    }
+}
+
+/* One range of a batch split across the executor */
+template <typename Call, typename BatchCall>
+struct BatchRange {
+    const bu_plugin_cmd_impl *fns;
+    const bu_plugin_cmd_batch_impl *batches;
+    size_t begin;
+    size_t end;
+    int *status;
+    const Call *call;
+    const BatchCall *batch;
+    CallCtx *ctx;
+    BatchErrors err;
+    std::mutex *m;
+    std::condition_variable *cv;
+    size_t *remaining;
+};
+
+template <typename Call, typename BatchCall>
+static void batch_range_job(void *arg) {
+    BatchRange<Call, BatchCall> *r = static_cast<BatchRange<Call, BatchCall> *>(arg);
+    run_batch_range(r->fns, r->batches, r->begin, r->end, r->status, *r->call, *r->batch, r->ctx, r->err);
+    std::lock_guard<std::mutex> lock(*r->m);
+    if (--*r->remaining == 0) r->cv->notify_one();
+}
+
+/* Shared driver for the batch entry points; see run_batch_range() for call and batch */
+template <typename Call, typename BatchCall>
+static int run_batch(const char *const *names, size_t n, int *status, const Call &call, const BatchCall &batch) {
+    if (!names) return -1;
+    std::vector<bu_plugin_cmd_impl> fns;
+    std::vector<bu_plugin_cmd_batch_impl> batches;
+    bool all_safe = resolve_batch(names, n, fns, batches);
+
+    size_t nranges = 1;
+    ExecPin pin(false);
+    Executor *e = pin.e;
+    if (all_safe && e && !tls_executor) {
+	nranges = std::min(e->queues.size() + 1, n / BATCH_MIN_RANGE);
+	if (nranges == 0) nranges = 1;
+    }
+
+    /* The caller waits for every range, so the context outlives them */
+    CallCtx *ctx = tls_call_ctx;
+    BatchErrors err;
+    if (nranges == 1) {
+	run_batch_range(fns.data(), batches.data(), 0, n, status, call, batch, ctx, err);
+    } else {
+	std::mutex m;
+	std::condition_variable cv;
+	size_t remaining = nranges - 1;
+	std::vector<BatchRange<Call, BatchCall> > ranges(nranges);
+	for (size_t r = 0; r < nranges; r++) {
+	    BatchRange<Call, BatchCall> &br = ranges[r];
+	    br.fns = fns.data();
+	    br.batches = batches.data();
+	    br.begin = n * r / nranges;
+	    br.end = n * (r + 1) / nranges;
+	    br.status = status;
+	    br.call = &call;
+	    br.batch = &batch;
+	    br.ctx = ctx;
+	    br.m = &m;
+	    br.cv = &cv;
+	    br.remaining = &remaining;
+	}
+	for (size_t r = 1; r < nranges; r++) {
+	    Job job = Job();
+	    job.fn = batch_range_job<Call, BatchCall>;
+	    job.arg = &ranges[r];
+	    job.reg = tls_registry;
+	    e->post(job);
+	}
+	run_batch_range(fns.data(), batches.data(), ranges[0].begin, ranges[0].end, status, call, batch, ctx,
+		ranges[0].err);
+	{
+	    std::unique_lock<std::mutex> lock(m);
+	    cv.wait(lock, [&remaining]() { return remaining == 0; });
+	}
+	for (const auto &br : ranges) err.merge(br.err);
+    }
+
+    if (err.missing) {
+	const char *first = names[err.first_missing];
+	bu_plugin_logf(BU_LOG_ERR, "Batch: %zu of %zu command(s) not found (first: '%s' at item %zu)",
+		err.missing, n, first ? first : "(null)", err.first_missing);
+    }
+    if (err.thrown) {
+	bu_plugin_logf(BU_LOG_ERR, "Batch: %zu of %zu command(s) threw (first: '%s' at item %zu: %s)",
+		err.thrown, n, names[err.first_thrown], err.first_thrown, err.what.c_str());
+    }
+    if (err.cancelled) {
+	bu_plugin_logf(BU_LOG_WARN, "Batch: %zu of %zu command(s) cancelled before they started", err.cancelled, n);
+    }
+    return static_cast<int>(err.missing + err.thrown + err.cancelled);
+}
+
+#ifdef BU_PLUGIN_DEFAULT_SIGNATURE
+/* One command in a bu_plugin_dag */
+struct DagNode {
+    std::string name;
+    bu_plugin_cmd_handle handle;        /* From bu_plugin_dag_add_handle(), else NULL */
+    std::vector<size_t> deps;
+    std::vector<size_t> dependents;
+
+    /* State of the last run */
+    bu_plugin_cmd_handle cmd;           /* NULL if the name did not resolve */
+    bu_plugin_strand *strand;           /* The command's strand, or NULL */
+    size_t pending;                     /* unfinished dependencies */
+    bool skip;                          /* a dependency failed */
+    int status;
+    BU_PLUGIN_CMD_RET result;
+    double start_us;
+    double end_us;
+    double path_us;                     /* longest chain of run times ending at this node */
+    size_t path_prev;                   /* predecessor on that chain, or SIZE_MAX */
+};
+
+/* Shared state of one bu_plugin_dag_run() */
+struct DagRun {
+    std::vector<DagNode> *nodes;
+    Executor *exec;                     /* NULL: nodes run on the calling thread */
+    CallCtx *ctx;                       /* Caller's call context, current in every node */
+    bu_plugin_ctx *reg;                 /* Caller's registry context, likewise */
+    std::chrono::steady_clock::time_point start;
+    std::mutex m;
+    std::condition_variable cv;
+    size_t remaining;
+    std::deque<size_t> inline_ready;    /* Ready nodes when exec is NULL */
+    std::vector<std::pair<DagRun *, size_t> > tasks;  /* Job arguments, one per node */
+};
+
+static void dag_node_job(void *arg);
+
+/* Node i has no pending dependencies: dispatch it, or add it to done if cancelled. Caller holds r.m */
+static void dag_ready(DagRun &r, size_t i, std::vector<size_t> &done) {
+    DagNode &node = (*r.nodes)[i];
+    if (node.skip || bu_plugin_call_ctx_stopped(r.ctx)) {
+	node.status = BU_PLUGIN_DAG_CANCELLED;
+	done.push_back(i);
+    } else if (!r.exec) {
+	r.inline_ready.push_back(i);
+    } else {
+	Job job = Job();
+	job.fn = dag_node_job;
+	job.arg = &r.tasks[i];
+	job.reg = r.reg;
+	if (node.strand) {
+	    strand_post(r.exec, node.strand, job);
+	} else {
+	    r.exec->post(job);
+	}
+    }
+}
+
+/* Release the dependents of finished nodes, cancelling downstream of failures; caller holds r.m */
+static void dag_complete(DagRun &r, std::vector<size_t> &done) {
+    std::vector<DagNode> &nodes = *r.nodes;
+    while (!done.empty()) {
+	size_t i = done.back();
+	done.pop_back();
+	for (size_t d : nodes[i].dependents) {
+	    if (nodes[i].status != 0) nodes[d].skip = true;
+	    if (--nodes[d].pending == 0) dag_ready(r, d, done);
+	}
+	if (--r.remaining == 0) r.cv.notify_all();
+    }
+}
+
+static void dag_run_node(DagRun &r, size_t i) {
+    DagNode &node = (*r.nodes)[i];
+    /* Dependencies are final once a node is ready, so its chain length is too */
+    for (size_t d : node.deps) {
+	if ((*r.nodes)[d].path_us > node.path_us) {
+	    node.path_us = (*r.nodes)[d].path_us;
+	    node.path_prev = d;
+	}
+    }
+    node.start_us = elapsed_us(r.start);
+    bu_plugin_cmd_impl fn = node.cmd ? node.cmd->impl.load(std::memory_order_acquire) : nullptr;
+    if (fn) {
+	CallCtxScope ctx_scope(r.ctx);
+	node.status = guarded_call(node.name.c_str(), fn, &node.result);
+	if (node.status == BU_PLUGIN_CALL_CANCELLED) node.status = BU_PLUGIN_DAG_CANCELLED;
+    } else {
+	bu_plugin_logf(BU_LOG_ERR, "Command '%s' not found", node.name.c_str());
+	node.status = -1;
+    }
+    node.end_us = elapsed_us(r.start);
+    node.path_us += node.end_us - node.start_us;
+
+    std::lock_guard<std::mutex> lock(r.m);
+    std::vector<size_t> done(1, i);
+    dag_complete(r, done);
+}
+
+static void dag_node_job(void *arg) {
+    std::pair<DagRun *, size_t> *task = static_cast<std::pair<DagRun *, size_t> *>(arg);
+    dag_run_node(*task->first, task->second);
+}
+#endif /* BU_PLUGIN_DEFAULT_SIGNATURE */
+
+#if !defined(_WIN32) && defined(BU_PLUGIN_DEFAULT_SIGNATURE)
+/**
+ * Out-of-process worker pool.
+ *
+ * One MAP_SHARED anonymous mapping, created before the spawner is forked,
+ * holds a PoolBlob (the pooled plugin paths and the proxy command names,
+ * appended by the host only) followed by one PoolShared per worker. A call
+ * claims a FREE slot, fills it, marks it POSTED and pushes its index on the
+ * worker's ring (a bounded MPSC queue: callers on any host thread produce,
+ * the worker consumes). The worker writes the status and result and marks
+ * the slot DONE. Each side spins for a few microseconds before sleeping on
+ * a futex: the worker on the doorbell, a caller on its slot's state, each
+ * announcing it with a flag the other side checks after publishing.
+ *
+ * Workers never load anything on the host's behalf by index: before each
+ * request a worker opens every path in the blob it has not opened yet, and
+ * resolves proxy index i through the name the host stored for it. A worker
+ * restarted after a crash therefore catches up on its own.
+ */
+static const unsigned int POOL_SLOTS = 64;              /* Calls in flight per worker (power of two) */
+static const unsigned int POOL_MAX_PATHS = 256;
+static const unsigned int POOL_MAX_CMDS = 512;          /* Proxies available to pooled commands */
+static const size_t POOL_BLOB_BYTES = 64 * 1024;        /* Paths and command names */
+static const size_t POOL_CONTROL_BYTES = 16 * 1024;     /* Names in a LOAD reply */
+static const uint64_t POOL_SPIN_NS = 20000;             /* Spin before sleeping on a futex */
+static const int POOL_START_ATTEMPTS = 3;               /* Deaths before ready, before giving up */
+
+enum PoolSlotState : uint32_t { SLOT_FREE, SLOT_CLAIMED, SLOT_POSTED, SLOT_DONE, SLOT_FAILED };
+enum PoolOp : uint32_t { POOL_OP_CALL, POOL_OP_LOAD };
+
+struct PoolSlot {
+    std::atomic<uint32_t> state;        /* PoolSlotState; the caller's futex word */
+    std::atomic<uint32_t> waiting;      /* The caller is (about to be) asleep on state */
+    uint32_t op;
+    uint32_t arg;                       /* Proxy index (CALL) or path index (LOAD) */
+    int32_t status;                     /* bu_plugin_cmd_run() convention; LOAD: name count or -1 */
+    BU_PLUGIN_CMD_RET result;
+    char what[104];                     /* Exception text when status is -2 */
+};
+
+struct PoolCell {
+    std::atomic<uint32_t> seq;
+    uint32_t slot;
+};
+
+/* Shared with one worker */
+struct PoolShared {
+    alignas(64) std::atomic<uint32_t> head;     /* Next ring position to fill (callers) */
+    alignas(64) std::atomic<uint32_t> tail;     /* Next ring position to take (worker) */
+    alignas(64) std::atomic<uint32_t> doorbell; /* The idle worker's futex word */
+    std::atomic<uint32_t> sleeping;             /* The worker is (about to be) asleep on doorbell */
+    std::atomic<uint32_t> ready;                /* Set once the worker has caught up and serves the ring */
+    PoolCell ring[POOL_SLOTS];
+    PoolSlot slots[POOL_SLOTS];
+    char control[POOL_CONTROL_BYTES];
+};
+
+/* Shared with every worker; written by the host under WorkerPool::m */
+struct PoolBlob {
+    std::atomic<uint32_t> npaths;
+    std::atomic<uint32_t> ncmds;
+    uint32_t path_off[POOL_MAX_PATHS];
+    uint32_t cmd_off[POOL_MAX_CMDS];
+    uint32_t used;
+    char data[POOL_BLOB_BYTES];
+};
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex words must be plain 32-bit integers");
+
+/* Host side of one worker */
+struct PoolWorker {
+    PoolShared *sh;
+    std::atomic<bool> down;             /* Not serving: starting, restarting or given up */
+    std::atomic<bool> failed;           /* Kept dying during startup; not restarted again */
+    std::atomic<int> users;             /* Host threads touching sh */
+    std::atomic<uint32_t> next_slot;
+    std::atomic<int> pid;
+    int attempts;                       /* Consecutive deaths before ready (supervisor only) */
+    PoolWorker() : sh(nullptr), down(true), failed(false), users(0), next_slot(0), pid(-1), attempts(0) {}
+};
+
+struct WorkerPool {
+    std::vector<std::unique_ptr<PoolWorker> > workers;
+    PoolBlob *blob;
+    void *map;
+    size_t map_bytes;
+    int sock;                           /* Socket to the spawner */
+    pid_t spawner;
+    std::thread supervisor;
+    std::mutex m;                       /* Loads and the proxy table */
+    std::atomic<bool> stopping;
+    std::atomic<size_t> next;
+    std::atomic<unsigned long long> calls, crashes, restarts;
+    std::vector<std::string> proxies;   /* Proxy names registered here */
+    WorkerPool() : blob(nullptr), map(nullptr), map_bytes(0), sock(-1), spawner(-1), stopping(false),
+	next(0), calls(0), crashes(0), restarts(0) {}
+};
+
+/* Spawner <-> supervisor messages */
+enum PoolMsgOp : uint32_t { POOL_MSG_SPAWN, POOL_MSG_UP, POOL_MSG_DEAD };
+struct PoolMsg {
+    uint32_t op;
+    uint32_t worker;
+    int32_t value;                      /* UP: pid; DEAD: wait status */
+};
+
+static std::atomic<WorkerPool *>& get_pool() {
+    static std::atomic<WorkerPool *> pool(nullptr);
+    return pool;
+}
+
+/* True in a worker process, where out-of-process loads are opened in-process */
+static bool& pool_in_worker() {
+    static bool in_worker = false;
+    return in_worker;
+}
+
+static thread_local size_t tls_pool_worker = SIZE_MAX;
+
+static inline void pool_pause() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+/* Sleep while word == expected, at most timeout_ms */
+static void pool_futex_wait(std::atomic<uint32_t> &word, uint32_t expected, int timeout_ms) {
+#if defined(__linux__)
+    struct timespec ts;
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = static_cast<long>(timeout_ms % 1000) * 1000000L;
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT, expected, &ts, nullptr, 0);
+#else
+    if (word.load() == expected) std::this_thread::sleep_for(std::chrono::microseconds(50));
+#endif
+}
+
+static void pool_futex_wake(std::atomic<uint32_t> &word) {
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#else
+    (void)word;
+#endif
+}
+
+static void ring_reset(PoolShared *sh) {
+    sh->head.store(0);
+    sh->tail.store(0);
+    for (uint32_t i = 0; i < POOL_SLOTS; i++) sh->ring[i].seq.store(i);
+}
+
+/* Callers; cannot fail while there are no more posted entries than slots */
+static void ring_push(PoolShared *sh, uint32_t slot) {
+    uint32_t pos = sh->head.load(std::memory_order_relaxed);
+    for (;;) {
+	PoolCell &c = sh->ring[pos % POOL_SLOTS];
+	int32_t dif = static_cast<int32_t>(c.seq.load(std::memory_order_acquire) - pos);
+	if (dif == 0) {
+	    if (sh->head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+		c.slot = slot;
+		c.seq.store(pos + 1);   /* seq_cst: ordered before the caller's check of sleeping */
+		return;
+	    }
+	} else if (dif < 0) {
+	    pool_pause();
+	    pos = sh->head.load(std::memory_order_relaxed);
+	} else {
+	    pos = sh->head.load(std::memory_order_relaxed);
+	}
+    }
+}
+
+/* Worker only */
+static bool ring_ready(const PoolShared *sh) {
+    uint32_t pos = sh->tail.load(std::memory_order_relaxed);
+    return sh->ring[pos % POOL_SLOTS].seq.load() == pos + 1;
+}
+
+static bool ring_pop(PoolShared *sh, uint32_t &slot) {
+    uint32_t pos = sh->tail.load(std::memory_order_relaxed);
+    PoolCell &c = sh->ring[pos % POOL_SLOTS];
+    if (c.seq.load(std::memory_order_acquire) != pos + 1) return false;
+    slot = c.slot;
+    c.seq.store(pos + POOL_SLOTS, std::memory_order_release);
+    sh->tail.store(pos + 1, std::memory_order_relaxed);
+    return true;
+}
+
+static void pool_reset_shared(PoolShared *sh) {
+    ring_reset(sh);
+    for (PoolSlot &s : sh->slots) {
+	s.state.store(SLOT_FREE);
+	s.waiting.store(0);
+    }
+    sh->sleeping.store(0);
+    sh->ready.store(0);
+}
+
+static bool pool_write(int fd, const PoolMsg &msg) {
+    const char *p = reinterpret_cast<const char *>(&msg);
+    size_t left = sizeof(msg);
+    while (left) {
+#if defined(MSG_NOSIGNAL)
+	ssize_t n = send(fd, p, left, MSG_NOSIGNAL);
+#else
+	ssize_t n = send(fd, p, left, 0);
+#endif
+	if (n < 0 && errno == EINTR) continue;
+	if (n <= 0) return false;
+	p += n;
+	left -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static bool pool_read(int fd, PoolMsg &msg) {
+    char *p = reinterpret_cast<char *>(&msg);
+    size_t left = sizeof(msg);
+    while (left) {
+	ssize_t n = read(fd, p, left);
+	if (n < 0 && errno == EINTR) continue;
+	if (n <= 0) return false;
+	p += n;
+	left -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+/* Append a NUL-terminated string to the blob; returns its offset or UINT32_MAX when full */
+static uint32_t blob_append(PoolBlob *blob, const std::string &s) {
+    if (blob->used + s.size() + 1 > POOL_BLOB_BYTES) return UINT32_MAX;
+    uint32_t off = blob->used;
+    std::memcpy(blob->data + off, s.c_str(), s.size() + 1);
+    blob->used += static_cast<uint32_t>(s.size() + 1);
+    return off;
+}
+
+/* Worker process state */
+struct PoolWorkerState {
+    PoolShared *sh;
+    PoolBlob *blob;
+    std::vector<std::vector<std::string> > names;       /* Commands each pooled path registered */
+    std::vector<int> loaded;                            /* Each path's load result */
+    std::vector<bu_plugin_cmd_impl> impls;              /* By proxy index, resolved on first call */
+};
+
+static int pool_collect_name(const char *name, bu_plugin_cmd_impl, void *user) {
+    static_cast<std::unordered_set<std::string> *>(user)->insert(name);
+    return 0;
+}
+
+/* Open every path the host has added since the last request */
+static void pool_catch_up(PoolWorkerState &ws) {
+    uint32_t npaths = ws.blob->npaths.load(std::memory_order_acquire);
+    while (ws.names.size() < npaths) {
+	const char *path = ws.blob->data + ws.blob->path_off[ws.names.size()];
+	std::unordered_set<std::string> before, after;
+	bu_plugin_cmd_foreach(pool_collect_name, &before);
+	int r = bu_plugin_load(path);
+	bu_plugin_cmd_foreach(pool_collect_name, &after);
+	std::vector<std::string> added;
+	for (const auto &n : after) {
+	    if (!before.count(n)) added.push_back(n);
+	}
+	std::sort(added.begin(), added.end());
+	ws.names.push_back(added);
+	ws.loaded.push_back(r);
+    }
+}
+
+static void pool_serve(PoolWorkerState &ws, PoolSlot &slot) {
+    pool_catch_up(ws);
+    slot.status = -1;
+    if (slot.op == POOL_OP_LOAD) {
+	uint32_t p = slot.arg;
+	if (p >= ws.names.size() || ws.loaded[p] < 0) return;
+	size_t used = 0;
+	int count = 0;
+	for (const auto &n : ws.names[p]) {
+	    if (used + n.size() + 1 > POOL_CONTROL_BYTES) break;
+	    std::memcpy(ws.sh->control + used, n.c_str(), n.size() + 1);
+	    used += n.size() + 1;
+	    count++;
+	}
+	slot.status = count;
+	return;
+    }
+
+    uint32_t i = slot.arg;
+    if (i >= ws.impls.size() || !ws.impls[i]) {
+	if (i >= ws.blob->ncmds.load(std::memory_order_acquire)) return;
+	if (ws.impls.size() <= i) ws.impls.resize(i + 1, nullptr);
+	ws.impls[i] = bu_plugin_cmd_get(ws.blob->data + ws.blob->cmd_off[i]);
+	if (!ws.impls[i]) return;
+    }
+    slot.what[0] = '\0';
+#if BU_PLUGIN_EXCEPTIONS
+    try {
+	slot.result = ws.impls[i]();
+	slot.status = 0;
+    } catch (const std::exception &e) {
+	std::snprintf(slot.what, sizeof(slot.what), "%s", e.what());
+	slot.status = -2;
+    } catch (...) {
+	std::snprintf(slot.what, sizeof(slot.what), "unknown exception");
+	slot.status = -2;
+    }
+#else
+    slot.result = ws.impls[i]();
+    slot.status = 0;
+#endif
+}
+
+/* Body of a worker process */
+static void pool_worker_main(PoolShared *sh, PoolBlob *blob, pid_t parent) {
+    pool_in_worker() = true;
+    PoolWorkerState ws;
+    ws.sh = sh;
+    ws.blob = blob;
+    pool_catch_up(ws);
+    sh->ready.store(1);
+    for (;;) {
+	uint32_t s;
+	if (!ring_pop(sh, s)) {
+	    uint64_t spin_end = now_ns() + POOL_SPIN_NS;
+	    for (unsigned k = 1; !ring_ready(sh) && now_ns() < spin_end; k++) {
+		if (k % 64 == 0) std::this_thread::yield(); else pool_pause();
+	    }
+	    if (!ring_ready(sh)) {
+		uint32_t bell = sh->doorbell.load();
+		sh->sleeping.store(1);
+		if (!ring_ready(sh)) pool_futex_wait(sh->doorbell, bell, 1000);
+		sh->sleeping.store(0);
+		if (getppid() != parent) return;    /* The spawner is gone */
+	    }
+	    continue;
+	}
+	PoolSlot &slot = sh->slots[s];
+	pool_serve(ws, slot);
+	slot.state.store(SLOT_DONE);
+	if (slot.waiting.load()) pool_futex_wake(slot.state);
+    }
+}
+
+/* Body of the spawner process: forks workers on request and reports their deaths */
+static void pool_spawner_main(int sock, PoolBlob *blob, const std::vector<PoolShared *> &shared) {
+    std::vector<pid_t> pids(shared.size(), -1);
+    pid_t self = getpid();
+    for (;;) {
+	struct pollfd pfd;
+	pfd.fd = sock;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	int r = poll(&pfd, 1, 10);
+	if (r > 0) {
+	    PoolMsg msg;
+	    if (!pool_read(sock, msg)) break;       /* The host stopped the pool or exited */
+	    if (msg.op == POOL_MSG_SPAWN && msg.worker < shared.size()) {
+		pid_t pid = fork();
+		if (pid == 0) {
+		    close(sock);
+#if defined(__linux__)
+		    prctl(PR_SET_PDEATHSIG, SIGKILL);
+#endif
+		    if (getppid() != self) _exit(0);
+		    pool_worker_main(shared[msg.worker], blob, self);
+		    _exit(0);
+		}
+		PoolMsg up = { POOL_MSG_UP, msg.worker, static_cast<int32_t>(pid) };
+		if (pid > 0) {
+		    pids[msg.worker] = pid;
+		} else {
+		    up.op = POOL_MSG_DEAD;
+		    up.value = 0;
+		}
+		pool_write(sock, up);
+	    }
+	}
+	int status;
+	pid_t pid;
+	while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+	    for (size_t i = 0; i < pids.size(); i++) {
+		if (pids[i] != pid) continue;
+		pids[i] = -1;
+		PoolMsg dead = { POOL_MSG_DEAD, static_cast<uint32_t>(i), static_cast<int32_t>(status) };
+		pool_write(sock, dead);
+	    }
+	}
+    }
+    for (pid_t pid : pids) {
+	if (pid > 0) kill(pid, SIGKILL);
+    }
+    while (waitpid(-1, nullptr, 0) > 0 || errno == EINTR) {}
+}
+
+/* A worker died: fail its calls, wait until no host thread touches it, ask for a new one */
+static void pool_worker_died(WorkerPool *pool, uint32_t i, int status) {
+    PoolWorker &w = *pool->workers[i];
+    bool was_up = !w.down.exchange(true);
+    if (pool->stopping.load()) return;
+    pool->crashes++;
+    if (WIFSIGNALED(status)) {
+	bu_plugin_logf(BU_LOG_ERR, "Plugin worker %u (pid %d) killed by signal %d", i, w.pid.load(), WTERMSIG(status));
+    } else {
+	bu_plugin_logf(BU_LOG_ERR, "Plugin worker %u (pid %d) exited with status %d", i, w.pid.load(), WEXITSTATUS(status));
+    }
+    for (;;) {
+	for (PoolSlot &s : w.sh->slots) {
+	    uint32_t posted = SLOT_POSTED;
+	    if (s.state.compare_exchange_strong(posted, SLOT_FAILED) && s.waiting.load()) pool_futex_wake(s.state);
+	}
+	if (w.users.load() == 0) break;
+	std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    w.attempts = was_up ? 1 : w.attempts + 1;
+    if (w.attempts > POOL_START_ATTEMPTS) {
+	bu_plugin_logf(BU_LOG_ERR, "Plugin worker %u keeps dying while loading plugins; not restarting it", i);
+	w.failed = true;
+	return;
+    }
+    pool_reset_shared(w.sh);
+    PoolMsg msg = { POOL_MSG_SPAWN, i, 0 };
+    if (pool_write(pool->sock, msg)) pool->restarts++;
+}
+
+/* Supervisor thread: follows the spawner's reports and brings started workers up */
+static void pool_supervise(WorkerPool *pool) {
+    for (;;) {
+	bool starting = false;
+	for (const auto &w : pool->workers) starting = starting || (w->down.load() && !w->failed.load());
+	struct pollfd pfd;
+	pfd.fd = pool->sock;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	int r = poll(&pfd, 1, starting ? 1 : -1);
+	if (r < 0 && errno != EINTR) break;
+	if (r > 0) {
+	    PoolMsg msg;
+	    if (!pool_read(pool->sock, msg)) break;
+	    if (msg.worker >= pool->workers.size()) continue;
+	    if (msg.op == POOL_MSG_UP) pool->workers[msg.worker]->pid.store(msg.value);
+	    if (msg.op == POOL_MSG_DEAD) pool_worker_died(pool, msg.worker, msg.value);
+	}
+	for (size_t i = 0; i < pool->workers.size(); i++) {
+	    PoolWorker &w = *pool->workers[i];
+	    if (w.down.load() && !w.failed.load() && w.sh->ready.load()) {
+		if (w.attempts) bu_plugin_logf(BU_LOG_INFO, "Plugin worker %zu restarted (pid %d)", i, w.pid.load());
+		w.down.store(false);
+	    }
+	}
+    }
+    if (!pool->stopping.load()) bu_plugin_logf(BU_LOG_ERR, "Plugin worker spawner exited; pooled commands are unavailable");
+    for (const auto &w : pool->workers) {
+	w->down.store(true);
+	w->failed.store(true);
+    }
+}
+
+/* Pick a serving worker (this thread's, if it is up) and hold it; NULL if none comes up */
+static PoolWorker *pool_acquire(WorkerPool *pool) {
+    size_t n = pool->workers.size();
+    if (tls_pool_worker == SIZE_MAX) tls_pool_worker = pool->next.fetch_add(1, std::memory_order_relaxed);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    for (;;) {
+	bool any_alive = false;
+	for (size_t k = 0; k < n; k++) {
+	    PoolWorker *w = pool->workers[(tls_pool_worker + k) % n].get();
+	    any_alive = any_alive || !w->failed.load();
+	    if (w->down.load()) continue;
+	    w->users.fetch_add(1);
+	    if (!w->down.load()) return w;
+	    w->users.fetch_sub(1);
+	}
+	if (!any_alive || pool->stopping.load() || std::chrono::steady_clock::now() > deadline) return nullptr;
+	std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+/* Post one request on a held worker and wait; returns SLOT_DONE or SLOT_FAILED */
+static uint32_t pool_request(PoolWorker *w, uint32_t op, uint32_t arg, PoolSlot *&out) {
+    PoolShared *sh = w->sh;
+    uint32_t s;
+    for (unsigned k = 1;; k++) {
+	s = w->next_slot.fetch_add(1, std::memory_order_relaxed) % POOL_SLOTS;
+	uint32_t expected = SLOT_FREE;
+	if (sh->slots[s].state.compare_exchange_strong(expected, SLOT_CLAIMED)) break;
+	if (k % POOL_SLOTS == 0) std::this_thread::yield();
+    }
+    PoolSlot &slot = sh->slots[s];
+    out = &slot;
+    slot.op = op;
+    slot.arg = arg;
+    slot.state.store(SLOT_POSTED);
+    ring_push(sh, s);
+    if (sh->sleeping.load()) {
+	sh->doorbell.fetch_add(1);
+	pool_futex_wake(sh->doorbell);
+    }
+
+    uint32_t st = slot.state.load(std::memory_order_acquire);
+    uint64_t spin_end = now_ns() + POOL_SPIN_NS;
+    for (unsigned k = 1; st == SLOT_POSTED && now_ns() < spin_end; k++) {
+	if (k % 64 == 0) std::this_thread::yield(); else pool_pause();
+	st = slot.state.load(std::memory_order_acquire);
+    }
+    while (st == SLOT_POSTED) {
+	slot.waiting.store(1);
+	st = slot.state.load();
+	if (st != SLOT_POSTED) break;
+	if (w->down.load()) {
+	    st = SLOT_FAILED;
+	    break;
+	}
+	pool_futex_wait(slot.state, SLOT_POSTED, 20);
+	st = slot.state.load();
+    }
+    slot.waiting.store(0);
+    return st;
+}
+
+static void pool_release(PoolWorker *w, PoolSlot *slot) {
+    slot->state.store(SLOT_FREE, std::memory_order_release);
+    w->users.fetch_sub(1);
+}
+
+/* A failed proxy call: record the failure for the run wrapper, as bu_plugin_cmd_fail() does */
+static BU_PLUGIN_CMD_RET pool_fail(const char *what) {
+    set_call_failure(what);
+    return BU_PLUGIN_CMD_RET();
+}
+
+/* Body of every proxy: run pooled command i in a worker; failures go through pool_fail() */
+static BU_PLUGIN_CMD_RET pool_call(unsigned int i) {
+    WorkerPool *pool = get_pool().load(std::memory_order_acquire);
+    if (!pool) return pool_fail("worker pool is not running");
+    PoolWorker *w = pool_acquire(pool);
+    if (!w) return pool_fail("no plugin worker is available");
+    PoolSlot *slot;
+    uint32_t st = pool_request(w, POOL_OP_CALL, i, slot);
+    int status = slot->status;
+    BU_PLUGIN_CMD_RET result = slot->result;
+    std::string what = (st == SLOT_DONE && status == -2) ? slot->what : "";
+    pool_release(w, slot);
+    if (st != SLOT_DONE) return pool_fail("plugin worker died during the call");
+    pool->calls.fetch_add(1, std::memory_order_relaxed);
+    if (status == -1) return pool_fail("command is not available in the plugin worker");
+    if (status == -2) return pool_fail(what.c_str());
+    return result;
+}
+
+/* One proxy per index, so a registered function pointer identifies its pooled command */
+template <unsigned int I>
+static BU_PLUGIN_CMD_RET pool_proxy() {
+    return pool_call(I);
+}
+
+template <unsigned int B, unsigned int N>
+struct PoolProxyFill {
+    static void fill(bu_plugin_cmd_impl *t) {
+	PoolProxyFill<B, N / 2>::fill(t);
+	PoolProxyFill<B + N / 2, N - N / 2>::fill(t);
+    }
+};
+
+template <unsigned int B>
+struct PoolProxyFill<B, 1> {
+    static void fill(bu_plugin_cmd_impl *t) {
+	t[B] = &pool_proxy<B>;
+    }
+};
+
+static const bu_plugin_cmd_impl *pool_proxies() {
+    static bu_plugin_cmd_impl table[POOL_MAX_CMDS];
+    static bool filled = (PoolProxyFill<0, POOL_MAX_CMDS>::fill(table), true);
+    (void)filled;
+    return table;
+}
+
+/* bu_plugin_load_ex() with BU_PLUGIN_LOAD_OUT_OF_PROCESS */
+static int pool_load(const char *path) {
+    if (!path || path[0] == '\0') {
+	bu_plugin_logf(BU_LOG_ERR, "Invalid plugin path (null or empty)");
+	return -1;
+    }
+    bu_plugin_path_allow_cb path_allow = get_path_allow();
+    if (path_allow && !path_allow(path)) {
+	bu_plugin_logf(BU_LOG_ERR, "Plugin path '%s' not allowed by policy", path);
+	return -1;
+    }
+    if (!get_pool().load() && bu_plugin_worker_pool_start(0) < 0) return -1;
+    WorkerPool *pool = get_pool().load();
+    if (!pool) return -1;
+
+    std::lock_guard<std::mutex> lock(pool->m);
+    PoolBlob *blob = pool->blob;
+    uint32_t p = blob->npaths.load();
+    uint32_t off = (p < POOL_MAX_PATHS) ? blob_append(blob, path) : UINT32_MAX;
+    if (off == UINT32_MAX) {
+	bu_plugin_logf(BU_LOG_ERR, "Worker pool cannot take more plugins (loading %s)", path);
+	return -1;
+    }
+    blob->path_off[p] = off;
+    blob->npaths.store(p + 1, std::memory_order_release);
+
+    /* Every serving worker opens it now; one that is restarting catches up on its own */
+    std::vector<std::string> names;
+    bool loaded = false;
+    for (const auto &wp : pool->workers) {
+	PoolWorker *w = wp.get();
+	if (w->down.load()) continue;
+	w->users.fetch_add(1);
+	if (w->down.load()) {
+	    w->users.fetch_sub(1);
+	    continue;
+	}
+	PoolSlot *slot;
+	if (pool_request(w, POOL_OP_LOAD, p, slot) == SLOT_DONE && slot->status >= 0 && !loaded) {
+	    const char *n = w->sh->control;
+	    for (int k = 0; k < slot->status; k++, n += std::strlen(n) + 1) names.push_back(n);
+	    loaded = true;
+	}
+	pool_release(w, slot);
+    }
+    if (!loaded) {
+	bu_plugin_logf(BU_LOG_ERR, "No plugin worker could load %s", path);
+	return -1;
+    }
+
+    int registered = 0;
+    const bu_plugin_cmd_impl *proxies = pool_proxies();
+    for (const auto &n : names) {
+	uint32_t i = blob->ncmds.load();
+	uint32_t noff = (i < POOL_MAX_CMDS) ? blob_append(blob, n) : UINT32_MAX;
+	if (noff == UINT32_MAX) {
+	    bu_plugin_logf(BU_LOG_ERR, "Worker pool cannot take more commands; '%s' from %s is not registered", n.c_str(), path);
+	    break;
+	}
+	blob->cmd_off[i] = noff;
+	blob->ncmds.store(i + 1, std::memory_order_release);
+	if (bu_plugin_cmd_register(n.c_str(), proxies[i]) == 0) {
+	    bu_plugin_cmd_set_flags(n.c_str(), BU_PLUGIN_CMD_THREADSAFE);
+	    pool->proxies.push_back(n);
+	    registered++;
+	}
+    }
+    bu_plugin_logf(BU_LOG_INFO, "Plugin %s loaded out of process (%d command(s))", path, registered);
+    return registered;
+}
+
+/* Whether a thread this library started may be running, and so may hold a lock a fork() child would inherit */
+static bool library_threads_running() {
+    if (get_executor().load(std::memory_order_acquire)) return true;
+    if (get_helper_calls().load() != 0) return true;
+    DeadlineTimer &t = get_deadline_timer();
+    std::lock_guard<std::mutex> lock(t.m);
+    return t.running;
+}
+
+static std::mutex& get_pool_mutex() {
+    static std::mutex m;
+    return m;
+}
+
+/* Stop the spawner (which kills the workers), join the supervisor, unmap */
+static void pool_destroy(WorkerPool *pool) {
+    pool->stopping.store(true);
+    if (pool->sock >= 0) shutdown(pool->sock, SHUT_RDWR);
+    if (pool->supervisor.joinable()) pool->supervisor.join();
+    if (pool->sock >= 0) close(pool->sock);
+    if (pool->spawner > 0) {
+	while (waitpid(pool->spawner, nullptr, 0) < 0 && errno == EINTR) {}
+    }
+    if (pool->map) munmap(pool->map, pool->map_bytes);
+    delete pool;
+}
+#else
+static bool& pool_in_worker() {
+    static bool in_worker = false;
+    return in_worker;
+}
+
+static int pool_load(const char *path) {
+    bu_plugin_logf(BU_LOG_ERR, "Plugin %s: out-of-process loading needs POSIX and the default command signature", path ? path : "(null)");
+    return -1;
+}
+#endif /* !_WIN32 && BU_PLUGIN_DEFAULT_SIGNATURE */
+
+/* Run the current context's fini hooks and unload its modules in reverse order, then clear its registry */
+static void registry_release() {
+    std::vector<LoadedModule> mods;
+    {
+	std::lock_guard<std::mutex> lock(get_modules_mutex());
+	mods.swap(get_modules());
+    }
+    for (auto it = mods.rbegin(); it != mods.rend(); ++it) {
+	if (it->fini) it->fini();
+	close_module(it->handle);
+    }
+    std::lock_guard<std::mutex> lock(get_mutex());
+    get_registry().clear();
+    get_cmd_flags().clear();
+    get_cmd_batch().clear();
+    get_cmd_strands().clear();
+    get_cmd_sigs().clear();
+    for (auto &entry : get_handle_pool()) {
+	fill_handle(&entry, nullptr, BU_PLUGIN_SIG_NATIVE, nullptr);
+	entry.strand.store(nullptr, std::memory_order_release);
+	entry.flags.store(0, std::memory_order_release);
+    }
+    memo_invalidate();
+    delete get_frozen().exchange(nullptr);
+}
+
+/* A context namespace prefixes exported symbol names, so it must be an identifier */
+static bool valid_ns(const char *ns) {
+    if (!ns[0] || std::isdigit(static_cast<unsigned char>(ns[0]))) return false;
+    for (const char *c = ns; *c; c++) {
+	if (!sig_word_char(*c)) return false;
+    }
+    return true;
+}
+
+} /* namespace bu_plugin_impl */
+
+#ifdef BU_PLUGIN_DEFAULT_SIGNATURE
+struct bu_plugin_dag {
+    std::vector<bu_plugin_impl::DagNode> nodes;
+    std::vector<size_t> critical;       /* Last run's critical path, first node first */
+};
+#endif
+
+extern "C" {
+
+    BU_PLUGIN_API void bu_plugin_set_logger(bu_plugin_logger_cb cb) {
+	bu_plugin_impl::get_logger() = cb;
+    }
+
+    BU_PLUGIN_API void bu_plugin_logf(int level, const char *fmt, ...) {
+	/* Buffer size of 2048 should be sufficient for most log messages.
+	   Messages longer than this will be truncated. */
+	char buf[2048];
+	va_list args;
+	va_start(args, fmt);
+#if defined(_WIN32)
+	_vsnprintf_s(buf, sizeof(buf), _TRUNCATE, fmt, args);
+#else
+	vsnprintf(buf, sizeof(buf), fmt, args);
+#endif
+	va_end(args);
+	buf[sizeof(buf) - 1] = '\0';
+
+	bu_plugin_logger_cb logger = bu_plugin_impl::get_logger();
+	if (logger) {
+	    /* Logger callback is set - dispatch immediately */
+	    logger(level, buf);
+	} else {
+	    /* No logger set - buffer internally to avoid STDOUT/STDERR during startup */
+	    std::lock_guard<std::mutex> lock(bu_plugin_impl::get_log_buffer_mutex());
+	    bu_plugin_impl::get_log_buffer().push_back({level, std::string(buf)});
+	}
+    }
+
+    BU_PLUGIN_API void bu_plugin_flush_logs(bu_plugin_logger_cb cb) {
+	std::vector<bu_plugin_impl::BufferedLogEntry> logs;
+	{
+	    std::lock_guard<std::mutex> lock(bu_plugin_impl::get_log_buffer_mutex());
+	    logs = std::move(bu_plugin_impl::get_log_buffer());
+	    /* Note: move leaves source in valid but unspecified state; clear ensures it's empty */
+	    bu_plugin_impl::get_log_buffer().clear();
+	}
+
+	if (cb) {
+	    for (const auto& entry : logs) {
+		cb(entry.level, entry.msg.c_str());
+	    }
+	}
+	/* If cb is NULL, logs are simply discarded */
+    }
+
+    BU_PLUGIN_API void bu_plugin_set_path_allow(bu_plugin_path_allow_cb cb) {
+	bu_plugin_impl::get_path_allow() = cb;
+    }
+
+    BU_PLUGIN_API void bu_plugin_set_load_flags(unsigned int flags) {
+	bu_plugin_impl::get_load_flags().store(flags);
+    }
+
+    BU_PLUGIN_API unsigned int bu_plugin_get_load_flags(void) {
+	return bu_plugin_impl::get_load_flags().load();
+    }
+
+    BU_PLUGIN_API int bu_plugin_cmd_register(const char *name, bu_plugin_cmd_impl impl) {
+	return bu_plugin_cmd_register_sig(name, BU_PLUGIN_SIG_NATIVE, reinterpret_cast<bu_plugin_any_fn>(impl));
+    }
+
+    BU_PLUGIN_API int bu_plugin_cmd_register_sig(const char *name, unsigned int sig, bu_plugin_any_fn fn) {
+	if (!name || !fn) return -1;
+
+	/* Trim whitespace from name */
+	std::string trimmed = bu_plugin_impl::trim_whitespace(name);
+	if (trimmed.empty()) return -1;  /* Reject empty string names */
+
+	/* Warn about internal whitespace */
+	if (bu_plugin_impl::has_internal_whitespace(trimmed)) {
+	    bu_plugin_logf(BU_LOG_WARN, "Command name '%s' contains internal whitespace", trimmed.c_str());
+	}
+
+	std::lock_guard<std::mutex> lock(bu_plugin_impl::get_mutex());
+	if (bu_plugin_impl::get_frozen().load(std::memory_order_acquire)) {
+	    bu_plugin_logf(BU_LOG_ERR, "Cannot register '%s': registry is frozen", trimmed.c_str());
+	    return -1;
+	}
+	if (!bu_plugin_impl::sig_name_of(sig)) {
+	    bu_plugin_logf(BU_LOG_ERR, "Cannot register '%s': unknown signature ID %u", trimmed.c_str(), sig);
+	    return -1;
+	}
+	auto& reg = bu_plugin_impl::get_registry();
+	if (reg.find(trimmed) != reg.end()) {
+	    bu_plugin_logf(BU_LOG_WARN, "Duplicate command '%s' ignored (first wins)", trimmed.c_str());
+	    return 1; /* Duplicate - first wins */
+	}
+	bu_plugin_cmd_impl impl = nullptr;
+	if (sig == BU_PLUGIN_SIG_NATIVE) {
+	    impl = reinterpret_cast<bu_plugin_cmd_impl>(fn);
+	} else {
+	    bu_plugin_impl::get_cmd_sigs()[trimmed] = {sig, fn};
+	}
+	reg[trimmed] = impl;
+	bu_plugin_impl::get_cmd_flags().erase(trimmed);
+	bu_plugin_impl::get_cmd_batch().erase(trimmed);
+	bu_plugin_impl::get_cmd_strands().erase(trimmed);
+	bu_plugin_impl::update_handle(trimmed, impl);
+	bu_plugin_impl::update_handle_strand(trimmed);
+	return 0;
+    }
+
+    BU_PLUGIN_API int bu_plugin_cmd_exists(const char *name) {
+	if (!name) return 0;
+	bu_plugin_ctx &r = bu_plugin_impl::current_registry();
+	const bu_plugin_impl::FrozenTable *frozen = r.frozen.load(std::memory_order_acquire);
+	if (frozen) return bu_plugin_impl::frozen_find(frozen, name) ? 1 : 0;
+	std::string trimmed = bu_plugin_impl::trim_whitespace(name);
+	if (trimmed.empty()) return 0;
+	std::lock_guard<std::mutex> lock(r.mtx);
+	return r.registry.find(trimmed) != r.registry.end() ? 1 : 0;
+    }
+
+    BU_PLUGIN_API bu_plugin_cmd_impl bu_plugin_cmd_get(const char *name) {
+	if (!name) return nullptr;
+	bu_plugin_ctx &r = bu_plugin_impl::current_registry();
+	const bu_plugin_impl::FrozenTable *frozen = r.frozen.load(std::memory_order_acquire);
+	if (frozen) {
+	    const bu_plugin_impl::FrozenSlot *slot = bu_plugin_impl::frozen_find(frozen, name);
+	    return slot ? slot->impl : nullptr;
+	}
+	std::string trimmed = bu_plugin_impl::trim_whitespace(name);
+	if (trimmed.empty()) return nullptr;
+	std::lock_guard<std::mutex> lock(r.mtx);
+	auto it = r.registry.find(trimmed);
+	return (it != r.registry.end()) ? it->second : nullptr;
+    }
+
+    BU_PLUGIN_API size_t bu_plugin_cmd_count(void) {
+	bu_plugin_ctx &r = bu_plugin_impl::current_registry();
+	const bu_plugin_impl::FrozenTable *frozen = r.frozen.load(std::memory_order_acquire);
+	if (frozen) return frozen->sorted.size();
+	std::lock_guard<std::mutex> lock(r.mtx);
+	return r.registry.size();
+    }
+
+    BU_PLUGIN_API void bu_plugin_cmd_foreach(bu_plugin_cmd_callback callback, void *user_data) {
+	if (!callback) return;
+
+	/* A frozen registry is immutable and already sorted */
+	const bu_plugin_impl::FrozenTable *frozen = bu_plugin_impl::get_frozen().load(std::memory_order_acquire);
+	if (frozen) {
+	    for (size_t idx : frozen->sorted) {
+		const bu_plugin_impl::FrozenSlot &slot = frozen->slots[idx];
+		if (!slot.impl) continue;   /* another signature */
+		if (callback(slot.name, slot.impl, user_data) != 0) break;
+	    }
+	    return;
+	}
+
+	/* Snapshot the registry under lock, then release lock for iteration */
+	std::vector<std::pair<std::string, bu_plugin_cmd_impl>> snapshot;
+	{
+	    std::lock_guard<std::mutex> lock(bu_plugin_impl::get_mutex());
+	    auto& reg = bu_plugin_impl::get_registry();
+	    snapshot.reserve(reg.size());
+	    for (const auto& pair : reg) {
+		if (pair.second) snapshot.push_back(pair);
+	    }
+	}
+
+	/* Sort out of lock */
+	std::sort(snapshot.begin(), snapshot.end(),
+		[](const std::pair<std::string, bu_plugin_cmd_impl>& a,
+		    const std::pair<std::string, bu_plugin_cmd_impl>& b) {
+		return a.first < b.first;
+		});
+
+	/* Iterate out of lock */
+	for (const auto& pair : snapshot) {
+	    if (callback(pair.first.c_str(), pair.second, user_data) != 0) {
+		break;  /* Callback requested stop */
+	    }
+	}
+    }
+
+    BU_PLUGIN_API bu_plugin_cmd_handle bu_plugin_cmd_lookup(const char *name) {
+	if (!name) return nullptr;
+	bu_plugin_ctx &r = bu_plugin_impl::current_registry();
+
+	/* bu_plugin_freeze() created a handle for every registered name */
+	const bu_plugin_impl::FrozenTable *frozen = r.frozen.load(std::memory_order_acquire);
+	if (frozen) {
+	    const bu_plugin_impl::FrozenSlot *slot = bu_plugin_impl::frozen_find(frozen, name);
+	    return slot ? slot->handle : nullptr;
+	}
+
+	std::string trimmed = bu_plugin_impl::trim_whitespace(name);
+	if (trimmed.empty()) return nullptr;
+	std::lock_guard<std::mutex> lock(r.mtx);
+	auto it = r.registry.find(trimmed);
+	if (it == r.registry.end()) return nullptr;
+	return bu_plugin_impl::handle_of(trimmed, it->second);
+    }
+
+    BU_PLUGIN_API bu_plugin_cmd_handle bu_plugin_cmd_lookup_sig(const char *name, unsigned int sig) {
+	bu_plugin_cmd_handle h = bu_plugin_cmd_lookup(name);
+	if (!h) return nullptr;
+	unsigned int actual = h->sig.load(std::memory_order_acquire);
+	if (actual == sig) return h;
+	bu_plugin_logf(BU_LOG_WARN, "Command '%s' has signature %s, not %s", h->name.c_str(),
+		bu_plugin_sig_name(actual), bu_plugin_sig_name(sig) ? bu_plugin_sig_name(sig) : "(unknown)");
+	return nullptr;
+    }
+
+    BU_PLUGIN_API unsigned int bu_plugin_sig_id(const char *signature) {
+	return bu_plugin_impl::sig_intern(signature);
+    }
+
+    BU_PLUGIN_API const char *bu_plugin_sig_name(unsigned int sig) {
+	return bu_plugin_impl::sig_name_of(sig);
+    }
+
+    BU_PLUGIN_API int bu_plugin_cmd_set_flags(const char *name, unsigned int flags) {
+	if (!name) return -1;
+	std::string trimmed = bu_plugin_impl::trim_whitespace(name);
+	std::lock_guard<std::mutex> lock(bu_plugin_impl::get_mutex());
+	if (bu_plugin_impl::get_frozen().load(std::memory_order_acquire)) return -1;
+	auto &reg = bu_plugin_impl::get_registry();
+	if (reg.find(trimmed) == reg.end()) return -1;
+	if ((bu_plugin_impl::cmd_flags_of(trimmed) ^ flags) & BU_PLUGIN_CMD_PURE) bu_plugin_impl::memo_invalidate();
+	if (flags) {
+	    bu_plugin_impl::get_cmd_flags()[trimmed] = flags;
+	} else {
+	    bu_plugin_impl::get_cmd_flags().erase(trimmed);
+	}
+	bu_plugin_impl::update_handle_strand(trimmed);
+	return 0;
+    }
+
+    BU_PLUGIN_API unsigned int bu_plugin_cmd_get_flags(const char *name) {
+	if (!name) return 0;
+	bu_plugin_ctx &r = bu_plugin_impl::current_registry();
+	const bu_plugin_impl::FrozenTable *frozen = r.frozen.load(std::memory_order_acquire);
+	if (frozen) {
+	    const bu_plugin_impl::FrozenSlot *slot = bu_plugin_impl::frozen_find(frozen, name);
+	    return slot ? slot->flags : 0;
+	}
+	std::string trimmed = bu_plugin_impl::trim_whitespace(name);
+	std::lock_guard<std::mutex> lock(r.mtx);
+	return bu_plugin_impl::cmd_flags_of(r, trimmed);
+    }
+
+    BU_PLUGIN_API int bu_plugin_cmd_set_batch(const char *name, bu_plugin_cmd_batch_impl batch) {
+	if (!name) return -1;
+	std::string trimmed = bu_plugin_impl::trim_whitespace(name);
+	std::lock_guard<std::mutex> lock(bu_plugin_impl::get_mutex());
+	if (bu_plugin_impl::get_frozen().load(std::memory_order_acquire)) return -1;
+	auto &reg = bu_plugin_impl::get_registry();
+	auto it = reg.find(trimmed);
+	if (it == reg.end() || !it->second) return -1;   /* unknown, or another signature */
+	if (batch) {
+	    bu_plugin_impl::get_cmd_batch()[trimmed] = batch;
+	} else {
+	    bu_plugin_impl::get_cmd_batch().erase(trimmed);
+	}
+	return 0;
+    }
+
+    BU_PLUGIN_API bu_plugin_cmd_batch_impl bu_plugin_cmd_get_batch(const char *name) {
+	if (!name) return nullptr;
+	bu_plugin_ctx &r = bu_plugin_impl::current_registry();
+	const bu_plugin_impl::FrozenTable *frozen = r.frozen.load(std::memory_order_acquire);
+	if (frozen) {
+	    const bu_plugin_impl::FrozenSlot *slot = bu_plugin_impl::frozen_find(frozen, name);
+	    return slot ? slot->batch : nullptr;
+	}
+	std::string trimmed = bu_plugin_impl::trim_whitespace(name);
+	std::lock_guard<std::mutex> lock(r.mtx);
+	return bu_plugin_impl::cmd_batch_of(r, trimmed);
+    }
+
+    BU_PLUGIN_API void bu_plugin_memo_set_capacity(size_t entries) {
+	bu_plugin_impl::memo_resize(entries);
+    }
+
+    BU_PLUGIN_API int bu_plugin_memo_lookup(bu_plugin_cmd_handle h, const void *args, size_t len,
+	    BU_PLUGIN_CMD_RET *result, bu_plugin_memo_token *token) {
+	if (token) *token = 0;
+	if (!h || (len && !args) || !bu_plugin_impl::memo_enabled()) return 0;
+	bu_plugin_cmd_impl fn = h->impl.load(std::memory_order_acquire);
+	if (!fn || !(h->flags.load(std::memory_order_acquire) & BU_PLUGIN_CMD_PURE)) return 0;
+	/* The epoch before the command runs, as cached_call() keeps it */
+	uint64_t epoch = bu_plugin_impl::get_memo().epoch.load(std::memory_order_acquire);
+	if (bu_plugin_impl::memo_find(fn, static_cast<const char *>(args), len, result)) return 1;
+	if (token) *token = epoch;
+	return 0;
+    }
+
+    BU_PLUGIN_API void bu_plugin_memo_store(bu_plugin_cmd_handle h, const void *args, size_t len,
+	    const BU_PLUGIN_CMD_RET *result, bu_plugin_memo_token token) {
+	if (!h || !result || !token || (len && !args) || !bu_plugin_impl::memo_enabled()) return;
+	bu_plugin_cmd_impl fn = h->impl.load(std::memory_order_acquire);
+	if (!fn || !(h->flags.load(std::memory_order_acquire) & BU_PLUGIN_CMD_PURE)) return;
+	bu_plugin_impl::memo_put(fn, static_cast<const char *>(args), len, result, token);
+    }
+
+    BU_PLUGIN_API void bu_plugin_memo_clear(void) {
+	bu_plugin_impl::memo_invalidate();
+    }
+
+    BU_PLUGIN_API int bu_plugin_memo_get_stats(bu_plugin_memo_stats *stats) {
+	if (!stats) return -1;
+	size_t sz = stats->struct_size;
+	bu_plugin_impl::MemoCache &c = bu_plugin_impl::get_memo();
+	uint64_t epoch = c.epoch.load(std::memory_order_acquire);
+	size_t entries = 0;
+	unsigned long long hits = 0, misses = 0, evictions = 0;
+	for (bu_plugin_impl::MemoShard &s : c.shards) {
+	    std::lock_guard<std::mutex> lock(s.m);
+	    for (const auto &slot : s.slots) {
+		if (slot.epoch == epoch) entries++;
+	    }
+	    hits += s.hits;
+	    misses += s.misses;
+	    evictions += s.evictions;
+	}
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_memo_stats, sz, capacity)) stats->capacity = c.capacity.load();
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_memo_stats, sz, entries)) stats->entries = entries;
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_memo_stats, sz, hits)) stats->hits = hits;
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_memo_stats, sz, misses)) stats->misses = misses;
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_memo_stats, sz, evictions)) stats->evictions = evictions;
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_memo_stats, sz, invalidations)) stats->invalidations = c.invalidations.load();
+	return 0;
+    }
+
+    BU_PLUGIN_API bu_plugin_cmd_impl bu_plugin_cmd_handle_impl(bu_plugin_cmd_handle h) {
+	return h ? h->impl.load(std::memory_order_acquire) : nullptr;
+    }
+
+    BU_PLUGIN_API const char *bu_plugin_cmd_handle_name(bu_plugin_cmd_handle h) {
+	return h ? h->name.c_str() : nullptr;
+    }
+
+    BU_PLUGIN_API unsigned int bu_plugin_cmd_handle_flags(bu_plugin_cmd_handle h) {
+	return h ? h->flags.load(std::memory_order_acquire) : 0;
+    }
+
+    BU_PLUGIN_API unsigned int bu_plugin_cmd_handle_sig(bu_plugin_cmd_handle h) {
+	return h ? h->sig.load(std::memory_order_acquire) : BU_PLUGIN_SIG_NATIVE;
+    }
+
+    BU_PLUGIN_API bu_plugin_any_fn bu_plugin_cmd_handle_fn(bu_plugin_cmd_handle h, unsigned int sig) {
+	if (!h) return nullptr;
+	bu_plugin_any_fn fn = h->fn.load(std::memory_order_acquire);
+	return h->sig.load(std::memory_order_acquire) == sig ? fn : nullptr;
+    }
+
+    BU_PLUGIN_API const bu_plugin_host_services *bu_plugin_get_host_services(void) {
+	return &bu_plugin_impl::get_host_services();
+    }
+
+    BU_PLUGIN_API bu_plugin_call_ctx *bu_plugin_call_ctx_create(void) {
+	return new (std::nothrow) bu_plugin_impl::CallCtx();
+    }
+
+    BU_PLUGIN_API void bu_plugin_call_ctx_destroy(bu_plugin_call_ctx *ctx) {
+	bu_plugin_impl::ctx_release(static_cast<bu_plugin_impl::CallCtx *>(ctx));
+    }
+
+    BU_PLUGIN_API void bu_plugin_call_ctx_cancel(bu_plugin_call_ctx *ctx) {
+	if (ctx) bu_plugin_impl::ctx_stop(static_cast<bu_plugin_impl::CallCtx *>(ctx));
+    }
+
+    BU_PLUGIN_API int bu_plugin_call_ctx_set_deadline(bu_plugin_call_ctx *ctx, unsigned long long timeout_us) {
+	if (!ctx) return -1;
+	bu_plugin_impl::ctx_set_deadline(static_cast<bu_plugin_impl::CallCtx *>(ctx), timeout_us);
+	return 0;
+    }
+
+    BU_PLUGIN_API bu_plugin_call_ctx *bu_plugin_call_ctx_current(void) {
+	return bu_plugin_impl::tls_call_ctx;
+    }
+
+    BU_PLUGIN_API bu_plugin_call_ctx *bu_plugin_call_ctx_set_current(bu_plugin_call_ctx *ctx) {
+	bu_plugin_call_ctx *prev = bu_plugin_impl::tls_call_ctx;
+	bu_plugin_impl::tls_call_ctx = static_cast<bu_plugin_impl::CallCtx *>(ctx);
+	return prev;
+    }
+
+    BU_PLUGIN_API void bu_plugin_output_write(const char *data, size_t len) {
+	if (!data || !len) return;
+	bu_plugin_impl::OutputState &st = bu_plugin_impl::output_state();
+	bool drop;
+	bu_plugin_impl::OutputBuffer *t = bu_plugin_impl::output_target(st, drop);
+	if (t) {
+	    t->append(data, len);
+	} else if (!drop) {
+	    bu_plugin_impl::output_emit(data, len);
+	}
+    }
+
+    BU_PLUGIN_API void bu_plugin_output_printf(const char *fmt, ...) {
+	if (!fmt) return;
+	va_list args;
+	va_start(args, fmt);
+	bu_plugin_impl::output_vprintf(fmt, args);
+	va_end(args);
+    }
+
+    BU_PLUGIN_API void bu_plugin_set_output_writer(bu_plugin_output_fn fn, void *user) {
+	std::lock_guard<std::mutex> lock(bu_plugin_impl::get_output_writers_mutex());
+	std::deque<bu_plugin_impl::OutputWriter> &writers = bu_plugin_impl::get_output_writers();
+	const bu_plugin_impl::OutputWriter *w = nullptr;
+	for (const bu_plugin_impl::OutputWriter &old : writers) {
+	    if (old.fn == fn && old.user == user) {
+		w = &old;
+		break;
+	    }
+	}
+	if (!w) {
+	    bu_plugin_impl::OutputWriter fresh = { fn, user };
+	    writers.push_back(fresh);
+	    w = &writers.back();
+	}
+	bu_plugin_impl::get_output_writer().store(w, std::memory_order_release);
+    }
+
+    BU_PLUGIN_API void bu_plugin_output_discard(void *, const char *, size_t) {
+    }
+
+    BU_PLUGIN_API bu_plugin_output *bu_plugin_output_create(void) {
+	return new (std::nothrow) bu_plugin_output();
+    }
+
+    BU_PLUGIN_API void bu_plugin_output_destroy(bu_plugin_output *out) {
+	delete out;
+    }
+
+    BU_PLUGIN_API const char *bu_plugin_output_data(const bu_plugin_output *out, size_t *len) {
+	if (len) *len = out ? out->buf.len : 0;
+	if (!out) return nullptr;
+	return out->buf.data ? out->buf.data : "";
+    }
+
+    BU_PLUGIN_API void bu_plugin_output_clear(bu_plugin_output *out) {
+	if (out) out->buf.clear();
+    }
+
+    BU_PLUGIN_API bu_plugin_output *bu_plugin_output_set_current(bu_plugin_output *out) {
+	bu_plugin_impl::OutputState &st = bu_plugin_impl::output_state();
+	bu_plugin_output *prev = st.capture;
+	st.capture = out;
+	return prev;
+    }
+
+    BU_PLUGIN_API void bu_plugin_output_begin(void) {
+	bu_plugin_impl::output_begin();
+    }
+
+    BU_PLUGIN_API void bu_plugin_output_end(void) {
+	bu_plugin_impl::output_end();
+    }
+
+    BU_PLUGIN_API bu_plugin_channel *bu_plugin_channel_create(const char *type, size_t record_size, size_t capacity) {
+	if (!type || !record_size || !capacity || capacity > (SIZE_MAX >> 2) / record_size) return nullptr;
+	size_t cap = 2;
+	while (cap < capacity) cap <<= 1;
+	bu_plugin_channel *ch = new (std::nothrow) bu_plugin_channel();
+	if (!ch) return nullptr;
+	ch->slots = static_cast<char *>(std::malloc(cap * record_size));
+	if (!ch->slots) {
+	    delete ch;
+	    return nullptr;
+	}
+	ch->type = type;
+	ch->record_size = record_size;
+	ch->capacity = cap;
+	return ch;
+    }
+
+    BU_PLUGIN_API void bu_plugin_channel_destroy(bu_plugin_channel *ch) {
+	if (!ch) return;
+	std::free(ch->slots);
+	delete ch;
+    }
+
+    BU_PLUGIN_API int bu_plugin_channel_check(const bu_plugin_channel *ch, const char *type, size_t record_size) {
+	if (!ch || !type || ch->record_size != record_size || ch->type != type) return -1;
+	return 0;
+    }
+
+    BU_PLUGIN_API const char *bu_plugin_channel_type(const bu_plugin_channel *ch, size_t *record_size) {
+	if (record_size) *record_size = ch ? ch->record_size : 0;
+	return ch ? ch->type.c_str() : nullptr;
+    }
+
+    BU_PLUGIN_API void *bu_plugin_channel_reserve(bu_plugin_channel *ch, size_t max, size_t *got) {
+	if (!ch) {
+	    if (got) *got = 0;
+	    return nullptr;
+	}
+	return bu_plugin_impl::channel_reserve(ch, max, got);
+    }
+
+    BU_PLUGIN_API void bu_plugin_channel_commit(bu_plugin_channel *ch, size_t n) {
+	if (ch) bu_plugin_impl::channel_commit(ch, n);
+    }
+
+    BU_PLUGIN_API const void *bu_plugin_channel_peek(bu_plugin_channel *ch, size_t max, size_t *got) {
+	if (!ch) {
+	    if (got) *got = 0;
+	    return nullptr;
+	}
+	return bu_plugin_impl::channel_peek(ch, max, got);
+    }
+
+    BU_PLUGIN_API void bu_plugin_channel_release(bu_plugin_channel *ch, size_t n) {
+	if (ch) bu_plugin_impl::channel_release(ch, n);
+    }
+
+    BU_PLUGIN_API int bu_plugin_channel_push(bu_plugin_channel *ch, const void *record) {
+	size_t got = 0;
+	void *slot = ch && record ? bu_plugin_impl::channel_reserve(ch, 1, &got) : nullptr;
+	if (!slot) return -1;
+	std::memcpy(slot, record, ch->record_size);
+	bu_plugin_impl::channel_commit(ch, 1);
+	return 0;
+    }
+
+    BU_PLUGIN_API int bu_plugin_channel_pop(bu_plugin_channel *ch, void *record) {
+	if (!ch || !record) return -1;
+	size_t got = 0;
+	const void *slot = bu_plugin_impl::channel_peek(ch, 1, &got);
+	if (!slot) return bu_plugin_channel_cancelled(ch) ? -1 : 0;
+	std::memcpy(record, slot, ch->record_size);
+	bu_plugin_impl::channel_release(ch, 1);
+	return 1;
+    }
+
+    BU_PLUGIN_API void bu_plugin_channel_close(bu_plugin_channel *ch) {
+	if (ch) bu_plugin_impl::channel_finish(ch, bu_plugin_impl::CHANNEL_CLOSED);
+    }
+
+    BU_PLUGIN_API void bu_plugin_channel_cancel(bu_plugin_channel *ch) {
+	if (ch) bu_plugin_impl::channel_finish(ch, bu_plugin_impl::CHANNEL_CANCELLED);
+    }
+
+    BU_PLUGIN_API int bu_plugin_channel_cancelled(const bu_plugin_channel *ch) {
+	return ch && ch->state.load() == bu_plugin_impl::CHANNEL_CANCELLED;
+    }
+
+    BU_PLUGIN_API int bu_plugin_channel_get_stats(const bu_plugin_channel *ch, bu_plugin_channel_stats *stats) {
+	if (!ch || !stats) return -1;
+	size_t sz = stats->struct_size;
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_channel_stats, sz, capacity)) stats->capacity = ch->capacity;
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_channel_stats, sz, records)) stats->records = ch->head.load();
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_channel_stats, sz, producer_waits)) stats->producer_waits = ch->producer_waits.load();
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_channel_stats, sz, consumer_waits)) stats->consumer_waits = ch->consumer_waits.load();
+	return 0;
+    }
+
+    BU_PLUGIN_API void bu_plugin_channel_set_current(bu_plugin_channel *in, bu_plugin_channel *out) {
+	bu_plugin_impl::tls_channel_in = in;
+	bu_plugin_impl::tls_channel_out = out;
+    }
+
+    BU_PLUGIN_API bu_plugin_channel *bu_plugin_channel_input(void) {
+	return bu_plugin_impl::tls_channel_in;
+    }
+
+    BU_PLUGIN_API bu_plugin_channel *bu_plugin_channel_output(void) {
+	return bu_plugin_impl::tls_channel_out;
+    }
+
+    BU_PLUGIN_API int bu_plugin_set_allocator(const bu_plugin_allocator *alloc) {
+	if (!alloc) {
+	    bu_plugin_impl::get_allocator().store(&bu_plugin_impl::default_allocator(), std::memory_order_release);
+	    return 0;
+	}
+	if (alloc->struct_size < sizeof(bu_plugin_allocator) || !alloc->mem_alloc || !alloc->mem_realloc ||
+		!alloc->mem_free || !alloc->arena_push || !alloc->arena_pop) {
+	    bu_plugin_logf(BU_LOG_ERR, "Rejected incomplete bu_plugin_allocator");
+	    return -1;
+	}
+	bu_plugin_impl::get_allocator().store(alloc, std::memory_order_release);
+	return 0;
+    }
+
+    BU_PLUGIN_API const bu_plugin_allocator *bu_plugin_get_allocator(void) {
+	return bu_plugin_impl::host_allocator();
+    }
+
+    BU_PLUGIN_API void bu_plugin_set_cmd_arena(int enable) {
+	bu_plugin_impl::get_cmd_arena().store(enable != 0, std::memory_order_relaxed);
+    }
+
+    BU_PLUGIN_API void bu_plugin_cmd_fail(const char *msg) {
+	bu_plugin_impl::set_call_failure(msg);
+    }
+
+    BU_PLUGIN_API const char *bu_plugin_cmd_take_failure(void) {
+	return bu_plugin_impl::take_call_failure();
+    }
+
+    BU_PLUGIN_API int bu_plugin_exec_start(unsigned int nworkers) {
+	std::lock_guard<std::mutex> lock(bu_plugin_impl::get_exec_mutex());
+	if (bu_plugin_impl::get_executor().load()) return 1;
+	if (nworkers == 0) nworkers = std::max(1u, std::thread::hardware_concurrency());
+	bu_plugin_impl::get_executor().store(new bu_plugin_impl::Executor(nworkers), std::memory_order_release);
+	return 0;
+    }
+
+    BU_PLUGIN_API unsigned int bu_plugin_exec_workers(void) {
+	bu_plugin_impl::ExecPin pin(false);
+	return pin.e ? static_cast<unsigned int>(pin.e->queues.size()) : 0;
+    }
+
+    BU_PLUGIN_API int bu_plugin_exec_post(bu_plugin_job_fn fn, void *arg) {
+	if (!fn) return -1;
+	bu_plugin_impl::ExecPin pin(true);
+	if (!pin.e) return -1;
+	bu_plugin_impl::Job job = bu_plugin_impl::Job();
+	job.fn = fn;
+	job.arg = arg;
+	job.ctx = bu_plugin_impl::tls_call_ctx;
+	job.reg = bu_plugin_impl::tls_registry;
+	bu_plugin_impl::ctx_retain(job.ctx);
+	pin.e->post(job);
+	return 0;
+    }
+
+    BU_PLUGIN_API int bu_plugin_exec_drain(void) {
+	if (bu_plugin_impl::tls_executor) {
+	    bu_plugin_logf(BU_LOG_ERR, "bu_plugin_exec_drain() called from an executor worker; it would wait for its own job");
+	    return -1;
+	}
+	bu_plugin_impl::ExecPin pin(false);
+	if (pin.e) pin.e->drain();
+	return 0;
+    }
+
+    BU_PLUGIN_API void bu_plugin_exec_stop(void) {
+	std::lock_guard<std::mutex> lock(bu_plugin_impl::get_exec_mutex());
+	bu_plugin_impl::Executor *e = bu_plugin_impl::get_executor().load(std::memory_order_acquire);
+	if (!e) return;
+	/* Posters already past their check finish before the drain; later ones see closing */
+	e->closing.store(true);
+	bu_plugin_impl::wait_exec_users();
+	e->stop();
+	bu_plugin_impl::get_executor().store(nullptr);
+	/* Callers that loaded e before it was unpublished may still be checking closing */
+	bu_plugin_impl::wait_exec_users();
+	delete e;
+    }
+
+    BU_PLUGIN_API bu_plugin_strand *bu_plugin_strand_get(const char *name) {
+	if (!name) return nullptr;
+	std::string trimmed = bu_plugin_impl::trim_whitespace(name);
+	if (trimmed.empty()) return nullptr;
+	std::lock_guard<std::mutex> lock(bu_plugin_impl::get_strands_mutex());
+	auto &strands = bu_plugin_impl::get_strands();
+	auto it = strands.find(trimmed);
+	if (it != strands.end()) return it->second.get();
+	bu_plugin_strand *s = new bu_plugin_strand(trimmed);
+	strands[trimmed].reset(s);
+	return s;
+    }
+
+    BU_PLUGIN_API const char *bu_plugin_strand_name(const bu_plugin_strand *s) {
+	return s ? s->name.c_str() : nullptr;
+    }
+
+    BU_PLUGIN_API int bu_plugin_strand_post(bu_plugin_strand *s, bu_plugin_job_fn fn, void *arg) {
+	if (!s || !fn) return -1;
+	bu_plugin_impl::ExecPin pin(true);
+	if (!pin.e) return -1;
+	bu_plugin_impl::Job job = bu_plugin_impl::Job();
+	job.fn = fn;
+	job.arg = arg;
+	job.ctx = bu_plugin_impl::tls_call_ctx;
+	job.reg = bu_plugin_impl::tls_registry;
+	bu_plugin_impl::ctx_retain(job.ctx);
+	bu_plugin_impl::strand_post(pin.e, s, job);
+	return 0;
+    }
+
+    BU_PLUGIN_API int bu_plugin_cmd_set_strand(const char *name, const char *strand) {
+	if (!name) return -1;
+	bu_plugin_strand *group = strand ? bu_plugin_strand_get(strand) : nullptr;
+	if (strand && !group) return -1;
+	std::string trimmed = bu_plugin_impl::trim_whitespace(name);
+	std::lock_guard<std::mutex> lock(bu_plugin_impl::get_mutex());
+	auto &reg = bu_plugin_impl::get_registry();
+	if (reg.find(trimmed) == reg.end()) return -1;
+	bu_plugin_impl::get_cmd_strands()[trimmed].group = group;
+	bu_plugin_impl::update_handle_strand(trimmed);
+	return 0;
+    }
+
+    BU_PLUGIN_API bu_plugin_strand *bu_plugin_cmd_handle_strand(bu_plugin_cmd_handle h) {
+	return h ? h->strand.load(std::memory_order_acquire) : nullptr;
+    }
+
+    BU_PLUGIN_API int bu_plugin_lane_configure(int lane, const bu_plugin_lane_config *cfg) {
+	if (lane < 0 || lane >= BU_PLUGIN_LANE_COUNT || !cfg) return -1;
+	if (cfg->struct_size < sizeof(bu_plugin_lane_config)) return -1;
+	if (cfg->policy < BU_PLUGIN_ADMIT_BLOCK || cfg->policy > BU_PLUGIN_ADMIT_SHED) return -1;
+	/* Shedding needs held jobs: a full lane must hold more than the executor has */
+	if (cfg->policy == BU_PLUGIN_ADMIT_SHED && cfg->capacity
+		&& (!cfg->max_running || cfg->capacity <= cfg->max_running)) {
+	    return -1;
+	}
+	bu_plugin_impl::Lane &l = bu_plugin_impl::get_lanes()[lane];
+	std::lock_guard<std::mutex> lock(l.m);
+	l.capacity.store(cfg->capacity, std::memory_order_relaxed);
+	l.max_running.store(cfg->max_running, std::memory_order_relaxed);
+	l.policy.store(cfg->policy, std::memory_order_relaxed);
+	/* A raised limit releases held jobs now rather than on the next completion */
+	bu_plugin_impl::ExecPin pin(false);
+	if (pin.e) bu_plugin_impl::lane_release(pin.e, l);
+	l.space_cv.notify_all();
+	return 0;
+    }
+
+    BU_PLUGIN_API int bu_plugin_lane_get_stats(int lane, bu_plugin_lane_stats *stats) {
+	if (lane < 0 || lane >= BU_PLUGIN_LANE_COUNT || !stats) return -1;
+	const bu_plugin_impl::Lane &l = bu_plugin_impl::get_lanes()[lane];
+	unsigned long long counts[bu_plugin_impl::LANE_HIST_BUCKETS];
+	unsigned long long started = 0;
+	for (size_t i = 0; i < bu_plugin_impl::LANE_HIST_BUCKETS; i++) {
+	    counts[i] = l.hist[i].load(std::memory_order_relaxed);
+	    started += counts[i];
+	}
+	/* Upper bound of the bucket holding the q-quantile, in us */
+	double wait_max = static_cast<double>(l.wait_max_ns.load()) / 1000.0;
+	auto quantile = [&](double q) -> double {
+	    if (!started) return 0.0;
+	    unsigned long long rank = static_cast<unsigned long long>(q * static_cast<double>(started - 1)) + 1;
+	    unsigned long long seen = 0;
+	    for (size_t i = 0; i < bu_plugin_impl::LANE_HIST_BUCKETS; i++) {
+		seen += counts[i];
+		if (seen >= rank) return std::min(wait_max, static_cast<double>(bu_plugin_impl::lane_bucket_ceiling(i)) / 1000.0);
+	    }
+	    return 0.0;
+	};
+	size_t sz = stats->struct_size;
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_lane_stats, sz, depth)) stats->depth = l.depth.load();
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_lane_stats, sz, max_depth)) stats->max_depth = l.max_depth.load();
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_lane_stats, sz, running)) stats->running = l.running.load();
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_lane_stats, sz, admitted)) stats->admitted = l.admitted.load();
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_lane_stats, sz, rejected)) stats->rejected = l.rejected.load();
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_lane_stats, sz, shed)) stats->shed = l.shed.load();
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_lane_stats, sz, completed)) stats->completed = l.completed.load();
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_lane_stats, sz, wait_mean_us)) {
+	    stats->wait_mean_us = started ? static_cast<double>(l.wait_sum_ns.load()) / static_cast<double>(started) / 1000.0 : 0.0;
+	}
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_lane_stats, sz, wait_p50_us)) stats->wait_p50_us = quantile(0.50);
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_lane_stats, sz, wait_p99_us)) stats->wait_p99_us = quantile(0.99);
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_lane_stats, sz, wait_max_us)) stats->wait_max_us = wait_max;
+	return 0;
+    }
+
+    BU_PLUGIN_API void bu_plugin_lane_reset_stats(int lane) {
+	if (lane < 0 || lane >= BU_PLUGIN_LANE_COUNT) return;
+	bu_plugin_impl::Lane &l = bu_plugin_impl::get_lanes()[lane];
+	for (auto &h : l.hist) h.store(0, std::memory_order_relaxed);
+	l.max_depth.store(l.depth.load(), std::memory_order_relaxed);
+	l.admitted.store(0);
+	l.rejected.store(0);
+	l.shed.store(0);
+	l.completed.store(0);
+	l.wait_sum_ns.store(0);
+	l.wait_max_ns.store(0);
+    }
+
+#ifdef BU_PLUGIN_DEFAULT_SIGNATURE
+    BU_PLUGIN_API int bu_plugin_cmd_submit(bu_plugin_cmd_handle h, bu_plugin_cmd_done_fn done, void *user) {
+	return bu_plugin_cmd_submit_lane(h, BU_PLUGIN_LANE_NORMAL, done, user);
+    }
+
+    BU_PLUGIN_API int bu_plugin_cmd_submit_lane(bu_plugin_cmd_handle h, int lane, bu_plugin_cmd_done_fn done, void *user) {
+	if (!h || lane < 0 || lane >= BU_PLUGIN_LANE_COUNT) return -1;
+	bu_plugin_impl::ExecPin pin(true);
+	if (!pin.e) return -1;
+	bu_plugin_impl::Job job = bu_plugin_impl::Job();
+	job.cmd = h;
+	job.done = done;
+	job.arg = user;
+	job.ctx = bu_plugin_impl::tls_call_ctx;
+	job.reg = bu_plugin_impl::tls_registry;
+	bu_plugin_impl::ctx_retain(job.ctx);
+	bu_plugin_impl::Job dropped = bu_plugin_impl::Job();
+	bool has_dropped = false;
+	int ret = bu_plugin_impl::lane_admit(pin.e, bu_plugin_impl::get_lanes()[lane], job, dropped, has_dropped);
+	if (has_dropped && dropped.done) {
+#if BU_PLUGIN_EXCEPTIONS
+	    try {
+		dropped.done(BU_PLUGIN_LANE_SHED, BU_PLUGIN_CMD_RET(), dropped.arg);
+	    } catch (...) {
+		bu_plugin_logf(BU_LOG_ERR, "Completion callback for '%s' threw an exception", dropped.cmd->name.c_str());
+	    }
+#else
+	    dropped.done(BU_PLUGIN_LANE_SHED, BU_PLUGIN_CMD_RET(), dropped.arg);
+#endif
+	}
+	if (has_dropped) bu_plugin_impl::ctx_release(dropped.ctx);
+	if (ret != 0) bu_plugin_impl::ctx_release(job.ctx);
+	return ret;
+    }
+
+    BU_PLUGIN_API int bu_plugin_cmd_submit_name(const char *name, bu_plugin_cmd_done_fn done, void *user) {
+	bu_plugin_cmd_handle h = bu_plugin_cmd_lookup(name);
+	if (!h) {
+	    bu_plugin_logf(BU_LOG_ERR, "Command '%s' not found", name ? name : "(null)");
+	    return -1;
+	}
+	return bu_plugin_cmd_submit(h, done, user);
+    }
+
+    BU_PLUGIN_API bu_plugin_dag *bu_plugin_dag_create(void) {
+	return new bu_plugin_dag();
+    }
+
+    BU_PLUGIN_API void bu_plugin_dag_destroy(bu_plugin_dag *dag) {
+	delete dag;
+    }
+
+    BU_PLUGIN_API int bu_plugin_dag_add(bu_plugin_dag *dag, const char *name) {
+	if (!dag || !name) return -1;
+	std::string trimmed = bu_plugin_impl::trim_whitespace(name);
+	if (trimmed.empty()) return -1;
+	bu_plugin_impl::DagNode node = bu_plugin_impl::DagNode();
+	node.name = trimmed;
+	node.status = BU_PLUGIN_DAG_NOT_RUN;
+	node.path_prev = SIZE_MAX;
+	dag->nodes.push_back(node);
+	return static_cast<int>(dag->nodes.size() - 1);
+    }
 
-#ifdef __cplusplus
-} /* extern "C" */
-#endif
+    BU_PLUGIN_API int bu_plugin_dag_add_handle(bu_plugin_dag *dag, bu_plugin_cmd_handle h) {
+	if (!h) return -1;
+	int id = bu_plugin_dag_add(dag, h->name.c_str());
+	if (id >= 0) dag->nodes[static_cast<size_t>(id)].handle = h;
+	return id;
+    }
 
-/*
- * C++ helper macro for registering built-in commands at static initialization time.
- * Usage: REGISTER_BU_PLUGIN_COMMAND("cmdname", my_cmd_func);
- * This creates a static object whose constructor registers the command.
- * Uses __COUNTER__ for unique variable names to avoid collisions.
- */
-#ifdef __cplusplus
+    BU_PLUGIN_API int bu_plugin_dag_depend(bu_plugin_dag *dag, int node, int dependency) {
+	if (!dag || node < 0 || dependency < 0 || node == dependency) return -1;
+	size_t n = static_cast<size_t>(node);
+	size_t d = static_cast<size_t>(dependency);
+	if (n >= dag->nodes.size() || d >= dag->nodes.size()) return -1;
+	dag->nodes[n].deps.push_back(d);
+	dag->nodes[d].dependents.push_back(n);
+	return 0;
+    }
 
-/* Helper macros for unique identifier generation */
-#define BU_PLUGIN_CONCAT_IMPL(a, b) a##b
-#define BU_PLUGIN_CONCAT(a, b) BU_PLUGIN_CONCAT_IMPL(a, b)
+    BU_PLUGIN_API int bu_plugin_dag_run(bu_plugin_dag *dag, bu_plugin_dag_report *report) {
+	using bu_plugin_impl::DagNode;
+	if (!dag) return -1;
+	std::vector<DagNode> &nodes = dag->nodes;
+	size_t count = nodes.size();
+	dag->critical.clear();
+	for (auto &node : nodes) {
+	    node.cmd = node.handle ? node.handle : bu_plugin_cmd_lookup(node.name.c_str());
+	    node.strand = bu_plugin_cmd_handle_strand(node.cmd);
+	    node.pending = node.deps.size();
+	    node.skip = false;
+	    node.status = BU_PLUGIN_DAG_NOT_RUN;
+	    node.result = BU_PLUGIN_CMD_RET();
+	    node.start_us = node.end_us = node.path_us = 0.0;
+	    node.path_prev = SIZE_MAX;
+	}
 
-#ifdef __COUNTER__
-#define BU_PLUGIN_UNIQUE_ID BU_PLUGIN_CONCAT(_bu_plugin_cmd_registrar_, __COUNTER__)
+	/* Kahn's algorithm on a copy of the pending counts detects cycles */
+	{
+	    std::vector<size_t> pending(count);
+	    std::vector<size_t> queue;
+	    for (size_t i = 0; i < count; i++) {
+		pending[i] = nodes[i].pending;
+		if (pending[i] == 0) queue.push_back(i);
+	    }
+	    for (size_t qi = 0; qi < queue.size(); qi++) {
+		for (size_t d : nodes[queue[qi]].dependents) {
+		    if (--pending[d] == 0) queue.push_back(d);
+		}
+	    }
+	    if (queue.size() != count) {
+		for (size_t i = 0; i < count; i++) nodes[i].pending = pending[i];
+		bu_plugin_logf(BU_LOG_ERR, "Command DAG rejected: dependency cycle %s",
+			bu_plugin_impl::describe_cycle(nodes).c_str());
+		return -1;
+	    }
+	}
+
+	bu_plugin_impl::DagRun r;
+	r.nodes = &nodes;
+	/* From a worker the DAG runs inline; a closing executor does not take it either */
+	bu_plugin_impl::ExecPin pin(!bu_plugin_impl::tls_executor);
+	r.exec = bu_plugin_impl::tls_executor ? nullptr : pin.e;
+	r.ctx = bu_plugin_impl::tls_call_ctx;
+	r.reg = bu_plugin_impl::tls_registry;
+	r.start = std::chrono::steady_clock::now();
+	r.remaining = count;
+	for (size_t i = 0; i < count; i++) r.tasks.push_back(std::make_pair(&r, i));
+
+	if (count > 0) {
+	    std::unique_lock<std::mutex> lock(r.m);
+	    std::vector<size_t> done;
+	    for (size_t i = 0; i < count; i++) {
+		if (nodes[i].pending == 0) bu_plugin_impl::dag_ready(r, i, done);
+	    }
+	    /* Roots are cancelled up front if the call context has already stopped */
+	    bu_plugin_impl::dag_complete(r, done);
+	    if (r.exec) {
+		r.cv.wait(lock, [&r]() { return r.remaining == 0; });
+	    } else {
+		while (!r.inline_ready.empty()) {
+		    size_t i = r.inline_ready.front();
+		    r.inline_ready.pop_front();
+		    lock.unlock();
+		    bu_plugin_impl::dag_run_node(r, i);
+		    lock.lock();
+		}
+	    }
+	}
+
+	/* Report the critical path */
+	size_t succeeded = 0, failed = 0, cancelled = 0;
+	double work_us = 0.0, wall_us = 0.0;
+	size_t tail = SIZE_MAX;
+	for (size_t i = 0; i < count; i++) {
+	    const DagNode &node = nodes[i];
+	    if (node.status == BU_PLUGIN_DAG_CANCELLED) {
+		cancelled++;
+		continue;
+	    }
+	    if (node.status == 0) {
+		succeeded++;
+	    } else {
+		failed++;
+	    }
+	    work_us += node.end_us - node.start_us;
+	    wall_us = std::max(wall_us, node.end_us);
+	    if (tail == SIZE_MAX || node.path_us > nodes[tail].path_us) tail = i;
+	}
+	std::string chain;
+	for (size_t i = tail; i != SIZE_MAX; i = nodes[i].path_prev) {
+	    dag->critical.insert(dag->critical.begin(), i);
+	    chain = nodes[i].name + (chain.empty() ? "" : " -> ") + chain;
+	}
+	double critical_us = (tail == SIZE_MAX) ? 0.0 : nodes[tail].path_us;
+	bu_plugin_logf(BU_LOG_INFO, "Command DAG ran %zu of %zu node(s) (%zu failed, %zu cancelled): critical path %.1f us (%s), work %.1f us, wall %.1f us",
+		succeeded, count, failed, cancelled, critical_us, chain.c_str(), work_us, wall_us);
+
+	if (report) {
+	    size_t sz = report->struct_size;
+	    if (BU_PLUGIN_HAS_FIELD(bu_plugin_dag_report, sz, nodes)) report->nodes = count;
+	    if (BU_PLUGIN_HAS_FIELD(bu_plugin_dag_report, sz, succeeded)) report->succeeded = succeeded;
+	    if (BU_PLUGIN_HAS_FIELD(bu_plugin_dag_report, sz, failed)) report->failed = failed;
+	    if (BU_PLUGIN_HAS_FIELD(bu_plugin_dag_report, sz, cancelled)) report->cancelled = cancelled;
+	    if (BU_PLUGIN_HAS_FIELD(bu_plugin_dag_report, sz, wall_us)) report->wall_us = wall_us;
+	    if (BU_PLUGIN_HAS_FIELD(bu_plugin_dag_report, sz, work_us)) report->work_us = work_us;
+	    if (BU_PLUGIN_HAS_FIELD(bu_plugin_dag_report, sz, critical_us)) report->critical_us = critical_us;
+	    if (BU_PLUGIN_HAS_FIELD(bu_plugin_dag_report, sz, critical_len)) report->critical_len = dag->critical.size();
+	}
+	return static_cast<int>(failed + cancelled);
+    }
+
+    BU_PLUGIN_API int bu_plugin_dag_node_info(const bu_plugin_dag *dag, int node, bu_plugin_dag_node_report *info) {
+	if (!dag || !info || node < 0 || static_cast<size_t>(node) >= dag->nodes.size()) return -1;
+	const bu_plugin_impl::DagNode &n = dag->nodes[static_cast<size_t>(node)];
+	size_t sz = info->struct_size;
+	bool critical = std::find(dag->critical.begin(), dag->critical.end(), static_cast<size_t>(node)) != dag->critical.end();
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_dag_node_report, sz, name)) info->name = n.name.c_str();
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_dag_node_report, sz, status)) info->status = n.status;
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_dag_node_report, sz, result)) info->result = n.result;
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_dag_node_report, sz, start_us)) info->start_us = n.start_us;
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_dag_node_report, sz, end_us)) info->end_us = n.end_us;
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_dag_node_report, sz, critical)) info->critical = critical ? 1 : 0;
+	return 0;
+    }
+
+    BU_PLUGIN_API size_t bu_plugin_dag_critical_path(const bu_plugin_dag *dag, int *nodes, size_t max) {
+	if (!dag) return 0;
+	for (size_t i = 0; nodes && i < max && i < dag->critical.size(); i++) {
+	    nodes[i] = static_cast<int>(dag->critical[i]);
+	}
+	return dag->critical.size();
+    }
+
+    BU_PLUGIN_API int bu_plugin_pipeline_run(const char *const *names, size_t n, bu_plugin_channel *const *links,
+	    BU_PLUGIN_CMD_RET *results, int *status) {
+	if (!names || !n || !links) return -1;
+	std::vector<bu_plugin_impl::PipelineStage> stages(n);
+	for (size_t i = 0; i < n; i++) {
+	    if ((i > 0 && !links[i]) || (links[i] && links[i] == links[i + 1])) {
+		bu_plugin_logf(BU_LOG_ERR, "Pipeline stage %zu has no valid input channel", i);
+		return -1;
+	    }
+	    bu_plugin_impl::PipelineStage &st = stages[i];
+	    st.name = names[i] ? names[i] : "(null)";
+	    st.fn = names[i] ? bu_plugin_cmd_get(names[i]) : nullptr;
+	    if (!st.fn) {
+		bu_plugin_logf(BU_LOG_ERR, "Pipeline command '%s' not found", st.name);
+		if (status) status[i] = -1;
+		return -1;
+	    }
+	    st.in = links[i];
+	    st.out = links[i + 1];
+	    st.result = BU_PLUGIN_CMD_RET();
+	    st.status = 0;
+	}
+
+	bu_plugin_impl::CallCtx *ctx = bu_plugin_impl::tls_call_ctx;
+	bu_plugin_ctx *reg = bu_plugin_impl::tls_registry;
+	bu_plugin_impl::HelperThreadsScope helpers;
+	std::vector<std::thread> threads;
+	threads.reserve(n - 1);
+	for (size_t i = 0; i + 1 < n; i++) {
+#if BU_PLUGIN_EXCEPTIONS
+	    try {
+		threads.emplace_back(bu_plugin_impl::run_pipeline_stage, std::ref(stages[i]), ctx, reg, links, n + 1);
+	    } catch (...) {
+		/* Stages already started see the cancelled links and stop */
+		bu_plugin_logf(BU_LOG_ERR, "Could not start a thread for pipeline stage '%s'", stages[i].name);
+		stages[i].status = -2;
+		for (size_t k = 0; k <= n; k++) {
+		    if (links[k]) bu_plugin_impl::channel_finish(links[k], bu_plugin_impl::CHANNEL_CANCELLED);
+		}
+		break;
+	    }
 #else
-#define BU_PLUGIN_UNIQUE_ID BU_PLUGIN_CONCAT(_bu_plugin_cmd_registrar_, __LINE__)
+	    threads.emplace_back(bu_plugin_impl::run_pipeline_stage, std::ref(stages[i]), ctx, reg, links, n + 1);
 #endif
+	}
+	if (threads.size() == n - 1) bu_plugin_impl::run_pipeline_stage(stages[n - 1], ctx, reg, links, n + 1);
+	for (auto &t : threads) t.join();
 
-namespace bu_plugin_detail {
-struct CommandRegistrar {
-    CommandRegistrar(const char *name, bu_plugin_cmd_impl impl) {
-	bu_plugin_cmd_register(name, impl);
+	int failed = 0;
+	for (size_t i = 0; i < n; i++) {
+	    if (threads.size() < n - 1 && i > threads.size()) stages[i].status = BU_PLUGIN_CALL_CANCELLED;
+	    if (stages[i].status != 0) failed++;
+	    if (status) status[i] = stages[i].status;
+	    if (results) results[i] = stages[i].result;
+	}
+	return failed;
     }
-};
-}
+#endif /* BU_PLUGIN_DEFAULT_SIGNATURE */
 
-#define REGISTER_BU_PLUGIN_COMMAND(name, impl) \
-    static ::bu_plugin_detail::CommandRegistrar \
-    BU_PLUGIN_UNIQUE_ID(name, impl)
-#endif
+    BU_PLUGIN_API int bu_plugin_init(void) {
+	/* No-op for now; registry is initialized on first access */
+	return 0;
+    }
 
-/*
- * Macro for declaring the plugin manifest symbol in a dynamic plugin.
- * This exports a function that returns a pointer to the plugin's manifest.
- * Usage in plugin source:
- *   static bu_plugin_cmd s_commands[] = { {"example", example_impl}, ... };
- *   static bu_plugin_manifest s_manifest = { "myplugin", 1, 1, s_commands };
- *   BU_PLUGIN_DECLARE_MANIFEST(s_manifest)
- *
- * The host will dlsym() for a namespaced symbol "<host>_plugin_info".
- * To set the host namespace, define BU_PLUGIN_NAME (e.g., 'ged') before including.
- */
-#ifndef BU_PLUGIN_NAME
-#define BU_PLUGIN_NAME bu
-#endif
-#define BU_PLUGIN_CAT2_IMPL(a,b) a##b
-#define BU_PLUGIN_CAT2(a,b) BU_PLUGIN_CAT2_IMPL(a,b)
-#define BU_PLUGIN_STR1(x) #x
-#define BU_PLUGIN_STR(x) BU_PLUGIN_STR1(x)
-#define BU_PLUGIN_MANIFEST_FN  BU_PLUGIN_CAT2(BU_PLUGIN_NAME, _plugin_info)
-#define BU_PLUGIN_MANIFEST_SYM BU_PLUGIN_STR(BU_PLUGIN_MANIFEST_FN)
+#ifdef BU_PLUGIN_DEFAULT_SIGNATURE
+    BU_PLUGIN_API int bu_plugin_cmd_run(const char *name, BU_PLUGIN_CMD_RET *result) {
+	unsigned int flags = 0;
+	bu_plugin_cmd_impl fn = bu_plugin_impl::cmd_resolve(name, flags);
+	if (!fn) {
+	    bu_plugin_logf(BU_LOG_ERR, "Command '%s' not found", name ? name : "(null)");
+	    return -1;
+	}
+	return bu_plugin_impl::cached_call(name, fn, flags, result);
+    }
 
-#ifdef __cplusplus
-#define BU_PLUGIN_DECLARE_MANIFEST(manifest_var) \
-    extern "C" BU_PLUGIN_EXPORT const bu_plugin_manifest* BU_PLUGIN_MANIFEST_FN(void) { \
-	return &(manifest_var); \
+    BU_PLUGIN_API int bu_plugin_cmd_invoke(bu_plugin_cmd_handle h, BU_PLUGIN_CMD_RET *result) {
+	bu_plugin_cmd_impl fn = bu_plugin_cmd_handle_impl(h);
+	if (!fn) {
+	    bu_plugin_logf(BU_LOG_ERR, "Command '%s' not found", h ? h->name.c_str() : "(null handle)");
+	    return -1;
+	}
+	return bu_plugin_impl::cached_call(h->name.c_str(), fn, h->flags.load(std::memory_order_acquire), result);
     }
-#else
-#define BU_PLUGIN_DECLARE_MANIFEST(manifest_var) \
-    BU_PLUGIN_EXPORT const bu_plugin_manifest* BU_PLUGIN_MANIFEST_FN(void) { \
-	return &(manifest_var); \
+
+    BU_PLUGIN_API int bu_plugin_cmd_run_batch(const char *const *names, size_t n, BU_PLUGIN_CMD_RET *results, int *status) {
+	return bu_plugin_impl::run_batch(names, n, status, [results](size_t i, bu_plugin_cmd_impl fn) {
+		BU_PLUGIN_CMD_RET ret = fn();
+		if (results) results[i] = ret;
+		}, [results](size_t i, size_t count, bu_plugin_cmd_batch_impl b) {
+		return bu_plugin_impl::batch_into(results, i, count, [b](size_t, size_t m, BU_PLUGIN_CMD_RET *out) {
+			return b(m, out);
+			});
+		});
     }
-#endif
+#endif /* BU_PLUGIN_DEFAULT_SIGNATURE */
 
-/*
- * Built-in registry implementation (C++ only).
- * This is included in the host library when BU_PLUGIN_IMPLEMENTATION is defined.
- */
-#if defined(BU_PLUGIN_IMPLEMENTATION) && defined(__cplusplus)
+#ifdef BU_PLUGIN_CMD_ARGV_SIGNATURE
+    BU_PLUGIN_API int bu_plugin_cmd_run_batch_argv(const char *const *names, size_t n, const int *argcs,
+	    const char **const *argvs, BU_PLUGIN_CMD_RET *results, int *status) {
+	if (n && (!argcs || !argvs)) return -1;
+	return bu_plugin_impl::run_batch(names, n, status, [argcs, argvs, results](size_t i, bu_plugin_cmd_impl fn) {
+		BU_PLUGIN_CMD_RET ret = fn(argcs[i], argvs[i]);
+		if (results) results[i] = ret;
+		}, [argcs, argvs, results](size_t i, size_t count, bu_plugin_cmd_batch_impl b) {
+		return bu_plugin_impl::batch_into(results, i, count, [b, argcs, argvs](size_t j, size_t m, BU_PLUGIN_CMD_RET *out) {
+			return b(m, argcs + j, argvs + j, out);
+			});
+		});
+    }
 
-#include <unordered_map>
-#include <unordered_set>
-#include <string>
-#include <cstdio>
-#include <cstdarg>
-#include <cstring>
-#include <cctype>
-#include <mutex>
-#include <vector>
-#include <algorithm>
-#include <exception>
+    BU_PLUGIN_API int bu_plugin_cmd_run_line(const char *line, BU_PLUGIN_CMD_RET *result) {
+	return bu_plugin_impl::run_line(line, result);
+    }
+#endif /* BU_PLUGIN_CMD_ARGV_SIGNATURE */
 
-#if defined(_WIN32)
-#include <windows.h>
-#else
-#include <dlfcn.h>
+    BU_PLUGIN_API int bu_plugin_line_word(char **cursor, const char **word) {
+	if (!cursor || !*cursor || !word) return 0;
+	return bu_plugin_impl::line_word(cursor, word);
+    }
+
+    /**
+     * bu_plugin_load - Load a dynamic plugin and register its commands.
+     */
+    BU_PLUGIN_API int bu_plugin_load(const char *path) {
+	return bu_plugin_load_ex(path, nullptr);
+    }
+
+    BU_PLUGIN_API int bu_plugin_load_ex(const char *path, const bu_plugin_load_opts *opts) {
+	auto total_start = std::chrono::steady_clock::now();
+	bu_plugin_load_stats *stats = nullptr;
+	if (opts) {
+	    if (opts->struct_size < offsetof(bu_plugin_load_opts, binding)) {
+		bu_plugin_logf(BU_LOG_ERR, "Invalid bu_plugin_load_opts struct_size %zu", opts->struct_size);
+		return -1;
+	    }
+	    if (BU_PLUGIN_HAS_FIELD(bu_plugin_load_opts, opts->struct_size, stats)) stats = opts->stats;
+	}
+	bu_plugin_impl::LoadSettings ls = bu_plugin_impl::resolve_load_settings(opts);
+
+	bu_plugin_impl::OpenedPlugin plugin;
+	plugin.timing = bu_plugin_impl::LoadTiming();
+	int ret = -1;
+	if ((ls.flags & BU_PLUGIN_LOAD_OUT_OF_PROCESS) && !bu_plugin_impl::pool_in_worker()) {
+	    /* Workers open pooled plugins into their default context */
+	    if (&bu_plugin_impl::current_registry() == &bu_plugin_impl::default_registry()) {
+		ret = bu_plugin_impl::pool_load(path);
+	    } else {
+		bu_plugin_logf(BU_LOG_ERR, "Plugin %s: out-of-process loading is only available in the default context", path ? path : "(null)");
+	    }
+	} else if (bu_plugin_impl::open_plugin(path, ls, plugin)) {
+	    /* A single load cannot reorder anything, so dependencies must already be loaded */
+	    bool deps_ok = true;
+	    for (const auto &dep : bu_plugin_impl::plugin_depends_of(plugin)) {
+		if (!bu_plugin_impl::module_loaded(dep)) {
+		    bu_plugin_logf(BU_LOG_ERR, "Plugin %s depends on '%s', which is not loaded", path, dep.c_str());
+		    deps_ok = false;
+		}
+	    }
+	    if (deps_ok) {
+		ret = bu_plugin_impl::activate_plugin(path, plugin);
+	    } else {
+		bu_plugin_impl::close_module(plugin.handle);
+	    }
+	}
+
+	if (stats) {
+	    size_t sz = stats->struct_size;
+	    const bu_plugin_impl::LoadTiming &t = plugin.timing;
+	    if (BU_PLUGIN_HAS_FIELD(bu_plugin_load_stats, sz, registered)) stats->registered = ret;
+	    if (BU_PLUGIN_HAS_FIELD(bu_plugin_load_stats, sz, open_us)) stats->open_us = t.open_us;
+	    if (BU_PLUGIN_HAS_FIELD(bu_plugin_load_stats, sz, resolve_us)) stats->resolve_us = t.resolve_us;
+	    if (BU_PLUGIN_HAS_FIELD(bu_plugin_load_stats, sz, prefault_us)) stats->prefault_us = t.prefault_us;
+	    if (BU_PLUGIN_HAS_FIELD(bu_plugin_load_stats, sz, register_us)) stats->register_us = t.register_us;
+	    if (BU_PLUGIN_HAS_FIELD(bu_plugin_load_stats, sz, init_us)) stats->init_us = t.init_us;
+	    if (BU_PLUGIN_HAS_FIELD(bu_plugin_load_stats, sz, total_us)) stats->total_us = bu_plugin_impl::elapsed_us(total_start);
+	}
+	return ret;
+    }
+
+    BU_PLUGIN_API int bu_plugin_load_graph(const char * const *paths, size_t count, unsigned int nthreads) {
+	using bu_plugin_impl::GraphNode;
+	if (!paths || count == 0) {
+	    bu_plugin_logf(BU_LOG_ERR, "Invalid plugin graph (no paths)");
+	    return -1;
+	}
+	if (nthreads == 0) {
+	    nthreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	auto wall_start = std::chrono::steady_clock::now();
+
+	bu_plugin_impl::LoadSettings settings = bu_plugin_impl::resolve_load_settings(nullptr);
+	if ((settings.flags & BU_PLUGIN_LOAD_OUT_OF_PROCESS) && !bu_plugin_impl::pool_in_worker()) {
+	    bu_plugin_logf(BU_LOG_ERR, "bu_plugin_load_graph cannot load out of process; use bu_plugin_load_ex");
+	    return -1;
+	}
+	std::vector<GraphNode> nodes(count);
+	for (size_t i = 0; i < count; i++) {
+	    nodes[i].path = paths[i] ? paths[i] : "";
+	    nodes[i].opened = false;
+	    nodes[i].pending = 0;
+	    nodes[i].skip = false;
+	    nodes[i].ok = false;
+	    nodes[i].registered = 0;
+	    nodes[i].open_us = nodes[i].activate_us = nodes[i].path_us = 0.0;
+	    nodes[i].path_prev = SIZE_MAX;
+	}
+
+	/* Phase 1: open and validate every plugin in parallel */
+	bu_plugin_impl::parallel_for(count, nthreads, [&](size_t i) {
+		auto start = std::chrono::steady_clock::now();
+		nodes[i].opened = bu_plugin_impl::open_plugin(paths[i], settings, nodes[i].plugin);
+		nodes[i].open_us = bu_plugin_impl::elapsed_us(start);
+		});
+
+	auto reject = [&]() {
+	    for (auto &n : nodes) {
+		if (n.opened) bu_plugin_impl::close_module(n.plugin.handle);
+	    }
+	    return -1;
+	};
+
+	bool valid = true;
+	for (const auto &n : nodes) {
+	    if (!n.opened) valid = false;
+	}
+	if (!valid) {
+	    bu_plugin_logf(BU_LOG_ERR, "Plugin graph rejected: not every plugin could be opened");
+	    return reject();
+	}
+
+	/* Phase 2: build the dependency graph, reporting problems before registering anything */
+	std::unordered_map<std::string, size_t> by_name;
+	for (size_t i = 0; i < count; i++) {
+	    nodes[i].name = bu_plugin_impl::plugin_name_of(nodes[i].plugin);
+	    if (nodes[i].name.empty()) continue;
+	    auto ins = by_name.insert(std::make_pair(nodes[i].name, i));
+	    if (!ins.second) {
+		bu_plugin_logf(BU_LOG_ERR, "Plugin graph rejected: plugin name '%s' used by both %s and %s",
+			nodes[i].name.c_str(), nodes[ins.first->second].path.c_str(), nodes[i].path.c_str());
+		valid = false;
+	    }
+	}
+	for (size_t i = 0; i < count; i++) {
+	    for (const auto &dep : bu_plugin_impl::plugin_depends_of(nodes[i].plugin)) {
+		auto it = by_name.find(dep);
+		if (it != by_name.end()) {
+		    nodes[i].deps.push_back(it->second);
+		    nodes[it->second].dependents.push_back(i);
+		} else if (!bu_plugin_impl::module_loaded(dep)) {
+		    bu_plugin_logf(BU_LOG_ERR, "Plugin graph rejected: %s depends on '%s', which is neither in the set nor loaded",
+			    nodes[i].path.c_str(), dep.c_str());
+		    valid = false;
+		}
+	    }
+	    nodes[i].pending = nodes[i].deps.size();
+	}
+	if (!valid) return reject();
+
+	/* Kahn's algorithm on a copy of the pending counts detects cycles */
+	{
+	    std::vector<size_t> pending(count);
+	    std::vector<size_t> queue;
+	    for (size_t i = 0; i < count; i++) {
+		pending[i] = nodes[i].pending;
+		if (pending[i] == 0) queue.push_back(i);
+	    }
+	    for (size_t qi = 0; qi < queue.size(); qi++) {
+		for (size_t d : nodes[queue[qi]].dependents) {
+		    if (--pending[d] == 0) queue.push_back(d);
+		}
+	    }
+	    if (queue.size() != count) {
+		for (size_t i = 0; i < count; i++) nodes[i].pending = pending[i];
+		bu_plugin_logf(BU_LOG_ERR, "Plugin graph rejected: dependency cycle %s",
+			bu_plugin_impl::describe_cycle(nodes).c_str());
+		return reject();
+	    }
+	}
+
+	/* Phase 3: register and init each plugin once its dependencies are done */
+	std::mutex mtx;
+	std::condition_variable cv;
+	std::deque<size_t> ready;
+	size_t remaining = count;
+	for (size_t i = 0; i < count; i++) {
+	    if (nodes[i].pending == 0) ready.push_back(i);
+	}
+
+	bu_plugin_ctx *reg = bu_plugin_impl::tls_registry;
+	auto worker = [&]() {
+	    bu_plugin_impl::RegistryScope reg_scope(reg);
+	    std::unique_lock<std::mutex> lock(mtx);
+	    for (;;) {
+		cv.wait(lock, [&]() { return !ready.empty() || remaining == 0; });
+		if (ready.empty()) return;
+		size_t i = ready.front();
+		ready.pop_front();
+		GraphNode &node = nodes[i];
+		lock.unlock();
+
+		/* Dependencies are final once a node is ready, so its chain length is too */
+		for (size_t d : node.deps) {
+		    if (nodes[d].path_us > node.path_us) {
+			node.path_us = nodes[d].path_us;
+			node.path_prev = d;
+		    }
+		}
+		if (node.skip) {
+		    bu_plugin_logf(BU_LOG_ERR, "Plugin %s skipped because a dependency failed", node.path.c_str());
+		    bu_plugin_impl::close_module(node.plugin.handle);
+		} else {
+		    auto start = std::chrono::steady_clock::now();
+		    node.registered = bu_plugin_impl::activate_plugin(node.path.c_str(), node.plugin);
+		    node.activate_us = bu_plugin_impl::elapsed_us(start);
+		    node.ok = node.registered >= 0;
+		}
+		node.path_us += node.open_us + node.activate_us;
+
+		lock.lock();
+		for (size_t d : node.dependents) {
+		    if (!node.ok) nodes[d].skip = true;
+		    if (--nodes[d].pending == 0) ready.push_back(d);
+		}
+		if (--remaining == 0 || !ready.empty()) cv.notify_all();
+	    }
+	};
+	{
+	    bu_plugin_impl::HelperThreadsScope helpers;
+	    std::vector<std::thread> threads;
+	    for (unsigned int t = 1; t < std::min(static_cast<size_t>(nthreads), count); t++) {
+		threads.emplace_back(worker);
+	    }
+	    worker();
+	    for (auto &t : threads) t.join();
+	}
+
+	/* Report the critical path */
+	int total = 0;
+	size_t loaded = 0;
+	size_t tail = 0;
+	for (size_t i = 0; i < count; i++) {
+	    if (nodes[i].ok) {
+		total += nodes[i].registered;
+		loaded++;
+	    }
+	    if (nodes[i].path_us > nodes[tail].path_us) tail = i;
+	}
+	std::string chain;
+	for (size_t i = tail; i != SIZE_MAX; i = nodes[i].path_prev) {
+	    chain = (nodes[i].name.empty() ? nodes[i].path : nodes[i].name) + (chain.empty() ? "" : " -> ") + chain;
+	}
+	bu_plugin_logf(BU_LOG_INFO, "Plugin graph loaded %zu of %zu plugin(s), %d command(s): critical path %.1f us (%s), wall %.1f us, %u thread(s)",
+		loaded, count, total, nodes[tail].path_us, chain.c_str(),
+		bu_plugin_impl::elapsed_us(wall_start), nthreads);
+
+	return total;
+    }
+
+    /* Count retained modules */
+    BU_PLUGIN_API size_t bu_plugin_loaded_modules_count(void) {
+	std::lock_guard<std::mutex> lock(bu_plugin_impl::get_modules_mutex());
+	return bu_plugin_impl::get_modules().size();
+    }
+
+    /* Optional shutdown: run fini hooks and unload modules in reverse order, then clear registry */
+    BU_PLUGIN_API void bu_plugin_shutdown(void) {
+	/* Queued commands may live in modules about to be unloaded */
+	bu_plugin_exec_stop();
+#if !defined(_WIN32) && defined(BU_PLUGIN_DEFAULT_SIGNATURE)
+	bu_plugin_worker_pool_stop();
 #endif
 
-namespace bu_plugin_impl {
+	bu_plugin_impl::registry_release();
+    }
 
-/**
- * Thread-safe registry using unordered_map for O(1) lookups.
- * Uses a static local to ensure initialization before first use.
- * Protected by a mutex for thread-safe access.
- */
-static std::unordered_map<std::string, bu_plugin_cmd_impl>& get_registry() {
-    static std::unordered_map<std::string, bu_plugin_cmd_impl> registry;
-    return registry;
-}
+    BU_PLUGIN_API int bu_plugin_freeze(void) {
+	std::lock_guard<std::mutex> lock(bu_plugin_impl::get_mutex());
+	if (bu_plugin_impl::get_frozen().load()) return 0;
 
-static std::mutex& get_mutex() {
-    static std::mutex mtx;
-    return mtx;
-}
+	auto &reg = bu_plugin_impl::get_registry();
+	bu_plugin_impl::FrozenTable *t = new bu_plugin_impl::FrozenTable;
 
-/* Logger callback storage */
-static bu_plugin_logger_cb& get_logger() {
-    static bu_plugin_logger_cb logger = nullptr;
-    return logger;
-}
+	/* Keep the load factor at or below 1/2 so probe sequences stay short */
+	size_t nslots = 16;
+	while (nslots < reg.size() * 2) nslots <<= 1;
+	t->mask = nslots - 1;
+	t->slots.assign(nslots, bu_plugin_impl::FrozenSlot());
 
-/* Path allow callback storage */
-static bu_plugin_path_allow_cb& get_path_allow() {
-    static bu_plugin_path_allow_cb cb = nullptr;
-    return cb;
-}
+	size_t name_bytes = 0;
+	for (const auto &pair : reg) name_bytes += pair.first.size() + 1;
+	t->names.reserve(name_bytes);
 
-/* Internal implementation detail - buffered startup log storage.
-   Avoids writing to STDOUT/STDERR during early startup. */
-struct BufferedLogEntry {
-    int level;
-    std::string msg;
-};
+	std::vector<size_t> offsets;
+	offsets.reserve(reg.size());
+	for (const auto &pair : reg) {
+	    offsets.push_back(t->names.size());
+	    t->names.insert(t->names.end(), pair.first.begin(), pair.first.end());
+	    t->names.push_back('\0');
+	}
+
+	size_t n = 0;
+	for (const auto &pair : reg) {
+	    const std::string &name = pair.first;
+	    uint64_t h = bu_plugin_impl::hash_name(name.data(), name.size());
+	    size_t i = static_cast<size_t>(h) & t->mask;
+	    while (t->slots[i].name) i = (i + 1) & t->mask;
+	    t->slots[i].hash = h;
+	    t->slots[i].name = t->names.data() + offsets[n++];
+	    t->slots[i].len = name.size();
+	    t->slots[i].impl = pair.second;
+	    t->slots[i].flags = bu_plugin_impl::cmd_flags_of(name);
+	    t->slots[i].batch = bu_plugin_impl::cmd_batch_of(name);
+	    t->slots[i].handle = bu_plugin_impl::handle_of(name, pair.second);
+	    t->sorted.push_back(i);
+	}
+	std::sort(t->sorted.begin(), t->sorted.end(), [t](size_t a, size_t b) {
+		return std::strcmp(t->slots[a].name, t->slots[b].name) < 0;
+		});
+
+	bu_plugin_impl::get_frozen().store(t, std::memory_order_release);
+	return 0;
+    }
+
+    BU_PLUGIN_API int bu_plugin_is_frozen(void) {
+	return bu_plugin_impl::get_frozen().load(std::memory_order_acquire) ? 1 : 0;
+    }
+
+    BU_PLUGIN_API bu_plugin_ctx *bu_plugin_ctx_create(const char *ns) {
+	if (!ns) return new (std::nothrow) bu_plugin_ctx(bu_plugin_impl::default_registry().ns);
+	if (!bu_plugin_impl::valid_ns(ns)) {
+	    bu_plugin_logf(BU_LOG_ERR, "Invalid context namespace '%s'", ns);
+	    return nullptr;
+	}
+	return new (std::nothrow) bu_plugin_ctx(ns);
+    }
+
+    BU_PLUGIN_API void bu_plugin_ctx_shutdown(bu_plugin_ctx *ctx) {
+	/* Queued commands may live in modules about to be unloaded */
+	bu_plugin_exec_drain();
+	bu_plugin_impl::RegistryScope reg_scope(ctx);
+	bu_plugin_impl::registry_release();
+    }
+
+    BU_PLUGIN_API void bu_plugin_ctx_destroy(bu_plugin_ctx *ctx) {
+	if (!ctx) return;
+	if (ctx == &bu_plugin_impl::default_registry()) {
+	    bu_plugin_logf(BU_LOG_WARN, "The default context cannot be destroyed");
+	    return;
+	}
+	bu_plugin_ctx_shutdown(ctx);
+	delete ctx;
+    }
 
-static std::vector<BufferedLogEntry>& get_log_buffer() {
-    static std::vector<BufferedLogEntry> buffer;
-    return buffer;
-}
+    BU_PLUGIN_API bu_plugin_ctx *bu_plugin_ctx_default(void) {
+	return &bu_plugin_impl::default_registry();
+    }
 
-static std::mutex& get_log_buffer_mutex() {
-    static std::mutex mtx;
-    return mtx;
-}
+    BU_PLUGIN_API bu_plugin_ctx *bu_plugin_ctx_current(void) {
+	return &bu_plugin_impl::current_registry();
+    }
 
-/* Retained module handles (kept loaded for lifetime unless bu_plugin_shutdown is called) */
-#if defined(_WIN32)
-typedef HMODULE bu_plugin_module_handle_t;
-#else
-typedef void*   bu_plugin_module_handle_t;
-#endif
-static std::vector<bu_plugin_module_handle_t>& get_modules() {
-    static std::vector<bu_plugin_module_handle_t> mods;
-    return mods;
-}
+    BU_PLUGIN_API bu_plugin_ctx *bu_plugin_ctx_set_current(bu_plugin_ctx *ctx) {
+	bu_plugin_ctx *prev = &bu_plugin_impl::current_registry();
+	bu_plugin_impl::tls_registry = ctx;
+	return prev;
+    }
 
-/* Trim leading/trailing whitespace from a string, returns trimmed copy */
-static std::string trim_whitespace(const char *str) {
-    if (!str) return "";
-    const char *start = str;
-    while (*start && std::isspace(static_cast<unsigned char>(*start))) {
-	++start;
+    BU_PLUGIN_API const char *bu_plugin_ctx_ns(const bu_plugin_ctx *ctx) {
+	return ctx ? ctx->ns.c_str() : nullptr;
     }
-    if (*start == '\0') return "";
-    const char *end = str + std::strlen(str) - 1;
-    while (end > start && std::isspace(static_cast<unsigned char>(*end))) {
-	--end;
+
+    BU_PLUGIN_API int bu_plugin_ctx_cmd_register(bu_plugin_ctx *ctx, const char *name, bu_plugin_cmd_impl impl) {
+	bu_plugin_impl::RegistryScope reg_scope(ctx);
+	return bu_plugin_cmd_register(name, impl);
     }
-    return std::string(start, static_cast<size_t>(end - start + 1));
-}
 
-/* Check if string contains internal whitespace */
-static bool has_internal_whitespace(const std::string& s) {
-    for (size_t i = 0; i < s.size(); ++i) {
-	if (std::isspace(static_cast<unsigned char>(s[i]))) {
-	    return true;
-	}
+    BU_PLUGIN_API int bu_plugin_ctx_cmd_register_sig(bu_plugin_ctx *ctx, const char *name, unsigned int sig, bu_plugin_any_fn fn) {
+	bu_plugin_impl::RegistryScope reg_scope(ctx);
+	return bu_plugin_cmd_register_sig(name, sig, fn);
     }
-    return false;
-}
 
-} /* namespace bu_plugin_impl */
+    BU_PLUGIN_API int bu_plugin_ctx_cmd_exists(bu_plugin_ctx *ctx, const char *name) {
+	bu_plugin_impl::RegistryScope reg_scope(ctx);
+	return bu_plugin_cmd_exists(name);
+    }
 
-extern "C" {
+    BU_PLUGIN_API bu_plugin_cmd_impl bu_plugin_ctx_cmd_get(bu_plugin_ctx *ctx, const char *name) {
+	bu_plugin_impl::RegistryScope reg_scope(ctx);
+	return bu_plugin_cmd_get(name);
+    }
 
-    BU_PLUGIN_API void bu_plugin_set_logger(bu_plugin_logger_cb cb) {
-	bu_plugin_impl::get_logger() = cb;
+    BU_PLUGIN_API size_t bu_plugin_ctx_cmd_count(bu_plugin_ctx *ctx) {
+	bu_plugin_impl::RegistryScope reg_scope(ctx);
+	return bu_plugin_cmd_count();
     }
 
-    BU_PLUGIN_API void bu_plugin_logf(int level, const char *fmt, ...) {
-	/* Buffer size of 2048 should be sufficient for most log messages.
-	   Messages longer than this will be truncated. */
-	char buf[2048];
-	va_list args;
-	va_start(args, fmt);
-#if defined(_WIN32)
-	_vsnprintf_s(buf, sizeof(buf), _TRUNCATE, fmt, args);
-#else
-	vsnprintf(buf, sizeof(buf), fmt, args);
-#endif
-	va_end(args);
-	buf[sizeof(buf) - 1] = '\0';
+    BU_PLUGIN_API void bu_plugin_ctx_cmd_foreach(bu_plugin_ctx *ctx, bu_plugin_cmd_callback callback, void *user_data) {
+	bu_plugin_impl::RegistryScope reg_scope(ctx);
+	bu_plugin_cmd_foreach(callback, user_data);
+    }
 
-	bu_plugin_logger_cb logger = bu_plugin_impl::get_logger();
-	if (logger) {
-	    /* Logger callback is set - dispatch immediately */
-	    logger(level, buf);
-	} else {
-	    /* No logger set - buffer internally to avoid STDOUT/STDERR during startup */
-	    std::lock_guard<std::mutex> lock(bu_plugin_impl::get_log_buffer_mutex());
-	    bu_plugin_impl::get_log_buffer().push_back({level, std::string(buf)});
-	}
+    BU_PLUGIN_API bu_plugin_cmd_handle bu_plugin_ctx_cmd_lookup(bu_plugin_ctx *ctx, const char *name) {
+	bu_plugin_impl::RegistryScope reg_scope(ctx);
+	return bu_plugin_cmd_lookup(name);
     }
 
-    BU_PLUGIN_API void bu_plugin_flush_logs(bu_plugin_logger_cb cb) {
-	std::vector<bu_plugin_impl::BufferedLogEntry> logs;
-	{
-	    std::lock_guard<std::mutex> lock(bu_plugin_impl::get_log_buffer_mutex());
-	    logs = std::move(bu_plugin_impl::get_log_buffer());
-	    /* Note: move leaves source in valid but unspecified state; clear ensures it's empty */
-	    bu_plugin_impl::get_log_buffer().clear();
-	}
+    BU_PLUGIN_API bu_plugin_cmd_handle bu_plugin_ctx_cmd_lookup_sig(bu_plugin_ctx *ctx, const char *name, unsigned int sig) {
+	bu_plugin_impl::RegistryScope reg_scope(ctx);
+	return bu_plugin_cmd_lookup_sig(name, sig);
+    }
 
-	if (cb) {
-	    for (const auto& entry : logs) {
-		cb(entry.level, entry.msg.c_str());
-	    }
-	}
-	/* If cb is NULL, logs are simply discarded */
+    BU_PLUGIN_API int bu_plugin_ctx_cmd_set_flags(bu_plugin_ctx *ctx, const char *name, unsigned int flags) {
+	bu_plugin_impl::RegistryScope reg_scope(ctx);
+	return bu_plugin_cmd_set_flags(name, flags);
     }
 
-    BU_PLUGIN_API void bu_plugin_set_path_allow(bu_plugin_path_allow_cb cb) {
-	bu_plugin_impl::get_path_allow() = cb;
+    BU_PLUGIN_API unsigned int bu_plugin_ctx_cmd_get_flags(bu_plugin_ctx *ctx, const char *name) {
+	bu_plugin_impl::RegistryScope reg_scope(ctx);
+	return bu_plugin_cmd_get_flags(name);
     }
 
-    BU_PLUGIN_API int bu_plugin_cmd_register(const char *name, bu_plugin_cmd_impl impl) {
-	if (!name || !impl) return -1;
+    BU_PLUGIN_API int bu_plugin_ctx_cmd_set_batch(bu_plugin_ctx *ctx, const char *name, bu_plugin_cmd_batch_impl batch) {
+	bu_plugin_impl::RegistryScope reg_scope(ctx);
+	return bu_plugin_cmd_set_batch(name, batch);
+    }
 
-	/* Trim whitespace from name */
-	std::string trimmed = bu_plugin_impl::trim_whitespace(name);
-	if (trimmed.empty()) return -1;  /* Reject empty string names */
+    BU_PLUGIN_API bu_plugin_cmd_batch_impl bu_plugin_ctx_cmd_get_batch(bu_plugin_ctx *ctx, const char *name) {
+	bu_plugin_impl::RegistryScope reg_scope(ctx);
+	return bu_plugin_cmd_get_batch(name);
+    }
 
-	/* Warn about internal whitespace */
-	if (bu_plugin_impl::has_internal_whitespace(trimmed)) {
-	    bu_plugin_logf(BU_LOG_WARN, "Command name '%s' contains internal whitespace", trimmed.c_str());
-	}
+    BU_PLUGIN_API int bu_plugin_ctx_cmd_set_strand(bu_plugin_ctx *ctx, const char *name, const char *strand) {
+	bu_plugin_impl::RegistryScope reg_scope(ctx);
+	return bu_plugin_cmd_set_strand(name, strand);
+    }
 
-	std::lock_guard<std::mutex> lock(bu_plugin_impl::get_mutex());
-	auto& reg = bu_plugin_impl::get_registry();
-	if (reg.find(trimmed) != reg.end()) {
-	    bu_plugin_logf(BU_LOG_WARN, "Duplicate command '%s' ignored (first wins)", trimmed.c_str());
-	    return 1; /* Duplicate - first wins */
-	}
-	reg[trimmed] = impl;
-	return 0;
+#ifdef BU_PLUGIN_DEFAULT_SIGNATURE
+    BU_PLUGIN_API int bu_plugin_ctx_cmd_run(bu_plugin_ctx *ctx, const char *name, BU_PLUGIN_CMD_RET *result) {
+	bu_plugin_impl::RegistryScope reg_scope(ctx);
+	return bu_plugin_cmd_run(name, result);
     }
 
-    BU_PLUGIN_API int bu_plugin_cmd_exists(const char *name) {
-	if (!name) return 0;
-	std::string trimmed = bu_plugin_impl::trim_whitespace(name);
-	if (trimmed.empty()) return 0;
-	std::lock_guard<std::mutex> lock(bu_plugin_impl::get_mutex());
-	auto& reg = bu_plugin_impl::get_registry();
-	return reg.find(trimmed) != reg.end() ? 1 : 0;
+    BU_PLUGIN_API int bu_plugin_ctx_cmd_run_batch(bu_plugin_ctx *ctx, const char *const *names, size_t n,
+	    BU_PLUGIN_CMD_RET *results, int *status) {
+	bu_plugin_impl::RegistryScope reg_scope(ctx);
+	return bu_plugin_cmd_run_batch(names, n, results, status);
     }
 
-    BU_PLUGIN_API bu_plugin_cmd_impl bu_plugin_cmd_get(const char *name) {
-	if (!name) return nullptr;
-	std::string trimmed = bu_plugin_impl::trim_whitespace(name);
-	if (trimmed.empty()) return nullptr;
-	std::lock_guard<std::mutex> lock(bu_plugin_impl::get_mutex());
-	auto& reg = bu_plugin_impl::get_registry();
-	auto it = reg.find(trimmed);
-	return (it != reg.end()) ? it->second : nullptr;
+    BU_PLUGIN_API int bu_plugin_ctx_cmd_submit_name(bu_plugin_ctx *ctx, const char *name, bu_plugin_cmd_done_fn done, void *user) {
+	bu_plugin_impl::RegistryScope reg_scope(ctx);
+	return bu_plugin_cmd_submit_name(name, done, user);
     }
+#endif /* BU_PLUGIN_DEFAULT_SIGNATURE */
 
-    BU_PLUGIN_API size_t bu_plugin_cmd_count(void) {
-	std::lock_guard<std::mutex> lock(bu_plugin_impl::get_mutex());
-	return bu_plugin_impl::get_registry().size();
+#ifdef BU_PLUGIN_CMD_ARGV_SIGNATURE
+    BU_PLUGIN_API int bu_plugin_ctx_cmd_run_batch_argv(bu_plugin_ctx *ctx, const char *const *names, size_t n,
+	    const int *argcs, const char **const *argvs, BU_PLUGIN_CMD_RET *results, int *status) {
+	bu_plugin_impl::RegistryScope reg_scope(ctx);
+	return bu_plugin_cmd_run_batch_argv(names, n, argcs, argvs, results, status);
     }
 
-    BU_PLUGIN_API void bu_plugin_cmd_foreach(bu_plugin_cmd_callback callback, void *user_data) {
-	if (!callback) return;
+    BU_PLUGIN_API int bu_plugin_ctx_cmd_run_line(bu_plugin_ctx *ctx, const char *line, BU_PLUGIN_CMD_RET *result) {
+	bu_plugin_impl::RegistryScope reg_scope(ctx);
+	return bu_plugin_cmd_run_line(line, result);
+    }
+#endif /* BU_PLUGIN_CMD_ARGV_SIGNATURE */
 
-	/* Snapshot the registry under lock, then release lock for iteration */
-	std::vector<std::pair<std::string, bu_plugin_cmd_impl>> snapshot;
-	{
-	    std::lock_guard<std::mutex> lock(bu_plugin_impl::get_mutex());
-	    auto& reg = bu_plugin_impl::get_registry();
-	    snapshot.reserve(reg.size());
-	    for (const auto& pair : reg) {
-		snapshot.push_back(pair);
-	    }
-	}
+    BU_PLUGIN_API int bu_plugin_ctx_load(bu_plugin_ctx *ctx, const char *path) {
+	bu_plugin_impl::RegistryScope reg_scope(ctx);
+	return bu_plugin_load(path);
+    }
 
-	/* Sort out of lock */
-	std::sort(snapshot.begin(), snapshot.end(),
-		[](const std::pair<std::string, bu_plugin_cmd_impl>& a,
-		    const std::pair<std::string, bu_plugin_cmd_impl>& b) {
-		return a.first < b.first;
-		});
+    BU_PLUGIN_API int bu_plugin_ctx_load_ex(bu_plugin_ctx *ctx, const char *path, const bu_plugin_load_opts *opts) {
+	bu_plugin_impl::RegistryScope reg_scope(ctx);
+	return bu_plugin_load_ex(path, opts);
+    }
 
-	/* Iterate out of lock */
-	for (const auto& pair : snapshot) {
-	    if (callback(pair.first.c_str(), pair.second, user_data) != 0) {
-		break;  /* Callback requested stop */
-	    }
-	}
+    BU_PLUGIN_API int bu_plugin_ctx_load_graph(bu_plugin_ctx *ctx, const char * const *paths, size_t count, unsigned int nthreads) {
+	bu_plugin_impl::RegistryScope reg_scope(ctx);
+	return bu_plugin_load_graph(paths, count, nthreads);
     }
 
-    BU_PLUGIN_API int bu_plugin_init(void) {
-	/* No-op for now; registry is initialized on first access */
-	return 0;
+    BU_PLUGIN_API size_t bu_plugin_ctx_loaded_modules_count(bu_plugin_ctx *ctx) {
+	bu_plugin_impl::RegistryScope reg_scope(ctx);
+	return bu_plugin_loaded_modules_count();
     }
 
-#ifdef BU_PLUGIN_DEFAULT_SIGNATURE
-    BU_PLUGIN_API int bu_plugin_cmd_run(const char *name, BU_PLUGIN_CMD_RET *result) {
-	bu_plugin_cmd_impl fn = bu_plugin_cmd_get(name);
-	if (!fn) {
-	    bu_plugin_logf(BU_LOG_ERR, "Command '%s' not found", name ? name : "(null)");
-	    return -1;
-	}
+    BU_PLUGIN_API int bu_plugin_ctx_freeze(bu_plugin_ctx *ctx) {
+	bu_plugin_impl::RegistryScope reg_scope(ctx);
+	return bu_plugin_freeze();
+    }
 
-#ifdef __cplusplus
-	try {
-#endif
-	    BU_PLUGIN_CMD_RET ret = fn();
-	    if (result) {
-		*result = ret;
-	    }
-	    return 0;
-#ifdef __cplusplus
-	} catch (const std::exception& e) {
-	    bu_plugin_logf(BU_LOG_ERR, "Command '%s' threw exception: %s", name, e.what());
-	    return -2;
-	} catch (...) {
-	    bu_plugin_logf(BU_LOG_ERR, "Command '%s' threw unknown exception", name);
-	    return -2;
-	}
-#endif
+    BU_PLUGIN_API int bu_plugin_ctx_is_frozen(bu_plugin_ctx *ctx) {
+	bu_plugin_impl::RegistryScope reg_scope(ctx);
+	return bu_plugin_is_frozen();
     }
-#endif /* BU_PLUGIN_DEFAULT_SIGNATURE */
 
-    /**
-     * bu_plugin_load - Load a dynamic plugin and register its commands.
-     */
-    BU_PLUGIN_API int bu_plugin_load(const char *path) {
-	if (!path || path[0] == '\0') {
-	    bu_plugin_logf(BU_LOG_ERR, "Invalid plugin path (null or empty)");
+#if !defined(_WIN32)
+    BU_PLUGIN_API int bu_plugin_zygote_serve(const char *socket_path, bu_plugin_zygote_fn fn, void *user) {
+	if (!socket_path || !fn) {
+	    bu_plugin_logf(BU_LOG_ERR, "Invalid zygote arguments");
 	    return -1;
 	}
-
-	/* Enforce path allow policy */
-	bu_plugin_path_allow_cb path_allow = bu_plugin_impl::get_path_allow();
-	if (path_allow && !path_allow(path)) {
-	    bu_plugin_logf(BU_LOG_ERR, "Plugin path '%s' not allowed by policy", path);
+	struct sockaddr_un addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (std::strlen(socket_path) >= sizeof(addr.sun_path)) {
+	    bu_plugin_logf(BU_LOG_ERR, "Zygote socket path too long: %s", socket_path);
 	    return -1;
 	}
+	std::strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
 
-#if defined(_WIN32)
-	/* Convert UTF-8 path to UTF-16 for Windows */
-	int wlen = MultiByteToWideChar(CP_UTF8, 0, path, -1, NULL, 0);
-	if (wlen <= 0) {
-	    bu_plugin_logf(BU_LOG_ERR, "Failed to convert plugin path to UTF-16: %s (error %lu)", path, GetLastError());
-	    return -1;
-	}
-	std::vector<wchar_t> wpath(static_cast<size_t>(wlen));
-	MultiByteToWideChar(CP_UTF8, 0, path, -1, wpath.data(), wlen);
+	/* Workers share the registry pages with the server; freeze so lookups never write */
+	bu_plugin_freeze();
 
-	/* Use LoadLibraryExW with safer flags (no DLL search path manipulation) */
-	HMODULE handle = LoadLibraryExW(wpath.data(), NULL, LOAD_LIBRARY_SEARCH_DLL_LOAD_DIR | LOAD_LIBRARY_SEARCH_DEFAULT_DIRS);
-	if (!handle) {
-	    /* Fallback to LoadLibraryW if the flags are not supported */
-	    handle = LoadLibraryW(wpath.data());
-	}
-	if (!handle) {
-	    DWORD err = GetLastError();
-	    bu_plugin_logf(BU_LOG_ERR, "Failed to load plugin: %s (Windows error %lu)", path, err);
+	int lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (lfd < 0) {
+	    bu_plugin_logf(BU_LOG_ERR, "Zygote socket() failed: %s", std::strerror(errno));
 	    return -1;
 	}
-	typedef const bu_plugin_manifest* (*info_fn)(void);
-	info_fn get_info = reinterpret_cast<info_fn>(reinterpret_cast<void*>(GetProcAddress(handle, BU_PLUGIN_MANIFEST_SYM)));
-	if (!get_info) {
-	    DWORD err = GetLastError();
-	    bu_plugin_logf(BU_LOG_ERR, "Plugin %s does not export %s (Windows error %lu)", path, BU_PLUGIN_MANIFEST_SYM, err);
-	    FreeLibrary(handle);
+	unlink(socket_path);
+	if (bind(lfd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0 || listen(lfd, SOMAXCONN) != 0) {
+	    bu_plugin_logf(BU_LOG_ERR, "Zygote cannot listen on %s: %s", socket_path, std::strerror(errno));
+	    close(lfd);
 	    return -1;
 	}
-#else
-	void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
-	if (!handle) {
-	    const char *err = dlerror();
-	    bu_plugin_logf(BU_LOG_ERR, "Failed to load plugin: %s (%s)", path, err ? err : "unknown error");
-	    return -1;
+	bu_plugin_logf(BU_LOG_INFO, "Zygote serving %zu command(s) on %s", bu_plugin_cmd_count(), socket_path);
+
+	std::vector<pid_t> workers;
+	int spawned = 0;
+	for (;;) {
+	    /* Reap workers that have exited */
+	    for (size_t i = 0; i < workers.size();) {
+		if (waitpid(workers[i], nullptr, WNOHANG) != 0) {
+		    workers[i] = workers.back();
+		    workers.pop_back();
+		} else {
+		    i++;
+		}
+	    }
+
+	    int cfd = accept(lfd, nullptr, nullptr);
+	    if (cfd < 0) {
+		if (errno == EINTR || errno == ECONNABORTED) continue;
+		bu_plugin_logf(BU_LOG_ERR, "Zygote accept() failed: %s", std::strerror(errno));
+		break;
+	    }
+
+	    /* Read one newline-terminated request */
+	    std::string request;
+	    char buf[256];
+	    bool complete = false;
+	    while (!complete && request.size() < 4096) {
+		ssize_t n = read(cfd, buf, sizeof(buf));
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) break;
+		const char *nl = static_cast<const char *>(std::memchr(buf, '\n', static_cast<size_t>(n)));
+		request.append(buf, nl ? static_cast<size_t>(nl - buf) : static_cast<size_t>(n));
+		complete = (nl != nullptr);
+	    }
+	    if (!complete) {
+		bu_plugin_logf(BU_LOG_WARN, "Zygote dropped an incomplete request");
+		close(cfd);
+		continue;
+	    }
+	    if (request == BU_PLUGIN_ZYGOTE_QUIT) {
+		close(cfd);
+		break;
+	    }
+
+	    /* Don't let the worker inherit (and later flush) buffered output */
+	    std::fflush(nullptr);
+	    pid_t pid = fork();
+	    if (pid == 0) {
+		close(lfd);
+		/* Executor threads do not survive fork(); let the worker start its own */
+		bu_plugin_impl::get_executor().store(nullptr, std::memory_order_release);
+		bu_plugin_impl::get_exec_users().store(0);		bu_plugin_impl::reset_strands_after_fork();
+		bu_plugin_impl::reset_deadlines_after_fork();
+		int rc = fn(cfd, request.c_str(), user);
+		std::fflush(nullptr);
+		close(cfd);
+		_exit(rc & 0xff);
+	    }
+	    if (pid < 0) {
+		bu_plugin_logf(BU_LOG_ERR, "Zygote fork() failed: %s", std::strerror(errno));
+	    } else {
+		workers.push_back(pid);
+		spawned++;
+	    }
+	    close(cfd);
 	}
 
-	/* Clear dlerror before dlsym for accurate error reporting */
-	dlerror();
+	close(lfd);
+	unlink(socket_path);
+	for (pid_t pid : workers) {
+	    while (waitpid(pid, nullptr, 0) < 0 && errno == EINTR) {}
+	}
+	return spawned;
+    }
 
-	typedef const bu_plugin_manifest* (*info_fn)(void);
-	info_fn get_info = reinterpret_cast<info_fn>(dlsym(handle, BU_PLUGIN_MANIFEST_SYM));
-	const char *sym_err = dlerror();
-	if (sym_err || !get_info) {
-	    bu_plugin_logf(BU_LOG_ERR, "Plugin %s does not export %s (%s)",
-		    path, BU_PLUGIN_MANIFEST_SYM, sym_err ? sym_err : "symbol not found");
-	    dlclose(handle);
+    BU_PLUGIN_API int bu_plugin_zygote_spawn(const char *socket_path, const char *request) {
+	if (!socket_path || !request || std::strchr(request, '\n')) return -1;
+	struct sockaddr_un addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (std::strlen(socket_path) >= sizeof(addr.sun_path)) return -1;
+	std::strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) return -1;
+	if (connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0) {
+	    close(fd);
 	    return -1;
 	}
-#endif
+	std::string line(request);
+	line += '\n';
+	size_t off = 0;
+	while (off < line.size()) {
+	    ssize_t n = write(fd, line.data() + off, line.size() - off);
+	    if (n < 0 && errno == EINTR) continue;
+	    if (n <= 0) {
+		close(fd);
+		return -1;
+	    }
+	    off += static_cast<size_t>(n);
+	}
+	return fd;
+    }
 
-	const bu_plugin_manifest *manifest = get_info();
-	if (!manifest) {
-	    bu_plugin_logf(BU_LOG_ERR, "Plugin %s returned NULL manifest", path);
-#if defined(_WIN32)
-	    FreeLibrary(handle);
-#else
-	    dlclose(handle);
-#endif
+#ifdef BU_PLUGIN_DEFAULT_SIGNATURE
+    BU_PLUGIN_API int bu_plugin_worker_pool_start(unsigned int workers) {
+	using bu_plugin_impl::PoolShared;
+	using bu_plugin_impl::PoolBlob;
+	using bu_plugin_impl::WorkerPool;
+	if (bu_plugin_impl::pool_in_worker()) return -1;
+	std::lock_guard<std::mutex> lock(bu_plugin_impl::get_pool_mutex());
+	if (bu_plugin_impl::get_pool().load()) return 1;
+	if (bu_plugin_impl::library_threads_running()) {
+	    bu_plugin_logf(BU_LOG_ERR, "Cannot start the worker pool while bu_plugin threads are running "
+		    "(executor, call deadlines, parallel loads); start it before them");
 	    return -1;
 	}
+	if (workers == 0) workers = 2;
 
-	/* Validate manifest ABI version and struct_size */
-	if (manifest->abi_version != BU_PLUGIN_ABI_VERSION) {
-	    bu_plugin_logf(BU_LOG_ERR, "Plugin %s has incompatible ABI version %u (expected %u)",
-		    path, manifest->abi_version, BU_PLUGIN_ABI_VERSION);
-#if defined(_WIN32)
-	    FreeLibrary(handle);
-#else
-	    dlclose(handle);
-#endif
+	/* Blob first, then one PoolShared per worker, each on its own cache lines */
+	size_t blob_bytes = (sizeof(PoolBlob) + 63) & ~static_cast<size_t>(63);
+	size_t shared_bytes = (sizeof(PoolShared) + 63) & ~static_cast<size_t>(63);
+	WorkerPool *pool = new WorkerPool;
+	pool->map_bytes = blob_bytes + shared_bytes * workers;
+	void *map = mmap(nullptr, pool->map_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (map == MAP_FAILED) {
+	    bu_plugin_logf(BU_LOG_ERR, "Worker pool mmap() failed: %s", std::strerror(errno));
+	    delete pool;
 	    return -1;
 	}
+	pool->map = map;
+	char *base = static_cast<char *>(map);
+	pool->blob = new (base) PoolBlob();
+	std::vector<PoolShared *> shared;
+	for (unsigned int i = 0; i < workers; i++) {
+	    PoolShared *sh = new (base + blob_bytes + shared_bytes * i) PoolShared();
+	    bu_plugin_impl::pool_reset_shared(sh);
+	    shared.push_back(sh);
+	    pool->workers.emplace_back(new bu_plugin_impl::PoolWorker);
+	    pool->workers.back()->sh = sh;
+	}
 
-	if (manifest->struct_size < sizeof(bu_plugin_manifest)) {
-	    bu_plugin_logf(BU_LOG_ERR, "Plugin %s has incompatible manifest struct_size %zu (expected >= %zu)",
-		    path, manifest->struct_size, sizeof(bu_plugin_manifest));
-#if defined(_WIN32)
-	    FreeLibrary(handle);
-#else
-	    dlclose(handle);
-#endif
+	int sv[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+	    bu_plugin_logf(BU_LOG_ERR, "Worker pool socketpair() failed: %s", std::strerror(errno));
+	    bu_plugin_impl::pool_destroy(pool);
 	    return -1;
 	}
-
-	/* Validate manifest has commands */
-	if (!manifest->commands || manifest->cmd_count == 0) {
-	    bu_plugin_logf(BU_LOG_INFO, "Plugin %s has no commands", path);
-	    /* Not an error, just nothing to register */
-#if defined(_WIN32)
-	    bu_plugin_impl::get_modules().push_back(handle);
-#else
-	    bu_plugin_impl::get_modules().push_back(handle);
-#endif
-	    return 0;
+	std::fflush(nullptr);
+	pid_t pid = fork();
+	if (pid == 0) {
+	    close(sv[0]);
+	    bu_plugin_impl::get_executor().store(nullptr, std::memory_order_release);
+	    bu_plugin_impl::get_exec_users().store(0);	    bu_plugin_impl::reset_strands_after_fork();
+	    bu_plugin_impl::reset_deadlines_after_fork();
+	    bu_plugin_impl::pool_spawner_main(sv[1], pool->blob, shared);
+	    _exit(0);
 	}
-
-	/* Detect duplicate command names within the manifest */
-	std::unordered_set<std::string> manifest_names;
-	for (unsigned int i = 0; i < manifest->cmd_count; i++) {
-	    const bu_plugin_cmd *cmd = &manifest->commands[i];
-	    if (cmd->name) {
-		std::string trimmed = bu_plugin_impl::trim_whitespace(cmd->name);
-		if (!trimmed.empty() && manifest_names.find(trimmed) != manifest_names.end()) {
-		    bu_plugin_logf(BU_LOG_WARN, "Plugin %s has duplicate command name '%s' in manifest",
-			    path, trimmed.c_str());
-		}
-		manifest_names.insert(trimmed);
-	    }
+	close(sv[1]);
+	if (pid < 0) {
+	    bu_plugin_logf(BU_LOG_ERR, "Worker pool fork() failed: %s", std::strerror(errno));
+	    close(sv[0]);
+	    bu_plugin_impl::pool_destroy(pool);
+	    return -1;
 	}
+	pool->sock = sv[0];
+	pool->spawner = pid;
+	for (unsigned int i = 0; i < workers; i++) {
+	    bu_plugin_impl::PoolMsg msg = { bu_plugin_impl::POOL_MSG_SPAWN, i, 0 };
+	    bu_plugin_impl::pool_write(pool->sock, msg);
+	}
+	pool->supervisor = std::thread(bu_plugin_impl::pool_supervise, pool);
 
-	int registered = 0;
-	for (unsigned int i = 0; i < manifest->cmd_count; i++) {
-	    const bu_plugin_cmd *cmd = &manifest->commands[i];
-	    if (cmd->name && cmd->impl) {
-		int result = bu_plugin_cmd_register(cmd->name, cmd->impl);
-		if (result == 0) {
-		    registered++;
-		}
-		/* result == 1 means duplicate (logged by register function) */
+	/* Wait until every worker serves or has given up */
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	unsigned int up = 0;
+	for (;;) {
+	    unsigned int settled = 0;
+	    up = 0;
+	    for (const auto &w : pool->workers) {
+		if (!w->down.load()) up++;
+		if (!w->down.load() || w->failed.load()) settled++;
 	    }
+	    if (settled == workers || std::chrono::steady_clock::now() > deadline) break;
+	    std::this_thread::sleep_for(std::chrono::milliseconds(1));
 	}
-
-	/* Retain module handle for lifetime */
-#if defined(_WIN32)
-	bu_plugin_impl::get_modules().push_back(handle);
-#else
-	bu_plugin_impl::get_modules().push_back(handle);
-#endif
-
-	return registered;
+	if (up == 0) {
+	    bu_plugin_logf(BU_LOG_ERR, "No plugin worker started");
+	    bu_plugin_impl::pool_destroy(pool);
+	    return -1;
+	}
+	bu_plugin_impl::get_pool().store(pool, std::memory_order_release);
+	bu_plugin_logf(BU_LOG_INFO, "Worker pool started (%u of %u worker(s) up)", up, workers);
+	return 0;
     }
 
-    /* Count retained modules */
-    BU_PLUGIN_API size_t bu_plugin_loaded_modules_count(void) {
-	return bu_plugin_impl::get_modules().size();
+    BU_PLUGIN_API void bu_plugin_worker_pool_stop(void) {
+	std::lock_guard<std::mutex> lock(bu_plugin_impl::get_pool_mutex());
+	bu_plugin_impl::WorkerPool *pool = bu_plugin_impl::get_pool().exchange(nullptr);
+	if (!pool) return;
+	pool->stopping.store(true);
+	{
+	    /* Proxies are only registered in the default context */
+	    bu_plugin_impl::RegistryScope reg_scope(&bu_plugin_impl::default_registry());
+	    bu_plugin_impl::unregister_commands(pool->proxies);
+	}
+	bu_plugin_impl::pool_destroy(pool);
     }
 
-    /* Optional shutdown: unload modules in reverse order and clear registry */
-    BU_PLUGIN_API void bu_plugin_shutdown(void) {
-	auto &mods = bu_plugin_impl::get_modules();
-	for (auto it = mods.rbegin(); it != mods.rend(); ++it) {
-#if defined(_WIN32)
-	    if (*it) FreeLibrary(*it);
-#else
-	    if (*it) dlclose(*it);
-#endif
+    BU_PLUGIN_API int bu_plugin_worker_pool_get_stats(bu_plugin_worker_pool_stats *stats) {
+	if (!stats) return -1;
+	std::lock_guard<std::mutex> lock(bu_plugin_impl::get_pool_mutex());
+	bu_plugin_impl::WorkerPool *pool = bu_plugin_impl::get_pool().load();
+	size_t sz = stats->struct_size;
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_worker_pool_stats, sz, workers)) {
+	    stats->workers = pool ? static_cast<unsigned int>(pool->workers.size()) : 0;
 	}
-	mods.clear();
-	std::lock_guard<std::mutex> lock(bu_plugin_impl::get_mutex());
-	bu_plugin_impl::get_registry().clear();
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_worker_pool_stats, sz, commands)) stats->commands = pool ? pool->blob->ncmds.load() : 0;
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_worker_pool_stats, sz, calls)) stats->calls = pool ? pool->calls.load() : 0;
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_worker_pool_stats, sz, crashes)) stats->crashes = pool ? pool->crashes.load() : 0;
+	if (BU_PLUGIN_HAS_FIELD(bu_plugin_worker_pool_stats, sz, restarts)) stats->restarts = pool ? pool->restarts.load() : 0;
+	return 0;
     }
+#endif /* BU_PLUGIN_DEFAULT_SIGNATURE */
+#endif /* !_WIN32 */
 
 } /* extern "C" */
 
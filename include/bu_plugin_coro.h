@@ -0,0 +1,185 @@
+/*           B U _ P L U G I N _ C O R O . H
+ * BRL-CAD
+ *
+ * Copyright (c) 2026 United States Government as represented by
+ * the U.S. Army Research Laboratory.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this file; see the file named COPYING for more
+ * information.
+ */
+/** @file bu_plugin_coro.h
+ *
+ * @brief C++20 coroutine interface to the bu_plugin executor
+ *
+ * Optional layer on top of bu_plugin.h for hosts built as C++20:
+ *
+ * @code
+ * #include "bu_plugin_coro.h"
+ *
+ * my_task handle_request(bu_plugin_cmd_handle h) {
+ *     int r = co_await bu_plugin::run(h);                  // default int(void)
+ *     int n = co_await bu_plugin::run("count", argc, argv); // custom BU_PLUGIN_CMD_ARGS
+ * }
+ * @endcode
+ *
+ * co_await bu_plugin::run(...) posts the command to the executor (see
+ * bu_plugin_exec_post()) and suspends; the worker that runs the command
+ * resumes the coroutine, so the code after the co_await continues on that
+ * worker. Awaiting again from there queues on the worker's own deque.
+ * Commands that have a strand (see bu_plugin_strand_get()) run on it; the
+ * coroutine is then resumed from a separate executor job, so the code after
+ * the co_await does not hold up the strand.
+ *
+ * The arguments are stored by value inside the awaitable, which lives in
+ * the coroutine frame, and the executor job points at it, so an await
+ * does not allocate. Pass pointers, not temporaries that the command must
+ * see after the full-expression, as with any by-value capture.
+ *
+ * The awaited value is the command's BU_PLUGIN_CMD_RET. The worker runs
+ * the command through bu_plugin::invoke(), so it is called exactly as
+ * bu_plugin_cmd_invoke() would: results of BU_PLUGIN_CMD_PURE commands
+ * come from the cache, BU_PLUGIN_CMD_NOEXCEPT commands skip the try block
+ * and the command's output is flushed in one piece. A command that is not
+ * registered, or that throws or calls bu_plugin_cmd_fail(), makes the
+ * co_await throw bu_plugin::cmd_error with status -1 or -2 (failures are
+ * logged like bu_plugin_cmd_run() does). The command runs under the call
+ * context current at the co_await; if that context stops before the
+ * command starts, the co_await throws with status BU_PLUGIN_CALL_CANCELLED.
+ * If the executor is stopping and the command cannot be posted, the
+ * co_await throws with status -1 and "command could not be submitted".
+ *
+ * Include this header with the same BU_PLUGIN_CMD_RET / BU_PLUGIN_CMD_ARGS
+ * definitions as the rest of the host; the coroutine types themselves
+ * (task, generator, ...) are left to the application.
+ */
+
+#ifndef BU_PLUGIN_CORO_H
+#define BU_PLUGIN_CORO_H
+
+#include "bu_plugin.h"
+
+#if !defined(__cpp_impl_coroutine) && !defined(__cpp_coroutines)
+#error "bu_plugin_coro.h requires C++20 coroutines"
+#endif
+
+#include <coroutine>
+#include <string>
+#include <tuple>
+#include <utility>
+
+namespace bu_plugin {
+
+/**
+ * cmd_awaitable - Awaitable that runs one command on the executor.
+ *
+ * Created by bu_plugin::run(); not meant to be stored or awaited twice.
+ */
+template <typename... Args>
+class cmd_awaitable {
+public:
+    using result_type = BU_PLUGIN_CMD_RET;
+
+    explicit cmd_awaitable(bu_plugin_cmd_handle h, Args... args)
+	: handle_(h), args_(std::move(args)...) {
+	result_.status = -1;
+    }
+
+    /* An unknown command completes immediately and throws from await_resume */
+    bool await_ready() const noexcept {
+	return handle_ == nullptr;
+    }
+
+    bool await_suspend(std::coroutine_handle<> cont) noexcept {
+	cont_ = cont;
+	/* The worker may resume the coroutine before this returns; do not touch *this after posting */
+	bu_plugin_strand *strand = bu_plugin_cmd_handle_strand(handle_);
+	int posted = strand ? bu_plugin_strand_post(strand, &cmd_awaitable::run_strand_job, this) :
+	    bu_plugin_exec_post(&cmd_awaitable::run_job, this);
+	if (posted != 0) unposted_ = true;
+	return posted == 0;
+    }
+
+    result_type await_resume() {
+	if (unposted_) throw cmd_error(-1, std::string("command could not be submitted: ") + name());
+	if (result_.status != 0) throw cmd_error(result_.status, std::string(status_message(result_.status)) + ": " + name());
+	return detail::result_of_call<result_type>::take(result_);
+    }
+
+private:
+    using signature_type = BU_PLUGIN_CMD_RET(BU_PLUGIN_CMD_ARGS);
+
+    const char *name() const {
+	return handle_ ? bu_plugin_cmd_handle_name(handle_) : "(null handle)";
+    }
+
+    static void run_job(void *arg) {
+	cmd_awaitable *self = static_cast<cmd_awaitable *>(arg);
+	self->invoke();
+	self->cont_.resume();
+    }
+
+    static void run_strand_job(void *arg) {
+	cmd_awaitable *self = static_cast<cmd_awaitable *>(arg);
+	self->invoke();
+	if (bu_plugin_exec_post(&cmd_awaitable::resume_job, self) != 0) self->cont_.resume();
+    }
+
+    static void resume_job(void *arg) {
+	static_cast<cmd_awaitable *>(arg)->cont_.resume();
+    }
+
+    /* The shared checked call: cache, NOEXCEPT fast path, output scope and failure reporting */
+    void invoke() noexcept {
+	result_ = std::apply([this](Args &...args) {
+		return bu_plugin::invoke<signature_type, return_status>(handle_, args...);
+		}, args_);
+    }
+
+    bu_plugin_cmd_handle handle_;
+    std::tuple<Args...> args_;
+    std::coroutine_handle<> cont_;
+    bool unposted_ = false;
+    /* Status and value; call_result<void> (a void BU_PLUGIN_CMD_RET) holds only the status */
+    call_result<result_type> result_{};
+};
+
+/**
+ * run - co_await a command by handle on the executor.
+ */
+template <typename... Args>
+cmd_awaitable<std::decay_t<Args>...> run(bu_plugin_cmd_handle h, Args &&...args) {
+    return cmd_awaitable<std::decay_t<Args>...>(h, std::forward<Args>(args)...);
+}
+
+/**
+ * run - co_await a command by name; resolves the handle on every call, so
+ * prefer the handle overload on hot paths.
+ */
+template <typename... Args>
+cmd_awaitable<std::decay_t<Args>...> run(const char *name, Args &&...args) {
+    return cmd_awaitable<std::decay_t<Args>...>(bu_plugin_cmd_lookup(name), std::forward<Args>(args)...);
+}
+
+} /* namespace bu_plugin */
+
+#endif /* BU_PLUGIN_CORO_H */
+
+/*
+ * Local Variables:
+ * tab-width: 8
+ * mode: C++
+ * indent-tabs-mode: t
+ * c-file-style: "stroustrup"
+ * End:
+ * ex: shiftwidth=4 tabstop=8 cino=N-s
+ */
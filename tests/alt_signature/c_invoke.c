@@ -0,0 +1,23 @@
+/**
+ * c_invoke.c - Run wrappers generated by BU_PLUGIN_DEFINE_INVOKE in C.
+ *
+ * Compiled as C into test_alt_signature, which calls the wrappers below to
+ * check that the generated code follows the bu_plugin_cmd_run() status
+ * convention for the int (*)(int, const char**) signature.
+ */
+
+#define BU_PLUGIN_CMD_RET int
+#define BU_PLUGIN_CMD_ARGS int argc, const char** argv
+#define BU_PLUGIN_CMD_ARGV_SIGNATURE
+
+#include "bu_plugin.h"
+
+BU_PLUGIN_DEFINE_INVOKE(c_argv_run, int, (int argc, const char **argv), (argc, argv))
+
+int c_invoke_name(const char *name, int argc, const char **argv, int *result) {
+    return c_argv_run_name(name, result, argc, argv);
+}
+
+int c_invoke_handle(bu_plugin_cmd_handle h, int argc, const char **argv, int *result) {
+    return c_argv_run(h, result, argc, argv);
+}
@@ -7,15 +7,20 @@
  * Key points:
  *   - Defines BU_PLUGIN_CMD_RET and BU_PLUGIN_CMD_ARGS before including bu_plugin.h
  *   - Defines BU_PLUGIN_IMPLEMENTATION to include the registry implementation
- *   - Provides a custom wrapper function for running commands with arguments
+ *   - Provides a custom wrapper function for running commands with arguments,
+ *     bracketing each call with bu_plugin_output_begin()/bu_plugin_output_end()
+ *     and answering pure commands from the result cache
+ *   - Defines BU_PLUGIN_CMD_ARGV_SIGNATURE to get bu_plugin_cmd_run_batch_argv()
  */
 
 #include <cstdio>
 #include <cstring>
+#include <string>
 
 /* Define custom command signature BEFORE including bu_plugin.h */
 #define BU_PLUGIN_CMD_RET int
 #define BU_PLUGIN_CMD_ARGS int argc, const char** argv
+#define BU_PLUGIN_CMD_ARGV_SIGNATURE
 
 /* Enable the implementation in this compilation unit */
 #ifndef BU_PLUGIN_IMPLEMENTATION
@@ -38,52 +43,84 @@ extern "C" BU_PLUGIN_EXPORT int alt_sig_host_init(void) {
  * @param argc     Number of arguments to pass to the command.
  * @param argv     Array of argument strings.
  * @param result   Output parameter for the command's return value (can be NULL).
- * @return 0 on success, -1 if command not found, -2 if command threw an exception.
+ * @return 0 on success, -1 if command not found, -2 if command threw an exception
+ *         or failed through bu_plugin_cmd_fail().
  *
  * This is a custom wrapper tailored to the int (*)(int, const char**) signature.
  * It demonstrates how applications can provide their own run wrappers for
- * custom signatures.
+ * custom signatures. Commands flagged BU_PLUGIN_CMD_PURE are looked up in
+ * the result cache by their argument words, each NUL-terminated; commands
+ * flagged BU_PLUGIN_CMD_NOEXCEPT are called without a try block.
  */
 extern "C" BU_PLUGIN_EXPORT int alt_sig_cmd_run(const char *name, int argc, const char** argv, int *result) {
-    bu_plugin_cmd_impl fn = bu_plugin_cmd_get(name);
+    bu_plugin_cmd_handle h = bu_plugin_cmd_lookup(name);
+    bu_plugin_cmd_impl fn = bu_plugin_cmd_handle_impl(h);
     if (!fn) {
         bu_plugin_logf(BU_LOG_ERR, "Command '%s' not found", name ? name : "(null)");
         return -1;
     }
 
-#ifdef __cplusplus
-    try {
+    unsigned int flags = bu_plugin_cmd_handle_flags(h);
+    bool pure = (flags & BU_PLUGIN_CMD_PURE) != 0;
+    std::string key;
+    bu_plugin_memo_token token = 0;
+    if (pure) {
+        for (int i = 0; i < argc; i++) key.append(argv[i], std::strlen(argv[i]) + 1);
+        if (bu_plugin_memo_lookup(h, key.data(), key.size(), result, &token)) return 0;
+    }
+
+    /* The command's output is flushed in one piece when it returns */
+    bu_plugin_output_begin();
+    int status = 0;
+    int ret = 0;
+    if (flags & BU_PLUGIN_CMD_NOEXCEPT) {
+        ret = fn(argc, argv);
+    } else {
+#if BU_PLUGIN_EXCEPTIONS
+        try {
 #endif
-        int ret = fn(argc, argv);
-        if (result) {
-            *result = ret;
+            ret = fn(argc, argv);
+#if BU_PLUGIN_EXCEPTIONS
+        } catch (const std::exception& e) {
+            bu_plugin_logf(BU_LOG_ERR, "Command '%s' threw exception: %s", name, e.what());
+            status = -2;
+        } catch (...) {
+            bu_plugin_logf(BU_LOG_ERR, "Command '%s' threw unknown exception", name);
+            status = -2;
         }
-        return 0;
-#ifdef __cplusplus
-    } catch (const std::exception& e) {
-        bu_plugin_logf(BU_LOG_ERR, "Command '%s' threw exception: %s", name, e.what());
-        return -2;
-    } catch (...) {
-        bu_plugin_logf(BU_LOG_ERR, "Command '%s' threw unknown exception", name);
-        return -2;
-    }
 #endif
+    }
+    /* Collected even after a throw, or it would fail the thread's next command */
+    const char *what = bu_plugin_cmd_take_failure();
+    if (status == 0) {
+        if (what) {
+            bu_plugin_logf(BU_LOG_ERR, "Command '%s' failed: %s", name, what);
+            status = -2;
+        } else {
+            if (pure) bu_plugin_memo_store(h, key.data(), key.size(), &ret, token);
+            if (result) {
+                *result = ret;
+            }
+        }
+    }
+    bu_plugin_output_end();
+    return status;
 }
 
 /* Built-in echo command for testing */
 static int builtin_echo(int argc, const char** argv) {
-    printf("echo:");
+    bu_plugin_output_printf("echo:");
     for (int i = 0; i < argc; i++) {
-        printf(" %s", argv[i]);
+        bu_plugin_output_printf(" %s", argv[i]);
     }
-    printf("\n");
+    bu_plugin_output_printf("\n");
     return argc;
 }
 REGISTER_BU_PLUGIN_COMMAND("echo", builtin_echo);
 
 /* Built-in count command for testing */
 static int builtin_count(int argc, const char**) {
-    printf("count: received %d arguments\n", argc);
+    bu_plugin_output_printf("count: received %d arguments\n", argc);
     return argc;
 }
 REGISTER_BU_PLUGIN_COMMAND("count", builtin_count);
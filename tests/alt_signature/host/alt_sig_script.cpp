@@ -0,0 +1,33 @@
+/**
+ * alt_sig_script.cpp - Script driver for alternative signature commands.
+ *
+ * run_alt_script is run_bu_plugin --script built against alt_sig_host:
+ * each script line's words after the command name become the command's
+ * argc/argv. It adds one built-in command, "fail [message]", which
+ * fails through bu_plugin_cmd_fail() so scripts can exercise failed lines.
+ *
+ * Usage: run_alt_script [-p plugin]... [-j jobs] [--time] [FILE|-]
+ */
+
+#define BU_PLUGIN_CMD_RET int
+#define BU_PLUGIN_CMD_ARGS int argc, const char **argv
+
+#include <cstdio>
+#include "bu_plugin.h"
+#include "script.h"
+
+extern "C" int alt_sig_host_init(void);
+
+static int cmd_fail(int argc, const char **argv) {
+    bu_plugin_cmd_fail(argc > 0 ? argv[0] : nullptr);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (alt_sig_host_init() != 0) {
+        fprintf(stderr, "Failed to initialize plugin system\n");
+        return 1;
+    }
+    bu_plugin_cmd_register("fail", cmd_fail);
+    return script_main(argc - 1, argv + 1);
+}
@@ -3,10 +3,10 @@
  *
  * This plugin demonstrates custom command signatures:
  *   int (*)(int argc, const char** argv)
+ *
+ * Output goes through the host services table.
  */
 
-#include <cstdio>
-
 /* Define custom command signature BEFORE including bu_plugin.h */
 #define BU_PLUGIN_CMD_RET int
 #define BU_PLUGIN_CMD_ARGS int argc, const char** argv
@@ -18,11 +18,13 @@
 
 #include "bu_plugin.h"
 
+static const bu_plugin_host_services *s_host = nullptr;
+
 /* Command that prints all arguments */
 static int cmd_args_test(int argc, const char** argv) {
-    printf("cmd_args_test called with %d arguments:\n", argc);
+    s_host->output_printf("cmd_args_test called with %d arguments:\n", argc);
     for (int i = 0; i < argc; i++) {
-        printf("  argv[%d] = %s\n", i, argv[i]);
+        s_host->output_printf("  argv[%d] = %s\n", i, argv[i]);
     }
     return argc;
 }
@@ -30,7 +32,7 @@ static int cmd_args_test(int argc, const char** argv) {
 /* Command that sums numeric arguments */
 static int cmd_sum(int argc, const char** argv) {
     int sum = 0;
-    printf("cmd_sum calculating sum of %d numbers\n", argc);
+    s_host->output_printf("cmd_sum calculating sum of %d numbers\n", argc);
     for (int i = 0; i < argc; i++) {
         /* Simple atoi for testing - only handles positive integers, ignores non-numeric chars */
         int val = 0;
@@ -39,20 +41,20 @@ static int cmd_sum(int argc, const char** argv) {
                 val = val * 10 + (*p - '0');
             }
         }
-        printf("  argv[%d] = %s -> %d\n", i, argv[i], val);
+        s_host->output_printf("  argv[%d] = %s -> %d\n", i, argv[i], val);
         sum += val;
     }
-    printf("  Sum = %d\n", sum);
+    s_host->output_printf("  Sum = %d\n", sum);
     return sum;
 }
 
 /* Command that concatenates arguments */
 static int cmd_concat(int argc, const char** argv) {
-    printf("concat:");
+    s_host->output_printf("concat:");
     for (int i = 0; i < argc; i++) {
-        printf("%s", argv[i]);
+        s_host->output_printf("%s", argv[i]);
     }
-    printf("\n");
+    s_host->output_printf("\n");
     return argc;
 }
 
@@ -63,15 +65,30 @@ static bu_plugin_cmd s_commands[] = {
     { "concat", cmd_concat }
 };
 
+static int args_bind(const bu_plugin_host_services *host) {
+    if (!host || !BU_PLUGIN_HAS_FIELD(bu_plugin_host_services, host->struct_size, output_printf)) return 1;
+    s_host = host;
+    return 0;
+}
+
 /* Define the manifest */
-static bu_plugin_manifest s_manifest = {
-    "alt-args-plugin",          /* plugin_name */
-    1,                          /* version */
-    3,                          /* cmd_count */
-    s_commands,                 /* commands */
-    BU_PLUGIN_ABI_VERSION,      /* abi_version */
-    sizeof(bu_plugin_manifest)  /* struct_size */
+static bu_plugin_manifest_v2 s_manifest = {
+    {
+        "alt-args-plugin",              /* plugin_name */
+        1,                              /* version */
+        3,                              /* cmd_count */
+        s_commands,                     /* commands */
+        BU_PLUGIN_ABI_VERSION,          /* abi_version */
+        sizeof(bu_plugin_manifest_v2)   /* struct_size */
+    },
+    BU_PLUGIN_MANIFEST_EXT_VERSION,     /* ext_version */
+    nullptr,                            /* depends */
+    nullptr,                            /* init */
+    nullptr,                            /* fini */
+    args_bind,                          /* bind */
+    nullptr,                            /* cmd_flags */
+    nullptr                             /* cmd_batch */
 };
 
 /* Export the manifest */
-BU_PLUGIN_DECLARE_MANIFEST(s_manifest)
+BU_PLUGIN_DECLARE_MANIFEST_V2(s_manifest)
@@ -3,9 +3,11 @@
  *
  * This plugin demonstrates custom command signatures for string operations:
  *   int (*)(int argc, const char** argv)
+ *
+ * Output goes through the host services table: single characters are
+ * appended to the invocation's buffer rather than written to stdio.
  */
 
-#include <cstdio>
 #include <cstring>
 
 /* Define custom command signature BEFORE including bu_plugin.h */
@@ -19,34 +21,36 @@
 
 #include "bu_plugin.h"
 
+static const bu_plugin_host_services *s_host = nullptr;
+
 /* Command that reverses each argument */
 static int cmd_reverse(int argc, const char** argv) {
-    printf("reverse:");
+    s_host->output_printf("reverse:");
     for (int i = 0; i < argc; i++) {
         size_t len = strlen(argv[i]);
-        printf(" ");
+        s_host->output_write(" ", 1);
         for (size_t j = len; j > 0; j--) {
-            printf("%c", argv[i][j-1]);
+            s_host->output_write(&argv[i][j-1], 1);
         }
     }
-    printf("\n");
+    s_host->output_printf("\n");
     return argc;
 }
 
 /* Command that converts to uppercase */
 static int cmd_upper(int argc, const char** argv) {
-    printf("upper:");
+    s_host->output_printf("upper:");
     for (int i = 0; i < argc; i++) {
-        printf(" ");
+        s_host->output_write(" ", 1);
         for (const char* p = argv[i]; *p; p++) {
             char c = *p;
             if (c >= 'a' && c <= 'z') {
                 c = c - 'a' + 'A';
             }
-            printf("%c", c);
+            s_host->output_write(&c, 1);
         }
     }
-    printf("\n");
+    s_host->output_printf("\n");
     return argc;
 }
 
@@ -56,7 +60,7 @@ static int cmd_length(int argc, const char** argv) {
     for (int i = 0; i < argc; i++) {
         total += strlen(argv[i]);
     }
-    printf("length: %zu total characters\n", total);
+    s_host->output_printf("length: %zu total characters\n", total);
     return static_cast<int>(total);
 }
 
@@ -67,15 +71,30 @@ static bu_plugin_cmd s_commands[] = {
     { "length", cmd_length }
 };
 
+static int string_ops_bind(const bu_plugin_host_services *host) {
+    if (!host || !BU_PLUGIN_HAS_FIELD(bu_plugin_host_services, host->struct_size, output_printf)) return 1;
+    s_host = host;
+    return 0;
+}
+
 /* Define the manifest */
-static bu_plugin_manifest s_manifest = {
-    "alt-string-ops-plugin",    /* plugin_name */
-    1,                          /* version */
-    3,                          /* cmd_count */
-    s_commands,                 /* commands */
-    BU_PLUGIN_ABI_VERSION,      /* abi_version */
-    sizeof(bu_plugin_manifest)  /* struct_size */
+static bu_plugin_manifest_v2 s_manifest = {
+    {
+        "alt-string-ops-plugin",        /* plugin_name */
+        1,                              /* version */
+        3,                              /* cmd_count */
+        s_commands,                     /* commands */
+        BU_PLUGIN_ABI_VERSION,          /* abi_version */
+        sizeof(bu_plugin_manifest_v2)   /* struct_size */
+    },
+    BU_PLUGIN_MANIFEST_EXT_VERSION,     /* ext_version */
+    nullptr,                            /* depends */
+    nullptr,                            /* init */
+    nullptr,                            /* fini */
+    string_ops_bind,                    /* bind */
+    nullptr,                            /* cmd_flags */
+    nullptr                             /* cmd_batch */
 };
 
 /* Export the manifest */
-BU_PLUGIN_DECLARE_MANIFEST(s_manifest)
+BU_PLUGIN_DECLARE_MANIFEST_V2(s_manifest)
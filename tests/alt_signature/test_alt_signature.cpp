@@ -12,14 +12,20 @@
  *   - Loads dynamic plugins with the alternative signature
  *   - Tests built-in commands registered at static initialization
  *   - Uses custom wrapper function alt_sig_cmd_run() for command execution
+ *   - Runs commands through bu_plugin::invoke() and through C wrappers
+ *     generated by BU_PLUGIN_DEFINE_INVOKE (c_invoke.c)
+ *   - Loads an int (*)(void) plugin into the same registry and runs it
+ *     through invoke<int()>()
  */
 
 #include <cstdio>
+#include <cstring>
 #include <string>
 
 /* Define custom command signature before including the plugin header */
 #define BU_PLUGIN_CMD_RET int
 #define BU_PLUGIN_CMD_ARGS int argc, const char** argv
+#define BU_PLUGIN_CMD_ARGV_SIGNATURE
 
 #include "bu_plugin.h"
 
@@ -29,13 +35,22 @@ extern "C" {
     int alt_sig_cmd_run(const char *name, int argc, const char** argv, int *result);
 }
 
+/* C wrappers from c_invoke.c */
+extern "C" {
+    int c_invoke_name(const char *name, int argc, const char **argv, int *result);
+    int c_invoke_handle(bu_plugin_cmd_handle h, int argc, const char **argv, int *result);
+}
+
 /* Build configuration (for multi-config generators like Visual Studio) */
 static std::string g_build_config;
 
 /* Helper function to construct plugin path - handles multi-config builds */
-static std::string get_plugin_path(const char* base_dir, const char* plugin_name) {
+static std::string get_plugin_path(const char* base_dir, const char* plugin_name,
+                                   const char* subdir = "tests/alt_signature") {
     std::string path = base_dir;
-    path += "/tests/alt_signature/";
+    path += "/";
+    path += subdir;
+    path += "/";
     
 #if defined(_WIN32) && defined(_MSC_VER)
     /* For MSVC multi-config builds, add the configuration subdirectory */
@@ -313,6 +328,183 @@ int main(int argc, char** argv) {
     }
     printf("PASS: Iterated over %zu commands successfully\n", count_data.count);
     
+    /* Test 12: Batch invocation with per-item argc/argv */
+    printf("\n=== Test 12: Batch invocation via bu_plugin_cmd_run_batch_argv ===\n");
+    const char* batch_names[] = {"sum", "length", "nonexistent", "count"};
+    const char* sum_args[] = {"1", "2", "3"};
+    const char* length_args[] = {"batch"};
+    const int batch_argcs[] = {3, 1, 0, 2};
+    const char** const batch_argvs[] = {sum_args, length_args, nullptr, count_args};
+    int batch_results[4] = {0, 0, 0, 0};
+    int batch_status[4] = {1, 1, 1, 1};
+    int failed = bu_plugin_cmd_run_batch_argv(batch_names, 4, batch_argcs, batch_argvs, batch_results, batch_status);
+    if (failed != 1 || batch_status[2] != -1) {
+        printf("FAIL: Expected exactly the missing command to fail, got %d failure(s)\n", failed);
+        return 1;
+    }
+    if (batch_status[0] != 0 || batch_results[0] != 6 || batch_results[1] != 5 || batch_results[3] != 2) {
+        printf("FAIL: Unexpected batch results %d %d %d\n", batch_results[0], batch_results[1], batch_results[3]);
+        return 1;
+    }
+    printf("PASS: Batch ran %d item(s) with their own arguments\n", 4 - failed);
+    
+    /* Test 13: Command lines split in place and dispatched */
+    printf("\n=== Test 13: Command lines via bu_plugin_line_word/bu_plugin_cmd_run_line ===\n");
+    char line[] = "  sum 'a b'\t\"c \\\"d\\\" e\" f\\ g # comment";
+    char *cursor = line;
+    const char *word = nullptr;
+    std::string words;
+    while (bu_plugin_line_word(&cursor, &word) == 1) {
+        words += word;
+        words += "|";
+    }
+    if (words != "sum|a b|c \"d\" e|f g|") {
+        printf("FAIL: Unexpected words '%s'\n", words.c_str());
+        return 1;
+    }
+    char bad[] = "sum 'open";
+    cursor = bad;
+    if (bu_plugin_line_word(&cursor, &word) != 1 || bu_plugin_line_word(&cursor, &word) != -1) {
+        printf("FAIL: Unterminated quote not reported\n");
+        return 1;
+    }
+    int line_result = 0;
+    if (bu_plugin_cmd_run_line("sum 1 2 '3'", &line_result) != 0 || line_result != 6) {
+        printf("FAIL: run_line 'sum' returned %d\n", line_result);
+        return 1;
+    }
+    if (bu_plugin_cmd_run_line("length \"a b\" c\nlength ignored", &line_result) != 0 || line_result != 4) {
+        printf("FAIL: run_line 'length' returned %d\n", line_result);
+        return 1;
+    }
+    if (bu_plugin_cmd_run_line("nonexistent 1", nullptr) != -1 || bu_plugin_cmd_run_line("  # empty", nullptr) != -1 ||
+        bu_plugin_cmd_run_line("sum \"1", nullptr) != -1 || bu_plugin_cmd_run_line(nullptr, nullptr) != -1) {
+        printf("FAIL: Bad command lines should fail with -1\n");
+        return 1;
+    }
+    /* A command that runs a line itself must not clobber its own argv */
+    static auto nested_cmd = [](int nargc, const char** nargv) -> int {
+        int inner = 0;
+        if (bu_plugin_cmd_run_line("sum 40 2", &inner) != 0) return -1;
+        return (nargc == 2 && std::string(nargv[0]) == "x" && std::string(nargv[1]) == "yz" && !nargv[2]) ? inner : -1;
+    };
+    bu_plugin_cmd_register("nested_line", nested_cmd);
+    if (bu_plugin_cmd_run_line("nested_line x yz", &line_result) != 0 || line_result != 42) {
+        printf("FAIL: Nested run_line returned %d\n", line_result);
+        return 1;
+    }
+    printf("PASS: Command lines split and ran, including a nested line\n");
+    
+    /* Test 14: Pure commands answered from the result cache */
+    printf("\n=== Test 14: Result cache for pure commands ===\n");
+    static int memo_calls = 0;
+    static auto memo_cmd = [](int margc, const char** margv) -> int {
+        memo_calls++;
+        int total = 0;
+        for (int i = 0; i < margc; i++) total += static_cast<int>(std::strlen(margv[i]));
+        return total;
+    };
+    bu_plugin_cmd_register("memo_len", memo_cmd);
+    bu_plugin_cmd_set_flags("memo_len", BU_PLUGIN_CMD_PURE);
+    bu_plugin_memo_set_capacity(64);
+    /* alt_sig_cmd_run() and run_line key the cache the same way, so they share entries */
+    const char* memo_args[] = {"ab", "c"};
+    int memo_results[4] = {0, 0, 0, 0};
+    if (alt_sig_cmd_run("memo_len", 2, memo_args, &memo_results[0]) != 0 ||
+        alt_sig_cmd_run("memo_len", 2, memo_args, &memo_results[1]) != 0 ||
+        bu_plugin_cmd_run_line("memo_len ab c", &memo_results[2]) != 0 ||
+        bu_plugin_cmd_run_line("memo_len abc", &memo_results[3]) != 0) {
+        printf("FAIL: memo_len did not run\n");
+        return 1;
+    }
+    if (memo_calls != 2 || memo_results[0] != 3 || memo_results[1] != 3 || memo_results[2] != 3 || memo_results[3] != 3) {
+        printf("FAIL: Expected 2 calls for 2 distinct argument lists, got %d\n", memo_calls);
+        return 1;
+    }
+    bu_plugin_memo_stats memo_stats;
+    memo_stats.struct_size = sizeof(memo_stats);
+    if (bu_plugin_memo_get_stats(&memo_stats) != 0 || memo_stats.hits != 2 || memo_stats.misses != 2) {
+        printf("FAIL: Expected 2 hits and 2 misses, got %llu and %llu\n", memo_stats.hits, memo_stats.misses);
+        return 1;
+    }
+    bu_plugin_memo_set_capacity(0);
+    alt_sig_cmd_run("memo_len", 2, memo_args, nullptr);
+    if (memo_calls != 3) {
+        printf("FAIL: A disabled cache should run the command\n");
+        return 1;
+    }
+    printf("PASS: Pure command ran once per distinct argument list\n");
+    
+    /* Test 15: Generic run wrapper and C wrapper generator */
+    printf("\n=== Test 15: bu_plugin::invoke() and BU_PLUGIN_DEFINE_INVOKE ===\n");
+    typedef int argv_sig(int, const char **);
+    const char* inv_args[] = {"1", "2", "3"};
+    bu_plugin_cmd_handle sum_h = bu_plugin_cmd_lookup("sum");
+    bu_plugin::cmd<argv_sig> sum_cmd("sum");
+    int invoked[4] = {
+        bu_plugin::invoke<argv_sig>("sum", 3, inv_args),
+        bu_plugin::invoke<argv_sig>(sum_h, 2, inv_args),
+        bu_plugin::invoke(sum_cmd, 1, inv_args),
+        bu_plugin::invoke<argv_sig, bu_plugin::unchecked>(sum_cmd, 3, inv_args)
+    };
+    if (!sum_cmd || invoked[0] != 6 || invoked[1] != 3 || invoked[2] != 1 || invoked[3] != 6 || sum_cmd(2, inv_args) != 3) {
+        printf("FAIL: invoke() returned %d %d %d %d\n", invoked[0], invoked[1], invoked[2], invoked[3]);
+        return 1;
+    }
+    static auto fail_cmd = [](int, const char**) -> int {
+        bu_plugin_cmd_fail("invoke test failure");
+        return 0;
+    };
+    bu_plugin_cmd_register("invoke_fail", fail_cmd);
+    int thrown = 0;
+    try {
+        bu_plugin::invoke<argv_sig>("invoke_fail", 0, inv_args);
+    } catch (const bu_plugin::cmd_error &e) {
+        thrown = e.status();
+    }
+    bu_plugin::call_result<int> missing = bu_plugin::invoke<argv_sig, bu_plugin::return_status>("no_such_command", 0, inv_args);
+    bu_plugin::call_result<int> fail_res = bu_plugin::invoke<argv_sig, bu_plugin::return_status>("invoke_fail", 0, inv_args);
+    bu_plugin::call_result<int> ok = bu_plugin::invoke<argv_sig, bu_plugin::return_status>(sum_h, 3, inv_args);
+    if (thrown != -2 || missing.status != -1 || fail_res.status != -2 || ok.status != 0 || ok.value != 6) {
+        printf("FAIL: Statuses %d %d %d %d (value %d)\n", thrown, missing.status, fail_res.status, ok.status, ok.value);
+        return 1;
+    }
+    int c_results[2] = {0, 0};
+    if (c_invoke_name("sum", 3, inv_args, &c_results[0]) != 0 || c_invoke_handle(sum_h, 2, inv_args, &c_results[1]) != 0 ||
+        c_results[0] != 6 || c_results[1] != 3) {
+        printf("FAIL: C wrappers returned %d and %d\n", c_results[0], c_results[1]);
+        return 1;
+    }
+    if (c_invoke_name("no_such_command", 0, inv_args, nullptr) != -1 ||
+        c_invoke_name("invoke_fail", 0, inv_args, nullptr) != -2 ||
+        c_invoke_handle(nullptr, 0, inv_args, nullptr) != -1) {
+        printf("FAIL: C wrappers should report -1 and -2\n");
+        return 1;
+    }
+    printf("PASS: invoke() and the generated C wrappers follow the run status convention\n");
+    
+    /* Test 16: A plugin of the default signature in this host's registry */
+    printf("\n=== Test 16: int (*)(void) plugin next to argc/argv commands ===\n");
+    std::string example_path = get_plugin_path(build_dir, "bu-example-plugin", "tests/plugin/example");
+    if (bu_plugin_load(example_path.c_str()) != 1) {
+        printf("FAIL: Could not load %s\n", example_path.c_str());
+        return 1;
+    }
+    bu_plugin_cmd_handle example_h = bu_plugin_cmd_lookup("example");
+    int example_result = 0;
+    if (bu_plugin_cmd_handle_sig(example_h) != bu_plugin_sig_id(BU_PLUGIN_SIG_VOID) || bu_plugin_cmd_get("example") ||
+        alt_sig_cmd_run("example", 0, inv_args, &example_result) != -1 ||
+        c_invoke_name("example", 0, inv_args, nullptr) != -1) {
+        printf("FAIL: The int (*)(void) command should be tagged and hidden from argc/argv wrappers\n");
+        return 1;
+    }
+    example_result = bu_plugin::invoke<int()>("example");
+    if (example_result != 42 || bu_plugin::invoke<int(), bu_plugin::return_status>(example_h).value != 42) {
+        printf("FAIL: invoke<int()>() returned %d\n", example_result);
+        return 1;
+    }
+    printf("PASS: One host runs int (*)(void) and argc/argv commands side by side\n");
+    
     /* Summary */
     printf("\n========================================\n");
     printf("    Test Summary\n");
@@ -323,6 +515,11 @@ int main(int argc, char** argv) {
     printf("✓ Dynamic plugin loading with custom signatures\n");
     printf("✓ Custom wrapper function alt_sig_cmd_run() works\n");
     printf("✓ Direct command invocation via bu_plugin_cmd_get()\n");
+    printf("✓ Batch invocation via bu_plugin_cmd_run_batch_argv()\n");
+    printf("✓ Command lines via bu_plugin_line_word() and bu_plugin_cmd_run_line()\n");
+    printf("✓ Result cache keyed by argument words for pure commands\n");
+    printf("✓ Generic bu_plugin::invoke() and C wrappers from BU_PLUGIN_DEFINE_INVOKE\n");
+    printf("✓ Default-signature plugins in the same registry, tagged by signature\n");
     printf("✓ All bu_plugin.h API functions work with custom signatures\n");
     printf("✓ Successfully loaded and executed commands from %d plugins\n", loaded1 + loaded2);
     printf("✓ Total commands registered: %zu\n", final_count);
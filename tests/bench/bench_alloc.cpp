@@ -0,0 +1,133 @@
+/**
+ * bench_alloc.cpp - Allocation-heavy command latency: system allocator vs
+ * the host allocator, with and without per-command arena scopes.
+ *
+ * The command builds a list of variously sized nodes, walks it and frees
+ * it again, the pattern of a command that parses its input into temporary
+ * structures. Each configuration runs the command through bu_plugin_cmd_run
+ * from 1 thread and from several threads at once.
+ *
+ * Usage: bench_alloc [build_dir] [calls_per_thread]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bu_plugin.h"
+#include "bench_common.h"
+
+static const int s_nodes = 512;
+
+struct Node {
+    Node *next;
+    size_t len;
+    unsigned char data[1];
+};
+
+/* Node payload sizes cycle through 16..528 bytes */
+static size_t node_size(int i) {
+    return sizeof(Node) + 16 + static_cast<size_t>((i * 37) % 513);
+}
+
+static int checksum(const Node *head) {
+    unsigned int sum = 0;
+    for (const Node *n = head; n; n = n->next) {
+        sum += n->data[0] + n->data[n->len - 1];
+    }
+    return static_cast<int>(sum & 0x7fff);
+}
+
+static int alloc_system() {
+    Node *head = nullptr;
+    for (int i = 0; i < s_nodes; i++) {
+        size_t sz = node_size(i);
+        Node *n = static_cast<Node *>(std::malloc(sz));
+        if (!n) return -1;
+        n->len = sz - sizeof(Node) + 1;
+        std::memset(n->data, i & 0xff, n->len);
+        n->next = head;
+        head = n;
+    }
+    int sum = checksum(head);
+    while (head) {
+        Node *next = head->next;
+        std::free(head);
+        head = next;
+    }
+    return sum;
+}
+
+static int alloc_host() {
+    const bu_plugin_allocator *a = bu_plugin_get_allocator();
+    Node *head = nullptr;
+    for (int i = 0; i < s_nodes; i++) {
+        size_t sz = node_size(i);
+        Node *n = static_cast<Node *>(a->mem_alloc(a->ctx, sz));
+        if (!n) return -1;
+        n->len = sz - sizeof(Node) + 1;
+        std::memset(n->data, i & 0xff, n->len);
+        n->next = head;
+        head = n;
+    }
+    int sum = checksum(head);
+    while (head) {
+        Node *next = head->next;
+        a->mem_free(a->ctx, head);
+        head = next;
+    }
+    return sum;
+}
+
+/* Run name on nthreads threads, calls times each, and report per-call latency */
+static void run_config(const char *label, const char *name, unsigned int nthreads, int calls) {
+    std::vector<std::vector<double> > per_thread(nthreads);
+    std::vector<std::thread> threads;
+    double t0 = bench_now_us();
+    for (unsigned int t = 0; t < nthreads; t++) {
+        threads.emplace_back([&per_thread, t, name, calls]() {
+            std::vector<double> &samples = per_thread[t];
+            samples.reserve(static_cast<size_t>(calls));
+            for (int i = 0; i < calls; i++) {
+                int result = 0;
+                double s = bench_now_us();
+                bu_plugin_cmd_run(name, &result);
+                samples.push_back(bench_now_us() - s);
+            }
+        });
+    }
+    for (auto &th : threads) th.join();
+    double wall = bench_now_us() - t0;
+
+    std::vector<double> all;
+    for (auto &v : per_thread) all.insert(all.end(), v.begin(), v.end());
+    char row[64];
+    snprintf(row, sizeof(row), "%s x%u", label, nthreads);
+    bench_report(row, all);
+    printf("  %-28s %.0f calls/s\n", "", static_cast<double>(all.size()) / (wall / 1e6));
+}
+
+int main(int argc, char *argv[]) {
+    int calls = (argc > 2) ? std::atoi(argv[2]) : 2000;
+    unsigned int hw = std::thread::hardware_concurrency();
+    unsigned int many = hw > 8 ? 8 : (hw > 1 ? hw : 2);
+
+    bu_plugin_init();
+    bu_plugin_cmd_register("bench_alloc_system", alloc_system);
+    bu_plugin_cmd_register("bench_alloc_host", alloc_host);
+
+    printf("Allocation-heavy command (%d nodes per call), %d calls per thread\n\n", s_nodes, calls);
+    unsigned int counts[2] = { 1, many };
+    for (unsigned int nthreads : counts) {
+        run_config("system malloc", "bench_alloc_system", nthreads, calls);
+        bu_plugin_set_cmd_arena(0);
+        run_config("host heap", "bench_alloc_host", nthreads, calls);
+        bu_plugin_set_cmd_arena(1);
+        run_config("host arena", "bench_alloc_host", nthreads, calls);
+        bu_plugin_set_cmd_arena(0);
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,125 @@
+/**
+ * bench_cancel.cpp - Cost of polling a call context, and how fast a stop is seen.
+ *
+ * A tight loop of dependent integer work is timed with one check per
+ * iteration:
+ *   - none:      no check (baseline)
+ *   - inline:    bu_plugin_call_ctx_stopped() on a context fetched once
+ *   - current:   bu_plugin_call_ctx_current() + stopped on every iteration
+ *   - services:  the host services call_ctx_current + stopped, as a plugin
+ *                without a link dependency would do it
+ *   - clock:     reading steady_clock against a deadline, the alternative
+ *                without a timer thread
+ * Then a command polling its context on an executor worker is stopped by
+ * bu_plugin_call_ctx_cancel() and by a deadline, and the delay until it
+ * returns is reported.
+ *
+ * Usage: bench_cancel [build_dir] [iterations] [stops]
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <thread>
+#include <vector>
+#include "bu_plugin.h"
+#include "bench_common.h"
+
+static volatile unsigned long long s_sink;
+static std::atomic<double> s_stopped_at(0.0);
+
+enum PollKind { POLL_NONE, POLL_INLINE, POLL_CURRENT, POLL_SERVICES, POLL_CLOCK };
+
+/* ns per iteration of the work loop with the given check */
+static double time_loop(PollKind kind, size_t iters) {
+    const bu_plugin_call_ctx *ctx = bu_plugin_call_ctx_current();
+    const bu_plugin_host_services *host = bu_plugin_get_host_services();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::hours(1);
+    unsigned long long acc = 1;
+    double t0 = bench_now_us();
+    for (size_t i = 0; i < iters; i++) {
+        acc = acc * 6364136223846793005ULL + i;
+        bool stop = false;
+        switch (kind) {
+            case POLL_NONE: break;
+            case POLL_INLINE: stop = bu_plugin_call_ctx_stopped(ctx) != 0; break;
+            case POLL_CURRENT: stop = bu_plugin_call_ctx_stopped(bu_plugin_call_ctx_current()) != 0; break;
+            case POLL_SERVICES: stop = bu_plugin_call_ctx_stopped(host->call_ctx_current()) != 0; break;
+            case POLL_CLOCK: stop = std::chrono::steady_clock::now() >= deadline; break;
+        }
+        if (stop) break;
+    }
+    double us = bench_now_us() - t0;
+    s_sink = acc;
+    return us * 1000.0 / static_cast<double>(iters);
+}
+
+/* Spin on the current context; records when the stop was noticed */
+static int poll_cmd() {
+    const bu_plugin_call_ctx *ctx = bu_plugin_call_ctx_current();
+    unsigned long long acc = 1;
+    while (!bu_plugin_call_ctx_stopped(ctx)) acc = acc * 6364136223846793005ULL + 1;
+    s_stopped_at = bench_now_us();
+    s_sink = acc;
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    size_t iters = (argc > 2) ? static_cast<size_t>(std::atol(argv[2])) : 100000000;
+    int stops = (argc > 3) ? std::atoi(argv[3]) : 50;
+    if (iters < 1) iters = 1;
+    if (stops < 1) stops = 1;
+
+    bu_plugin_init();
+    bu_plugin_cmd_register("bench_poll", poll_cmd);
+    bu_plugin_cmd_set_flags("bench_poll", BU_PLUGIN_CMD_THREADSAFE);
+
+    printf("========================================\n");
+    printf("  Call Context Benchmark (%zu iterations, %d stops)\n", iters, stops);
+    printf("========================================\n");
+
+    bu_plugin_call_ctx *ctx = bu_plugin_call_ctx_create();
+    bu_plugin_call_ctx_set_current(ctx);
+    const char *labels[] = { "none", "inline", "current", "services", "clock" };
+    double base = time_loop(POLL_NONE, iters);
+    printf("  %-10s %6.2f ns/iteration\n", labels[0], base);
+    for (int k = POLL_INLINE; k <= POLL_CLOCK; k++) {
+        double ns = time_loop(static_cast<PollKind>(k), iters);
+        printf("  %-10s %6.2f ns/iteration  %+6.2f ns/check\n", labels[k], ns, ns - base);
+    }
+    bu_plugin_call_ctx_set_current(nullptr);
+    bu_plugin_call_ctx_destroy(ctx);
+
+    /* Stop latency: cancel from this thread, or a 2 ms deadline */
+    bu_plugin_cmd_handle h = bu_plugin_cmd_lookup("bench_poll");
+    bu_plugin_exec_start(0);
+    for (int deadline = 0; deadline < 2; deadline++) {
+        std::vector<double> samples;
+        for (int i = 0; i < stops; i++) {
+            ctx = bu_plugin_call_ctx_create();
+            std::promise<void> done;
+            std::future<void> finished = done.get_future();
+            double stop_at;
+            {
+                bu_plugin::call_scope scope(ctx);
+                bu_plugin::submit(h, [&done](int, int) { done.set_value(); });
+            }
+            if (deadline) {
+                stop_at = bench_now_us() + 2000.0;
+                bu_plugin_call_ctx_set_deadline(ctx, 2000);
+            } else {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                stop_at = bench_now_us();
+                bu_plugin_call_ctx_cancel(ctx);
+            }
+            finished.wait();
+            samples.push_back(s_stopped_at.load() - stop_at);
+            bu_plugin_call_ctx_destroy(ctx);
+        }
+        bench_report(deadline ? "deadline -> command returns" : "cancel -> command returns", samples);
+    }
+    bu_plugin_exec_stop();
+    return 0;
+}
@@ -0,0 +1,72 @@
+/**
+ * bench_common.h - Helpers shared by the benchmark executables.
+ *
+ * Provides:
+ *   - Plugin path construction (same layout rules as the test executables)
+ *   - A monotonic microsecond clock
+ *   - Latency sample summaries (min / median / p99 / max / mean)
+ */
+
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/* Build configuration (for multi-config generators like Visual Studio) */
+static std::string g_build_config;
+
+/* Construct plugin path based on OS and build configuration */
+static inline std::string bench_plugin_path(const char* base_dir, const char* plugin_subdir, const char* plugin_name) {
+    std::string path = base_dir;
+    path += "/";
+    path += plugin_subdir;
+    path += "/";
+#if defined(_WIN32) && defined(_MSC_VER)
+    if (!g_build_config.empty()) {
+        path += g_build_config;
+        path += "/";
+    }
+    path += plugin_name;
+    path += ".dll";
+#elif defined(_WIN32)
+    path += "lib";
+    path += plugin_name;
+    path += ".dll";
+#elif defined(__APPLE__)
+    path += "lib";
+    path += plugin_name;
+    path += ".dylib";
+#else
+    path += "lib";
+    path += plugin_name;
+    path += ".so";
+#endif
+    return path;
+}
+
+/* Microseconds on the steady clock */
+static inline double bench_now_us() {
+    return std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* Print one summary row for a set of latency samples (microseconds) */
+static inline void bench_report(const char* label, std::vector<double> samples) {
+    if (samples.empty()) {
+        printf("  %-28s (no samples)\n", label);
+        return;
+    }
+    std::sort(samples.begin(), samples.end());
+    double sum = 0.0;
+    for (double v : samples) sum += v;
+    size_t n = samples.size();
+    size_t p99 = std::min(n - 1, (n * 99) / 100);
+    printf("  %-28s n=%-8zu min %10.2f  median %10.2f  p99 %10.2f  max %10.2f  mean %10.2f us\n",
+           label, n, samples[0], samples[n / 2], samples[p99], samples[n - 1], sum / static_cast<double>(n));
+}
+
+#endif /* BENCH_COMMON_H */
@@ -0,0 +1,111 @@
+/**
+ * bench_coro.cpp - Per-call overhead of co_await bu_plugin::run() against
+ * the synchronous paths.
+ *
+ * Rows:
+ *   - direct:     calling the function pointer from bu_plugin_cmd_get
+ *   - invoke:     bu_plugin_cmd_invoke on a handle (exception guard)
+ *   - run:        bu_plugin_cmd_run by name (lookup + guard)
+ *   - future:     bu_plugin::submit(h).get(), a blocking thread hop per call
+ *   - co_await:   one coroutine awaiting the command repeatedly; after the
+ *                 first await it runs on a worker and re-queues on that
+ *                 worker's own deque
+ *   - co_await xN: N coroutines awaiting concurrently (throughput per call)
+ *
+ * Usage: bench_coro [build_dir] [calls] [workers]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <string>
+#include <vector>
+#include "bu_plugin_coro.h"
+#include "bench_common.h"
+#include "coro_common.h"
+
+static void report(const char *label, size_t calls, double us) {
+    printf("  %-16s %10zu calls  %9.1f ms  %9.1f ns/call\n", label, calls, us / 1000.0, us * 1000.0 / static_cast<double>(calls));
+}
+
+static detached await_loop(bu_plugin_cmd_handle h, size_t calls, long *sum, std::promise<void> *done) {
+    for (size_t i = 0; i < calls; i++) {
+        *sum += co_await bu_plugin::run(h);
+    }
+    done->set_value();
+}
+
+static detached await_some(bu_plugin_cmd_handle h, size_t calls, long *sum) {
+    for (size_t i = 0; i < calls; i++) {
+        *sum += co_await bu_plugin::run(h);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const char *build_dir = (argc > 1) ? argv[1] : ".";
+    size_t calls = (argc > 2) ? static_cast<size_t>(std::atol(argv[2])) : 1000000;
+    unsigned int workers = (argc > 3) ? static_cast<unsigned int>(std::atoi(argv[3])) : 2;
+    if (calls < 1) calls = 1;
+    if (workers < 1) workers = 1;
+
+    bu_plugin_init();
+    std::string path = bench_plugin_path(build_dir, "tests/plugin/stress_plugin", "bu-stress-plugin");
+    if (bu_plugin_load(path.c_str()) < 0) {
+        fprintf(stderr, "Failed to load %s\n", path.c_str());
+        return 1;
+    }
+    /* Measure executor overhead, not strand serialization */
+    bu_plugin_cmd_set_flags("stress_7", BU_PLUGIN_CMD_THREADSAFE);
+    bu_plugin_cmd_handle h = bu_plugin_cmd_lookup("stress_7");
+    bu_plugin_cmd_impl fn = bu_plugin_cmd_get("stress_7");
+    bu_plugin_exec_start(workers);
+
+    printf("========================================\n");
+    printf("  Coroutine Benchmark (stress_7, %u worker(s))\n", workers);
+    printf("========================================\n");
+
+    volatile long sink = 0;
+    double t0 = bench_now_us();
+    for (size_t i = 0; i < calls; i++) sink = sink + fn();
+    report("direct", calls, bench_now_us() - t0);
+
+    t0 = bench_now_us();
+    for (size_t i = 0; i < calls; i++) {
+        int r = 0;
+        bu_plugin_cmd_invoke(h, &r);
+        sink = sink + r;
+    }
+    report("invoke", calls, bench_now_us() - t0);
+
+    t0 = bench_now_us();
+    for (size_t i = 0; i < calls; i++) {
+        int r = 0;
+        bu_plugin_cmd_run("stress_7", &r);
+        sink = sink + r;
+    }
+    report("run", calls, bench_now_us() - t0);
+
+    size_t future_calls = calls / 10 > 0 ? calls / 10 : 1;
+    t0 = bench_now_us();
+    for (size_t i = 0; i < future_calls; i++) sink = sink + bu_plugin::submit(h).get();
+    report("future", future_calls, bench_now_us() - t0);
+
+    long sum = 0;
+    std::promise<void> done;
+    t0 = bench_now_us();
+    await_loop(h, calls, &sum, &done);
+    done.get_future().wait();
+    report("co_await", calls, bench_now_us() - t0);
+
+    unsigned int ncoro = workers * 16;
+    std::vector<long> sums(ncoro, 0);
+    t0 = bench_now_us();
+    for (unsigned int c = 0; c < ncoro; c++) await_some(h, calls / ncoro, &sums[c]);
+    bu_plugin_exec_drain();
+    char label[32];
+    snprintf(label, sizeof(label), "co_await x%u", ncoro);
+    report(label, (calls / ncoro) * ncoro, bench_now_us() - t0);
+
+    bu_plugin_exec_stop();
+    return (sink < 0 || sum < 0) ? 1 : 0;
+}
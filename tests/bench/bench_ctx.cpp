@@ -0,0 +1,135 @@
+/**
+ * bench_ctx.cpp - Registry contexts: lookup cost and footprint.
+ *
+ * Creates [contexts] registry contexts next to the default one, each
+ * holding the same [commands] trivial commands, and runs them by name:
+ *   - default:   bu_plugin_cmd_run() in the default context alone
+ *   - ctx arg:   bu_plugin_ctx_cmd_run(), the context changing on every call
+ *   - current:   bu_plugin_ctx_set_current() per context, then bu_plugin_cmd_run()
+ * first with mutable registries, then with every registry frozen.
+ *
+ * It also prints the heap held per context (glibc only) and the sizes of
+ * the host library against tests/multilib_stress's libraries, each of
+ * which compiles its own copy of the implementation for its namespace.
+ *
+ * Usage: bench_ctx [build_dir] [calls] [contexts] [commands]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+#include "bu_plugin.h"
+#include "bench_common.h"
+
+static int cmd_trivial(void) {
+    return 1;
+}
+
+/* Bytes currently allocated from the heap, or 0 where that is not known */
+static size_t heap_in_use() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    return mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+}
+
+static long file_size(const std::string &path) {
+    std::ifstream f(path, std::ios::binary | std::ios::ate);
+    return f ? static_cast<long>(f.tellg()) : -1;
+}
+
+static void report(const char *label, const char *mode, size_t n, double us, int sink) {
+    printf("  %-8s %-10s %8.2f ms  %7.1f ns/call%s\n", label, mode, us / 1000.0,
+           us * 1000.0 / static_cast<double>(n), sink == 1 ? " " : "");
+}
+
+int main(int argc, char *argv[]) {
+    const char *build_dir = (argc > 1) ? argv[1] : ".";
+    size_t calls = (argc > 2) ? static_cast<size_t>(std::atol(argv[2])) : 2000000;
+    size_t nctx = (argc > 3) ? static_cast<size_t>(std::atol(argv[3])) : 48;
+    size_t ncmd = (argc > 4) ? static_cast<size_t>(std::atol(argv[4])) : 64;
+    if (calls < 1) calls = 1;
+    if (nctx < 1) nctx = 1;
+    if (ncmd < 1) ncmd = 1;
+
+    bu_plugin_init();
+    std::vector<std::string> names;
+    for (size_t i = 0; i < ncmd; i++) names.push_back("cmd_" + std::to_string(i));
+    for (const std::string &n : names) bu_plugin_cmd_register(n.c_str(), cmd_trivial);
+
+    /* Footprint: empty contexts first, then the same contexts filled */
+    size_t heap0 = heap_in_use();
+    std::vector<bu_plugin_ctx *> ctxs;
+    for (size_t c = 0; c < nctx; c++) ctxs.push_back(bu_plugin_ctx_create(("lib" + std::to_string(c)).c_str()));
+    size_t heap1 = heap_in_use();
+    for (bu_plugin_ctx *ctx : ctxs) {
+        for (const std::string &n : names) {
+            bu_plugin_ctx_cmd_register(ctx, n.c_str(), cmd_trivial);
+            bu_plugin_ctx_cmd_lookup(ctx, n.c_str());
+        }
+    }
+    size_t heap2 = heap_in_use();
+
+    printf("========================================\n");
+    printf("  Registry Context Benchmark (%zu calls, %zu contexts x %zu commands)\n", calls, nctx, ncmd);
+    printf("========================================\n");
+    if (heap0) {
+        printf("  heap per context: %zu bytes empty, %zu bytes with %zu commands and handles\n",
+               (heap1 - heap0) / nctx, (heap2 - heap0) / nctx, ncmd);
+    }
+    long host = file_size(bench_plugin_path(build_dir, "tests", "bu_plugin_host"));
+    long lib1 = file_size(bench_plugin_path(build_dir, "tests/multilib_stress/libtestplugins1", "testplugins1_plugin_host"));
+    if (host > 0 && lib1 > 0) {
+        printf("  host library: %ld bytes, shared by every context\n", host);
+        printf("  per-library copy (multilib_stress): %ld bytes each, %ld bytes for %zu libraries\n",
+               lib1, lib1 * static_cast<long>(nctx), nctx);
+    }
+
+    for (int frozen = 0; frozen < 2; frozen++) {
+        const char *label = frozen ? "frozen" : "mutable";
+        if (frozen) {
+            bu_plugin_freeze();
+            for (bu_plugin_ctx *ctx : ctxs) bu_plugin_ctx_freeze(ctx);
+        }
+        int sink = 0;
+        double t0 = bench_now_us();
+        for (size_t i = 0; i < calls; i++) {
+            int r = 0;
+            bu_plugin_cmd_run(names[i % ncmd].c_str(), &r);
+            sink += r;
+        }
+        report(label, "default", calls, bench_now_us() - t0, sink);
+
+        sink = 0;
+        t0 = bench_now_us();
+        for (size_t i = 0; i < calls; i++) {
+            int r = 0;
+            bu_plugin_ctx_cmd_run(ctxs[i % nctx], names[i % ncmd].c_str(), &r);
+            sink += r;
+        }
+        report(label, "ctx arg", calls, bench_now_us() - t0, sink);
+
+        sink = 0;
+        size_t per_ctx = calls / nctx + 1;
+        t0 = bench_now_us();
+        for (bu_plugin_ctx *ctx : ctxs) {
+            bu_plugin_ctx *prev = bu_plugin_ctx_set_current(ctx);
+            for (size_t i = 0; i < per_ctx; i++) {
+                int r = 0;
+                bu_plugin_cmd_run(names[i % ncmd].c_str(), &r);
+                sink += r;
+            }
+            bu_plugin_ctx_set_current(prev);
+        }
+        report(label, "current", per_ctx * nctx, bench_now_us() - t0, sink);
+    }
+
+    for (bu_plugin_ctx *ctx : ctxs) bu_plugin_ctx_destroy(ctx);
+    return 0;
+}
@@ -0,0 +1,116 @@
+/**
+ * bench_executor.cpp - Throughput of bu_plugin_cmd_submit on 1..N workers.
+ *
+ * Runs a fixed number of submissions of the trivial stress_N commands
+ * (cycling over all 50) for each worker count, in two patterns:
+ *   - external: the main thread submits everything (round-robin over the
+ *               worker deques, workers steal from each other)
+ *   - fan-out:  one seed job per worker submits its share from inside the
+ *               executor, so submissions go to the workers' own deques
+ * A synchronous bu_plugin_cmd_invoke loop on the main thread is the baseline.
+ *
+ * Usage: bench_executor [build_dir] [submissions] [max_workers]
+ *   max_workers defaults to the hardware concurrency
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bu_plugin.h"
+#include "bench_common.h"
+
+static std::vector<bu_plugin_cmd_handle> s_handles;
+static std::atomic<long> s_checksum(0);
+
+static void count_done(int status, int result, void *) {
+    if (status == 0 && result == 49) s_checksum.fetch_add(1, std::memory_order_relaxed);
+}
+
+struct Seed {
+    size_t begin;
+    size_t end;
+};
+
+static void seed_job(void *arg) {
+    const Seed *seed = static_cast<const Seed *>(arg);
+    for (size_t i = seed->begin; i < seed->end; i++) {
+        bu_plugin_cmd_submit(s_handles[i % s_handles.size()], count_done, nullptr);
+    }
+}
+
+static void report(const char *label, unsigned int workers, size_t n, double us) {
+    printf("  %-10s %3u worker(s)  %8.1f ms  %12.0f submissions/s  %7.1f ns/submission\n",
+           label, workers, us / 1000.0, static_cast<double>(n) / (us / 1e6), us * 1000.0 / static_cast<double>(n));
+}
+
+int main(int argc, char *argv[]) {
+    const char *build_dir = (argc > 1) ? argv[1] : ".";
+    size_t total = (argc > 2) ? static_cast<size_t>(std::atol(argv[2])) : 1000000;
+    if (total < 1) total = 1;
+
+    bu_plugin_init();
+    std::string path = bench_plugin_path(build_dir, "tests/plugin/stress_plugin", "bu-stress-plugin");
+    if (bu_plugin_load(path.c_str()) < 0) {
+        fprintf(stderr, "Failed to load %s\n", path.c_str());
+        return 1;
+    }
+    for (int i = 0; i < 50; i++) {
+        std::string name = "stress_" + std::to_string(i);
+        /* Measure executor overhead, not strand serialization */
+        bu_plugin_cmd_set_flags(name.c_str(), BU_PLUGIN_CMD_THREADSAFE);
+        s_handles.push_back(bu_plugin_cmd_lookup(name.c_str()));
+    }
+
+    unsigned int hw = (argc > 3) ? static_cast<unsigned int>(std::atoi(argv[3])) : std::thread::hardware_concurrency();
+    if (hw == 0) hw = 1;
+    std::vector<unsigned int> counts;
+    for (unsigned int n = 1; n < hw; n *= 2) counts.push_back(n);
+    counts.push_back(hw);
+
+    printf("========================================\n");
+    printf("  Executor Benchmark (%zu submissions)\n", total);
+    printf("========================================\n");
+
+    double t0 = bench_now_us();
+    long sync_sum = 0;
+    for (size_t i = 0; i < total; i++) {
+        int result = 0;
+        bu_plugin_cmd_invoke(s_handles[i % s_handles.size()], &result);
+        sync_sum += result;
+    }
+    report("sync", 0, total, bench_now_us() - t0);
+    if (sync_sum < 0) return 1;
+
+    for (unsigned int workers : counts) {
+        bu_plugin_exec_start(workers);
+
+        s_checksum = 0;
+        t0 = bench_now_us();
+        for (size_t i = 0; i < total; i++) {
+            bu_plugin_cmd_submit(s_handles[i % s_handles.size()], count_done, nullptr);
+        }
+        bu_plugin_exec_drain();
+        report("external", workers, total, bench_now_us() - t0);
+        if (static_cast<size_t>(s_checksum.load()) != total / 50) fprintf(stderr, "  checksum mismatch\n");
+
+        std::vector<Seed> seeds(workers);
+        for (unsigned int w = 0; w < workers; w++) {
+            seeds[w].begin = total * w / workers;
+            seeds[w].end = total * (w + 1) / workers;
+        }
+        s_checksum = 0;
+        t0 = bench_now_us();
+        for (unsigned int w = 0; w < workers; w++) {
+            bu_plugin_exec_post(seed_job, &seeds[w]);
+        }
+        bu_plugin_exec_drain();
+        report("fan-out", workers, total, bench_now_us() - t0);
+        if (static_cast<size_t>(s_checksum.load()) != total / 50) fprintf(stderr, "  checksum mismatch\n");
+
+        bu_plugin_exec_stop();
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+/**
+ * bench_invoke.cpp - Run wrappers for a custom signature, argc/argv.
+ *
+ * Each iteration runs a registered int (*)(int argc, const char **argv)
+ * command that sums its argument lengths:
+ *   - alt_sig:    alt_sig_cmd_run(), the hand-written wrapper in
+ *                 tests/alt_signature (lookup by name on every call)
+ *   - by name:    bu_plugin::invoke<Sig>("name", ...)
+ *   - handle:     bu_plugin::invoke<Sig>(handle, ...)
+ *   - cmd:        bu_plugin::invoke(cmd, ...), the implementation resolved once
+ *   - noexcept:   the same with the command flagged BU_PLUGIN_CMD_NOEXCEPT
+ *   - unchecked:  bu_plugin::invoke<Sig, unchecked>(cmd, ...)
+ *   - direct:     a call through the function pointer
+ *
+ * Usage: bench_invoke [build_dir] [calls]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+
+#define BU_PLUGIN_CMD_RET int
+#define BU_PLUGIN_CMD_ARGS int argc, const char** argv
+#define BU_PLUGIN_CMD_ARGV_SIGNATURE
+#include "bu_plugin.h"
+#include "bench_common.h"
+
+extern "C" {
+    int alt_sig_host_init(void);
+    int alt_sig_cmd_run(const char *name, int argc, const char** argv, int *result);
+}
+
+typedef int argv_sig(int, const char **);
+
+static int cmd_lengths(int argc, const char **argv) {
+    int n = 0;
+    for (int i = 0; i < argc; i++) {
+        for (const char *c = argv[i]; *c; c++) n++;
+    }
+    return n;
+}
+
+static void report(const char *label, size_t n, double us, int sink) {
+    printf("  %-10s %8.2f ms  %7.1f ns/call%s\n", label, us / 1000.0,
+           us * 1000.0 / static_cast<double>(n), sink == 1 ? " " : "");
+}
+
+template <typename F>
+static void run(const char *label, size_t calls, F f) {
+    int sink = 0;
+    double t0 = bench_now_us();
+    for (size_t i = 0; i < calls; i++) sink += f();
+    report(label, calls, bench_now_us() - t0, sink);
+}
+
+int main(int argc, char *argv[]) {
+    size_t calls = (argc > 2) ? static_cast<size_t>(std::atol(argv[2])) : 2000000;
+    if (calls < 1) calls = 1;
+
+    alt_sig_host_init();
+    bu_plugin_cmd_register("lengths", cmd_lengths);
+    bu_plugin_cmd_handle h = bu_plugin_cmd_lookup("lengths");
+    bu_plugin::cmd<argv_sig> c(h);
+    int (*volatile fn)(int, const char **) = cmd_lengths;
+    const char *args[] = { "ab", "cde", "f" };
+
+    printf("========================================\n");
+    printf("  Run Wrapper Benchmark (%zu calls)\n", calls);
+    printf("========================================\n");
+    run("alt_sig", calls, [&]() { int r = 0; alt_sig_cmd_run("lengths", 3, args, &r); return r; });
+    run("by name", calls, [&]() { return bu_plugin::invoke<argv_sig>("lengths", 3, args); });
+    run("handle", calls, [&]() { return bu_plugin::invoke<argv_sig>(h, 3, args); });
+    run("cmd", calls, [&]() { return bu_plugin::invoke(c, 3, args); });
+    bu_plugin_cmd_set_flags("lengths", BU_PLUGIN_CMD_NOEXCEPT);
+    run("noexcept", calls, [&]() { return bu_plugin::invoke(c, 3, args); });
+    run("unchecked", calls, [&]() { return bu_plugin::invoke<argv_sig, bu_plugin::unchecked>(c, 3, args); });
+    run("direct", calls, [&]() { return fn(3, args); });
+    return 0;
+}
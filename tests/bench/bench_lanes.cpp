@@ -0,0 +1,149 @@
+/**
+ * bench_lanes.cpp - Interactive latency under a bulk flood, with and without lanes.
+ *
+ * A producer thread keeps the executor flooded with bulk commands that each
+ * spin for 200 us while the main thread submits a 5 us interactive command
+ * every millisecond and measures submit-to-completion latency. Two runs:
+ *   - no lanes: everything through bu_plugin_cmd_submit() (the normal lane,
+ *               unbounded), so interactive commands queue behind the flood
+ *   - lanes:    bulk commands in BU_PLUGIN_LANE_BULK, bounded with
+ *               BU_PLUGIN_ADMIT_BLOCK and limited to workers - 1 running;
+ *               interactive commands in BU_PLUGIN_LANE_INTERACTIVE
+ *
+ * Usage: bench_lanes [build_dir] [duration_ms] [workers]
+ *   workers defaults to the hardware concurrency
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "bu_plugin.h"
+#include "bench_common.h"
+
+static const int BULK_US = 200;
+static const int INTERACTIVE_US = 5;
+static const long FLOOD = 4000;          /* Bulk commands kept outstanding without lanes */
+
+static std::atomic<long> s_bulk_done(0);
+
+static void spin(int us) {
+    auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(us);
+    while (std::chrono::steady_clock::now() < end) {}
+}
+
+static int bulk_cmd() {
+    spin(BULK_US);
+    return 0;
+}
+
+static int interactive_cmd() {
+    spin(INTERACTIVE_US);
+    return 0;
+}
+
+static void bulk_done(int, int, void *) {
+    s_bulk_done.fetch_add(1, std::memory_order_relaxed);
+}
+
+/* One interactive request: submit time in, latency out */
+struct Sample {
+    double submitted;
+    std::atomic<double> latency{-1.0};
+};
+
+static void interactive_done(int status, int, void *user) {
+    Sample *s = static_cast<Sample *>(user);
+    if (status == 0) s->latency = bench_now_us() - s->submitted;
+}
+
+static void print_stats(const char *label, int lane) {
+    bu_plugin_lane_stats st = bu_plugin_lane_stats();
+    st.struct_size = sizeof(st);
+    bu_plugin_lane_get_stats(lane, &st);
+    printf("    %-12s completed %8llu  max depth %6zu  wait p50 %9.1f  p99 %9.1f  max %9.1f us\n",
+           label, st.completed, st.max_depth, st.wait_p50_us, st.wait_p99_us, st.wait_max_us);
+}
+
+/* Flood for duration_ms while sampling interactive latency */
+static void run(const char *label, bool lanes, unsigned int workers, int duration_ms) {
+    bu_plugin_cmd_handle bulk = bu_plugin_cmd_lookup("lane_bulk");
+    bu_plugin_cmd_handle interactive = bu_plugin_cmd_lookup("lane_interactive");
+    for (int lane = 0; lane < BU_PLUGIN_LANE_COUNT; lane++) bu_plugin_lane_reset_stats(lane);
+    s_bulk_done = 0;
+
+    bu_plugin_exec_start(workers);
+    std::atomic<bool> stop(false);
+    std::thread producer([&]() {
+        long submitted = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            if (lanes) {
+                /* The lane's capacity does the throttling */
+                if (bu_plugin_cmd_submit_lane(bulk, BU_PLUGIN_LANE_BULK, bulk_done, nullptr) == 0) submitted++;
+            } else if (submitted - s_bulk_done.load(std::memory_order_relaxed) < FLOOD) {
+                if (bu_plugin_cmd_submit(bulk, bulk_done, nullptr) == 0) submitted++;
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+    });
+
+    std::vector<Sample> samples(static_cast<size_t>(duration_ms));
+    double t0 = bench_now_us();
+    for (size_t i = 0; i < samples.size(); i++) {
+        double due = t0 + 1000.0 * static_cast<double>(i);
+        while (bench_now_us() < due) std::this_thread::sleep_for(std::chrono::microseconds(50));
+        samples[i].submitted = bench_now_us();
+        if (lanes) {
+            bu_plugin_cmd_submit_lane(interactive, BU_PLUGIN_LANE_INTERACTIVE, interactive_done, &samples[i]);
+        } else {
+            bu_plugin_cmd_submit(interactive, interactive_done, &samples[i]);
+        }
+    }
+    double elapsed = bench_now_us() - t0;
+    long bulk_in_window = s_bulk_done.load();
+    stop = true;
+    producer.join();
+    bu_plugin_exec_drain();
+    bu_plugin_exec_stop();
+
+    std::vector<double> latencies;
+    for (const Sample &s : samples) {
+        if (s.latency.load() >= 0.0) latencies.push_back(s.latency.load());
+    }
+    bench_report(label, latencies);
+    printf("    bulk throughput %.0f commands/s\n", static_cast<double>(bulk_in_window) / (elapsed / 1e6));
+    if (lanes) {
+        print_stats("interactive", BU_PLUGIN_LANE_INTERACTIVE);
+        print_stats("bulk", BU_PLUGIN_LANE_BULK);
+    } else {
+        print_stats("normal", BU_PLUGIN_LANE_NORMAL);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int duration_ms = (argc > 2) ? std::atoi(argv[2]) : 2000;
+    unsigned int workers = (argc > 3) ? static_cast<unsigned int>(std::atoi(argv[3])) : std::thread::hardware_concurrency();
+    if (duration_ms < 1) duration_ms = 1;
+    if (workers == 0) workers = 1;
+
+    bu_plugin_init();
+    bu_plugin_cmd_register("lane_bulk", bulk_cmd);
+    bu_plugin_cmd_register("lane_interactive", interactive_cmd);
+    bu_plugin_cmd_set_flags("lane_bulk", BU_PLUGIN_CMD_THREADSAFE);
+    bu_plugin_cmd_set_flags("lane_interactive", BU_PLUGIN_CMD_THREADSAFE);
+
+    printf("========================================\n");
+    printf("  Priority Lane Benchmark (%d ms, %d us bulk flood, %d us interactive every 1 ms, %u worker(s))\n",
+           duration_ms, BULK_US, INTERACTIVE_US, workers);
+    printf("========================================\n");
+
+    run("no lanes: interactive", false, workers, duration_ms);
+
+    bu_plugin_lane_config bulk_cfg = { sizeof(bu_plugin_lane_config), 64, (workers > 1) ? workers - 1 : 1, BU_PLUGIN_ADMIT_BLOCK };
+    bu_plugin_lane_configure(BU_PLUGIN_LANE_BULK, &bulk_cfg);
+    run("lanes: interactive", true, workers, duration_ms);
+    return 0;
+}
@@ -0,0 +1,143 @@
+/**
+ * bench_line.cpp - Parsing and dispatching command lines, argc/argv signature.
+ *
+ * Each iteration turns a command line into a call of a registered
+ * int (*)(int argc, const char **argv) command:
+ *   - naive:     split into a std::vector<std::string> (same quoting rules),
+ *                build a std::vector<const char *> argv, look the command up
+ *                by name and call it, as hosts typically do
+ *   - run_line:  bu_plugin_cmd_run_line(), which splits a per-thread copy
+ *                of the line in place and builds argv in a per-thread array
+ * Allocations are counted by replacing the global operator new, so the
+ * allocations per call of each path are reported next to the latency.
+ *
+ * Usage: bench_line [build_dir] [calls]
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#define BU_PLUGIN_CMD_RET int
+#define BU_PLUGIN_CMD_ARGS int argc, const char** argv
+#define BU_PLUGIN_CMD_ARGV_SIGNATURE
+#include "bu_plugin.h"
+#include "bench_common.h"
+
+extern "C" int alt_sig_host_init(void);
+
+static std::atomic<size_t> g_allocs(0);
+
+void *operator new(size_t size) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    void *p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+/* Touches every argument, so both paths hand over usable argv */
+static int cmd_reverse(int argc, const char **argv) {
+    int n = 0;
+    for (int i = argc - 1; i >= 0; i--) {
+        for (const char *c = argv[i]; *c; c++) n += (*c != ' ');
+    }
+    return n;
+}
+
+/* The usual host-side splitter: a std::string per word */
+static bool naive_split(const std::string &line, std::vector<std::string> &words) {
+    words.clear();
+    size_t i = 0, n = line.size();
+    while (i < n) {
+        while (i < n && (line[i] == ' ' || line[i] == '\t')) i++;
+        if (i == n || line[i] == '#') break;
+        std::string w;
+        while (i < n && line[i] != ' ' && line[i] != '\t') {
+            char c = line[i++];
+            if (c == '\'' || c == '"') {
+                while (i < n && line[i] != c) {
+                    if (c == '"' && line[i] == '\\' && i + 1 < n) i++;
+                    w += line[i++];
+                }
+                if (i++ == n) return false;
+            } else if (c == '\\' && i < n) {
+                w += line[i++];
+            } else {
+                w += c;
+            }
+        }
+        words.push_back(w);
+    }
+    return !words.empty();
+}
+
+static int naive_run(const std::string &line, int *result) {
+    std::vector<std::string> words;
+    if (!naive_split(line, words)) return -1;
+    std::vector<const char *> argv;
+    for (size_t i = 1; i < words.size(); i++) argv.push_back(words[i].c_str());
+    argv.push_back(nullptr);
+    bu_plugin_cmd_impl fn = bu_plugin_cmd_get(words[0].c_str());
+    if (!fn) return -1;
+    try {
+        *result = fn(static_cast<int>(words.size() - 1), argv.data());
+        return 0;
+    } catch (...) {
+        return -2;
+    }
+}
+
+template <typename Run>
+static void time_path(const char *label, const char *line, int calls, Run run) {
+    std::vector<double> samples;
+    samples.reserve(static_cast<size_t>(calls));
+    int result = 0, expect = 0;
+    run(line, &expect);    /* Warm up: let reusable buffers grow */
+    size_t allocs = g_allocs.load(std::memory_order_relaxed);
+    for (int i = 0; i < calls; i++) {
+        double t0 = bench_now_us();
+        int status = run(line, &result);
+        samples.push_back(bench_now_us() - t0);
+        if (status != 0 || result != expect) {
+            fprintf(stderr, "%s failed (status %d)\n", label, status);
+            return;
+        }
+    }
+    /* samples.push_back never reallocates after the reserve */
+    allocs = g_allocs.load(std::memory_order_relaxed) - allocs;
+    char row[64];
+    snprintf(row, sizeof(row), "%s, %.1f allocs", label, static_cast<double>(allocs) / calls);
+    bench_report(row, samples);
+}
+
+int main(int argc, char *argv[]) {
+    int calls = (argc > 2) ? std::atoi(argv[2]) : 200000;
+    if (calls < 1) calls = 1;
+    if (alt_sig_host_init() != 0) return 1;
+    bu_plugin_cmd_register("reverse", cmd_reverse);
+
+    const char *lines[] = {
+        "reverse abc def",
+        "reverse 'a quoted argument' \"another \\\"one\\\"\" plain\\ word alpha beta gamma delta epsilon",
+    };
+    printf("========================================\n");
+    printf("  Command Line Benchmark (%d calls per row)\n", calls);
+    printf("========================================\n");
+    for (const char *line : lines) {
+        printf("\n  %s\n", line);
+        time_path("naive split", line, calls, [](const char *l, int *r) { return naive_run(l, r); });
+        time_path("run_line", line, calls, [](const char *l, int *r) { return bu_plugin_cmd_run_line(l, r); });
+    }
+    return 0;
+}
@@ -0,0 +1,131 @@
+/**
+ * bench_memo.cpp - Result cache hit path for commands flagged pure.
+ *
+ *   - large:   the large plugin's 500 trivial commands, flagged pure and
+ *              invoked round-robin through handles, with the cache off
+ *              and on; shows what a hit costs next to a call that does
+ *              nothing
+ *   - costly:  a built-in command doing about a microsecond of arithmetic,
+ *              cache off and on
+ *   - args:    bu_plugin_memo_lookup() with 32-byte argument keys, the
+ *              path a run wrapper for a custom signature takes
+ *
+ * The costly hit path then runs on 1..N threads; the cache's shards keep
+ * threads hitting different keys off each other's locks.
+ *
+ * Usage: bench_memo [build_dir] [calls] [max_threads]
+ *   max_threads defaults to the hardware concurrency
+ */
+
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bu_plugin.h"
+#include "bench_common.h"
+
+static int costly() {
+    uint32_t h = 2166136261u;
+    for (uint32_t i = 0; i < 1000; i++) h = (h ^ i) * 16777619u;
+    return static_cast<int>(h & 0x7fffffff);
+}
+
+static void report(const char *label, const char *mode, size_t n, double us) {
+    printf("  %-8s %-10s %8.2f ms  %7.1f ns/call\n", label, mode, us / 1000.0,
+           us * 1000.0 / static_cast<double>(n));
+}
+
+static double invoke_all(const std::vector<bu_plugin_cmd_handle> &hs, size_t calls) {
+    int sink = 0;
+    double t0 = bench_now_us();
+    for (size_t i = 0; i < calls; i++) {
+        int r = 0;
+        bu_plugin_cmd_invoke(hs[i % hs.size()], &r);
+        sink += r;
+    }
+    double us = bench_now_us() - t0;
+    if (sink == 1) printf(" ");
+    return us;
+}
+
+static void run_threads(bu_plugin_cmd_handle h, unsigned int threads, size_t calls) {
+    double t0 = bench_now_us();
+    std::vector<std::thread> pool;
+    for (unsigned int t = 0; t < threads; t++) {
+        pool.emplace_back([h, calls]() {
+            for (size_t i = 0; i < calls; i++) bu_plugin_cmd_invoke(h, nullptr);
+        });
+    }
+    for (auto &t : pool) t.join();
+    double us = bench_now_us() - t0;
+    size_t n = calls * threads;
+    printf("  costly   hit       %3u thread(s)  %7.1f ns/call  %10.0f calls/s\n", threads,
+           us * 1000.0 / static_cast<double>(n), static_cast<double>(n) / (us / 1e6));
+}
+
+int main(int argc, char *argv[]) {
+    const char *build_dir = (argc > 1) ? argv[1] : ".";
+    size_t calls = (argc > 2) ? static_cast<size_t>(std::atol(argv[2])) : 2000000;
+    unsigned int max_threads = (argc > 3) ? static_cast<unsigned int>(std::atoi(argv[3])) : std::thread::hardware_concurrency();
+    if (calls < 1) calls = 1;
+    if (max_threads < 1) max_threads = 1;
+
+    bu_plugin_init();
+    std::string path = bench_plugin_path(build_dir, "tests/plugin/large_plugin", "bu-large-plugin");
+    if (bu_plugin_load(path.c_str()) != 500) {
+        fprintf(stderr, "Failed to load %s\n", path.c_str());
+        return 1;
+    }
+    std::vector<bu_plugin_cmd_handle> large;
+    for (int i = 0; i < 500; i++) {
+        std::string name = "large_" + std::to_string(i);
+        bu_plugin_cmd_set_flags(name.c_str(), BU_PLUGIN_CMD_PURE);
+        large.push_back(bu_plugin_cmd_lookup(name.c_str()));
+    }
+    bu_plugin_cmd_register("costly", costly);
+    bu_plugin_cmd_set_flags("costly", BU_PLUGIN_CMD_PURE | BU_PLUGIN_CMD_THREADSAFE);
+    std::vector<bu_plugin_cmd_handle> one(1, bu_plugin_cmd_lookup("costly"));
+
+    printf("========================================\n");
+    printf("  Result Cache Benchmark (%zu calls)\n", calls);
+    printf("========================================\n");
+    bu_plugin_memo_set_capacity(0);
+    report("large", "uncached", calls, invoke_all(large, calls));
+    report("costly", "uncached", calls / 16, invoke_all(one, calls / 16));
+
+    bu_plugin_memo_set_capacity(4096);
+    invoke_all(large, large.size());
+    invoke_all(one, 1);
+    report("large", "hit", calls, invoke_all(large, calls));
+    report("costly", "hit", calls, invoke_all(one, calls));
+
+    /* Custom-signature wrappers: 32-byte argument keys, 1000 distinct */
+    std::vector<std::string> keys;
+    for (int i = 0; i < 1000; i++) {
+        char buf[33];
+        snprintf(buf, sizeof(buf), "%-31d", i);
+        keys.push_back(std::string(buf, 32));
+        bu_plugin_memo_token token = 0;
+        bu_plugin_memo_lookup(one[0], keys.back().data(), 32, nullptr, &token);
+        bu_plugin_memo_store(one[0], keys.back().data(), 32, &i, token);
+    }
+    int sink = 0;
+    double t0 = bench_now_us();
+    for (size_t i = 0; i < calls; i++) {
+        int r = 0;
+        const std::string &k = keys[i % keys.size()];
+        if (bu_plugin_memo_lookup(one[0], k.data(), k.size(), &r, nullptr)) sink += r;
+    }
+    report("args", "hit", calls, bench_now_us() - t0);
+
+    printf("\n");
+    for (unsigned int t = 1; t <= max_threads; t *= 2) run_threads(one[0], t, calls / t);
+
+    bu_plugin_memo_stats st;
+    st.struct_size = sizeof(st);
+    bu_plugin_memo_get_stats(&st);
+    printf("\n  %llu hits, %llu misses, %zu of %zu entries used\n", st.hits, st.misses, st.entries, st.capacity);
+    return sink == 0 ? 1 : 0;
+}
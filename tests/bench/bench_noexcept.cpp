@@ -0,0 +1,104 @@
+/**
+ * bench_noexcept.cpp - Dispatch cost of the exception frame.
+ *
+ *   - large:   the large plugin's 500 trivial commands invoked round-robin
+ *              through handles, unflagged (inside guarded_call's try block)
+ *              and flagged BU_PLUGIN_CMD_NOEXCEPT (called directly)
+ *   - c_only:  the C-only plugin's c_only_hello run by name, with its
+ *              manifest's noexcept flag cleared and restored; its output
+ *              is discarded
+ *
+ * Build the tree a second time with -DBU_PLUGIN_NO_EXCEPTIONS=ON to compare
+ * against a host that has no try blocks at all.
+ *
+ * Usage: bench_noexcept [build_dir] [calls]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "bu_plugin.h"
+#include "bench_common.h"
+
+static void report(const char *label, const char *mode, size_t n, double us) {
+    printf("  %-8s %-10s %8.2f ms  %7.1f ns/call\n", label, mode, us / 1000.0,
+           us * 1000.0 / static_cast<double>(n));
+}
+
+static double invoke_all(const std::vector<bu_plugin_cmd_handle> &hs, size_t calls) {
+    int sink = 0;
+    double t0 = bench_now_us();
+    for (size_t i = 0; i < calls; i++) {
+        int r = 0;
+        bu_plugin_cmd_invoke(hs[i % hs.size()], &r);
+        sink += r;
+    }
+    double us = bench_now_us() - t0;
+    if (sink == 1) printf(" ");
+    return us;
+}
+
+static double run_by_name(const char *name, size_t calls) {
+    int sink = 0;
+    double t0 = bench_now_us();
+    for (size_t i = 0; i < calls; i++) {
+        int r = 0;
+        bu_plugin_cmd_run(name, &r);
+        sink += r;
+    }
+    double us = bench_now_us() - t0;
+    if (sink == 1) printf(" ");
+    return us;
+}
+
+static void set_all(const std::vector<std::string> &names, unsigned int flags) {
+    for (const std::string &n : names) bu_plugin_cmd_set_flags(n.c_str(), flags);
+}
+
+int main(int argc, char *argv[]) {
+    const char *build_dir = (argc > 1) ? argv[1] : ".";
+    size_t calls = (argc > 2) ? static_cast<size_t>(std::atol(argv[2])) : 2000000;
+    if (calls < 1) calls = 1;
+
+    bu_plugin_init();
+    bu_plugin_set_output_writer(bu_plugin_output_discard, nullptr);
+    std::string path = bench_plugin_path(build_dir, "tests/plugin/large_plugin", "bu-large-plugin");
+    if (bu_plugin_load(path.c_str()) != 500) {
+        fprintf(stderr, "Failed to load %s\n", path.c_str());
+        return 1;
+    }
+    path = bench_plugin_path(build_dir, "tests/plugin/c_only", "bu-c-only-plugin");
+    if (bu_plugin_load(path.c_str()) != 2) {
+        fprintf(stderr, "Failed to load %s\n", path.c_str());
+        return 1;
+    }
+    std::vector<std::string> names;
+    std::vector<bu_plugin_cmd_handle> large;
+    for (int i = 0; i < 500; i++) {
+        names.push_back("large_" + std::to_string(i));
+        large.push_back(bu_plugin_cmd_lookup(names.back().c_str()));
+    }
+
+    printf("========================================\n");
+#ifdef BU_PLUGIN_HOST_NO_EXCEPTIONS
+    printf("  Noexcept Dispatch Benchmark (%zu calls, host without exceptions)\n", calls);
+#else
+    printf("  Noexcept Dispatch Benchmark (%zu calls)\n", calls);
+#endif
+    printf("========================================\n");
+    /* Alternate the modes so frequency drift hits both */
+    for (int round = 0; round < 2; round++) {
+        set_all(names, 0);
+        report("large", "guarded", calls, invoke_all(large, calls));
+        set_all(names, BU_PLUGIN_CMD_NOEXCEPT);
+        report("large", "noexcept", calls, invoke_all(large, calls));
+    }
+    for (int round = 0; round < 2; round++) {
+        bu_plugin_cmd_set_flags("c_only_hello", 0);
+        report("c_only", "guarded", calls / 4, run_by_name("c_only_hello", calls / 4));
+        bu_plugin_cmd_set_flags("c_only_hello", BU_PLUGIN_CMD_NOEXCEPT);
+        report("c_only", "noexcept", calls / 4, run_by_name("c_only_hello", calls / 4));
+    }
+    return 0;
+}
@@ -0,0 +1,98 @@
+/**
+ * bench_oop.cpp - Call latency of an in-process vs an out-of-process plugin.
+ *
+ * math_add from tests/plugin/math_plugin is called through its handle:
+ *   - in-process:     loaded normally, a direct call
+ *   - pooled, hot:    loaded with BU_PLUGIN_LOAD_OUT_OF_PROCESS, calls back
+ *                     to back, so the worker is still spinning on its ring
+ *   - pooled, idle:   the same with a pause between calls long enough for
+ *                     the worker to fall asleep, so every call pays a
+ *                     futex wake
+ * The command's printf goes to /dev/null (in the workers too, which inherit
+ * the redirected stdout), so it costs the same on both sides.
+ *
+ * Usage: bench_oop [build_dir] [calls] [workers]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "bu_plugin.h"
+#include "bench_common.h"
+
+static std::vector<double> time_calls(bu_plugin_cmd_handle h, int calls, int gap_us) {
+    std::vector<double> samples;
+    samples.reserve(static_cast<size_t>(calls));
+    int result = 0;
+    for (int i = 0; i < calls; i++) {
+        if (gap_us) std::this_thread::sleep_for(std::chrono::microseconds(gap_us));
+        double t0 = bench_now_us();
+        int status = bu_plugin_cmd_invoke(h, &result);
+        samples.push_back(bench_now_us() - t0);
+        if (status != 0 || result != 5) {
+            fprintf(stderr, "math_add failed (status %d, result %d)\n", status, result);
+            break;
+        }
+    }
+    return samples;
+}
+
+int main(int argc, char *argv[]) {
+    const char *build_dir = (argc > 1) ? argv[1] : ".";
+    int calls = (argc > 2) ? std::atoi(argv[2]) : 100000;
+    unsigned int workers = (argc > 3) ? static_cast<unsigned int>(std::atoi(argv[3])) : 1;
+    if (calls < 1) calls = 1;
+    std::string path = bench_plugin_path(build_dir, "tests/plugin/math_plugin", "bu-math-plugin");
+
+    printf("========================================\n");
+    printf("  Out-of-Process Call Benchmark (%d calls of math_add, %u worker(s))\n", calls, workers);
+    printf("========================================\n");
+    fflush(stdout);
+
+    /* Keep the command's output off the terminal */
+    int saved_stdout = dup(STDOUT_FILENO);
+    int devnull = open("/dev/null", O_WRONLY);
+    dup2(devnull, STDOUT_FILENO);
+    close(devnull);
+
+    bu_plugin_init();
+    std::vector<double> local, hot, idle;
+    if (bu_plugin_load(path.c_str()) == 3) {
+        local = time_calls(bu_plugin_cmd_lookup("math_add"), calls, 0);
+    }
+    bu_plugin_shutdown();
+
+    bu_plugin_load_opts opts = bu_plugin_load_opts();
+    opts.struct_size = sizeof(opts);
+    opts.flags = BU_PLUGIN_LOAD_OUT_OF_PROCESS;
+    double start_us = bench_now_us();
+    bool pooled = bu_plugin_worker_pool_start(workers) == 0;
+    start_us = bench_now_us() - start_us;
+    double load_us = bench_now_us();
+    pooled = pooled && bu_plugin_load_ex(path.c_str(), &opts) == 3;
+    load_us = bench_now_us() - load_us;
+    if (pooled) {
+        bu_plugin_cmd_handle h = bu_plugin_cmd_lookup("math_add");
+        hot = time_calls(h, calls, 0);
+        idle = time_calls(h, std::min(calls, 2000), 2000);
+    }
+    bu_plugin_shutdown();
+
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+    if (local.empty() || !pooled) {
+        fprintf(stderr, "Cannot load %s\n", path.c_str());
+        return 1;
+    }
+    printf("  pool start %.0f us, pooled load %.0f us\n", start_us, load_us);
+    bench_report("in-process", local);
+    bench_report("pooled, hot", hot);
+    bench_report("pooled, idle (2 ms gaps)", idle);
+    return 0;
+}
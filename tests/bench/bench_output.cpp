@@ -0,0 +1,117 @@
+/**
+ * bench_output.cpp - Command output through stdio against the output sink.
+ *
+ * The command upper-cases a fixed set of words one character at a time,
+ * the way the reference string commands did with printf("%c"):
+ *   - stdio:   every piece is an fprintf() to a shared FILE, taking the
+ *              stdio lock each time; concurrent lines interleave
+ *   - sink:    every piece goes through bu_plugin_output_write/printf into
+ *              the invocation's buffer, which the writer hands to the same
+ *              FILE with one fwrite() per invocation
+ *   - discard: the sink with bu_plugin_output_discard as the writer
+ *
+ * Output goes to the null device so the numbers measure dispatch and
+ * locking, not the terminal. Each thread count runs every variant.
+ *
+ * Usage: bench_output [build_dir] [calls_per_thread] [max_threads]
+ *   max_threads defaults to the hardware concurrency
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bu_plugin.h"
+#include "bench_common.h"
+
+static FILE *s_null = nullptr;
+static const char *const s_words[] = { "alpha", "bravo", "charlie", "delta", "echo", "foxtrot" };
+
+static char upper(char c) {
+    return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+static int upper_stdio() {
+    fprintf(s_null, "upper:");
+    for (const char *w : s_words) {
+        fprintf(s_null, " ");
+        for (const char *p = w; *p; p++) fprintf(s_null, "%c", upper(*p));
+    }
+    fprintf(s_null, "\n");
+    return 0;
+}
+
+static int upper_sink() {
+    bu_plugin_output_printf("upper:");
+    for (const char *w : s_words) {
+        bu_plugin_output_write(" ", 1);
+        for (const char *p = w; *p; p++) {
+            char c = upper(*p);
+            bu_plugin_output_write(&c, 1);
+        }
+    }
+    bu_plugin_output_write("\n", 1);
+    return 0;
+}
+
+static void write_null(void *, const char *data, size_t len) {
+    fwrite(data, 1, len, s_null);
+}
+
+/* Run name calls times on each of threads threads; returns the wall time in us */
+static double run(const char *name, unsigned int threads, size_t calls) {
+    bu_plugin_cmd_handle h = bu_plugin_cmd_lookup(name);
+    double t0 = bench_now_us();
+    std::vector<std::thread> pool;
+    for (unsigned int t = 0; t < threads; t++) {
+        pool.emplace_back([h, calls]() {
+            for (size_t i = 0; i < calls; i++) bu_plugin_cmd_invoke(h, nullptr);
+        });
+    }
+    for (auto &t : pool) t.join();
+    return bench_now_us() - t0;
+}
+
+static void report(const char *label, unsigned int threads, size_t n, double us) {
+    printf("  %-8s %3u thread(s)  %8.2f ms  %7.1f ns/call  %10.0f calls/s\n",
+           label, threads, us / 1000.0, us * 1000.0 / static_cast<double>(n),
+           static_cast<double>(n) / (us / 1e6));
+}
+
+int main(int argc, char *argv[]) {
+    size_t calls = (argc > 2) ? static_cast<size_t>(std::atol(argv[2])) : 200000;
+    if (calls < 1) calls = 1;
+    unsigned int hw = (argc > 3) ? static_cast<unsigned int>(std::atoi(argv[3])) : std::thread::hardware_concurrency();
+    if (hw == 0) hw = 1;
+
+#if defined(_WIN32)
+    s_null = fopen("NUL", "w");
+#else
+    s_null = fopen("/dev/null", "w");
+#endif
+    if (!s_null) {
+        fprintf(stderr, "Cannot open the null device\n");
+        return 1;
+    }
+    bu_plugin_init();
+    bu_plugin_cmd_register("upper_stdio", upper_stdio);
+    bu_plugin_cmd_register("upper_sink", upper_sink);
+
+    printf("========================================\n");
+    printf("  Command Output Benchmark (%zu calls per thread)\n", calls);
+    printf("========================================\n");
+
+    for (unsigned int threads = 1; ; threads = (threads * 2 < hw) ? threads * 2 : hw) {
+        size_t n = calls * threads;
+        report("stdio", threads, n, run("upper_stdio", threads, calls));
+        bu_plugin_set_output_writer(write_null, nullptr);
+        report("sink", threads, n, run("upper_sink", threads, calls));
+        bu_plugin_set_output_writer(bu_plugin_output_discard, nullptr);
+        report("discard", threads, n, run("upper_sink", threads, calls));
+        bu_plugin_set_output_writer(nullptr, nullptr);
+        if (threads == hw) break;
+    }
+    fclose(s_null);
+    return 0;
+}
@@ -0,0 +1,131 @@
+/**
+ * bench_pipeline.cpp - Record channel throughput.
+ *
+ *   - pipeline: stream_draw | stream_render | stream_volume from the
+ *               stream plugin, three stages on three threads moving
+ *               segments and samples through two channels, for several
+ *               ring capacities
+ *   - handoff:  one producer and one consumer thread moving int records
+ *               through a single channel one record at a time
+ *               (push/pop) and in runs (reserve/peek)
+ *
+ * Reports records per second through the whole pipeline and how often
+ * either end of the middle links had to wait.
+ *
+ * Usage: bench_pipeline [build_dir] [records]
+ */
+
+#include <cstdio>
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bu_plugin.h"
+#include "bench_common.h"
+#include "../plugin/stream_plugin/stream_records.h"
+
+static void report(const char *label, size_t capacity, size_t n, double us) {
+    printf("  %-10s capacity %6zu  %8.2f ms  %7.1f ns/record  %6.1f M records/s\n",
+           label, capacity, us / 1000.0, us * 1000.0 / static_cast<double>(n),
+           static_cast<double>(n) / us);
+}
+
+static unsigned long long waits(const bu_plugin_channel *ch) {
+    bu_plugin_channel_stats st;
+    st.struct_size = sizeof(st);
+    bu_plugin_channel_get_stats(ch, &st);
+    return st.producer_waits + st.consumer_waits;
+}
+
+static bool run_pipeline(size_t records, size_t capacity) {
+    bu_plugin_channel *links[4] = {
+        bu_plugin_channel_create(STREAM_JOB_TYPE, sizeof(stream_job), 64),
+        bu_plugin_channel_create(STREAM_SEGMENT_TYPE, sizeof(stream_segment), capacity),
+        bu_plugin_channel_create(STREAM_SAMPLE_TYPE, sizeof(stream_sample), capacity),
+        nullptr
+    };
+    const uint32_t per_job = 1000000;
+    size_t jobs = (records + per_job - 1) / per_job;
+    for (size_t j = 0; j < jobs; j++) {
+        stream_job job = { static_cast<uint32_t>(std::min<size_t>(per_job, records - j * per_job)), static_cast<uint32_t>(j + 1) };
+        bu_plugin_channel_push(links[0], &job);
+    }
+    bu_plugin_channel_close(links[0]);
+
+    const char *stages[] = { "stream_draw", "stream_render", "stream_volume" };
+    int results[3] = { 0, 0, 0 };
+    double t0 = bench_now_us();
+    int failed = bu_plugin_pipeline_run(stages, 3, links, results, nullptr);
+    double us = bench_now_us() - t0;
+    report("pipeline", capacity, records, us);
+    printf("             waits: segments %llu, samples %llu\n", waits(links[1]), waits(links[2]));
+    for (bu_plugin_channel *l : links) bu_plugin_channel_destroy(l);
+    return failed == 0 && results[2] == static_cast<int>(records);
+}
+
+static void run_handoff(size_t records, size_t capacity, bool runs) {
+    bu_plugin_channel *ch = bu_plugin_channel_create("int", sizeof(int), capacity);
+    double t0 = bench_now_us();
+    std::thread producer([ch, records, runs]() {
+        size_t sent = 0;
+        while (sent < records) {
+            if (runs) {
+                size_t got = 0;
+                int *slot = static_cast<int *>(bu_plugin_channel_reserve(ch, std::min<size_t>(256, records - sent), &got));
+                if (!slot) break;
+                for (size_t i = 0; i < got; i++) slot[i] = static_cast<int>(sent + i);
+                bu_plugin_channel_commit(ch, got);
+                sent += got;
+            } else {
+                int v = static_cast<int>(sent++);
+                bu_plugin_channel_push(ch, &v);
+            }
+        }
+        bu_plugin_channel_close(ch);
+    });
+    long long sum = 0;
+    if (runs) {
+        size_t got = 0;
+        while (const int *r = static_cast<const int *>(bu_plugin_channel_peek(ch, 256, &got))) {
+            for (size_t i = 0; i < got; i++) sum += r[i];
+            bu_plugin_channel_release(ch, got);
+        }
+    } else {
+        int v = 0;
+        while (bu_plugin_channel_pop(ch, &v) == 1) sum += v;
+    }
+    producer.join();
+    double us = bench_now_us() - t0;
+    report(runs ? "runs" : "push/pop", capacity, records, us);
+    if (sum != static_cast<long long>(records) * static_cast<long long>(records - 1) / 2) fprintf(stderr, "  checksum mismatch\n");
+    bu_plugin_channel_destroy(ch);
+}
+
+int main(int argc, char *argv[]) {
+    const char *build_dir = (argc > 1) ? argv[1] : ".";
+    size_t records = (argc > 2) ? static_cast<size_t>(std::atol(argv[2])) : 10000000;
+    if (records < 1) records = 1;
+
+    bu_plugin_init();
+    bu_plugin_set_output_writer(bu_plugin_output_discard, nullptr);
+    std::string path = bench_plugin_path(build_dir, "tests/plugin/stream_plugin", "bu-stream-plugin");
+    if (bu_plugin_load(path.c_str()) < 0) {
+        fprintf(stderr, "Failed to load %s\n", path.c_str());
+        return 1;
+    }
+
+    printf("========================================\n");
+    printf("  Record Channel Benchmark (%zu records)\n", records);
+    printf("========================================\n");
+    bool ok = true;
+    const size_t capacities[] = { 64, 1024, 16384 };
+    for (size_t capacity : capacities) ok = run_pipeline(records, capacity) && ok;
+    for (size_t i = 0; i < 2; i++) {
+        size_t capacity = capacities[i];
+        run_handoff(records, capacity, false);
+        run_handoff(records, capacity, true);
+    }
+    if (!ok) fprintf(stderr, "  pipeline lost records\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,191 @@
+/**
+ * bench_prefault.cpp - First-call vs steady-state latency of plugin commands,
+ * loaded plainly, with BU_PLUGIN_LOAD_PREFAULT and with BU_PLUGIN_LOAD_HUGEPAGES.
+ *
+ * Every round loads the plugin in a fresh child process (so its text has no
+ * page table entries yet), calls each of the plugin's commands once to get
+ * the first-call latency, then calls each one repeatedly for the steady-state
+ * latency. The table reports the median over all rounds per command.
+ *
+ * Only the 2 MiB-aligned part of a text segment is moved onto huge pages,
+ * so the huge page columns differ from the prefault ones only for a plugin
+ * with several MiB of text, such as tests/plugin/huge_text_plugin.
+ *
+ * Usage: bench_prefault [build_dir] [plugin_subdir plugin_name] [rounds]
+ *   default plugin: tests/plugin/stress_plugin bu-stress-plugin
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "bu_plugin.h"
+#include "bench_common.h"
+
+extern char **environ;
+
+static const int s_steady_calls = 1000;
+
+static int collect_name(const char *name, bu_plugin_cmd_impl, void *data) {
+    static_cast<std::set<std::string> *>(data)->insert(name);
+    return 0;
+}
+
+static double now_ns() {
+    return bench_now_us() * 1000.0;
+}
+
+/* Child mode: load the plugin with the given flags and write "name first steady" lines to fd 3 */
+static int run_child(unsigned int flags, const char *path) {
+    bu_plugin_init();
+    std::set<std::string> before, after;
+    bu_plugin_cmd_foreach(collect_name, &before);
+    bu_plugin_set_load_flags(flags);
+    if (bu_plugin_load(path) < 0) return 1;
+    bu_plugin_cmd_foreach(collect_name, &after);
+
+    std::vector<std::string> names;
+    std::vector<bu_plugin_cmd_impl> fns;
+    for (const auto &n : after) {
+        if (before.count(n)) continue;
+        names.push_back(n);
+        fns.push_back(bu_plugin_cmd_get(n.c_str()));
+    }
+
+    std::vector<double> first(names.size()), steady(names.size());
+    for (size_t i = 0; i < fns.size(); i++) {
+        double t0 = now_ns();
+        fns[i]();
+        first[i] = now_ns() - t0;
+    }
+    /* Steady state: best of 5 batches, averaged per call so clock overhead drops out */
+    for (size_t i = 0; i < fns.size(); i++) {
+        double best = 0.0;
+        for (int batch = 0; batch < 5; batch++) {
+            double t0 = now_ns();
+            for (int k = 0; k < s_steady_calls; k++) fns[i]();
+            double per_call = (now_ns() - t0) / s_steady_calls;
+            if (batch == 0 || per_call < best) best = per_call;
+        }
+        steady[i] = best;
+    }
+
+    FILE *out = fdopen(3, "w");
+    if (!out) return 1;
+    for (size_t i = 0; i < names.size(); i++) {
+        fprintf(out, "%s %.1f %.1f\n", names[i].c_str(), first[i], steady[i]);
+    }
+    fclose(out);
+    return 0;
+}
+
+/* Load modes: plain, prefaulted, moved onto huge pages (which prefaults too) */
+static const int s_modes = 3;
+static const char *s_mode_names[s_modes] = { "default", "prefault", "hugepages" };
+static const unsigned int s_mode_flags[s_modes] = { 0u, BU_PLUGIN_LOAD_PREFAULT, BU_PLUGIN_LOAD_HUGEPAGES };
+
+struct Samples {
+    std::vector<double> first[s_modes];
+    std::vector<double> steady[s_modes];
+};
+
+static bool run_round(const std::string &exe, const std::string &path, int mode, std::map<std::string, Samples> &results) {
+    int fds[2];
+    if (pipe(fds) != 0) return false;
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addclose(&actions, fds[0]);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], 3);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    std::string flags = std::to_string(mode);
+    std::string p(path);
+    char *args[] = { const_cast<char *>(exe.c_str()), const_cast<char *>("--child"), &flags[0], &p[0], nullptr };
+    pid_t pid = 0;
+    int rc = posix_spawn(&pid, exe.c_str(), &actions, nullptr, args, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+    if (rc != 0) {
+        close(fds[0]);
+        return false;
+    }
+    FILE *in = fdopen(fds[0], "r");
+    char name[256];
+    double first = 0.0, steady = 0.0;
+    int lines = 0;
+    while (in && fscanf(in, "%255s %lf %lf", name, &first, &steady) == 3) {
+        Samples &s = results[name];
+        s.first[mode].push_back(first);
+        s.steady[mode].push_back(steady);
+        lines++;
+    }
+    if (in) fclose(in);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return lines > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static double median(std::vector<double> v) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    return v[v.size() / 2];
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 3 && std::strcmp(argv[1], "--child") == 0) {
+        int mode = std::atoi(argv[2]);
+        if (mode < 0 || mode >= s_modes) return 1;
+        return run_child(s_mode_flags[mode], argv[3]);
+    }
+
+    const char *build_dir = (argc > 1) ? argv[1] : ".";
+    const char *subdir = (argc > 3) ? argv[2] : "tests/plugin/stress_plugin";
+    const char *plugin = (argc > 3) ? argv[3] : "bu-stress-plugin";
+    int rounds = (argc > 4) ? std::atoi(argv[4]) : 25;
+    if (rounds < 1) rounds = 1;
+
+    std::string exe;
+    char buf[4096];
+    ssize_t n = readlink("/proc/self/exe", buf, sizeof(buf) - 1);
+    exe = (n > 0) ? std::string(buf, static_cast<size_t>(n)) : std::string(argv[0]);
+    std::string path = bench_plugin_path(build_dir, subdir, plugin);
+
+    printf("========================================\n");
+    printf("  Prefault Benchmark\n");
+    printf("========================================\n");
+    printf("Plugin: %s, rounds: %d (fresh process each), steady-state batch: %d calls\n\n",
+           path.c_str(), rounds, s_steady_calls);
+
+    std::map<std::string, Samples> results;
+    for (int r = 0; r < rounds; r++) {
+        for (int mode = 0; mode < s_modes; mode++) {
+            if (!run_round(exe, path, mode, results)) {
+                fprintf(stderr, "Round %d (%s) failed\n", r, s_mode_names[mode]);
+                return 1;
+            }
+        }
+    }
+
+    printf("  %-32s %12s %12s %12s %12s %12s %12s\n", "command (median ns)",
+           "first", "first+pf", "first+huge", "steady", "steady+pf", "steady+huge");
+    double sum[2 * s_modes] = { 0.0 };
+    for (const auto &entry : results) {
+        double v[2 * s_modes];
+        for (int m = 0; m < s_modes; m++) {
+            v[m] = median(entry.second.first[m]);
+            v[s_modes + m] = median(entry.second.steady[m]);
+        }
+        printf("  %-32s %12.1f %12.1f %12.1f %12.1f %12.1f %12.1f\n", entry.first.c_str(), v[0], v[1], v[2], v[3], v[4], v[5]);
+        for (int i = 0; i < 2 * s_modes; i++) sum[i] += v[i];
+    }
+    double cmds = static_cast<double>(results.size());
+    printf("  %-32s %12.1f %12.1f %12.1f %12.1f %12.1f %12.1f\n", "mean over commands",
+           sum[0] / cmds, sum[1] / cmds, sum[2] / cmds, sum[3] / cmds, sum[4] / cmds, sum[5] / cmds);
+    return 0;
+}
@@ -0,0 +1,82 @@
+/**
+ * bench_soa.cpp - Batched (structure-of-arrays) entry points against
+ * per-item dispatch.
+ *
+ * Runs soa_hash from the soa plugin items times as:
+ *   - loop:     one bu_plugin_cmd_run() per item
+ *   - scalar:   one bu_plugin_cmd_run_batch() with the batched entry point
+ *               removed, so every item is its own call through the impl
+ *   - batched:  the same batch with the entry point in place, so each run
+ *               of BU_PLUGIN_BATCH_CHUNK items is one call into the plugin
+ *   - parallel: batched, with the executor running, so each worker's range
+ *               is batched separately
+ *
+ * Usage: bench_soa [build_dir] [items] [max_workers]
+ *   max_workers defaults to the hardware concurrency
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bu_plugin.h"
+#include "bench_common.h"
+
+static void report(const char *label, unsigned int workers, size_t n, double us) {
+    printf("  %-10s %3u worker(s)  %8.2f ms  %7.1f ns/item\n",
+           label, workers, us / 1000.0, us * 1000.0 / static_cast<double>(n));
+}
+
+int main(int argc, char *argv[]) {
+    const char *build_dir = (argc > 1) ? argv[1] : ".";
+    size_t total = (argc > 2) ? static_cast<size_t>(std::atol(argv[2])) : 1000000;
+    if (total < 1) total = 1;
+
+    bu_plugin_init();
+    std::string path = bench_plugin_path(build_dir, "tests/plugin/soa_plugin", "bu-soa-plugin");
+    if (bu_plugin_load(path.c_str()) < 0) {
+        fprintf(stderr, "Failed to load %s\n", path.c_str());
+        return 1;
+    }
+    bu_plugin_cmd_batch_impl batch = bu_plugin_cmd_get_batch("soa_hash");
+    std::vector<const char *> names(total, "soa_hash");
+    std::vector<int> results(total);
+    std::vector<int> status(total);
+
+    unsigned int hw = (argc > 3) ? static_cast<unsigned int>(std::atoi(argv[3])) : std::thread::hardware_concurrency();
+    if (hw == 0) hw = 1;
+
+    printf("========================================\n");
+    printf("  Batched Entry Point Benchmark (%zu items)\n", total);
+    printf("========================================\n");
+
+    double t0 = bench_now_us();
+    size_t failed = 0;
+    for (size_t i = 0; i < total; i++) {
+        if (bu_plugin_cmd_run(names[i], &results[i]) != 0) failed++;
+    }
+    report("loop", 0, total, bench_now_us() - t0);
+
+    bu_plugin_cmd_set_batch("soa_hash", nullptr);
+    t0 = bench_now_us();
+    int batch_failed = bu_plugin_cmd_run_batch(names.data(), total, results.data(), status.data());
+    report("scalar", 0, total, bench_now_us() - t0);
+
+    bu_plugin_cmd_set_batch("soa_hash", batch);
+    t0 = bench_now_us();
+    batch_failed += bu_plugin_cmd_run_batch(names.data(), total, results.data(), status.data());
+    report("batched", 0, total, bench_now_us() - t0);
+    if (failed || batch_failed) fprintf(stderr, "  %zu/%d item(s) failed\n", failed, batch_failed);
+
+    for (unsigned int workers = 1; ; workers = (workers * 2 < hw) ? workers * 2 : hw) {
+        bu_plugin_exec_start(workers);
+        t0 = bench_now_us();
+        batch_failed = bu_plugin_cmd_run_batch(names.data(), total, results.data(), status.data());
+        report("parallel", workers, total, bench_now_us() - t0);
+        if (batch_failed) fprintf(stderr, "  %d item(s) failed\n", batch_failed);
+        bu_plugin_exec_stop();
+        if (workers == hw) break;
+    }
+    return 0;
+}
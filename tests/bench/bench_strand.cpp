@@ -0,0 +1,117 @@
+/**
+ * bench_strand.cpp - Mixed serialized/parallel command throughput on the executor.
+ *
+ * A workload of commands that each spin for a few microseconds, of which a
+ * fraction belong to "legacy" plugins that must not run two commands at
+ * once (8 groups), the rest being thread-safe. Three ways to run it:
+ *   - global lock: every command takes one process-wide mutex (the usual
+ *                  fallback when some plugins are not thread-safe)
+ *   - strands:     legacy commands go through their group's strand,
+ *                  thread-safe ones run freely
+ *   - ideal:       nothing is serialized (not safe for the legacy
+ *                  commands; the upper bound)
+ *
+ * Usage: bench_strand [build_dir] [submissions] [workers] [legacy_percent]
+ *   workers defaults to the hardware concurrency, legacy_percent to 25
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bu_plugin.h"
+#include "bench_common.h"
+
+static const int GROUPS = 8;
+static const int SPIN_NS = 5000;
+
+static std::mutex s_global_lock;
+static std::atomic<long> s_done(0);
+
+static int spin() {
+    auto end = std::chrono::steady_clock::now() + std::chrono::nanoseconds(SPIN_NS);
+    while (std::chrono::steady_clock::now() < end) {}
+    return 1;
+}
+
+static int work_cmd() {
+    return spin();
+}
+
+static int locked_cmd() {
+    std::lock_guard<std::mutex> lock(s_global_lock);
+    return spin();
+}
+
+static void count_done(int status, int, void *) {
+    if (status == 0) s_done.fetch_add(1, std::memory_order_relaxed);
+}
+
+/* Submit the workload and wait; returns microseconds */
+static double run(const std::vector<bu_plugin_cmd_handle> &plan) {
+    s_done = 0;
+    double t0 = bench_now_us();
+    for (bu_plugin_cmd_handle h : plan) bu_plugin_cmd_submit(h, count_done, nullptr);
+    bu_plugin_exec_drain();
+    double us = bench_now_us() - t0;
+    if (static_cast<size_t>(s_done.load()) != plan.size()) fprintf(stderr, "  %ld of %zu completed\n", s_done.load(), plan.size());
+    return us;
+}
+
+int main(int argc, char *argv[]) {
+    size_t total = (argc > 2) ? static_cast<size_t>(std::atol(argv[2])) : 200000;
+    unsigned int workers = (argc > 3) ? static_cast<unsigned int>(std::atoi(argv[3])) : std::thread::hardware_concurrency();
+    int legacy_pct = (argc > 4) ? std::atoi(argv[4]) : 25;
+    if (total < 1) total = 1;
+    if (workers == 0) workers = 1;
+
+    bu_plugin_init();
+    /* Same mix under three names per command: free, grouped and globally locked */
+    std::vector<bu_plugin_cmd_handle> ideal, stranded, locked;
+    for (int g = 0; g < GROUPS; g++) {
+        std::string base = "legacy_" + std::to_string(g);
+        bu_plugin_cmd_register((base + "_free").c_str(), work_cmd);
+        bu_plugin_cmd_register((base + "_strand").c_str(), work_cmd);
+        bu_plugin_cmd_register((base + "_locked").c_str(), locked_cmd);
+        bu_plugin_cmd_set_strand((base + "_strand").c_str(), base.c_str());
+    }
+    bu_plugin_cmd_register("parallel_free", work_cmd);
+    bu_plugin_cmd_register("parallel_locked", locked_cmd);
+    bu_plugin_cmd_handle par_free = bu_plugin_cmd_lookup("parallel_free");
+    bu_plugin_cmd_handle par_locked = bu_plugin_cmd_lookup("parallel_locked");
+    for (size_t i = 0; i < total; i++) {
+        if (static_cast<int>(i % 100) < legacy_pct) {
+            std::string base = "legacy_" + std::to_string(i % GROUPS);
+            ideal.push_back(bu_plugin_cmd_lookup((base + "_free").c_str()));
+            stranded.push_back(bu_plugin_cmd_lookup((base + "_strand").c_str()));
+            locked.push_back(bu_plugin_cmd_lookup((base + "_locked").c_str()));
+        } else {
+            ideal.push_back(par_free);
+            stranded.push_back(par_free);
+            locked.push_back(par_locked);
+        }
+    }
+
+    printf("========================================\n");
+    printf("  Strand Benchmark (%zu commands of %d us, %d%% legacy in %d groups, %u worker(s))\n",
+           total, SPIN_NS / 1000, legacy_pct, GROUPS, workers);
+    printf("========================================\n");
+
+    bu_plugin_exec_start(workers);
+    double ideal_us = run(ideal);
+    double locked_us = run(locked);
+    double strand_us = run(stranded);
+    bu_plugin_exec_stop();
+
+    const char *labels[] = { "ideal", "global lock", "strands" };
+    double times[] = { ideal_us, locked_us, strand_us };
+    for (int i = 0; i < 3; i++) {
+        printf("  %-12s %9.1f ms  %10.0f commands/s  %5.1f%% of ideal\n", labels[i], times[i] / 1000.0,
+               static_cast<double>(total) / (times[i] / 1e6), 100.0 * ideal_us / times[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,183 @@
+/**
+ * bench_zygote.cpp - Time to first command: cold process start vs zygote fork.
+ *
+ * Both variants end with a worker process that has the same plugins loaded
+ * and has just run one command:
+ *   - cold:   posix_spawn() this executable with --cold; the child runs
+ *             bu_plugin_init(), loads every plugin and runs the command
+ *   - zygote: a server process loads the plugins once and serves
+ *             bu_plugin_zygote_spawn() requests by forking a worker that runs
+ *             the command straight away
+ *
+ * The time is measured from the request until the parent reads the result.
+ *
+ * Usage: bench_zygote [build_dir] [iterations]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+#include <spawn.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "bu_plugin.h"
+#include "bench_common.h"
+
+extern char **environ;
+
+/* The command every worker runs first (quiet, so it does not flood the output) */
+static const char *s_command = "stress_7";
+
+static const char *s_plugins[][2] = {
+    { "tests/plugin/example", "bu-example-plugin" },
+    { "tests/plugin/math_plugin", "bu-math-plugin" },
+    { "tests/plugin/string_plugin", "bu-string-plugin" },
+    { "tests/plugin/stress_plugin", "bu-stress-plugin" },
+    { "tests/plugin/large_plugin", "bu-large-plugin" },
+    { "tests/plugin/c_only", "bu-c-only-plugin" }
+};
+
+static int load_plugins(const char *build_dir) {
+    for (const auto &p : s_plugins) {
+        std::string path = bench_plugin_path(build_dir, p[0], p[1]);
+        if (bu_plugin_load(path.c_str()) < 0) {
+            fprintf(stderr, "Failed to load %s\n", path.c_str());
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Write "result N" for the first command to fd */
+static int run_first_command(int fd) {
+    int result = 0;
+    int status = bu_plugin_cmd_run(s_command, &result);
+    char reply[64];
+    int len = snprintf(reply, sizeof(reply), "result %d\n", status == 0 ? result : -1);
+    return (write(fd, reply, static_cast<size_t>(len)) == len) ? 0 : 1;
+}
+
+static int zygote_worker(int fd, const char *, void *) {
+    return run_first_command(fd);
+}
+
+/* Read from fd until a full "result" line arrives */
+static bool read_result(int fd) {
+    std::string buf;
+    char tmp[256];
+    ssize_t n;
+    while ((n = read(fd, tmp, sizeof(tmp))) > 0) {
+        buf.append(tmp, static_cast<size_t>(n));
+        if (buf.find('\n') != std::string::npos) return buf.compare(0, 7, "result ") == 0;
+    }
+    return false;
+}
+
+static std::string self_path(const char *argv0) {
+#if defined(__linux__)
+    char buf[4096];
+    ssize_t n = readlink("/proc/self/exe", buf, sizeof(buf) - 1);
+    if (n > 0) return std::string(buf, static_cast<size_t>(n));
+#endif
+    return argv0;
+}
+
+static double cold_start(const std::string &exe, const char *build_dir) {
+    int fds[2];
+    if (pipe(fds) != 0) return -1.0;
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&actions, fds[0]);
+    std::string dir(build_dir);
+    char *args[] = { const_cast<char *>(exe.c_str()), const_cast<char *>("--cold"), &dir[0], nullptr };
+
+    double start = bench_now_us();
+    pid_t pid = 0;
+    int rc = posix_spawn(&pid, exe.c_str(), &actions, nullptr, args, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+    bool ok = (rc == 0) && read_result(fds[0]);
+    double elapsed = bench_now_us() - start;
+    close(fds[0]);
+    if (rc == 0) waitpid(pid, nullptr, 0);
+    return ok ? elapsed : -1.0;
+}
+
+static double zygote_start(const char *sock) {
+    double start = bench_now_us();
+    int fd = bu_plugin_zygote_spawn(sock, s_command);
+    if (fd < 0) return -1.0;
+    bool ok = read_result(fd);
+    double elapsed = bench_now_us() - start;
+    close(fd);
+    return ok ? elapsed : -1.0;
+}
+
+int main(int argc, char *argv[]) {
+    /* Cold-start worker mode: everything a fresh worker process does */
+    if (argc > 2 && std::strcmp(argv[1], "--cold") == 0) {
+        bu_plugin_init();
+        if (load_plugins(argv[2]) != 0) return 1;
+        return run_first_command(STDOUT_FILENO);
+    }
+
+    const char *build_dir = (argc > 1) ? argv[1] : ".";
+    int iterations = (argc > 2) ? std::atoi(argv[2]) : 200;
+    if (iterations < 1) iterations = 1;
+    std::string exe = self_path(argv[0]);
+
+    printf("========================================\n");
+    printf("  Zygote Benchmark (time to first command)\n");
+    printf("========================================\n");
+    printf("Plugins: %zu, command: %s, iterations: %d\n\n",
+           sizeof(s_plugins) / sizeof(s_plugins[0]), s_command, iterations);
+
+    /* Start the zygote server: load once, then fork per request */
+    char sock[64];
+    snprintf(sock, sizeof(sock), "/tmp/bench_zygote_%d.sock", static_cast<int>(getpid()));
+    fflush(nullptr);
+    pid_t server = fork();
+    if (server == 0) {
+        bu_plugin_init();
+        if (load_plugins(build_dir) != 0) _exit(1);
+        _exit(bu_plugin_zygote_serve(sock, zygote_worker, nullptr) >= 0 ? 0 : 1);
+    }
+
+    /* Wait for the server to listen */
+    int probe = -1;
+    for (int i = 0; i < 1000 && probe < 0; i++) {
+        probe = bu_plugin_zygote_spawn(sock, s_command);
+        if (probe < 0) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    if (probe < 0 || !read_result(probe)) {
+        fprintf(stderr, "Zygote server did not start\n");
+        kill(server, SIGTERM);
+        return 1;
+    }
+    close(probe);
+
+    std::vector<double> cold, zygote;
+    for (int i = 0; i < iterations; i++) {
+        double c = cold_start(exe, build_dir);
+        double z = zygote_start(sock);
+        if (c < 0.0 || z < 0.0) {
+            fprintf(stderr, "Iteration %d failed\n", i);
+            break;
+        }
+        cold.push_back(c);
+        zygote.push_back(z);
+    }
+
+    int fd = bu_plugin_zygote_spawn(sock, BU_PLUGIN_ZYGOTE_QUIT);
+    if (fd >= 0) close(fd);
+    waitpid(server, nullptr, 0);
+
+    bench_report("cold start", cold);
+    bench_report("zygote fork", zygote);
+    return (cold.size() == static_cast<size_t>(iterations)) ? 0 : 1;
+}
@@ -0,0 +1,25 @@
+/**
+ * coro_common.h - Minimal coroutine type shared by the coroutine tests and benchmark.
+ *
+ * bu_plugin_coro.h leaves task types to the application; the tests only
+ * need a coroutine that starts eagerly and cleans up after itself.
+ */
+
+#ifndef CORO_COMMON_H
+#define CORO_COMMON_H
+
+#include <coroutine>
+#include <exception>
+
+/* Fire-and-forget coroutine: runs until its first suspension on the caller's thread */
+struct detached {
+    struct promise_type {
+        detached get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+#endif /* CORO_COMMON_H */
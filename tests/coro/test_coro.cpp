@@ -0,0 +1,141 @@
+/**
+ * test_coro.cpp - Tests for the C++20 coroutine layer (bu_plugin_coro.h)
+ * with the default int (*)(void) command signature.
+ *
+ * This test file covers:
+ *   - co_await on a command handle and by name
+ *   - Resumption on an executor worker
+ *   - Exceptions (-2) and unknown commands (-1) surfacing as cmd_error
+ *   - Pure commands answered from the result cache
+ *   - Many concurrent coroutines
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include "bu_plugin_coro.h"
+#include "coro_common.h"
+
+static int tests_run = 0;
+static int tests_failed = 0;
+
+#define CHECK(condition, msg) \
+    do { \
+        tests_run++; \
+        if (!(condition)) { \
+            printf("  FAIL: %s\n", msg); \
+            tests_failed++; \
+        } else { \
+            printf("  PASS: %s\n", msg); \
+        } \
+    } while(0)
+
+static int coro_seven() {
+    return 7;
+}
+
+static int coro_throw() {
+#ifdef BU_PLUGIN_HOST_NO_EXCEPTIONS
+    bu_plugin_cmd_fail("coroutine test exception");
+    return 0;
+#else
+    throw std::runtime_error("coroutine test exception");
+#endif
+}
+
+static std::atomic<int> s_pure_calls(0);
+
+static int coro_pure() {
+    return 40 + ++s_pure_calls;
+}
+
+static void quiet_logger(int, const char *) {
+}
+
+struct SequenceResult {
+    int sum;
+    bool resumed_on_worker;
+};
+
+static detached sequence(bu_plugin_cmd_handle h, std::thread::id caller, std::promise<SequenceResult> *done) {
+    SequenceResult r = { 0, true };
+    for (int i = 0; i < 100; i++) {
+        r.sum += co_await bu_plugin::run(h);
+        if (std::this_thread::get_id() == caller) r.resumed_on_worker = false;
+    }
+    done->set_value(r);
+}
+
+static detached await_status(const char *name, std::promise<int> *done) {
+    int status = 0;
+    try {
+        co_await bu_plugin::run(name);
+    } catch (const bu_plugin::cmd_error &e) {
+        status = e.status();
+    }
+    done->set_value(status);
+}
+
+static detached await_twice(bu_plugin_cmd_handle h, std::promise<int> *done) {
+    int a = co_await bu_plugin::run(h);
+    int b = co_await bu_plugin::run(h);
+    done->set_value(a == b ? a : -1);
+}
+
+static std::atomic<int> s_finished(0);
+
+static detached one_shot(bu_plugin_cmd_handle h) {
+    int r = co_await bu_plugin::run(h);
+    if (r == 7) s_finished++;
+}
+
+int main() {
+    printf("========================================\n");
+    printf("  Coroutine Layer Test (int (*)(void))\n");
+    printf("========================================\n");
+
+    bu_plugin_init();
+    bu_plugin_set_logger(quiet_logger);
+    bu_plugin_cmd_register("coro_seven", coro_seven);
+    bu_plugin_cmd_register("coro_throw", coro_throw);
+    bu_plugin_cmd_register("coro_pure", coro_pure);
+    bu_plugin_cmd_set_flags("coro_pure", BU_PLUGIN_CMD_PURE);
+    bu_plugin_exec_start(2);
+
+    bu_plugin_cmd_handle h = bu_plugin_cmd_lookup("coro_seven");
+    std::promise<SequenceResult> seq;
+    sequence(h, std::this_thread::get_id(), &seq);
+    SequenceResult r = seq.get_future().get();
+    CHECK(r.sum == 700, "Sequential awaits return each command's result");
+    CHECK(r.resumed_on_worker, "Coroutine resumes on an executor worker");
+
+    std::promise<int> by_name;
+    await_status("coro_seven", &by_name);
+    CHECK(by_name.get_future().get() == 0, "Await by name succeeds");
+
+    std::promise<int> thrown;
+    await_status("coro_throw", &thrown);
+    CHECK(thrown.get_future().get() == -2, "A throwing command raises cmd_error with status -2");
+
+    std::promise<int> missing;
+    await_status("no_such_command", &missing);
+    CHECK(missing.get_future().get() == -1, "An unknown command raises cmd_error with status -1");
+
+    bu_plugin_memo_set_capacity(16);
+    std::promise<int> cached;
+    await_twice(bu_plugin_cmd_lookup("coro_pure"), &cached);
+    CHECK(cached.get_future().get() == 41 && s_pure_calls.load() == 1, "A pure command is answered from the cache");
+    bu_plugin_memo_set_capacity(0);
+
+    for (int i = 0; i < 10000; i++) one_shot(h);
+    bu_plugin_exec_drain();
+    CHECK(s_finished.load() == 10000, "Concurrent coroutines all complete");
+
+    bu_plugin_exec_stop();
+    bu_plugin_set_logger(nullptr);
+
+    printf("\n%d checks, %d failed\n", tests_run, tests_failed);
+    return tests_failed == 0 ? 0 : 1;
+}
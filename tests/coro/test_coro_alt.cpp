@@ -0,0 +1,110 @@
+/**
+ * test_coro_alt.cpp - Tests for the C++20 coroutine layer with the custom
+ * int (*)(int argc, const char** argv) signature of tests/alt_signature.
+ *
+ * Loads the alt-args plugin through alt_sig_host and awaits its commands
+ * with argument packs.
+ */
+
+#include <cstdio>
+#include <future>
+#include <string>
+
+/* Same custom signature as the alt_sig_host library */
+#define BU_PLUGIN_CMD_RET int
+#define BU_PLUGIN_CMD_ARGS int argc, const char** argv
+
+#include "bu_plugin_coro.h"
+#include "coro_common.h"
+
+extern "C" {
+    int alt_sig_host_init(void);
+}
+
+static int tests_run = 0;
+static int tests_failed = 0;
+
+#define CHECK(condition, msg) \
+    do { \
+        tests_run++; \
+        if (!(condition)) { \
+            printf("  FAIL: %s\n", msg); \
+            tests_failed++; \
+        } else { \
+            printf("  PASS: %s\n", msg); \
+        } \
+    } while(0)
+
+static std::string plugin_path(const char *build_dir, const char *config, const char *name) {
+    std::string path = build_dir;
+    path += "/tests/alt_signature/";
+#if defined(_WIN32) && defined(_MSC_VER)
+    if (config && *config) {
+        path += config;
+        path += "/";
+    }
+    path += name;
+    path += ".dll";
+#elif defined(_WIN32)
+    (void)config;
+    path += "lib";
+    path += name;
+    path += ".dll";
+#elif defined(__APPLE__)
+    (void)config;
+    path += "lib";
+    path += name;
+    path += ".dylib";
+#else
+    (void)config;
+    path += "lib";
+    path += name;
+    path += ".so";
+#endif
+    return path;
+}
+
+static detached sum_twice(std::promise<int> *done) {
+    static const char *nums[] = { "10", "20", "12" };
+    int a = co_await bu_plugin::run("sum", 3, nums);
+    bu_plugin_cmd_handle h = bu_plugin_cmd_lookup("sum");
+    int b = co_await bu_plugin::run(h, 2, nums);
+    done->set_value(a * 100 + b);
+}
+
+static detached missing(std::promise<int> *done) {
+    static const char *none[] = { nullptr };
+    int status = 0;
+    try {
+        co_await bu_plugin::run("no_such_command", 0, none);
+    } catch (const bu_plugin::cmd_error &e) {
+        status = e.status();
+    }
+    done->set_value(status);
+}
+
+int main(int argc, char **argv) {
+    printf("========================================\n");
+    printf("  Coroutine Layer Test (int (*)(int, const char**))\n");
+    printf("========================================\n");
+
+    const char *build_dir = argc > 1 ? argv[1] : ".";
+    const char *config = argc > 2 ? argv[2] : "";
+
+    alt_sig_host_init();
+    std::string path = plugin_path(build_dir, config, "alt-args-plugin");
+    CHECK(bu_plugin_load(path.c_str()) > 0, "Alt-signature plugin loads");
+
+    std::promise<int> sums;
+    sum_twice(&sums);
+    CHECK(sums.get_future().get() == 42 * 100 + 30, "Awaited commands receive their argument packs");
+
+    std::promise<int> status;
+    missing(&status);
+    CHECK(status.get_future().get() == -1, "An unknown command raises cmd_error with status -1");
+
+    bu_plugin_exec_stop();
+
+    printf("\n%d checks, %d failed\n", tests_run, tests_failed);
+    return tests_failed == 0 ? 0 : 1;
+}
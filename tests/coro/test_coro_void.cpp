@@ -0,0 +1,88 @@
+/**
+ * test_coro_void.cpp - Tests for the C++20 coroutine layer with a void
+ * BU_PLUGIN_CMD_RET: commands report through an output argument.
+ *
+ * Builds the registry into this file (BU_PLUGIN_IMPLEMENTATION), since no
+ * host library uses this signature.
+ */
+
+#include <cstdio>
+#include <future>
+
+/* Commands return nothing and write their result through a pointer */
+#define BU_PLUGIN_CMD_RET void
+#define BU_PLUGIN_CMD_ARGS int *out
+
+#ifndef BU_PLUGIN_IMPLEMENTATION
+#define BU_PLUGIN_IMPLEMENTATION
+#endif
+
+#include "bu_plugin_coro.h"
+#include "coro_common.h"
+
+static int tests_run = 0;
+static int tests_failed = 0;
+
+#define CHECK(condition, msg) \
+    do { \
+        tests_run++; \
+        if (!(condition)) { \
+            printf("  FAIL: %s\n", msg); \
+            tests_failed++; \
+        } else { \
+            printf("  PASS: %s\n", msg); \
+        } \
+    } while(0)
+
+static void void_store(int *out) {
+    *out = 42;
+}
+
+static void void_fail(int *) {
+    bu_plugin_cmd_fail("void command failure");
+}
+
+static detached store_twice(std::promise<int> *done) {
+    int a = 0, b = 0;
+    co_await bu_plugin::run("void_store", &a);
+    co_await bu_plugin::run(bu_plugin_cmd_lookup("void_store"), &b);
+    done->set_value(a + b);
+}
+
+static detached failing(std::promise<int> *done) {
+    int unused = 0;
+    int status = 0;
+    try {
+        co_await bu_plugin::run("void_fail", &unused);
+    } catch (const bu_plugin::cmd_error &e) {
+        status = e.status();
+    }
+    done->set_value(status);
+}
+
+int main() {
+    printf("========================================\n");
+    printf("  Coroutine Layer Test (void (*)(int *))\n");
+    printf("========================================\n");
+
+    bu_plugin_init();
+    CHECK(bu_plugin_cmd_register("void_store", void_store) == 0, "Void command registers");
+    CHECK(bu_plugin_cmd_register("void_fail", void_fail) == 0, "Failing void command registers");
+    /* A pure void command has no result to cache; it still runs every time */
+    bu_plugin_cmd_set_flags("void_store", BU_PLUGIN_CMD_PURE);
+    bu_plugin_memo_set_capacity(16);
+
+    std::promise<int> stored;
+    store_twice(&stored);
+    CHECK(stored.get_future().get() == 84, "Awaited void commands run and write their output");
+
+    std::promise<int> status;
+    failing(&status);
+    CHECK(status.get_future().get() == -2, "A failing void command raises cmd_error with status -2");
+
+    bu_plugin_memo_set_capacity(0);
+    bu_plugin_exec_stop();
+
+    printf("\n%d checks, %d failed\n", tests_run, tests_failed);
+    return tests_failed == 0 ? 0 : 1;
+}
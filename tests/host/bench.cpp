@@ -0,0 +1,254 @@
+/**
+ * bench.cpp - Load generator for run_bu_plugin --serve (POSIX only).
+ *
+ * Usage: run_bu_plugin --bench SOCKET [-c connections] [-d depth] [-b batch]
+ *                      [-n frames] [--stop] [command]
+ *
+ * Each connection runs on its own thread: it resolves the command once,
+ * then keeps depth SERVE_OP_CALL frames of batch invocations in flight
+ * until it has sent frames frames. Requests are written in bursts and
+ * replies read as they come, so the server sees pipelined traffic. The
+ * latency of a frame is the time from queueing its request to reading its
+ * reply. Reports invocations per second and frame latency percentiles;
+ * exits non-zero if any invocation failed. --stop shuts the server down
+ * afterwards.
+ */
+
+#if !defined(_WIN32)
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "serve.h"
+
+namespace {
+
+struct BenchOptions {
+    const char *socket_path;
+    const char *command;
+    int connections;
+    int depth;
+    int batch;
+    long frames;
+    bool stop;
+};
+
+double now_us() {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int connect_to(const char *socket_path) {
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (std::strlen(socket_path) >= sizeof(addr.sun_path)) return -1;
+    std::strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool send_all(int fd, const std::string &buf) {
+    size_t off = 0;
+    while (off < buf.size()) {
+        ssize_t n = send(fd, buf.data() + off, buf.size() - off, 0);
+        if (n <= 0) return false;
+        off += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool recv_all(int fd, void *dst, size_t len) {
+    char *p = static_cast<char *>(dst);
+    while (len) {
+        ssize_t n = recv(fd, p, len, 0);
+        if (n <= 0) return false;
+        p += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+/* Send one request frame and read its reply frame; payload out */
+bool round_trip(int fd, const std::string &request, serve_frame &reply, std::string &payload) {
+    if (!send_all(fd, request) || !recv_all(fd, &reply, sizeof(reply))) return false;
+    payload.resize(reply.len);
+    return reply.len == 0 || recv_all(fd, &payload[0], reply.len);
+}
+
+struct ConnResult {
+    std::vector<double> latencies;      /* Per frame, us */
+    long calls;
+    long failures;
+    bool ok;
+};
+
+void run_connection(const BenchOptions &o, ConnResult &res) {
+    res.calls = res.failures = 0;
+    res.ok = false;
+    int fd = connect_to(o.socket_path);
+    if (fd < 0) {
+        fprintf(stderr, "Cannot connect to %s\n", o.socket_path);
+        return;
+    }
+
+    std::string req;
+    serve_put_frame(req, SERVE_OP_RESOLVE, 0, 1, sizeof(uint16_t) + std::strlen(o.command));
+    serve_put_name(req, o.command);
+    serve_frame reply;
+    std::string payload;
+    serve_resolved resolved;
+    if (!round_trip(fd, req, reply, payload) || reply.op != SERVE_OP_RESOLVE || payload.size() != sizeof(resolved)) {
+        fprintf(stderr, "Resolving '%s' failed\n", o.command);
+        close(fd);
+        return;
+    }
+    std::memcpy(&resolved, payload.data(), sizeof(resolved));
+    if (resolved.status != 0) {
+        fprintf(stderr, "Command '%s' is not registered on the server\n", o.command);
+        close(fd);
+        return;
+    }
+
+    /* One request frame, reused with a new tag each time */
+    std::string frame;
+    serve_put_frame(frame, SERVE_OP_CALL, 0, static_cast<uint16_t>(o.batch), static_cast<size_t>(o.batch) * sizeof(uint32_t));
+    for (int i = 0; i < o.batch; i++) frame.append(reinterpret_cast<const char *>(&resolved.id), sizeof(resolved.id));
+
+    std::vector<double> sent_at(static_cast<size_t>(o.frames));
+    res.latencies.reserve(static_cast<size_t>(o.frames));
+    std::vector<serve_result> results(static_cast<size_t>(o.batch));
+    long sent = 0, received = 0;
+    while (received < o.frames) {
+        /* Top the window up in one write */
+        req.clear();
+        double t = now_us();
+        while (sent < o.frames && sent - received < o.depth) {
+            uint32_t tag = static_cast<uint32_t>(sent);
+            frame.replace(offsetof(serve_frame, tag), sizeof(tag), reinterpret_cast<const char *>(&tag), sizeof(tag));
+            req += frame;
+            sent_at[static_cast<size_t>(sent++)] = t;
+        }
+        if (!req.empty() && !send_all(fd, req)) break;
+
+        if (!recv_all(fd, &reply, sizeof(reply)) || reply.op != SERVE_OP_CALL ||
+            reply.len != results.size() * sizeof(serve_result) || reply.tag != static_cast<uint32_t>(received) ||
+            !recv_all(fd, results.data(), reply.len)) {
+            fprintf(stderr, "Bad or missing reply to frame %ld\n", received);
+            break;
+        }
+        res.latencies.push_back(now_us() - sent_at[static_cast<size_t>(received++)]);
+        for (const serve_result &r : results) {
+            res.calls++;
+            if (r.status != 0) res.failures++;
+        }
+    }
+    res.ok = (received == o.frames);
+    close(fd);
+}
+
+double percentile(const std::vector<double> &sorted, double q) {
+    if (sorted.empty()) return 0.0;
+    size_t i = static_cast<size_t>(q * static_cast<double>(sorted.size() - 1));
+    return sorted[i];
+}
+
+void usage() {
+    fprintf(stderr, "Usage: run_bu_plugin --bench SOCKET [-c connections] [-d depth] [-b batch] [-n frames] [--stop] [command]\n");
+}
+
+} /* namespace */
+
+int bench_main(int argc, char *argv[]) {
+    if (argc < 1) {
+        usage();
+        return 2;
+    }
+    BenchOptions o;
+    o.socket_path = argv[0];
+    o.command = "help";
+    o.connections = 1;
+    o.depth = 16;
+    o.batch = 1;
+    o.frames = 100000;
+    o.stop = false;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool has_value = (i + 1 < argc);
+        if (a == "-c" && has_value) {
+            o.connections = std::atoi(argv[++i]);
+        } else if (a == "-d" && has_value) {
+            o.depth = std::atoi(argv[++i]);
+        } else if (a == "-b" && has_value) {
+            o.batch = std::atoi(argv[++i]);
+        } else if (a == "-n" && has_value) {
+            o.frames = std::atol(argv[++i]);
+        } else if (a == "--stop") {
+            o.stop = true;
+        } else if (a[0] != '-') {
+            o.command = argv[i];
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (o.connections < 1 || o.depth < 1 || o.batch < 1 || o.batch > 65535 || o.frames < 1) {
+        usage();
+        return 2;
+    }
+
+    printf("Benchmarking '%s' on %s: %d connection(s), %d frame(s) in flight, %d call(s) per frame, %ld frame(s) each\n",
+           o.command, o.socket_path, o.connections, o.depth, o.batch, o.frames);
+    std::vector<ConnResult> results(static_cast<size_t>(o.connections));
+    std::vector<std::thread> threads;
+    double t0 = now_us();
+    for (auto &r : results) threads.emplace_back(run_connection, std::cref(o), std::ref(r));
+    for (auto &t : threads) t.join();
+    double elapsed = now_us() - t0;
+
+    std::vector<double> all;
+    long calls = 0, failures = 0;
+    bool ok = true;
+    for (const auto &r : results) {
+        all.insert(all.end(), r.latencies.begin(), r.latencies.end());
+        calls += r.calls;
+        failures += r.failures;
+        ok = ok && r.ok;
+    }
+    std::sort(all.begin(), all.end());
+    printf("  %ld call(s) in %.1f ms: %.0f calls/s, %.0f frames/s\n", calls, elapsed / 1000.0,
+           static_cast<double>(calls) / (elapsed / 1e6), static_cast<double>(all.size()) / (elapsed / 1e6));
+    printf("  frame latency us: p50 %.1f  p90 %.1f  p99 %.1f  max %.1f\n", percentile(all, 0.50),
+           percentile(all, 0.90), percentile(all, 0.99), all.empty() ? 0.0 : all.back());
+    if (failures) printf("  %ld call(s) failed\n", failures);
+
+    if (o.stop) {
+        int fd = connect_to(o.socket_path);
+        std::string req;
+        serve_put_frame(req, SERVE_OP_SHUTDOWN, 0, 0, 0);
+        serve_frame reply;
+        std::string payload;
+        if (fd < 0 || !round_trip(fd, req, reply, payload)) {
+            fprintf(stderr, "Shutdown request failed\n");
+            ok = false;
+        }
+        if (fd >= 0) close(fd);
+    }
+    return (ok && failures == 0) ? 0 : 1;
+}
+
+#endif /* !_WIN32 */
@@ -6,11 +6,21 @@
  *   - Optionally loads a plugin from a command-line path
  *   - Reports registry size
  *   - Runs the "example" command if registered
+ *
+ * Usage:
+ *   run_bu_plugin [plugin]                    load a plugin and run "example"
+ *   run_bu_plugin --serve SOCKET [plugin...]  load plugins once and serve
+ *                                             command requests (POSIX, see serve.h)
+ *   run_bu_plugin --bench SOCKET [options]    load generator for --serve (POSIX)
+ *   run_bu_plugin --script [options] [FILE]   run a script of commands (see script.cpp)
  */
 
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include "bu_plugin.h"
+#include "script.h"
+#include "serve.h"
 
 int main(int argc, char *argv[]) {
     /* Initialize the plugin system */
@@ -19,6 +29,30 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
+    if (argc > 1 && std::strcmp(argv[1], "--script") == 0) return script_main(argc - 2, argv + 2);
+
+    if (argc > 1 && (std::strcmp(argv[1], "--serve") == 0 || std::strcmp(argv[1], "--bench") == 0)) {
+#if defined(_WIN32)
+        fprintf(stderr, "%s is not available on Windows\n", argv[1]);
+        return 1;
+#else
+        if (argc < 3) {
+            fprintf(stderr, "Usage: %s %s SOCKET ...\n", argv[0], argv[1]);
+            return 2;
+        }
+        if (std::strcmp(argv[1], "--bench") == 0) return bench_main(argc - 2, argv + 2);
+        for (int i = 3; i < argc; i++) {
+            int loaded = bu_plugin_load(argv[i]);
+            if (loaded < 0) {
+                fprintf(stderr, "Failed to load plugin: %s\n", argv[i]);
+                return 1;
+            }
+            printf("Registered %d command(s) from %s\n", loaded, argv[i]);
+        }
+        return serve_main(argv[2]);
+#endif
+    }
+
     /* Report initial state */
     printf("Initial registered count: %zu\n", bu_plugin_cmd_count());
 
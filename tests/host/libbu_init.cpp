@@ -105,14 +105,14 @@ extern "C" BU_PLUGIN_EXPORT int bu_host_init(const char *libexec_dir) {
 
 /* Built-in help command for testing */
 static int builtin_help(void) {
-    printf("Built-in help command\n");
+    bu_plugin_output_printf("Built-in help command\n");
     return 0;
 }
 REGISTER_BU_PLUGIN_COMMAND("help", builtin_help);
 
 /* Built-in version command for testing */
 static int builtin_version(void) {
-    printf("Plugin Test Framework v1.0\n");
+    bu_plugin_output_printf("Plugin Test Framework v1.0\n");
     return 1;
 }
 REGISTER_BU_PLUGIN_COMMAND("version", builtin_version);
@@ -120,7 +120,7 @@ REGISTER_BU_PLUGIN_COMMAND("version", builtin_version);
 /* Built-in status command for testing */
 static int builtin_status(void) {
     size_t count = bu_plugin_cmd_count();
-    printf("Status: OK, %zu commands registered\n", count);
+    bu_plugin_output_printf("Status: OK, %zu commands registered\n", count);
     /* Return count, clamped to INT_MAX if too large */
     if (count > static_cast<size_t>(INT_MAX)) {
         return INT_MAX;
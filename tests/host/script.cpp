@@ -0,0 +1,360 @@
+/**
+ * script.cpp - Script mode for run_bu_plugin.
+ *
+ * Usage: run_bu_plugin --script [-p plugin]... [-j jobs] [--time] [FILE|-]
+ *
+ * Runs the commands in FILE (stdin if FILE is omitted or "-"), one per
+ * line, against the plugins loaded with -p. A line is split into words by
+ * bu_plugin_line_word() (blanks separate words, shell-like quoting, #
+ * comments), in place in the script buffer. The first word names the
+ * command; with the argc/argv signature (SCRIPT_ARGV_SIGNATURE) the
+ * remaining words are its arguments, with the default signature a line
+ * must not have any.
+ *
+ * The whole script is read and tokenized, and every distinct command name
+ * resolved to a handle once, before any line runs; an unknown command or
+ * a malformed line stops the script there. Lines then run in script
+ * order, except that consecutive lines whose commands are flagged
+ * BU_PLUGIN_CMD_THREADSAFE form a segment that is split across the
+ * executor workers and the calling thread (-j, 0 for the hardware
+ * concurrency, 1 to run everything on one thread). Within a segment lines
+ * may run concurrently and out of order; any other line is a barrier.
+ *
+ * Failed lines are reported on stderr. --time prints each line's status,
+ * result and duration, then a per-command summary. The exit status is 0
+ * if every line succeeded, 1 otherwise and 2 on a usage error.
+ */
+
+#if defined(SCRIPT_ARGV_SIGNATURE)
+#define BU_PLUGIN_CMD_RET int
+#define BU_PLUGIN_CMD_ARGS int argc, const char **argv
+#define BU_PLUGIN_CMD_ARGV_SIGNATURE
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "bu_plugin.h"
+#include "script.h"
+
+namespace {
+
+/* Segments shorter than this run on the calling thread */
+const size_t kMinParallelLines = 512;
+
+/* Report at most this many bad lines before giving up */
+const size_t kMaxReportedErrors = 10;
+
+struct ScriptOptions {
+    std::vector<const char *> plugins;
+    const char *path;
+    unsigned int jobs;
+    bool timing;
+};
+
+struct Command {
+    std::string name;
+    bu_plugin_cmd_handle handle;
+#if defined(SCRIPT_ARGV_SIGNATURE)
+    bu_plugin::cmd<int(int, const char **)> fn;
+#endif
+    unsigned int flags;
+};
+
+struct Line {
+    uint32_t number;    /* 1-based line in the script */
+    uint32_t cmd;       /* Index into Script::commands */
+    uint32_t args;      /* First argument in Script::words */
+    int argc;           /* Words after the command name */
+};
+
+struct Script {
+    std::string text;                   /* Tokenized in place; words point into it */
+    std::vector<const char *> words;    /* Each line's arguments, NULL-terminated */
+    std::vector<Command> commands;
+    std::vector<Line> lines;
+    std::vector<int> status;
+    std::vector<int> results;
+    std::vector<float> micros;          /* Per line, with --time */
+};
+
+double now_us() {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool read_all(const char *path, std::string &out) {
+    FILE *f = (path && std::strcmp(path, "-") != 0) ? std::fopen(path, "rb") : stdin;
+    if (!f) return false;
+    char buf[65536];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+    bool ok = !std::ferror(f);
+    if (f != stdin) std::fclose(f);
+    return ok;
+}
+
+/* Tokenize s.text into s.lines and resolve every command; false on any bad line */
+bool parse(Script &s) {
+    if (!s.text.empty() && s.text[s.text.size() - 1] != '\n') s.text += '\n';
+    char *text = &s.text[0];
+    size_t newlines = static_cast<size_t>(std::count(s.text.begin(), s.text.end(), '\n'));
+    s.lines.reserve(newlines);
+    s.words.reserve(newlines);
+    std::unordered_map<std::string, uint32_t> index;
+    std::vector<const char *> words;
+    const char *prev_name = nullptr;
+    uint32_t prev_cmd = 0;
+    size_t errors = 0;
+    uint32_t number = 0;
+    size_t p = 0;
+    while (p < s.text.size() && errors < kMaxReportedErrors) {
+        size_t end = s.text.find('\n', p);
+        number++;
+        words.clear();
+        char *cursor = text + p;
+        const char *word = nullptr;
+        int rc;
+        while ((rc = bu_plugin_line_word(&cursor, &word)) == 1) words.push_back(word);
+        p = end + 1;
+        if (rc < 0) {
+            fprintf(stderr, "line %u: unterminated quote\n", number);
+            errors++;
+            continue;
+        }
+        if (words.empty()) continue;
+
+        /* Runs of the same command skip the hash lookup */
+        uint32_t cmd;
+        if (prev_name && std::strcmp(prev_name, words[0]) == 0) {
+            cmd = prev_cmd;
+        } else {
+            std::unordered_map<std::string, uint32_t>::const_iterator it = index.find(words[0]);
+            if (it != index.end()) {
+                cmd = it->second;
+            } else {
+                Command c;
+                c.name = words[0];
+                c.handle = bu_plugin_cmd_lookup(words[0]);
+                if (!c.handle) {
+                    fprintf(stderr, "line %u: unknown command '%s'\n", number, words[0]);
+                    errors++;
+                    continue;
+                }
+#if defined(SCRIPT_ARGV_SIGNATURE)
+                c.fn = bu_plugin::cmd<int(int, const char **)>(c.handle);
+#endif
+                c.flags = bu_plugin_cmd_get_flags(words[0]);
+                cmd = static_cast<uint32_t>(s.commands.size());
+                s.commands.push_back(c);
+                index[c.name] = cmd;
+            }
+            prev_name = words[0];
+            prev_cmd = cmd;
+        }
+#if !defined(SCRIPT_ARGV_SIGNATURE)
+        if (words.size() > 1) {
+            fprintf(stderr, "line %u: '%s' takes no arguments\n", number, words[0]);
+            errors++;
+            continue;
+        }
+#endif
+        Line l;
+        l.number = number;
+        l.cmd = cmd;
+        l.args = static_cast<uint32_t>(s.words.size());
+        l.argc = static_cast<int>(words.size() - 1);
+        s.words.insert(s.words.end(), words.begin() + 1, words.end());
+        s.words.push_back(nullptr);
+        s.lines.push_back(l);
+    }
+    if (errors >= kMaxReportedErrors && p < s.text.size()) fprintf(stderr, "too many errors\n");
+    return errors == 0;
+}
+
+int call(const Script &s, const Line &l, int *result) {
+    const Command &c = s.commands[l.cmd];
+#if defined(SCRIPT_ARGV_SIGNATURE)
+    /* The checked invoke: exceptions and bu_plugin_cmd_fail() both report -2 */
+    bu_plugin::call_result<int> r = bu_plugin::invoke<int(int, const char **), bu_plugin::return_status>(
+        c.fn, l.argc, const_cast<const char **>(s.words.data()) + l.args);
+    if (r.status == 0) *result = r.value;
+    return r.status;
+#else
+    return bu_plugin_cmd_invoke(c.handle, result);
+#endif
+}
+
+void run_range(Script &s, size_t begin, size_t end, bool timing) {
+    if (timing) {
+        for (size_t i = begin; i < end; i++) {
+            double t0 = now_us();
+            s.status[i] = call(s, s.lines[i], &s.results[i]);
+            s.micros[i] = static_cast<float>(now_us() - t0);
+        }
+    } else {
+        for (size_t i = begin; i < end; i++) s.status[i] = call(s, s.lines[i], &s.results[i]);
+    }
+}
+
+/* A run of thread-safe lines shared by the executor workers and the caller */
+struct Segment {
+    Script *script;
+    size_t end;
+    size_t chunk;
+    bool timing;
+    std::atomic<size_t> next;
+};
+
+void run_segment(void *arg) {
+    Segment *seg = static_cast<Segment *>(arg);
+    size_t b;
+    while ((b = seg->next.fetch_add(seg->chunk)) < seg->end) {
+        run_range(*seg->script, b, std::min(b + seg->chunk, seg->end), seg->timing);
+    }
+}
+
+/* Run every line; returns the number of parallel segments */
+size_t run(Script &s, unsigned int helpers, bool timing) {
+    size_t segments = 0;
+    size_t n = s.lines.size();
+    size_t i = 0;
+    while (i < n) {
+        size_t j = i;
+        while (j < n && (s.commands[s.lines[j].cmd].flags & BU_PLUGIN_CMD_THREADSAFE)) j++;
+        if (helpers && j - i >= kMinParallelLines) {
+            /* A few chunks per thread, so an uneven split evens out */
+            Segment seg;
+            seg.script = &s;
+            seg.end = j;
+            seg.chunk = std::max<size_t>(64, (j - i) / (4 * (helpers + 1)));
+            seg.timing = timing;
+            seg.next.store(i);
+            size_t posts = std::min<size_t>(helpers, (j - i - 1) / seg.chunk);
+            for (size_t k = 0; k < posts; k++) bu_plugin_exec_post(run_segment, &seg);
+            run_segment(&seg);
+            bu_plugin_exec_drain();
+            segments++;
+        } else {
+            run_range(s, i, j, timing);
+        }
+        /* The barrier line, if any, runs alone */
+        if (j < n) run_range(s, j, j + 1, timing);
+        i = j + 1;
+    }
+    return segments;
+}
+
+void print_timing(const Script &s) {
+    printf("%8s  %-24s %7s %11s %12s\n", "line", "command", "status", "result", "us");
+    for (size_t i = 0; i < s.lines.size(); i++) {
+        const Line &l = s.lines[i];
+        printf("%8u  %-24s %7d %11d %12.2f\n", l.number, s.commands[l.cmd].name.c_str(), s.status[i],
+               s.status[i] == 0 ? s.results[i] : 0, static_cast<double>(s.micros[i]));
+    }
+
+    std::vector<size_t> calls(s.commands.size(), 0);
+    std::vector<double> total(s.commands.size(), 0.0), worst(s.commands.size(), 0.0);
+    for (size_t i = 0; i < s.lines.size(); i++) {
+        uint32_t c = s.lines[i].cmd;
+        double us = static_cast<double>(s.micros[i]);
+        calls[c]++;
+        total[c] += us;
+        worst[c] = std::max(worst[c], us);
+    }
+    printf("\n%-24s %10s %12s %10s %10s\n", "command", "calls", "total ms", "mean us", "max us");
+    for (size_t c = 0; c < s.commands.size(); c++) {
+        printf("%-24s %10zu %12.3f %10.2f %10.2f\n", s.commands[c].name.c_str(), calls[c], total[c] / 1000.0,
+               total[c] / static_cast<double>(calls[c]), worst[c]);
+    }
+}
+
+void usage() {
+    fprintf(stderr, "Usage: run_bu_plugin --script [-p plugin]... [-j jobs] [--time] [FILE|-]\n");
+}
+
+} /* namespace */
+
+int script_main(int argc, char *argv[]) {
+    ScriptOptions o;
+    o.path = nullptr;
+    o.jobs = 0;
+    o.timing = false;
+    for (int i = 0; i < argc; i++) {
+        std::string a = argv[i];
+        bool has_value = (i + 1 < argc);
+        if (a == "-p" && has_value) {
+            o.plugins.push_back(argv[++i]);
+        } else if (a == "-j" && has_value) {
+            o.jobs = static_cast<unsigned int>(std::atoi(argv[++i]));
+        } else if (a == "--time") {
+            o.timing = true;
+        } else if ((a == "-" || a[0] != '-') && !o.path) {
+            o.path = argv[i];
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    for (const char *plugin : o.plugins) {
+        if (bu_plugin_load(plugin) < 0) {
+            fprintf(stderr, "Failed to load plugin: %s\n", plugin);
+            return 1;
+        }
+    }
+
+    Script s;
+    double t0 = now_us();
+    if (!read_all(o.path, s.text)) {
+        fprintf(stderr, "Cannot read %s\n", o.path ? o.path : "standard input");
+        return 1;
+    }
+    if (!parse(s)) return 1;
+    double parse_us = now_us() - t0;
+
+    size_t n = s.lines.size();
+    s.status.assign(n, 0);
+    s.results.assign(n, 0);
+    if (o.timing) s.micros.assign(n, 0.0f);
+
+    /* Helpers only pay off for thread-safe commands */
+    bool any_threadsafe = false;
+    for (const Command &c : s.commands) any_threadsafe = any_threadsafe || (c.flags & BU_PLUGIN_CMD_THREADSAFE);
+    unsigned int threads = o.jobs ? o.jobs : std::max(1u, std::thread::hardware_concurrency());
+    bool started = false;
+    if (threads > 1 && any_threadsafe && n >= kMinParallelLines) {
+        started = bu_plugin_exec_start(threads - 1) == 0;
+    }
+    unsigned int helpers = (threads > 1) ? std::min(threads - 1, bu_plugin_exec_workers()) : 0;
+
+    t0 = now_us();
+    size_t segments = run(s, helpers, o.timing);
+    double run_us = now_us() - t0;
+    if (started) bu_plugin_exec_stop();
+
+    size_t failed = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (s.status[i] == 0) continue;
+        if (++failed <= kMaxReportedErrors) {
+            fprintf(stderr, "line %u: '%s' failed with status %d\n", s.lines[i].number,
+                    s.commands[s.lines[i].cmd].name.c_str(), s.status[i]);
+        }
+    }
+    if (failed > kMaxReportedErrors) fprintf(stderr, "... and %zu more failed line(s)\n", failed - kMaxReportedErrors);
+
+    fflush(stdout);
+    if (o.timing) print_timing(s);
+    printf("Script: %zu line(s), %zu command(s), %zu failed\n", n, s.commands.size(), failed);
+    printf("  parse %.3f ms, run %.3f ms (%.0f lines/s), %zu parallel segment(s) on %u thread(s)\n",
+           parse_us / 1000.0, run_us / 1000.0, run_us > 0.0 ? static_cast<double>(n) / (run_us / 1e6) : 0.0,
+           segments, helpers + 1);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,20 @@
+/**
+ * script.h - Script mode for run_bu_plugin.
+ *
+ * run_bu_plugin --script runs a file (or stdin) of commands, one per line,
+ * against plugins loaded with -p. See script.cpp for the line syntax and
+ * how lines are scheduled.
+ *
+ * script.cpp is also built into tests/alt_signature's run_alt_script with
+ * SCRIPT_ARGV_SIGNATURE defined, where commands have the
+ * int (*)(int argc, const char **argv) signature and receive the words
+ * that follow the command name on their line.
+ */
+
+#ifndef RUN_BU_PLUGIN_SCRIPT_H
+#define RUN_BU_PLUGIN_SCRIPT_H
+
+/* argv holds the arguments after --script; bu_plugin_init() must have run */
+int script_main(int argc, char *argv[]);
+
+#endif /* RUN_BU_PLUGIN_SCRIPT_H */
@@ -0,0 +1,519 @@
+/**
+ * serve.cpp - Command server mode of run_bu_plugin (POSIX only).
+ *
+ * One thread runs an event loop over the listening socket and every
+ * client connection (epoll on Linux, poll() elsewhere). Sockets are
+ * non-blocking: a readable connection is drained into its input buffer,
+ * every complete frame in it is answered into the output buffer, and the
+ * output is written back with one send() for the whole burst, so a
+ * pipelined client gets many replies per system call. Output that does
+ * not fit in the socket buffer waits for writability.
+ *
+ * Both buffers are bounded. A connection whose unsent replies reach
+ * OUT_CAP is not read from, and its remaining frames are not answered,
+ * until the client takes some of them; a client that pipelines without
+ * reading is held back by the socket instead of growing the server.
+ *
+ * Serving is single-threaded: commands run inline on the loop thread
+ * through handles resolved once per name, and no other connection is
+ * served while one runs. This suits the short commands the server is
+ * meant for; long-running work belongs on the executor, behind a command
+ * that submits it. Stops on SIGINT/SIGTERM or a SERVE_OP_SHUTDOWN request.
+ */
+
+#if !defined(_WIN32)
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif
+#include "bu_plugin.h"
+#include "serve.h"
+
+namespace {
+
+volatile sig_atomic_t s_stop = 0;
+
+void on_signal(int) {
+    s_stop = 1;
+}
+
+void serve_logger(int level, const char *msg) {
+    fprintf(stderr, "[%d] %s\n", level, msg);
+}
+
+/* errno says a non-blocking call found nothing to do */
+bool would_block() {
+#if EAGAIN == EWOULDBLOCK
+    return errno == EAGAIN;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+bool set_nonblocking(int fd) {
+    int fl = fcntl(fd, F_GETFL, 0);
+    return fl >= 0 && fcntl(fd, F_SETFL, fl | O_NONBLOCK) == 0;
+}
+
+/* Unsent replies at which a connection stops being read and answered */
+const size_t OUT_CAP = 1u << 20;
+
+/* Unanswered input a connection may buffer; room for the largest frame */
+const size_t IN_CAP = 2 * (sizeof(serve_frame) + SERVE_MAX_PAYLOAD);
+
+struct Conn {
+    int fd;
+    std::string in;
+    std::string out;
+    size_t out_off;
+    unsigned want;      /* Poller::WANT_* registered for fd */
+    bool rdhup;         /* The peer shut down its side; stop asking for that */
+    bool eof;           /* Nothing more to read */
+    bool closing;       /* Close once out is flushed */
+    explicit Conn(int f) : fd(f), out_off(0), want(0), rdhup(false), eof(false), closing(false) {}
+    size_t pending() const { return out.size() - out_off; }
+};
+
+/* Readiness notification over the listening socket and the connections */
+class Poller {
+public:
+    enum { WANT_READ = 1, WANT_RDHUP = 2, WANT_WRITE = 4 };
+
+    struct Event {
+        int fd;
+        bool readable;
+        bool writable;
+        bool rdhup;
+        bool hangup;
+    };
+
+#if defined(__linux__)
+    Poller() : ep_(epoll_create1(EPOLL_CLOEXEC)) {}
+    ~Poller() { if (ep_ >= 0) close(ep_); }
+    bool ok() const { return ep_ >= 0; }
+
+    bool add(int fd, unsigned want) {
+        struct epoll_event ev;
+        std::memset(&ev, 0, sizeof(ev));
+        ev.events = mask(want);
+        ev.data.fd = fd;
+        return epoll_ctl(ep_, EPOLL_CTL_ADD, fd, &ev) == 0;
+    }
+
+    void set(int fd, unsigned want) {
+        struct epoll_event ev;
+        std::memset(&ev, 0, sizeof(ev));
+        ev.events = mask(want);
+        ev.data.fd = fd;
+        epoll_ctl(ep_, EPOLL_CTL_MOD, fd, &ev);
+    }
+
+    void remove(int fd) {
+        epoll_ctl(ep_, EPOLL_CTL_DEL, fd, nullptr);
+    }
+
+    /* Returns false on an error other than EINTR */
+    bool wait(std::vector<Event> &out) {
+        struct epoll_event evs[64];
+        out.clear();
+        int n = epoll_wait(ep_, evs, 64, -1);
+        if (n < 0) return errno == EINTR;
+        for (int i = 0; i < n; i++) {
+            Event e;
+            e.fd = evs[i].data.fd;
+            e.readable = (evs[i].events & (EPOLLIN | EPOLLRDHUP)) != 0;
+            e.writable = (evs[i].events & EPOLLOUT) != 0;
+            e.rdhup = (evs[i].events & EPOLLRDHUP) != 0;
+            e.hangup = (evs[i].events & (EPOLLERR | EPOLLHUP)) != 0;
+            out.push_back(e);
+        }
+        return true;
+    }
+
+private:
+    /* Readiness is level-triggered: RDHUP stays reported until it is dropped from the mask */
+    static uint32_t mask(unsigned want) {
+        uint32_t m = 0;
+        if (want & WANT_READ) m |= EPOLLIN;
+        if (want & WANT_RDHUP) m |= EPOLLRDHUP;
+        if (want & WANT_WRITE) m |= EPOLLOUT;
+        return m;
+    }
+
+    int ep_;
+#else
+    bool ok() const { return true; }
+
+    bool add(int fd, unsigned want) {
+        struct pollfd p;
+        p.fd = fd;
+        p.events = mask(want);
+        p.revents = 0;
+        fds_.push_back(p);
+        return true;
+    }
+
+    void set(int fd, unsigned want) {
+        for (auto &p : fds_) {
+            if (p.fd == fd) p.events = mask(want);
+        }
+    }
+
+    void remove(int fd) {
+        for (size_t i = 0; i < fds_.size(); i++) {
+            if (fds_[i].fd != fd) continue;
+            fds_[i] = fds_.back();
+            fds_.pop_back();
+            return;
+        }
+    }
+
+    bool wait(std::vector<Event> &out) {
+        out.clear();
+        int n = poll(fds_.data(), static_cast<nfds_t>(fds_.size()), -1);
+        if (n < 0) return errno == EINTR;
+        for (const auto &p : fds_) {
+            if (!p.revents) continue;
+            Event e;
+            e.fd = p.fd;
+            e.readable = (p.revents & POLLIN) != 0;
+            e.writable = (p.revents & POLLOUT) != 0;
+            e.rdhup = false;
+            e.hangup = (p.revents & (POLLERR | POLLHUP | POLLNVAL)) != 0;
+            out.push_back(e);
+        }
+        return true;
+    }
+
+private:
+    /* poll() has no half-close event; end of input shows up as POLLIN */
+    static short mask(unsigned want) {
+        return static_cast<short>(((want & WANT_READ) ? POLLIN : 0) | ((want & WANT_WRITE) ? POLLOUT : 0));
+    }
+
+    std::vector<struct pollfd> fds_;
+#endif
+};
+
+class Server {
+public:
+    Server() : listen_fd_(-1), shutdown_(false), frames_(0), calls_(0), accepted_(0) {}
+
+    int run(const char *socket_path);
+
+private:
+    void accept_all();
+    void receive(Conn &c);
+    void process(Conn &c);
+    void pump(Conn &c);
+    void flush(Conn &c);
+    void update(Conn &c);
+    void drop(int fd);
+    bool answer(Conn &c, const serve_frame &f, const char *payload);
+    bool read_name(const char *&p, const char *end, std::string &name);
+    uint32_t resolve(const std::string &name, int32_t &status);
+    void call(bu_plugin_cmd_handle h, serve_result &r);
+
+    int listen_fd_;
+    bool shutdown_;
+    Poller poller_;
+    std::unordered_map<int, std::unique_ptr<Conn> > conns_;
+    std::vector<bu_plugin_cmd_handle> handles_;         /* By id */
+    std::unordered_map<std::string, uint32_t> ids_;
+    unsigned long long frames_, calls_, accepted_;
+};
+
+void Server::call(bu_plugin_cmd_handle h, serve_result &r) {
+    int result = 0;
+    r.status = bu_plugin_cmd_invoke(h, &result);
+    r.result = (r.status == 0) ? result : 0;
+    calls_++;
+}
+
+uint32_t Server::resolve(const std::string &name, int32_t &status) {
+    auto it = ids_.find(name);
+    if (it != ids_.end()) {
+        status = 0;
+        return it->second;
+    }
+    if (!bu_plugin_cmd_exists(name.c_str())) {
+        status = -1;
+        return 0;
+    }
+    uint32_t id = static_cast<uint32_t>(handles_.size());
+    handles_.push_back(bu_plugin_cmd_lookup(name.c_str()));
+    ids_[name] = id;
+    status = 0;
+    return id;
+}
+
+bool Server::read_name(const char *&p, const char *end, std::string &name) {
+    uint16_t n;
+    if (end - p < static_cast<ptrdiff_t>(sizeof(n))) return false;
+    std::memcpy(&n, p, sizeof(n));
+    p += sizeof(n);
+    if (end - p < static_cast<ptrdiff_t>(n)) return false;
+    name.assign(p, n);
+    p += n;
+    return true;
+}
+
+/* Append the reply to one frame; false if the frame is malformed */
+bool Server::answer(Conn &c, const serve_frame &f, const char *payload) {
+    const char *p = payload;
+    const char *end = payload + f.len;
+    std::string &out = c.out;
+    frames_++;
+    switch (f.op) {
+        case SERVE_OP_RESOLVE: {
+            serve_put_frame(out, f.op, f.tag, f.count, f.count * sizeof(serve_resolved));
+            std::string name;
+            for (uint16_t i = 0; i < f.count; i++) {
+                if (!read_name(p, end, name)) return false;
+                serve_resolved r;
+                r.id = resolve(name, r.status);
+                out.append(reinterpret_cast<const char *>(&r), sizeof(r));
+            }
+            return p == end;
+        }
+        case SERVE_OP_CALL: {
+            if (f.len != f.count * sizeof(uint32_t)) return false;
+            serve_put_frame(out, f.op, f.tag, f.count, f.count * sizeof(serve_result));
+            for (uint16_t i = 0; i < f.count; i++) {
+                uint32_t id;
+                std::memcpy(&id, p + i * sizeof(id), sizeof(id));
+                serve_result r = { -1, 0 };
+                if (id < handles_.size()) call(handles_[id], r);
+                out.append(reinterpret_cast<const char *>(&r), sizeof(r));
+            }
+            return true;
+        }
+        case SERVE_OP_CALL_NAMED: {
+            serve_put_frame(out, f.op, f.tag, f.count, f.count * sizeof(serve_result));
+            std::string name;
+            for (uint16_t i = 0; i < f.count; i++) {
+                if (!read_name(p, end, name)) return false;
+                serve_result r = { -1, 0 };
+                int32_t status;
+                uint32_t id = resolve(name, status);
+                if (status == 0) call(handles_[id], r);
+                out.append(reinterpret_cast<const char *>(&r), sizeof(r));
+            }
+            return p == end;
+        }
+        case SERVE_OP_SHUTDOWN:
+            serve_put_frame(out, f.op, f.tag, 0, 0);
+            shutdown_ = true;
+            return f.len == 0;
+        default:
+            return false;
+    }
+}
+
+void Server::accept_all() {
+    for (;;) {
+        int fd = accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            return;     /* EAGAIN: drained */
+        }
+        unsigned want = Poller::WANT_READ | Poller::WANT_RDHUP;
+        if (!set_nonblocking(fd) || !poller_.add(fd, want)) {
+            close(fd);
+            continue;
+        }
+        Conn *c = new Conn(fd);
+        c->want = want;
+        conns_[fd].reset(c);
+        accepted_++;
+    }
+}
+
+void Server::drop(int fd) {
+    poller_.remove(fd);
+    close(fd);
+    conns_.erase(fd);
+}
+
+void Server::flush(Conn &c) {
+    while (c.out_off < c.out.size()) {
+        ssize_t n = send(c.fd, c.out.data() + c.out_off, c.out.size() - c.out_off, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && would_block()) break;
+        if (n <= 0) {
+            c.closing = true;
+            c.out.clear();
+            c.out_off = 0;
+            break;
+        }
+        c.out_off += static_cast<size_t>(n);
+    }
+    if (c.out_off == c.out.size()) {
+        c.out.clear();
+        c.out_off = 0;
+    }
+}
+
+/* Register for what c can make progress on: reading while both buffers have room, writing while replies wait */
+void Server::update(Conn &c) {
+    unsigned want = 0;
+    if (!c.eof && !c.closing && c.in.size() < IN_CAP && c.pending() < OUT_CAP) {
+        want |= Poller::WANT_READ;
+        if (!c.rdhup) want |= Poller::WANT_RDHUP;
+    }
+    if (c.pending()) want |= Poller::WANT_WRITE;
+    if (want == c.want) return;
+    poller_.set(c.fd, want);
+    c.want = want;
+}
+
+void Server::receive(Conn &c) {
+    char buf[65536];
+    while (!c.eof && c.in.size() < IN_CAP) {
+        ssize_t n = recv(c.fd, buf, std::min(sizeof(buf), IN_CAP - c.in.size()), 0);
+        if (n > 0) {
+            c.in.append(buf, static_cast<size_t>(n));
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n == 0 || !would_block()) c.eof = true;
+        break;
+    }
+}
+
+/* Answer complete frames while the unsent replies stay under OUT_CAP */
+void Server::process(Conn &c) {
+    if (c.out_off) {
+        c.out.erase(0, c.out_off);
+        c.out_off = 0;
+    }
+    size_t pos = 0;
+    while (!c.closing && c.out.size() < OUT_CAP && c.in.size() - pos >= sizeof(serve_frame)) {
+        serve_frame f;
+        std::memcpy(&f, c.in.data() + pos, sizeof(f));
+        if (f.len > SERVE_MAX_PAYLOAD) {
+            serve_put_frame(c.out, SERVE_OP_ERROR, f.tag, 0, 0);
+            c.closing = true;
+            break;
+        }
+        if (c.in.size() - pos - sizeof(f) < f.len) break;
+        size_t mark = c.out.size();
+        if (!answer(c, f, c.in.data() + pos + sizeof(f))) {
+            c.out.resize(mark);
+            serve_put_frame(c.out, SERVE_OP_ERROR, f.tag, 0, 0);
+            c.closing = true;
+        }
+        pos += sizeof(f) + f.len;
+    }
+    c.in.erase(0, pos);
+    /* After end of input, whatever is left short of the cap is an incomplete frame */
+    if (c.eof && c.out.size() < OUT_CAP) c.closing = true;
+}
+
+/* Answer and write back until the socket is full or no complete frame is left */
+void Server::pump(Conn &c) {
+    for (;;) {
+        process(c);
+        flush(c);
+        if (c.closing || c.pending() || c.in.size() < sizeof(serve_frame)) return;
+    }
+}
+
+int Server::run(const char *socket_path) {
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (std::strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", socket_path);
+        return 1;
+    }
+    std::strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd_ < 0 || !poller_.ok()) {
+        fprintf(stderr, "Cannot create the server socket: %s\n", std::strerror(errno));
+        return 1;
+    }
+    unlink(socket_path);
+    if (bind(listen_fd_, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0 ||
+        listen(listen_fd_, SOMAXCONN) != 0 || !set_nonblocking(listen_fd_) ||
+        !poller_.add(listen_fd_, Poller::WANT_READ)) {
+        fprintf(stderr, "Cannot listen on %s: %s\n", socket_path, std::strerror(errno));
+        close(listen_fd_);
+        return 1;
+    }
+    printf("Serving %zu command(s) on %s\n", bu_plugin_cmd_count(), socket_path);
+    fflush(stdout);
+
+    std::vector<Poller::Event> events;
+    while (!s_stop && !shutdown_) {
+        if (!poller_.wait(events)) {
+            fprintf(stderr, "Event loop failed: %s\n", std::strerror(errno));
+            break;
+        }
+        for (const auto &e : events) {
+            if (e.fd == listen_fd_) {
+                accept_all();
+                continue;
+            }
+            auto it = conns_.find(e.fd);
+            if (it == conns_.end()) continue;
+            Conn &c = *it->second;
+            if (e.rdhup) c.rdhup = true;
+            if (e.readable || e.hangup) receive(c);
+            pump(c);
+            if (e.hangup || (c.closing && !c.pending())) {
+                drop(e.fd);
+                continue;
+            }
+            update(c);
+        }
+    }
+
+    /* Deliver what is already answered (the shutdown reply among it) */
+    for (auto &pair : conns_) {
+        flush(*pair.second);
+        close(pair.first);
+    }
+    conns_.clear();
+    close(listen_fd_);
+    unlink(socket_path);
+    fprintf(stderr, "Served %llu frame(s), %llu call(s) on %llu connection(s)\n", frames_, calls_, accepted_);
+    return 0;
+}
+
+} /* namespace */
+
+int serve_main(const char *socket_path) {
+    struct sigaction sa;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    /* A long-running server must not accumulate buffered log messages */
+    bu_plugin_flush_logs(serve_logger);
+    bu_plugin_set_logger(serve_logger);
+
+    Server server;
+    return server.run(socket_path);
+}
+
+#endif /* !_WIN32 */
@@ -0,0 +1,80 @@
+/**
+ * serve.h - Command server protocol for run_bu_plugin (POSIX only).
+ *
+ * run_bu_plugin --serve loads its plugins once and answers command
+ * requests on a Unix domain socket; run_bu_plugin --bench is a load
+ * generator for it. Both ends, and tests/test_serve.cpp, share the
+ * definitions below.
+ *
+ * Every message is a frame: a serve_frame header followed by len payload
+ * bytes. Integers are in native byte order (the socket is local). A client
+ * may send any number of frames without waiting; the server answers them
+ * in order, one reply frame per request frame, echoing the tag.
+ *
+ *   SERVE_OP_RESOLVE     count names            -> count serve_resolved
+ *   SERVE_OP_CALL        count uint32_t ids     -> count serve_result
+ *   SERVE_OP_CALL_NAMED  count names            -> count serve_result
+ *   SERVE_OP_SHUTDOWN    (empty)                -> (empty), then the server exits
+ *
+ * A name is a uint16_t length followed by that many bytes (no NUL). Ids
+ * come from SERVE_OP_RESOLVE and stay valid for the server's lifetime, so
+ * a client resolves once and then sends four bytes per invocation.
+ * Statuses follow bu_plugin_cmd_run(): 0, -1 (unknown command or id), -2
+ * (threw). A frame the server cannot parse gets a SERVE_OP_ERROR reply and
+ * the connection is closed.
+ */
+
+#ifndef RUN_BU_PLUGIN_SERVE_H
+#define RUN_BU_PLUGIN_SERVE_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#define SERVE_OP_RESOLVE     1
+#define SERVE_OP_CALL        2
+#define SERVE_OP_CALL_NAMED  3
+#define SERVE_OP_SHUTDOWN    4
+#define SERVE_OP_ERROR       0xffff
+
+#define SERVE_MAX_PAYLOAD    (1u << 20)
+
+struct serve_frame {
+    uint32_t len;       /* Payload bytes after the header */
+    uint32_t tag;       /* Chosen by the client, echoed in the reply */
+    uint16_t op;        /* SERVE_OP_* */
+    uint16_t count;     /* Entries in the payload */
+};
+
+struct serve_resolved {
+    int32_t status;     /* 0, or -1 if the name is not registered */
+    uint32_t id;
+};
+
+struct serve_result {
+    int32_t status;
+    int32_t result;
+};
+
+/* Append a frame header to buf */
+static inline void serve_put_frame(std::string &buf, uint16_t op, uint32_t tag, uint16_t count, size_t len) {
+    serve_frame f;
+    f.len = static_cast<uint32_t>(len);
+    f.tag = tag;
+    f.op = op;
+    f.count = count;
+    buf.append(reinterpret_cast<const char *>(&f), sizeof(f));
+}
+
+/* Append one length-prefixed name to buf */
+static inline void serve_put_name(std::string &buf, const char *name) {
+    uint16_t n = static_cast<uint16_t>(std::strlen(name));
+    buf.append(reinterpret_cast<const char *>(&n), sizeof(n));
+    buf.append(name, n);
+}
+
+/* Entry points behind the run_bu_plugin modes */
+int serve_main(const char *socket_path);
+int bench_main(int argc, char *argv[]);
+
+#endif /* RUN_BU_PLUGIN_SERVE_H */
@@ -6,25 +6,27 @@
  *   - Tests that the plugin system works with pure C plugins
  *   - Verifies cross-platform compatibility (especially Windows)
  *   - Includes abi_version and struct_size for ABI safety
+ *   - Writes its output through the host services table
+ *   - Flags its commands BU_PLUGIN_CMD_NOEXCEPT: C code cannot throw
  */
 
-#include <stdio.h>
-
 /* When building a plugin, we export symbols */
 #ifndef BU_PLUGIN_BUILDING_DLL
 #define BU_PLUGIN_BUILDING_DLL
 #endif
 #include "bu_plugin.h"
 
+static const bu_plugin_host_services *s_host = NULL;
+
 /* C-only command implementation */
 static int c_only_hello(void) {
-    printf("Hello from the C-only plugin!\n");
+    s_host->output_printf("Hello from the C-only plugin!\n");
     return 100;
 }
 
 /* Another C-only command */
 static int c_only_goodbye(void) {
-    printf("Goodbye from the C-only plugin!\n");
+    s_host->output_printf("Goodbye from the C-only plugin!\n");
     return 200;
 }
 
@@ -34,15 +36,36 @@ static bu_plugin_cmd s_commands[] = {
     { "c_only_goodbye", c_only_goodbye }
 };
 
+/* C cannot throw, so the host may call these without an exception frame */
+static const unsigned int s_cmd_flags[] = {
+    BU_PLUGIN_CMD_NOEXCEPT,
+    BU_PLUGIN_CMD_NOEXCEPT
+};
+
+static int c_only_bind(const bu_plugin_host_services *host) {
+    if (!host || !BU_PLUGIN_HAS_FIELD(bu_plugin_host_services, host->struct_size, output_printf)) return 1;
+    s_host = host;
+    return 0;
+}
+
 /* Define the manifest with ABI safety fields */
-static bu_plugin_manifest s_manifest = {
-    "bu-c-only-plugin",     /* plugin_name */
-    1,                      /* version */
-    2,                      /* cmd_count */
-    s_commands,             /* commands */
-    BU_PLUGIN_ABI_VERSION,  /* abi_version */
-    sizeof(bu_plugin_manifest) /* struct_size */
+static bu_plugin_manifest_v2 s_manifest = {
+    {
+        "bu-c-only-plugin",             /* plugin_name */
+        1,                              /* version */
+        2,                              /* cmd_count */
+        s_commands,                     /* commands */
+        BU_PLUGIN_ABI_VERSION,          /* abi_version */
+        sizeof(bu_plugin_manifest_v2)   /* struct_size */
+    },
+    BU_PLUGIN_MANIFEST_EXT_VERSION,     /* ext_version */
+    NULL,                               /* depends */
+    NULL,                               /* init */
+    NULL,                               /* fini */
+    c_only_bind,                        /* bind */
+    s_cmd_flags,                        /* cmd_flags */
+    NULL                                /* cmd_batch */
 };
 
 /* Export the manifest */
-BU_PLUGIN_DECLARE_MANIFEST(s_manifest)
+BU_PLUGIN_DECLARE_MANIFEST_V2(s_manifest)
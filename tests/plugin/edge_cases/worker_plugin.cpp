@@ -0,0 +1,53 @@
+/**
+ * worker_plugin.cpp - Plugin for out-of-process loading tests.
+ *
+ * Reports the process it runs in, and can throw or take its process down,
+ * so the tests can tell a pooled command from an in-process one and
+ * exercise worker restarts.
+ */
+
+#include <cstdlib>
+#include <stdexcept>
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+#ifndef BU_PLUGIN_BUILDING_DLL
+#define BU_PLUGIN_BUILDING_DLL
+#endif
+#include "bu_plugin.h"
+
+/* The id of the process running the command */
+static int worker_pid(void) {
+#if defined(_WIN32)
+    return 0;
+#else
+    return static_cast<int>(getpid());
+#endif
+}
+
+static int worker_throw(void) {
+    throw std::runtime_error("worker plugin failure");
+}
+
+/* Kills whatever process runs it */
+static int worker_abort(void) {
+    std::abort();
+}
+
+static bu_plugin_cmd s_commands[] = {
+    { "worker_pid", worker_pid },
+    { "worker_throw", worker_throw },
+    { "worker_abort", worker_abort }
+};
+
+static bu_plugin_manifest s_manifest = {
+    "bu-worker-plugin",     /* plugin_name */
+    1,                      /* version */
+    3,                      /* cmd_count */
+    s_commands,             /* commands */
+    BU_PLUGIN_ABI_VERSION,  /* abi_version */
+    sizeof(bu_plugin_manifest) /* struct_size */
+};
+
+BU_PLUGIN_DECLARE_MANIFEST(s_manifest)
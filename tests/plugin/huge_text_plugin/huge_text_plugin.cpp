@@ -0,0 +1,67 @@
+/**
+ * huge_text_plugin.cpp - Plugin whose text spans whole 2 MiB pages.
+ *
+ * This plugin:
+ *   - Pads its text segment with 4 MiB of return instructions (Linux on
+ *     x86 and AArch64), so BU_PLUGIN_LOAD_HUGEPAGES has an aligned range
+ *     to move onto huge pages
+ *   - Implements "huge_text_probe", which calls into the middle of that
+ *     range and so fails loudly if the moved copy is not executable
+ */
+
+#include <cstdint>
+
+#ifndef BU_PLUGIN_BUILDING_DLL
+#define BU_PLUGIN_BUILDING_DLL
+#endif
+#include "bu_plugin.h"
+
+#if defined(__linux__) && (defined(__x86_64__) || defined(__i386__))
+__asm__(".pushsection .text\n"
+        ".balign 4096\n"
+        "huge_text_pad:\n"
+        ".fill 4194304, 1, 0xc3\n"          /* ret */
+        ".popsection\n");
+#define HUGE_TEXT_PADDED 1
+#elif defined(__linux__) && defined(__aarch64__)
+__asm__(".pushsection .text\n"
+        ".balign 4096\n"
+        "huge_text_pad:\n"
+        ".fill 1048576, 4, 0xd65f03c0\n"    /* ret */
+        ".popsection\n");
+#define HUGE_TEXT_PADDED 1
+#endif
+
+#if defined(HUGE_TEXT_PADDED)
+extern "C" __attribute__((visibility("hidden"))) const char huge_text_pad[];
+
+/* Returns 1 after calling the first instruction of the pad's first aligned 2 MiB page */
+static int huge_text_probe(void) {
+    const uintptr_t huge = 2u * 1024u * 1024u;
+    uintptr_t target = (reinterpret_cast<uintptr_t>(huge_text_pad) + huge - 1) & ~(huge - 1);
+    reinterpret_cast<void (*)(void)>(target)();
+    return 1;
+}
+#else
+static int huge_text_probe(void) {
+    return 0;
+}
+#endif
+
+/* Define the command array */
+static bu_plugin_cmd s_commands[] = {
+    { "huge_text_probe", huge_text_probe }
+};
+
+/* Define the manifest */
+static bu_plugin_manifest s_manifest = {
+    "bu-huge-text-plugin",  /* plugin_name */
+    1,                      /* version */
+    1,                      /* cmd_count */
+    s_commands,             /* commands */
+    BU_PLUGIN_ABI_VERSION,  /* abi_version */
+    sizeof(bu_plugin_manifest) /* struct_size */
+};
+
+/* Export the manifest */
+BU_PLUGIN_DECLARE_MANIFEST(s_manifest)
@@ -5,28 +5,29 @@
  *   - Implements multiple math commands
  *   - Tests loading plugins with multiple commands
  *   - Tests that different plugins can coexist
+ *   - Writes its output through the host services table
  */
 
-#include <cstdio>
-
 #ifndef BU_PLUGIN_BUILDING_DLL
 #define BU_PLUGIN_BUILDING_DLL
 #endif
 #include "bu_plugin.h"
 
+static const bu_plugin_host_services *s_host = nullptr;
+
 /* Math command implementations */
 static int math_add(void) {
-    printf("Math plugin: add command (2+3=5)\n");
+    s_host->output_printf("Math plugin: add command (2+3=5)\n");
     return 5;
 }
 
 static int math_multiply(void) {
-    printf("Math plugin: multiply command (2*3=6)\n");
+    s_host->output_printf("Math plugin: multiply command (2*3=6)\n");
     return 6;
 }
 
 static int math_square(void) {
-    printf("Math plugin: square command (4^2=16)\n");
+    s_host->output_printf("Math plugin: square command (4^2=16)\n");
     return 16;
 }
 
@@ -37,15 +38,30 @@ static bu_plugin_cmd s_commands[] = {
     { "math_square", math_square }
 };
 
+static int math_bind(const bu_plugin_host_services *host) {
+    if (!host || !BU_PLUGIN_HAS_FIELD(bu_plugin_host_services, host->struct_size, output_printf)) return 1;
+    s_host = host;
+    return 0;
+}
+
 /* Define the manifest */
-static bu_plugin_manifest s_manifest = {
-    "bu-math-plugin",       /* plugin_name */
-    1,                      /* version */
-    3,                      /* cmd_count - 3 commands */
-    s_commands,             /* commands */
-    BU_PLUGIN_ABI_VERSION,  /* abi_version */
-    sizeof(bu_plugin_manifest) /* struct_size */
+static bu_plugin_manifest_v2 s_manifest = {
+    {
+        "bu-math-plugin",               /* plugin_name */
+        1,                              /* version */
+        3,                              /* cmd_count - 3 commands */
+        s_commands,                     /* commands */
+        BU_PLUGIN_ABI_VERSION,          /* abi_version */
+        sizeof(bu_plugin_manifest_v2)   /* struct_size */
+    },
+    BU_PLUGIN_MANIFEST_EXT_VERSION,     /* ext_version */
+    nullptr,                            /* depends */
+    nullptr,                            /* init */
+    nullptr,                            /* fini */
+    math_bind,                          /* bind */
+    nullptr,                            /* cmd_flags */
+    nullptr                             /* cmd_batch */
 };
 
 /* Export the manifest */
-BU_PLUGIN_DECLARE_MANIFEST(s_manifest)
+BU_PLUGIN_DECLARE_MANIFEST_V2(s_manifest)
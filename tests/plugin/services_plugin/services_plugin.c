@@ -0,0 +1,105 @@
+/**
+ * services_plugin.c - A plugin that calls the host only through the services table.
+ *
+ * This plugin:
+ *   - Has no link-time dependency on the host library
+ *   - Receives bu_plugin_host_services through its v2 bind hook
+ *   - Resolves a command handle in its init hook and invokes it later
+ *   - Allocates through the host's heap
+ *   - Declares per-command flags (services_answer is thread-safe)
+ *   - Polls the caller's call context to stop early (services_poll)
+ */
+
+#include <string.h>
+
+#ifndef BU_PLUGIN_BUILDING_DLL
+#define BU_PLUGIN_BUILDING_DLL
+#endif
+#include "bu_plugin.h"
+
+static const bu_plugin_host_services *s_host = NULL;
+static bu_plugin_cmd_handle s_answer = NULL;
+
+static int services_answer(void) {
+    return 42;
+}
+
+/* Invoke services_answer through its handle */
+static int services_call(void) {
+    int result = 0;
+    if (s_host->cmd_invoke(s_answer, &result) != 0) return -1;
+    return result + 1;
+}
+
+/* Round-trip a buffer through the host allocator; returns the registry size */
+static int services_alloc(void) {
+    bu_plugin_host_stats stats;
+    char *buf = (char *)s_host->mem_alloc(16);
+    if (!buf) return -1;
+    memcpy(buf, "services", 9);
+    buf = (char *)s_host->mem_realloc(buf, 4096);
+    if (!buf || strcmp(buf, "services") != 0) {
+        s_host->mem_free(buf);
+        return -1;
+    }
+    s_host->mem_free(buf);
+
+    memset(&stats, 0, sizeof(stats));
+    stats.struct_size = sizeof(stats);
+    s_host->stats(&stats);
+    return (int)stats.cmd_count;
+}
+
+/* Spin until the call context stops; returns 1 if it did, -1 without a context */
+static int services_poll(void) {
+    const bu_plugin_call_ctx *ctx = s_host->call_ctx_current();
+    if (!ctx) return -1;
+    while (!bu_plugin_call_ctx_stopped(ctx)) {}
+    return 1;
+}
+
+static int services_bind(const bu_plugin_host_services *host) {
+    if (!host || !BU_PLUGIN_HAS_FIELD(bu_plugin_host_services, host->struct_size, call_ctx_current)) return 1;
+    s_host = host;
+    s_host->log_printf(BU_LOG_INFO, "Services plugin bound to host services v%u", host->version);
+    return 0;
+}
+
+static int services_init(void) {
+    s_answer = s_host->cmd_lookup("services_answer");
+    return s_answer ? 0 : 1;
+}
+
+static bu_plugin_cmd s_commands[] = {
+    { "services_answer", services_answer },
+    { "services_call", services_call },
+    { "services_alloc", services_alloc },
+    { "services_poll", services_poll }
+};
+
+static const unsigned int s_cmd_flags[] = {
+    BU_PLUGIN_CMD_THREADSAFE,
+    0,
+    0,
+    BU_PLUGIN_CMD_THREADSAFE
+};
+
+static bu_plugin_manifest_v2 s_manifest = {
+    {
+        "bu-services-plugin",           /* plugin_name */
+        1,                              /* version */
+        4,                              /* cmd_count */
+        s_commands,                     /* commands */
+        BU_PLUGIN_ABI_VERSION,          /* abi_version */
+        sizeof(bu_plugin_manifest_v2)   /* struct_size */
+    },
+    BU_PLUGIN_MANIFEST_EXT_VERSION,     /* ext_version */
+    NULL,                               /* depends */
+    services_init,                      /* init */
+    NULL,                               /* fini */
+    services_bind,                      /* bind */
+    s_cmd_flags,                        /* cmd_flags */
+    NULL                                /* cmd_batch */
+};
+
+BU_PLUGIN_DECLARE_MANIFEST_V2(s_manifest)
@@ -0,0 +1,94 @@
+/**
+ * soa_plugin.cpp - Reference plugin with batched (structure-of-arrays) entry points.
+ *
+ * This plugin:
+ *   - Declares a bu_plugin_cmd_batch_impl next to each scalar impl
+ *     (bu_plugin_manifest_v2.cmd_batch)
+ *   - Keeps its batched loops free of calls and branches so the compiler
+ *     vectorizes them
+ *   - Flags both commands thread-safe, so batches may also be split across
+ *     the executor
+ *
+ * With the default int (*)(void) signature a command has no inputs, so
+ * both commands draw from a sequence: soa_counter returns consecutive
+ * values and soa_hash returns a 32-bit mix of consecutive values (an id
+ * or seed generator). A batch reserves n sequence numbers at once, so a
+ * batch of n returns what n scalar calls would.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#ifndef BU_PLUGIN_BUILDING_DLL
+#define BU_PLUGIN_BUILDING_DLL
+#endif
+#include "bu_plugin.h"
+
+static std::atomic<uint32_t> s_counter(0);
+static std::atomic<uint32_t> s_hash_seq(0);
+
+/* Murmur3 finalizer */
+static inline uint32_t mix32(uint32_t h) {
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+static int soa_counter(void) {
+    return static_cast<int>(s_counter.fetch_add(1, std::memory_order_relaxed));
+}
+
+static int soa_counter_batch(size_t n, int *results) {
+    uint32_t base = s_counter.fetch_add(static_cast<uint32_t>(n), std::memory_order_relaxed);
+    for (size_t i = 0; i < n; i++) results[i] = static_cast<int>(base + static_cast<uint32_t>(i));
+    return 0;
+}
+
+static int soa_hash(void) {
+    return static_cast<int>(mix32(s_hash_seq.fetch_add(1, std::memory_order_relaxed)));
+}
+
+static int soa_hash_batch(size_t n, int *results) {
+    uint32_t base = s_hash_seq.fetch_add(static_cast<uint32_t>(n), std::memory_order_relaxed);
+    for (size_t i = 0; i < n; i++) results[i] = static_cast<int>(mix32(base + static_cast<uint32_t>(i)));
+    return 0;
+}
+
+static bu_plugin_cmd s_commands[] = {
+    { "soa_counter", soa_counter },
+    { "soa_hash", soa_hash }
+};
+
+static const unsigned int s_cmd_flags[] = {
+    BU_PLUGIN_CMD_THREADSAFE,
+    BU_PLUGIN_CMD_THREADSAFE
+};
+
+static const bu_plugin_cmd_batch_impl s_cmd_batch[] = {
+    soa_counter_batch,
+    soa_hash_batch
+};
+
+static bu_plugin_manifest_v2 s_manifest = {
+    {
+        "bu-soa-plugin",                /* plugin_name */
+        1,                              /* version */
+        2,                              /* cmd_count */
+        s_commands,                     /* commands */
+        BU_PLUGIN_ABI_VERSION,          /* abi_version */
+        sizeof(bu_plugin_manifest_v2)   /* struct_size */
+    },
+    BU_PLUGIN_MANIFEST_EXT_VERSION,     /* ext_version */
+    nullptr,                            /* depends */
+    nullptr,                            /* init */
+    nullptr,                            /* fini */
+    nullptr,                            /* bind */
+    s_cmd_flags,                        /* cmd_flags */
+    s_cmd_batch                         /* cmd_batch */
+};
+
+BU_PLUGIN_DECLARE_MANIFEST_V2(s_manifest)
@@ -0,0 +1,156 @@
+/**
+ * stream_plugin.cpp - Reference plugin for record channels.
+ *
+ * This plugin:
+ *   - Implements three pipeline stages that exchange typed records
+ *     through their input and output channels (stream_records.h)
+ *   - Reserves and peeks records in runs and works on them in place, so
+ *     nothing is copied between stages
+ *   - Checks the record type of each channel before using it
+ *   - Calls the host only through the host services table
+ *
+ * stream_draw turns each stream_job into job.count segments, stream_render
+ * measures each segment, and stream_volume sums the samples and returns
+ * how many it saw. Each stage returns -1 if its channels carry the wrong
+ * records.
+ */
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#ifndef BU_PLUGIN_BUILDING_DLL
+#define BU_PLUGIN_BUILDING_DLL
+#endif
+#include "bu_plugin.h"
+#include "stream_records.h"
+
+static const bu_plugin_host_services *s_host = nullptr;
+
+/* Records moved per reserve/peek */
+static const size_t STREAM_RUN = 256;
+
+static bool has_type(bu_plugin_channel *ch, const char *type, size_t size) {
+    return ch && s_host->channel_check(ch, type, size) == 0;
+}
+
+static int stream_draw(void) {
+    bu_plugin_channel *in = s_host->channel_input();
+    bu_plugin_channel *out = s_host->channel_output();
+    if (!has_type(in, STREAM_JOB_TYPE, sizeof(stream_job)) ||
+        !has_type(out, STREAM_SEGMENT_TYPE, sizeof(stream_segment))) {
+        return -1;
+    }
+    size_t got = 0;
+    uint32_t id = 0;
+    while (const stream_job *jobs = static_cast<const stream_job *>(s_host->channel_peek(in, 1, &got))) {
+        stream_job job = jobs[0];
+        s_host->channel_release(in, 1);
+        uint32_t state = job.seed | 1u;
+        uint32_t left = job.count;
+        while (left) {
+            stream_segment *seg = static_cast<stream_segment *>(s_host->channel_reserve(out, left < STREAM_RUN ? left : STREAM_RUN, &got));
+            if (!seg) return static_cast<int>(id);
+            for (size_t i = 0; i < got; i++) {
+                /* xorshift32 coordinates in [0, 1) */
+                float c[4];
+                for (float &v : c) {
+                    state ^= state << 13;
+                    state ^= state >> 17;
+                    state ^= state << 5;
+                    v = static_cast<float>(state >> 8) * (1.0f / 16777216.0f);
+                }
+                seg[i].x0 = c[0];
+                seg[i].y0 = c[1];
+                seg[i].x1 = c[2];
+                seg[i].y1 = c[3];
+                seg[i].id = id++;
+                seg[i].job = job.seed;
+            }
+            s_host->channel_commit(out, got);
+            left -= static_cast<uint32_t>(got);
+        }
+    }
+    return static_cast<int>(id);
+}
+
+static int stream_render(void) {
+    bu_plugin_channel *in = s_host->channel_input();
+    bu_plugin_channel *out = s_host->channel_output();
+    if (!has_type(in, STREAM_SEGMENT_TYPE, sizeof(stream_segment)) ||
+        !has_type(out, STREAM_SAMPLE_TYPE, sizeof(stream_sample))) {
+        return -1;
+    }
+    size_t got = 0;
+    int rendered = 0;
+    while (const stream_segment *seg = static_cast<const stream_segment *>(s_host->channel_peek(in, STREAM_RUN, &got))) {
+        size_t room = 0;
+        stream_sample *smp = static_cast<stream_sample *>(s_host->channel_reserve(out, got, &room));
+        if (!smp) return rendered;
+        for (size_t i = 0; i < room; i++) {
+            float dx = seg[i].x1 - seg[i].x0;
+            float dy = seg[i].y1 - seg[i].y0;
+            smp[i].id = seg[i].id;
+            smp[i].length = std::sqrt(dx * dx + dy * dy);
+            smp[i].cx = 0.5f * (seg[i].x0 + seg[i].x1);
+            smp[i].cy = 0.5f * (seg[i].y0 + seg[i].y1);
+        }
+        s_host->channel_commit(out, room);
+        s_host->channel_release(in, room);
+        rendered += static_cast<int>(room);
+    }
+    return rendered;
+}
+
+static int stream_volume(void) {
+    bu_plugin_channel *in = s_host->channel_input();
+    if (!has_type(in, STREAM_SAMPLE_TYPE, sizeof(stream_sample))) return -1;
+    size_t got = 0;
+    int count = 0;
+    double total = 0.0;
+    while (const stream_sample *smp = static_cast<const stream_sample *>(s_host->channel_peek(in, STREAM_RUN, &got))) {
+        for (size_t i = 0; i < got; i++) total += static_cast<double>(smp[i].length);
+        count += static_cast<int>(got);
+        s_host->channel_release(in, got);
+    }
+    s_host->output_printf("stream_volume: %d sample(s), mean length %.4f\n", count, count ? total / static_cast<double>(count) : 0.0);
+    return count;
+}
+
+static int stream_bind(const bu_plugin_host_services *host) {
+    if (!host || !BU_PLUGIN_HAS_FIELD(bu_plugin_host_services, host->struct_size, channel_release)) return 1;
+    s_host = host;
+    return 0;
+}
+
+static bu_plugin_cmd s_commands[] = {
+    { "stream_draw", stream_draw },
+    { "stream_render", stream_render },
+    { "stream_volume", stream_volume }
+};
+
+static const unsigned int s_cmd_flags[] = {
+    BU_PLUGIN_CMD_THREADSAFE,
+    BU_PLUGIN_CMD_THREADSAFE,
+    BU_PLUGIN_CMD_THREADSAFE
+};
+
+static bu_plugin_manifest_v2 s_manifest = {
+    {
+        "bu-stream-plugin",             /* plugin_name */
+        1,                              /* version */
+        3,                              /* cmd_count */
+        s_commands,                     /* commands */
+        BU_PLUGIN_ABI_VERSION,          /* abi_version */
+        sizeof(bu_plugin_manifest_v2)   /* struct_size */
+    },
+    BU_PLUGIN_MANIFEST_EXT_VERSION,     /* ext_version */
+    nullptr,                            /* depends */
+    nullptr,                            /* init */
+    nullptr,                            /* fini */
+    stream_bind,                        /* bind */
+    s_cmd_flags,                        /* cmd_flags */
+    nullptr                             /* cmd_batch */
+};
+
+BU_PLUGIN_DECLARE_MANIFEST_V2(s_manifest)
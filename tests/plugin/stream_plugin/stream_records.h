@@ -0,0 +1,39 @@
+/**
+ * stream_records.h - Record layouts of the stream plugin's channels.
+ *
+ * Shared by the plugin and the hosts that build its pipeline:
+ *
+ *   stream_job --> stream_draw --> stream_segment --> stream_render
+ *              --> stream_sample --> stream_volume
+ */
+
+#ifndef STREAM_RECORDS_H
+#define STREAM_RECORDS_H
+
+#include <stdint.h>
+
+/* Input of stream_draw: draw count segments from seed */
+#define STREAM_JOB_TYPE "bu.stream.job"
+typedef struct stream_job {
+    uint32_t count;
+    uint32_t seed;
+} stream_job;
+
+/* Output of stream_draw, input of stream_render */
+#define STREAM_SEGMENT_TYPE "bu.stream.segment"
+typedef struct stream_segment {
+    float x0, y0;
+    float x1, y1;
+    uint32_t id;
+    uint32_t job;
+} stream_segment;
+
+/* Output of stream_render, input of stream_volume */
+#define STREAM_SAMPLE_TYPE "bu.stream.sample"
+typedef struct stream_sample {
+    uint32_t id;
+    float length;
+    float cx, cy;
+} stream_sample;
+
+#endif /* STREAM_RECORDS_H */
@@ -4,9 +4,9 @@
  * This plugin:
  *   - Implements string-related commands
  *   - Tests coexistence with other plugins
+ *   - Writes its output through the host services table
  */
 
-#include <cstdio>
 #include <cstring>
 
 #ifndef BU_PLUGIN_BUILDING_DLL
@@ -14,15 +14,17 @@
 #endif
 #include "bu_plugin.h"
 
+static const bu_plugin_host_services *s_host = nullptr;
+
 /* String command implementations */
 static int string_length(void) {
     const char *test = "Hello, Plugin World!";
-    printf("String plugin: length of '%s' is %zu\n", test, strlen(test));
+    s_host->output_printf("String plugin: length of '%s' is %zu\n", test, strlen(test));
     return static_cast<int>(strlen(test));
 }
 
 static int string_upper(void) {
-    printf("String plugin: upper command executed\n");
+    s_host->output_printf("String plugin: upper command executed\n");
     return 0;
 }
 
@@ -32,15 +34,30 @@ static bu_plugin_cmd s_commands[] = {
     { "string_upper", string_upper }
 };
 
+static int string_bind(const bu_plugin_host_services *host) {
+    if (!host || !BU_PLUGIN_HAS_FIELD(bu_plugin_host_services, host->struct_size, output_printf)) return 1;
+    s_host = host;
+    return 0;
+}
+
 /* Define the manifest */
-static bu_plugin_manifest s_manifest = {
-    "bu-string-plugin",     /* plugin_name */
-    1,                      /* version */
-    2,                      /* cmd_count */
-    s_commands,             /* commands */
-    BU_PLUGIN_ABI_VERSION,  /* abi_version */
-    sizeof(bu_plugin_manifest) /* struct_size */
+static bu_plugin_manifest_v2 s_manifest = {
+    {
+        "bu-string-plugin",             /* plugin_name */
+        1,                              /* version */
+        2,                              /* cmd_count */
+        s_commands,                     /* commands */
+        BU_PLUGIN_ABI_VERSION,          /* abi_version */
+        sizeof(bu_plugin_manifest_v2)   /* struct_size */
+    },
+    BU_PLUGIN_MANIFEST_EXT_VERSION,     /* ext_version */
+    nullptr,                            /* depends */
+    nullptr,                            /* init */
+    nullptr,                            /* fini */
+    string_bind,                        /* bind */
+    nullptr,                            /* cmd_flags */
+    nullptr                             /* cmd_batch */
 };
 
 /* Export the manifest */
-BU_PLUGIN_DECLARE_MANIFEST(s_manifest)
+BU_PLUGIN_DECLARE_MANIFEST_V2(s_manifest)
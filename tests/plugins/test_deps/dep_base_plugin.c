@@ -0,0 +1,51 @@
+/**
+ * dep_base_plugin.c - Root of the dependency graph test plugins.
+ *
+ * This plugin:
+ *   - Uses a bu_plugin_manifest_v2 with no dependencies
+ *   - Provides init and fini hooks
+ */
+
+#ifndef BU_PLUGIN_BUILDING_DLL
+#define BU_PLUGIN_BUILDING_DLL
+#endif
+#include "bu_plugin.h"
+
+static int s_initialized = 0;
+
+static int dep_base_cmd(void) {
+    return s_initialized ? 1 : 0;
+}
+
+static int dep_base_init(void) {
+    s_initialized = 1;
+    return 0;
+}
+
+static void dep_base_fini(void) {
+    s_initialized = 0;
+}
+
+static bu_plugin_cmd s_commands[] = {
+    { "dep_base_cmd", dep_base_cmd }
+};
+
+static bu_plugin_manifest_v2 s_manifest = {
+    {
+        "bu-dep-base-plugin",           /* plugin_name */
+        1,                              /* version */
+        1,                              /* cmd_count */
+        s_commands,                     /* commands */
+        BU_PLUGIN_ABI_VERSION,          /* abi_version */
+        sizeof(bu_plugin_manifest_v2)   /* struct_size */
+    },
+    BU_PLUGIN_MANIFEST_EXT_VERSION,     /* ext_version */
+    NULL,                               /* depends */
+    dep_base_init,                      /* init */
+    dep_base_fini,                      /* fini */
+    NULL,                               /* bind */
+    NULL,                               /* cmd_flags */
+    NULL                                /* cmd_batch */
+};
+
+BU_PLUGIN_DECLARE_MANIFEST_V2(s_manifest)
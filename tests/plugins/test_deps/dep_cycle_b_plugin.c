@@ -0,0 +1,41 @@
+/**
+ * dep_cycle_b_plugin.c - Half of a dependency cycle (depends on cycle-a).
+ */
+
+#include <stdio.h>
+
+#ifndef BU_PLUGIN_BUILDING_DLL
+#define BU_PLUGIN_BUILDING_DLL
+#endif
+#include "bu_plugin.h"
+
+static int dep_cycle_b_cmd(void) {
+    printf("This command should never be registered!\n");
+    return 0;
+}
+
+static bu_plugin_cmd s_commands[] = {
+    { "dep_cycle_b_cmd", dep_cycle_b_cmd }
+};
+
+static const char * const s_depends[] = { "bu-dep-cycle-a-plugin", NULL };
+
+static bu_plugin_manifest_v2 s_manifest = {
+    {
+        "bu-dep-cycle-b-plugin",        /* plugin_name */
+        1,                              /* version */
+        1,                              /* cmd_count */
+        s_commands,                     /* commands */
+        BU_PLUGIN_ABI_VERSION,          /* abi_version */
+        sizeof(bu_plugin_manifest_v2)   /* struct_size */
+    },
+    BU_PLUGIN_MANIFEST_EXT_VERSION,     /* ext_version */
+    s_depends,                          /* depends */
+    NULL,                               /* init */
+    NULL,                               /* fini */
+    NULL,                               /* bind */
+    NULL,                               /* cmd_flags */
+    NULL                                /* cmd_batch */
+};
+
+BU_PLUGIN_DECLARE_MANIFEST_V2(s_manifest)
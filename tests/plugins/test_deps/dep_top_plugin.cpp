@@ -0,0 +1,50 @@
+/**
+ * dep_top_plugin.cpp - Dependency graph test plugin with two dependencies.
+ *
+ * This plugin:
+ *   - Depends on the left and right plugins (which both depend on base)
+ *   - Links the host library so its init hook can check that every command
+ *     from its dependencies was registered before it runs
+ */
+
+#ifndef BU_PLUGIN_BUILDING_DLL
+#define BU_PLUGIN_BUILDING_DLL
+#endif
+#include "bu_plugin.h"
+
+static int dep_top_cmd(void) {
+    return 4;
+}
+
+static int dep_top_init(void) {
+    if (!bu_plugin_cmd_exists("dep_base_cmd")) return 1;
+    if (!bu_plugin_cmd_exists("dep_left_cmd")) return 2;
+    if (!bu_plugin_cmd_exists("dep_right_cmd")) return 3;
+    return 0;
+}
+
+static bu_plugin_cmd s_commands[] = {
+    { "dep_top_cmd", dep_top_cmd }
+};
+
+static const char * const s_depends[] = { "bu-dep-left-plugin", "bu-dep-right-plugin", nullptr };
+
+static bu_plugin_manifest_v2 s_manifest = {
+    {
+        "bu-dep-top-plugin",            /* plugin_name */
+        1,                              /* version */
+        1,                              /* cmd_count */
+        s_commands,                     /* commands */
+        BU_PLUGIN_ABI_VERSION,          /* abi_version */
+        sizeof(bu_plugin_manifest_v2)   /* struct_size */
+    },
+    BU_PLUGIN_MANIFEST_EXT_VERSION,     /* ext_version */
+    s_depends,                          /* depends */
+    dep_top_init,                       /* init */
+    nullptr,                            /* fini */
+    NULL,                               /* bind */
+    NULL,                               /* cmd_flags */
+    NULL                                /* cmd_batch */
+};
+
+BU_PLUGIN_DECLARE_MANIFEST_V2(s_manifest)
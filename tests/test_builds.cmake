@@ -178,7 +178,10 @@ run_config("MinSizeRel" -DCMAKE_BUILD_TYPE=MinSizeRel)
 # Test 7: No warnings (minimal build)
 run_config("Release-NoWarnings" -DCMAKE_BUILD_TYPE=Release -DENABLE_STRICT_WARNINGS=OFF)
 
-# Test 8: With sanitizers (Linux/macOS only)
+# Test 8: Host library built without exception support
+run_config("Release-NoExceptions" -DCMAKE_BUILD_TYPE=Release -DBU_PLUGIN_NO_EXCEPTIONS=ON)
+
+# Test 9: With sanitizers (Linux/macOS only)
 # First check if the compiler supports sanitizers
 if(UNIX)
     message("")
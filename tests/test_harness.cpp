@@ -417,6 +417,12 @@ static bool test_c_only_plugin(const char* plugin_dir) {
     int goodbye_result = goodbye_fn();
     TEST_ASSERT_EQUAL(200, goodbye_result, "c_only_goodbye should return 200");
     
+    /* Its manifest marks both commands noexcept; they run through the direct path */
+    TEST_ASSERT(bu_plugin_cmd_get_flags("c_only_hello") == BU_PLUGIN_CMD_NOEXCEPT, "c_only_hello should be flagged noexcept");
+    int run_result = 0;
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run("c_only_goodbye", &run_result), "c_only_goodbye should run");
+    TEST_ASSERT_EQUAL(200, run_result, "c_only_goodbye should return 200 when run");
+    
     TEST_PASS();
 }
 
@@ -446,6 +452,7 @@ static bool test_all_plugins_collision_protection(const char* plugin_dir) {
         {"tests/plugin/stress_plugin", "bu-stress-plugin", 50},
         {"tests/plugin/large_plugin", "bu-large-plugin", 500},
         {"tests/plugin/c_only", "bu-c-only-plugin", 2},
+        {"tests/plugin/soa_plugin", "bu-soa-plugin", 2},
         {"tests/plugin/edge_cases", "bu-empty-plugin", 0},
         {"tests/plugin/edge_cases", "bu-null-impl-plugin", 1},
         {"tests/plugin/edge_cases", "bu-special-names-plugin", 4}
@@ -7,10 +7,32 @@
  *   - Manifest ABI validation (abi_version and struct_size)
  *   - dlerror clearing (missing symbol error reporting)
  *   - bu_plugin_cmd_run (valid, invalid, throwing commands)
+ *   - Failing commands without exceptions and the noexcept dispatch path
+ *   - Generic bu_plugin::invoke() wrapper and its error policies
  *   - Concurrency test for foreach
+ *   - Manifest v2 dependencies, parallel graph loading and cycle detection
+ *   - Zygote fork server with a frozen registry (POSIX only)
+ *   - Prefault load flags
+ *   - bu_plugin_load_ex binding options and load timing
+ *   - Host services table and command handles
+ *   - Host allocator and per-command arena scopes
+ *   - Work-stealing executor: C submissions, C++ futures and continuations
+ *   - Batch invocation, command flags and parallel batch splitting
+ *   - Batched (structure-of-arrays) entry points in batches
+ *   - Command DAGs: dependency order, downstream cancellation, critical path
+ *   - Executor strands for plugins and command groups that are not thread-safe
+ *   - Priority lanes: bounded queues, block/reject/shed admission, lane stats
+ *   - Call contexts: cancellation and deadlines across runs, batches, submits and DAGs
+ *   - Command output: per-invocation flushing, capture, discard and nesting
+ *   - Record channels: backpressure, end of stream, cancellation and pipelines
+ *   - Result cache for pure commands: hits, eviction, invalidation on unload
+ *   - Out-of-process worker pool: proxied commands, crashes and restarts (POSIX only)
+ *   - Commands of several signatures in one registry: typed lookups and invoke()
  */
 
+#include <algorithm>
 #include <cstdio>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <vector>
@@ -18,29 +40,59 @@
 #include <thread>
 #include <atomic>
 #include <chrono>
+#include <future>
+#include <mutex>
 #include <stdexcept>
 #include "bu_plugin.h"
+#include "plugin/stream_plugin/stream_records.h"
+
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <cstddef>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#endif
+
+/*
+ * Fail a test command. A host built without exceptions (BU_PLUGIN_NO_EXCEPTIONS)
+ * cannot catch a throw, so there the command reports through bu_plugin_cmd_fail().
+ */
+#ifdef BU_PLUGIN_HOST_NO_EXCEPTIONS
+#define TEST_CMD_FAIL(msg) do { bu_plugin_cmd_fail(msg); return 0; } while (0)
+#else
+#define TEST_CMD_FAIL(msg) throw std::runtime_error(msg)
+#endif
 
 /* Test statistics */
 static int tests_run = 0;
 static int tests_passed = 0;
 static int tests_failed = 0;
 
-/* Captured log messages for testing */
+/* Captured log messages for testing (executor workers log concurrently) */
 static std::vector<std::pair<int, std::string>> captured_logs;
+static std::mutex captured_logs_mutex;
 
 /* Custom logger to capture messages */
 static void test_logger(int level, const char *msg) {
+    std::lock_guard<std::mutex> lock(captured_logs_mutex);
     captured_logs.push_back({level, std::string(msg)});
 }
 
 /* Clear captured logs */
 static void clear_logs() {
+    std::lock_guard<std::mutex> lock(captured_logs_mutex);
     captured_logs.clear();
 }
 
 /* Check if a log message contains a substring */
 static bool log_contains(int level, const char *substr) {
+    std::lock_guard<std::mutex> lock(captured_logs_mutex);
     for (const auto& log : captured_logs) {
         if (log.first == level && log.second.find(substr) != std::string::npos) {
             return true;
@@ -255,7 +307,7 @@ static bool test_cmd_run() {
 static bool test_cmd_run_throwing() {
     TEST_START("bu_plugin_cmd_run with Exception");
     
-#ifdef __cplusplus
+#ifndef BU_PLUGIN_HOST_NO_EXCEPTIONS
     /* Register a command that throws */
     auto throwing_cmd = []() -> int { 
         throw std::runtime_error("Test exception");
@@ -275,12 +327,156 @@ static bool test_cmd_run_throwing() {
     
     printf("  Exception handling verified\n");
 #else
-    printf("  Skipped (C++ only)\n");
+    printf("  Skipped (host built without exceptions)\n");
 #endif
     
     TEST_PASS();
 }
 
+static int s_noexcept_calls = 0;
+static int s_fail_calls = 0;
+
+static int noexcept_count() {
+    return ++s_noexcept_calls;
+}
+
+/* Fails every odd-numbered call without throwing */
+static int fail_odd() {
+    if (++s_fail_calls % 2) bu_plugin_cmd_fail("odd call");
+    return s_fail_calls;
+}
+
+#ifndef BU_PLUGIN_HOST_NO_EXCEPTIONS
+/* Records a failure and then throws anyway */
+static int fail_then_throw() {
+    bu_plugin_cmd_fail("before the throw");
+    throw std::runtime_error("after the failure");
+}
+#endif
+
+/**
+ * Test: Failing without exceptions, and commands flagged noexcept
+ * bu_plugin_cmd_fail() turns a normal return into -2 on every run path;
+ * BU_PLUGIN_CMD_NOEXCEPT commands skip the try block but fail the same way.
+ */
+static bool test_cmd_fail() {
+    TEST_START("bu_plugin_cmd_fail and Noexcept Commands");
+    
+    clear_logs();
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_register("noexcept_count", noexcept_count), "Should register noexcept_count");
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_register("fail_odd", fail_odd), "Should register fail_odd");
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_set_flags("noexcept_count", BU_PLUGIN_CMD_NOEXCEPT), "Flags should be settable");
+    TEST_ASSERT(bu_plugin_cmd_get_flags("noexcept_count") == BU_PLUGIN_CMD_NOEXCEPT, "The noexcept flag should be readable");
+    
+    /* Noexcept commands run by name and through handles */
+    int result = 0;
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run("noexcept_count", &result), "Noexcept command should run");
+    TEST_ASSERT_EQUAL(1, result, "Noexcept command should return its result");
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_invoke(bu_plugin_cmd_lookup("noexcept_count"), &result), "Noexcept handle should run");
+    TEST_ASSERT_EQUAL(2, result, "Handle call should return its result");
+    
+    /* A recorded failure discards the result and does not stick to the next call */
+    for (unsigned int flags = 0; flags <= BU_PLUGIN_CMD_NOEXCEPT; flags += BU_PLUGIN_CMD_NOEXCEPT) {
+        bu_plugin_cmd_set_flags("fail_odd", flags);
+        result = -7;
+        TEST_ASSERT_EQUAL(-2, bu_plugin_cmd_run("fail_odd", &result), "A failed call should return -2");
+        TEST_ASSERT_EQUAL(-7, result, "A failed call should not store its result");
+        TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run("fail_odd", &result), "The next call should succeed");
+        TEST_ASSERT(result == 2 || result == 4, "The next call should return its result");
+    }
+    TEST_ASSERT(log_contains(BU_LOG_ERR, "Command 'fail_odd' failed: odd call"), "The failure should be logged");
+    
+    /* Batch items fail individually */
+    const char *names[] = { "fail_odd", "noexcept_count", "fail_odd", "fail_odd" };
+    int results[4] = { 0, 0, 0, 0 };
+    int status[4];
+    TEST_ASSERT_EQUAL(2, bu_plugin_cmd_run_batch(names, 4, results, status), "Two items should fail");
+    TEST_ASSERT(status[0] == -2 && status[1] == 0 && status[2] == 0 && status[3] == -2, "Odd calls should fail");
+    TEST_ASSERT(results[1] == 3 && results[2] == 6, "Other items should return their results");
+    
+#ifndef BU_PLUGIN_HOST_NO_EXCEPTIONS
+    /* A failure recorded before a throw is cleared with it on every run path */
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_register("fail_then_throw", fail_then_throw), "Should register fail_then_throw");
+    TEST_ASSERT_EQUAL(-2, bu_plugin_cmd_run("fail_then_throw", &result), "Fail then throw should return -2");
+    TEST_ASSERT(bu_plugin_cmd_take_failure() == nullptr, "bu_plugin_cmd_run should clear the failure");
+    TEST_ASSERT_EQUAL(-2, (bu_plugin::invoke<int(), bu_plugin::return_status>("fail_then_throw").status),
+                      "invoke() should report -2");
+    TEST_ASSERT(bu_plugin_cmd_take_failure() == nullptr, "invoke() should clear the failure");
+    const char *thrown[] = { "fail_then_throw" };
+    TEST_ASSERT_EQUAL(1, bu_plugin_cmd_run_batch(thrown, 1, results, status), "The batch item should fail");
+    TEST_ASSERT(bu_plugin_cmd_take_failure() == nullptr, "A batch should clear the failure");
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run("noexcept_count", &result), "The next command should succeed");
+#endif
+    
+    /* Hosts with their own wrappers collect the failure themselves */
+    TEST_ASSERT(bu_plugin_cmd_take_failure() == nullptr, "No failure should be pending");
+    bu_plugin_cmd_fail("by hand");
+    const char *what = bu_plugin_cmd_take_failure();
+    TEST_ASSERT(what && std::strcmp(what, "by hand") == 0, "The recorded message should be returned");
+    TEST_ASSERT(bu_plugin_cmd_take_failure() == nullptr, "Taking a failure should clear it");
+    bu_plugin_cmd_fail(nullptr);
+    TEST_ASSERT(bu_plugin_cmd_take_failure() != nullptr, "A NULL message still records a failure");
+    
+    bu_plugin_cmd_set_flags("noexcept_count", 0);
+    bu_plugin_cmd_set_flags("fail_odd", 0);
+    TEST_PASS();
+}
+
+static int s_invoke_calls = 0;
+
+static int invoke_count() {
+    return ++s_invoke_calls;
+}
+
+/**
+ * Test: bu_plugin::invoke() with the default signature
+ * Same statuses as bu_plugin_cmd_run() under each error policy; pure
+ * commands are answered from the result cache.
+ */
+static bool test_invoke() {
+    TEST_START("Generic invoke()");
+    
+    clear_logs();
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_register("invoke_count", invoke_count), "Should register invoke_count");
+    bu_plugin_cmd_handle h = bu_plugin_cmd_lookup("invoke_count");
+    bu_plugin::cmd<int()> c(h);
+    TEST_ASSERT(c && c.handle() == h && c.get() == invoke_count, "cmd should resolve the implementation");
+    TEST_ASSERT_EQUAL(1, bu_plugin::invoke<int()>("invoke_count"), "By name");
+    TEST_ASSERT_EQUAL(2, bu_plugin::invoke<int()>(h), "By handle");
+    TEST_ASSERT_EQUAL(3, bu_plugin::invoke(c), "By resolved cmd");
+    TEST_ASSERT_EQUAL(4, (bu_plugin::invoke<int(), bu_plugin::unchecked>(c)), "Unchecked");
+    TEST_ASSERT_EQUAL(5, c(), "Direct call");
+    
+    bu_plugin::call_result<int> r = bu_plugin::invoke<int(), bu_plugin::return_status>("no_such_command");
+    TEST_ASSERT_EQUAL(-1, r.status, "Unknown commands report -1");
+    TEST_ASSERT(log_contains(BU_LOG_ERR, "Command 'no_such_command' not found"), "Unknown commands are logged");
+    /* fail_odd has run seven times in test_cmd_fail */
+    r = bu_plugin::invoke<int(), bu_plugin::return_status>(bu_plugin::cmd<int()>("fail_odd"));
+    TEST_ASSERT(r.status == 0 && r.value == 8, "Even calls of fail_odd succeed");
+    r = bu_plugin::invoke<int(), bu_plugin::return_status>("fail_odd");
+    TEST_ASSERT_EQUAL(-2, r.status, "Failed commands report -2");
+#ifndef BU_PLUGIN_HOST_NO_EXCEPTIONS
+    int status = 0;
+    try {
+        bu_plugin::invoke<int()>("throwing_cmd");
+    } catch (const bu_plugin::cmd_error &e) {
+        status = e.status();
+    }
+    TEST_ASSERT_EQUAL(-2, status, "Thrown exceptions become cmd_error(-2)");
+#endif
+    
+    /* Pure commands come from the cache */
+    bu_plugin_memo_set_capacity(64);
+    bu_plugin_cmd_set_flags("invoke_count", BU_PLUGIN_CMD_PURE);
+    int first = bu_plugin::invoke(c);
+    TEST_ASSERT_EQUAL(first, bu_plugin::invoke(c), "A pure command should be answered from the cache");
+    TEST_ASSERT_EQUAL(6, s_invoke_calls, "The cached call should not run the command");
+    bu_plugin_cmd_set_flags("invoke_count", 0);
+    bu_plugin_memo_set_capacity(0);
+    
+    TEST_PASS();
+}
+
 /**
  * Test: Logger Callback API
  * Verify that the logger callback can be set and receives messages.
@@ -560,6 +756,1930 @@ static bool test_invalid_paths_logging() {
     TEST_PASS();
 }
 
+/**
+ * Test: Manifest v2 dependencies with a single bu_plugin_load
+ * A plugin whose dependencies are not loaded yet must be rejected.
+ */
+static bool test_dependency_single_load(const char* plugin_dir) {
+    TEST_START("Dependency Check on Single Load");
+    
+    bu_plugin_set_path_allow(nullptr);
+    clear_logs();
+    
+    std::string path = get_plugin_path(plugin_dir, "tests/plugins/test_deps", "bu-dep-top-plugin");
+    printf("  Loading plugin with unloaded dependencies: %s\n", path.c_str());
+    
+    int result = bu_plugin_load(path.c_str());
+    TEST_ASSERT(result < 0, "Plugin with missing dependencies should fail to load");
+    TEST_ASSERT(log_contains(BU_LOG_ERR, "which is not loaded"),
+                "Should log error about the missing dependency");
+    TEST_ASSERT(bu_plugin_cmd_exists("dep_top_cmd") == 0,
+                "Commands of a rejected plugin should not be registered");
+    
+    TEST_PASS();
+}
+
+/**
+ * Test: Dependency graph loading
+ * Plugins given in arbitrary order are registered and initialized in dependency order.
+ */
+static bool test_dependency_graph(const char* plugin_dir) {
+    TEST_START("Dependency Graph Loading");
+    
+    bu_plugin_set_path_allow(nullptr);
+    clear_logs();
+    
+    std::string top = get_plugin_path(plugin_dir, "tests/plugins/test_deps", "bu-dep-top-plugin");
+    std::string right = get_plugin_path(plugin_dir, "tests/plugins/test_deps", "bu-dep-right-plugin");
+    std::string base = get_plugin_path(plugin_dir, "tests/plugins/test_deps", "bu-dep-base-plugin");
+    std::string left = get_plugin_path(plugin_dir, "tests/plugins/test_deps", "bu-dep-left-plugin");
+    
+    /* Deliberately list dependents before their dependencies */
+    const char *paths[] = { top.c_str(), right.c_str(), base.c_str(), left.c_str() };
+    size_t modules_before = bu_plugin_loaded_modules_count();
+    
+    int result = bu_plugin_load_graph(paths, 4, 4);
+    TEST_ASSERT_EQUAL(4, result, "Graph load should register 4 commands");
+    TEST_ASSERT(bu_plugin_loaded_modules_count() == modules_before + 4,
+                "All 4 modules should be retained");
+    
+    /* The top plugin's init hook only succeeds if its dependencies were registered first */
+    int result_val = 0;
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run("dep_top_cmd", &result_val), "dep_top_cmd should run");
+    TEST_ASSERT_EQUAL(4, result_val, "dep_top_cmd should return 4");
+    
+    /* The base plugin's init hook should have run */
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run("dep_base_cmd", &result_val), "dep_base_cmd should run");
+    TEST_ASSERT_EQUAL(1, result_val, "Base plugin init hook should have run");
+    
+    TEST_ASSERT(log_contains(BU_LOG_INFO, "critical path"),
+                "Should log the critical-path time");
+    
+    TEST_PASS();
+}
+
+/**
+ * Test: Dependency cycle detection
+ * A cyclic graph is rejected before anything is registered.
+ */
+static bool test_dependency_cycle(const char* plugin_dir) {
+    TEST_START("Dependency Cycle Detection");
+    
+    bu_plugin_set_path_allow(nullptr);
+    clear_logs();
+    
+    std::string a = get_plugin_path(plugin_dir, "tests/plugins/test_deps", "bu-dep-cycle-a-plugin");
+    std::string b = get_plugin_path(plugin_dir, "tests/plugins/test_deps", "bu-dep-cycle-b-plugin");
+    const char *paths[] = { a.c_str(), b.c_str() };
+    size_t modules_before = bu_plugin_loaded_modules_count();
+    
+    int result = bu_plugin_load_graph(paths, 2, 2);
+    TEST_ASSERT(result < 0, "Cyclic graph should be rejected");
+    TEST_ASSERT(log_contains(BU_LOG_ERR, "dependency cycle"),
+                "Should log the dependency cycle");
+    TEST_ASSERT(bu_plugin_cmd_exists("dep_cycle_a_cmd") == 0 && bu_plugin_cmd_exists("dep_cycle_b_cmd") == 0,
+                "No command from a cyclic graph should be registered");
+    TEST_ASSERT(bu_plugin_loaded_modules_count() == modules_before,
+                "No module from a cyclic graph should be retained");
+    
+    TEST_PASS();
+}
+
+/**
+ * Test: Prefault load flags
+ * Loading with BU_PLUGIN_LOAD_PREFAULT prefaults the text and the commands still work.
+ */
+#if defined(__linux__) && (defined(__x86_64__) || defined(__i386__) || defined(__aarch64__))
+/*
+ * Child of test_prefault_load(): deny mprotect(PROT_EXEC) the way a W^X
+ * host does, then load the huge text plugin with BU_PLUGIN_LOAD_HUGEPAGES.
+ * Exits 0 if the move was skipped and the code still runs, 2 if seccomp
+ * is unavailable, 1 otherwise.
+ */
+static int huge_text_wx_child(const std::string &path) {
+    struct sock_filter filter[] = {
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, nr)),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_mprotect, 0, 3),
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, args[2])),
+        BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, PROT_EXEC, 0, 1),
+        BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ERRNO | EACCES),
+        BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW),
+    };
+    struct sock_fprog prog = { static_cast<unsigned short>(sizeof(filter) / sizeof(filter[0])), filter };
+    if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) != 0 || prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &prog) != 0) return 2;
+    clear_logs();
+    bu_plugin_set_load_flags(BU_PLUGIN_LOAD_HUGEPAGES);
+    if (bu_plugin_load(path.c_str()) != 1) return 1;
+    if (!log_contains(BU_LOG_WARN, "executable anonymous memory is not allowed")) return 1;
+    int result = 0;
+    return (bu_plugin_cmd_run("huge_text_probe", &result) == 0 && result == 1) ? 0 : 1;
+}
+#endif
+
+static bool test_prefault_load(const char* plugin_dir) {
+    TEST_START("Prefault Load Flags");
+    
+    bu_plugin_set_path_allow(nullptr);
+    clear_logs();
+    
+    bu_plugin_set_load_flags(BU_PLUGIN_LOAD_PREFAULT | BU_PLUGIN_LOAD_HUGEPAGES);
+    TEST_ASSERT(bu_plugin_get_load_flags() == (BU_PLUGIN_LOAD_PREFAULT | BU_PLUGIN_LOAD_HUGEPAGES),
+                "Load flags should be stored");
+    
+    std::string path = get_plugin_path(plugin_dir, "tests/plugin/string_plugin", "bu-string-plugin");
+    int result = bu_plugin_load(path.c_str());
+    bu_plugin_set_load_flags(0);
+    
+    TEST_ASSERT(result >= 0, "Plugin should load with prefault flags");
+#if defined(__linux__)
+    TEST_ASSERT(log_contains(BU_LOG_INFO, "Prefaulted"), "Should log the prefaulted text size");
+#endif
+    
+    int result_val = 0;
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run("string_length", &result_val), "Prefaulted command should run");
+    
+#if defined(__linux__) && (defined(__x86_64__) || defined(__i386__) || defined(__aarch64__))
+    /* A host that forbids executable anonymous memory keeps the text where it is */
+    std::string huge_path = get_plugin_path(plugin_dir, "tests/plugin/huge_text_plugin", "bu-huge-text-plugin");
+    pid_t child = fork();
+    TEST_ASSERT(child >= 0, "fork() should succeed");
+    if (child == 0) _exit(huge_text_wx_child(huge_path));
+    int wstatus = 0;
+    waitpid(child, &wstatus, 0);
+    TEST_ASSERT(WIFEXITED(wstatus) && WEXITSTATUS(wstatus) != 1,
+                "Without execmem the move should be skipped and the code should still run");
+    if (WEXITSTATUS(wstatus) == 2) printf("  (seccomp unavailable; W^X case not exercised)\n");
+    
+    /* A text segment spanning aligned 2 MiB ranges is moved, and the moved code runs */
+    clear_logs();
+    bu_plugin_set_load_flags(BU_PLUGIN_LOAD_HUGEPAGES);
+    result = bu_plugin_load(huge_path.c_str());
+    TEST_ASSERT_EQUAL(1, result, "The huge text plugin should load with BU_PLUGIN_LOAD_HUGEPAGES");
+    TEST_ASSERT(log_contains(BU_LOG_INFO, "KiB on huge pages") && !log_contains(BU_LOG_INFO, "(0 KiB on huge pages)"),
+                "Its aligned text should be moved onto huge pages");
+    result_val = 0;
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run("huge_text_probe", &result_val), "A command should run after the move");
+    TEST_ASSERT_EQUAL(1, result_val, "Code inside the moved range should execute");
+    
+    /* The same module loaded again (here into another context) may be running: it is not moved */
+    clear_logs();
+    bu_plugin_ctx *ctx = bu_plugin_ctx_create(nullptr);
+    TEST_ASSERT(ctx != nullptr, "Context should be created");
+    TEST_ASSERT_EQUAL(1, bu_plugin_ctx_load(ctx, huge_path.c_str()), "An already loaded module should load again");
+    TEST_ASSERT(log_contains(BU_LOG_INFO, "already loaded; not moving"), "An already loaded module should not be remapped");
+    TEST_ASSERT(log_contains(BU_LOG_INFO, "(0 KiB on huge pages)"), "No text of an already loaded module should be moved");
+    result_val = 0;
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run("huge_text_probe", &result_val), "The first load's command should still run");
+    TEST_ASSERT_EQUAL(1, result_val, "The moved range should still execute");
+    bu_plugin_ctx_destroy(ctx);
+    bu_plugin_set_load_flags(0);
+#endif
+    
+    TEST_PASS();
+}
+
+static bool test_load_ex(const char* plugin_dir) {
+    TEST_START("Load With Options");
+    
+    bu_plugin_set_path_allow(nullptr);
+    clear_logs();
+    
+    std::string path = get_plugin_path(plugin_dir, "tests/plugin/large_plugin", "bu-large-plugin");
+    
+    /* A struct_size too small to hold any option is rejected */
+    bu_plugin_load_opts bad;
+    std::memset(&bad, 0, sizeof(bad));
+    bad.struct_size = 1;
+    TEST_ASSERT_EQUAL(-1, bu_plugin_load_ex(path.c_str(), &bad), "Truncated options should be rejected");
+    TEST_ASSERT(log_contains(BU_LOG_ERR, "Invalid bu_plugin_load_opts"), "Should log the invalid options");
+    
+    bu_plugin_load_stats stats;
+    std::memset(&stats, 0, sizeof(stats));
+    stats.struct_size = sizeof(stats);
+    
+    bu_plugin_load_opts opts;
+    std::memset(&opts, 0, sizeof(opts));
+    opts.struct_size = sizeof(opts);
+    opts.binding = BU_PLUGIN_BIND_LAZY;
+    opts.nodelete = 1;
+    opts.stats = &stats;
+    
+    int result = bu_plugin_load_ex(path.c_str(), &opts);
+    TEST_ASSERT_EQUAL(500, result, "Lazy-bound plugin should register all its commands");
+    TEST_ASSERT_EQUAL(500, stats.registered, "Stats should record the registered count");
+    TEST_ASSERT(stats.open_us > 0.0, "Stats should record the open time");
+    TEST_ASSERT(stats.total_us >= stats.open_us + stats.register_us, "Total should cover the phases");
+    
+    int result_val = 0;
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run("large_499", &result_val), "Lazy-bound command should run");
+    
+    /* Stats are filled on failure too */
+    std::memset(&stats, 0, sizeof(stats));
+    stats.struct_size = sizeof(stats);
+    TEST_ASSERT_EQUAL(-1, bu_plugin_load_ex("/nonexistent/plugin.so", &opts), "Missing plugin should fail");
+    TEST_ASSERT_EQUAL(-1, stats.registered, "Stats should record the failure");
+    
+    TEST_PASS();
+}
+
+static bool test_host_services(const char* plugin_dir) {
+    TEST_START("Host Services and Command Handles");
+    
+    bu_plugin_set_path_allow(nullptr);
+    clear_logs();
+    
+    const bu_plugin_host_services *host = bu_plugin_get_host_services();
+    TEST_ASSERT(host != nullptr, "Host services table should exist");
+    TEST_ASSERT(host->struct_size == sizeof(bu_plugin_host_services), "Table should carry its struct_size");
+    TEST_ASSERT(host->version == BU_PLUGIN_HOST_SERVICES_VERSION, "Table should carry its version");
+    TEST_ASSERT(BU_PLUGIN_HAS_FIELD(bu_plugin_host_services, offsetof(bu_plugin_host_services, channel_input), output_printf),
+                "A version 4 table carries output_printf");
+    TEST_ASSERT(!BU_PLUGIN_HAS_FIELD(bu_plugin_host_services, offsetof(bu_plugin_host_services, output_write), output_printf),
+                "A version 3 table does not");
+    
+    std::string path = get_plugin_path(plugin_dir, "tests/plugin/services_plugin", "bu-services-plugin");
+    TEST_ASSERT_EQUAL(4, bu_plugin_load(path.c_str()), "Services plugin should load");
+    TEST_ASSERT(log_contains(BU_LOG_INFO, "bound to host services"), "Bind hook should log through the table");
+    
+    int result_val = 0;
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run("services_call", &result_val), "Handle call from plugin should run");
+    TEST_ASSERT_EQUAL(43, result_val, "Plugin should see the invoked command's result");
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run("services_alloc", &result_val), "Host allocation should work");
+    TEST_ASSERT(result_val >= 3, "Plugin should read registry stats");
+    
+    bu_plugin_cmd_handle h = bu_plugin_cmd_lookup("services_answer");
+    TEST_ASSERT(h != nullptr, "Lookup should return a handle");
+    TEST_ASSERT(h == bu_plugin_cmd_lookup("  services_answer "), "Handles should be interned per name");
+    TEST_ASSERT(std::strcmp(bu_plugin_cmd_handle_name(h), "services_answer") == 0, "Handle should know its name");
+    TEST_ASSERT(bu_plugin_cmd_handle_impl(h) == bu_plugin_cmd_get("services_answer"), "Handle should resolve the impl");
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_invoke(h, &result_val), "Invoke should run the command");
+    TEST_ASSERT_EQUAL(42, result_val, "Invoke should return the command's result");
+    
+    TEST_ASSERT(bu_plugin_cmd_lookup("no_such_command") == nullptr, "Unknown names have no handle");
+    TEST_ASSERT_EQUAL(-1, bu_plugin_cmd_invoke(nullptr, &result_val), "Invoking a NULL handle should fail");
+    
+    TEST_PASS();
+}
+
+/* First block an arena-scoped command got from the host allocator */
+static void *s_arena_cmd_block = nullptr;
+
+static int arena_cmd() {
+    const bu_plugin_allocator *a = bu_plugin_get_allocator();
+    for (int i = 0; i < 100; i++) {
+        void *p = a->mem_alloc(a->ctx, 64);
+        if (!p) return -1;
+        if (i == 0) s_arena_cmd_block = p;
+        a->mem_free(a->ctx, p);
+    }
+    return 0;
+}
+
+/* Counting allocator forwarding to the default one */
+static int s_counted_allocs = 0;
+static const bu_plugin_allocator *s_default_alloc = nullptr;
+
+static void *counting_alloc(void *, size_t size) {
+    s_counted_allocs++;
+    return s_default_alloc->mem_alloc(s_default_alloc->ctx, size);
+}
+static void *counting_realloc(void *, void *ptr, size_t size) {
+    return s_default_alloc->mem_realloc(s_default_alloc->ctx, ptr, size);
+}
+static void counting_free(void *, void *ptr) {
+    s_default_alloc->mem_free(s_default_alloc->ctx, ptr);
+}
+static size_t counting_push(void *) {
+    return s_default_alloc->arena_push(s_default_alloc->ctx);
+}
+static void counting_pop(void *, size_t mark) {
+    s_default_alloc->arena_pop(s_default_alloc->ctx, mark);
+}
+
+static bool test_allocator() {
+    TEST_START("Host Allocator and Arenas");
+    
+    clear_logs();
+    const bu_plugin_allocator *a = bu_plugin_get_allocator();
+    TEST_ASSERT(a != nullptr, "Default allocator should be installed");
+    TEST_ASSERT(bu_plugin_get_host_services()->allocator() == a, "Services table should expose the allocator");
+    
+    /* Heap blocks outside an arena scope */
+    char *heap = static_cast<char *>(a->mem_alloc(a->ctx, 32));
+    TEST_ASSERT(heap != nullptr, "Heap allocation should succeed");
+    std::strcpy(heap, "allocator");
+    heap = static_cast<char *>(a->mem_realloc(a->ctx, heap, 8192));
+    TEST_ASSERT(heap != nullptr && std::strcmp(heap, "allocator") == 0, "Realloc should keep contents");
+    a->mem_free(a->ctx, heap);
+    
+    /* Arena scopes reuse memory once popped, including nested scopes */
+    size_t outer = a->arena_push(a->ctx);
+    void *first = a->mem_alloc(a->ctx, 100);
+    TEST_ASSERT(reinterpret_cast<uintptr_t>(first) % 16 == 0, "Arena blocks should be 16-byte aligned");
+    size_t inner = a->arena_push(a->ctx);
+    for (int i = 0; i < 5000; i++) {
+        TEST_ASSERT(a->mem_alloc(a->ctx, 48) != nullptr, "Arena allocation should succeed");
+    }
+    char *grown = static_cast<char *>(a->mem_alloc(a->ctx, 4));
+    std::memcpy(grown, "abc", 4);
+    grown = static_cast<char *>(a->mem_realloc(a->ctx, grown, 200000));
+    TEST_ASSERT(grown != nullptr && std::strcmp(grown, "abc") == 0, "Arena realloc should copy contents");
+    a->arena_pop(a->ctx, inner);
+    a->arena_pop(a->ctx, outer);
+    a->arena_push(a->ctx);
+    TEST_ASSERT(a->mem_alloc(a->ctx, 100) == first, "Popped arena memory should be reused");
+    a->arena_pop(a->ctx, outer);
+    
+    /* Command-scoped arenas release a command's temporaries when it returns */
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_register("arena_cmd", arena_cmd), "Should register arena_cmd");
+    bu_plugin_set_cmd_arena(1);
+    int result_val = -1;
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run("arena_cmd", &result_val), "Arena command should run");
+    void *run1 = s_arena_cmd_block;
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run("arena_cmd", &result_val), "Arena command should run again");
+    TEST_ASSERT(s_arena_cmd_block == run1, "Each run should start from the same arena position");
+    bu_plugin_set_cmd_arena(0);
+    
+    /* Custom allocators */
+    bu_plugin_allocator bad;
+    std::memset(&bad, 0, sizeof(bad));
+    bad.struct_size = sizeof(bad);
+    TEST_ASSERT_EQUAL(-1, bu_plugin_set_allocator(&bad), "Incomplete allocator should be rejected");
+    
+    s_default_alloc = a;
+    bu_plugin_allocator counting = {
+        sizeof(bu_plugin_allocator), nullptr,
+        counting_alloc, counting_realloc, counting_free, counting_push, counting_pop
+    };
+    TEST_ASSERT_EQUAL(0, bu_plugin_set_allocator(&counting), "Custom allocator should install");
+    TEST_ASSERT(bu_plugin_get_allocator() == &counting, "Custom allocator should be returned");
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run("arena_cmd", &result_val), "Command should use the custom allocator");
+    TEST_ASSERT_EQUAL(100, s_counted_allocs, "Every allocation should go through the custom allocator");
+    const bu_plugin_host_services *host = bu_plugin_get_host_services();
+    void *table_block = host->mem_alloc(16);
+    TEST_ASSERT(table_block != nullptr, "Services table allocation should succeed");
+    TEST_ASSERT_EQUAL(101, s_counted_allocs, "The services table should allocate through the custom allocator");
+    host->mem_free(table_block);
+    TEST_ASSERT_EQUAL(0, bu_plugin_set_allocator(nullptr), "Default allocator should be restorable");
+    TEST_ASSERT(bu_plugin_get_allocator() == a, "Default allocator should be back");
+    
+    TEST_PASS();
+}
+
+static std::atomic<int> s_exec_calls(0);
+static std::atomic<int> s_exec_done(0);
+static std::atomic<int> s_exec_failed(0);
+static std::atomic<int> s_exec_result_sum(0);
+
+static int exec_add() {
+    s_exec_calls++;
+    return 7;
+}
+
+static int exec_throw() {
+    TEST_CMD_FAIL("executor test exception");
+}
+
+static void exec_done(int status, int result, void *) {
+    if (status == 0) {
+        s_exec_result_sum += result;
+    } else {
+        s_exec_failed++;
+    }
+    s_exec_done++;
+}
+
+/* A job that fans out into ten more jobs from inside a worker */
+static void exec_fan_out(void *) {
+    for (int i = 0; i < 10; i++) {
+        bu_plugin_exec_post([](void *) { s_exec_calls++; }, nullptr);
+    }
+}
+
+static bool test_executor() {
+    TEST_START("Work-Stealing Executor");
+    
+    clear_logs();
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_register("exec_add", exec_add), "Should register exec_add");
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_register("exec_throw", exec_throw), "Should register exec_throw");
+    
+    TEST_ASSERT_EQUAL(0, bu_plugin_exec_start(4), "Executor should start");
+    TEST_ASSERT_EQUAL(1, bu_plugin_exec_start(2), "Second start should report already running");
+    TEST_ASSERT(bu_plugin_exec_workers() == 4, "Executor should have 4 workers");
+    
+    /* C submissions with completion callbacks */
+    bu_plugin_cmd_handle h = bu_plugin_cmd_lookup("exec_add");
+    for (int i = 0; i < 1000; i++) {
+        TEST_ASSERT_EQUAL(0, bu_plugin_cmd_submit(h, exec_done, nullptr), "Submit should queue");
+    }
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_submit_name("exec_throw", exec_done, nullptr), "Submit by name should queue");
+    TEST_ASSERT_EQUAL(-1, bu_plugin_cmd_submit_name("no_such_command", exec_done, nullptr), "Unknown names are rejected");
+    TEST_ASSERT_EQUAL(-1, bu_plugin_cmd_submit(nullptr, exec_done, nullptr), "NULL handles are rejected");
+    bu_plugin_exec_drain();
+    TEST_ASSERT_EQUAL(1001, s_exec_done.load(), "Every submission should complete");
+    TEST_ASSERT_EQUAL(7000, s_exec_result_sum.load(), "Results should reach the callback");
+    TEST_ASSERT_EQUAL(1, s_exec_failed.load(), "The throwing command should fail");
+    TEST_ASSERT(log_contains(BU_LOG_ERR, "executor test exception"), "The exception should be logged");
+    
+    /* Drain waits for jobs posted by jobs */
+    s_exec_calls = 0;
+    for (int i = 0; i < 10; i++) {
+        TEST_ASSERT_EQUAL(0, bu_plugin_exec_post(exec_fan_out, nullptr), "Post should queue");
+    }
+    bu_plugin_exec_drain();
+    TEST_ASSERT_EQUAL(100, s_exec_calls.load(), "Nested jobs should be drained");
+
+    /* A worker draining would wait for its own job */
+    std::atomic<int> worker_drain(0);
+    bu_plugin_exec_post([](void *arg) { static_cast<std::atomic<int> *>(arg)->store(bu_plugin_exec_drain()); }, &worker_drain);
+    TEST_ASSERT_EQUAL(0, bu_plugin_exec_drain(), "Drain from the host should succeed");
+    TEST_ASSERT_EQUAL(-1, worker_drain.load(), "Drain from a worker should be refused");
+    TEST_ASSERT(log_contains(BU_LOG_ERR, "called from an executor worker"), "The refused drain should be logged");
+    
+    /* C++ futures and continuations */
+    TEST_ASSERT_EQUAL(7, bu_plugin::submit("exec_add").get(), "Future should yield the result");
+    int status = 0;
+    try {
+        bu_plugin::submit("exec_throw").get();
+    } catch (const bu_plugin::cmd_error &e) {
+        status = e.status();
+    }
+    TEST_ASSERT_EQUAL(-2, status, "Future should carry the -2 exception status");
+    std::promise<int> chained;
+    bu_plugin::submit(h, [&chained](int st, int result) { chained.set_value(st == 0 ? result * 2 : -1); });
+    TEST_ASSERT_EQUAL(14, chained.get_future().get(), "Continuation should see the result");
+    
+    bu_plugin_exec_stop();
+    TEST_ASSERT(bu_plugin_exec_workers() == 0, "Stopped executor should have no workers");
+    
+    /* Posts racing stops run on some executor or fail; none reach a deleted one */
+    s_exec_calls = 0;
+    std::atomic<bool> racing(true);
+    std::atomic<int> accepted(0);
+    std::thread poster([&racing, &accepted]() {
+        while (racing.load()) {
+            if (bu_plugin_exec_post([](void *) { s_exec_calls++; }, nullptr) == 0) accepted++;
+        }
+    });
+    while (accepted.load() == 0) std::this_thread::yield();
+    for (int i = 0; i < 50; i++) {
+        bu_plugin_exec_start(2);
+        bu_plugin_exec_stop();
+    }
+    racing = false;
+    poster.join();
+    bu_plugin_exec_stop();
+    TEST_ASSERT_EQUAL(accepted.load(), s_exec_calls.load(), "Every accepted post should run");
+    
+    TEST_PASS();
+}
+
+static std::atomic<int> s_batch_calls(0);
+
+static int batch_count() {
+    return ++s_batch_calls;
+}
+
+static int batch_throw() {
+    TEST_CMD_FAIL("batch test exception");
+}
+
+static bool test_batch() {
+    TEST_START("Batch Invocation");
+    
+    clear_logs();
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_register("batch_count", batch_count), "Should register batch_count");
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_register("batch_throw", batch_throw), "Should register batch_throw");
+    
+    /* Flags from the manifest and from the API */
+    TEST_ASSERT(bu_plugin_cmd_get_flags("services_answer") == BU_PLUGIN_CMD_THREADSAFE, "Manifest flags should apply");
+    TEST_ASSERT(bu_plugin_cmd_get_flags("services_call") == 0, "Unflagged commands have no flags");
+    TEST_ASSERT_EQUAL(-1, bu_plugin_cmd_set_flags("no_such_command", BU_PLUGIN_CMD_THREADSAFE), "Unknown names are rejected");
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_set_flags(" batch_count ", BU_PLUGIN_CMD_THREADSAFE), "Flags should be settable");
+    TEST_ASSERT(bu_plugin_cmd_get_flags("batch_count") == BU_PLUGIN_CMD_THREADSAFE, "Flags should be readable");
+    
+    /* Serial batch: one item throws, one is missing, the rest still run in order */
+    const char *names[] = { "batch_count", "batch_throw", "batch_count", "no_such_command", "services_answer", "batch_count" };
+    int results[6] = { 0, 0, 0, 0, 0, 0 };
+    int status[6];
+    s_batch_calls = 0;
+    TEST_ASSERT_EQUAL(2, bu_plugin_cmd_run_batch(names, 6, results, status), "Two items should fail");
+    TEST_ASSERT(status[0] == 0 && status[2] == 0 && status[4] == 0 && status[5] == 0, "Other items should succeed");
+    TEST_ASSERT_EQUAL(-2, status[1], "Throwing item should report -2");
+    TEST_ASSERT_EQUAL(-1, status[3], "Missing item should report -1");
+    TEST_ASSERT(results[0] == 1 && results[2] == 2 && results[5] == 3, "Items should run in order");
+    TEST_ASSERT_EQUAL(42, results[4], "Plugin commands should run in a batch");
+    TEST_ASSERT(log_contains(BU_LOG_ERR, "1 of 6 command(s) not found"), "Missing items should be summarized");
+    TEST_ASSERT(log_contains(BU_LOG_ERR, "batch test exception"), "The exception should be logged");
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run_batch(names, 1, nullptr, nullptr), "Outputs are optional");
+    TEST_ASSERT_EQUAL(-1, bu_plugin_cmd_run_batch(nullptr, 1, results, status), "NULL names are rejected");
+    
+    /* Parallel batch: every item is thread-safe, so the batch is split across the executor */
+    TEST_ASSERT_EQUAL(0, bu_plugin_exec_start(4), "Executor should start");
+    const size_t n = 20000;
+    std::vector<const char *> many(n, "batch_count");
+    std::vector<int> many_results(n, 0);
+    std::vector<int> many_status(n, 1);
+    s_batch_calls = 0;
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run_batch(many.data(), n, many_results.data(), many_status.data()), "Parallel batch should succeed");
+    TEST_ASSERT_EQUAL(static_cast<int>(n), s_batch_calls.load(), "Every item should run once");
+    bool all_ok = true;
+    for (size_t i = 0; i < n; i++) {
+        if (many_status[i] != 0 || many_results[i] <= 0) all_ok = false;
+    }
+    TEST_ASSERT(all_ok, "Every item should report its status and result");
+    bu_plugin_exec_stop();
+    
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_set_flags("batch_count", 0), "Flags should be clearable");
+    TEST_ASSERT(bu_plugin_cmd_get_flags("batch_count") == 0, "Cleared flags should read as 0");
+    
+    TEST_PASS();
+}
+
+static int batch_fail_scalar() {
+    return 7;
+}
+
+static int batch_fail_batch(size_t, int *) {
+    return -1;
+}
+
+/* Items [begin, end) hold consecutive values starting at first */
+static bool consecutive(const std::vector<int> &v, size_t begin, size_t end, int first) {
+    for (size_t i = begin; i < end; i++) {
+        if (v[i] != first + static_cast<int>(i - begin)) return false;
+    }
+    return true;
+}
+
+static bool test_batch_soa(const char* plugin_dir) {
+    TEST_START("Batched Entry Points");
+    
+    std::string path = get_plugin_path(plugin_dir, "tests/plugin/soa_plugin", "bu-soa-plugin");
+    TEST_ASSERT_EQUAL(2, bu_plugin_load(path.c_str()), "SoA plugin should load");
+    TEST_ASSERT(bu_plugin_cmd_get_batch("soa_counter") != nullptr, "Manifest batch entry points should apply");
+    TEST_ASSERT(bu_plugin_cmd_get_batch("batch_count") == nullptr, "Other commands have none");
+    
+    /* Runs of one command go through its batch entry point and return what scalar calls would */
+    int first = 0;
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run("soa_counter", &first), "Scalar call");
+    const size_t n = 3000;
+    std::vector<const char *> names(n, "soa_counter");
+    names.push_back("version");
+    names.push_back("soa_counter");
+    std::vector<int> results(names.size(), -1);
+    std::vector<int> status(names.size(), 1);
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run_batch(names.data(), names.size(), results.data(), status.data()), "SoA batch should succeed");
+    TEST_ASSERT(consecutive(results, 0, n, first + 1), "Chunks should continue the sequence");
+    TEST_ASSERT_EQUAL(first + 1 + static_cast<int>(n), results[n + 1], "A single item runs through the scalar impl");
+    bool all_ok = true;
+    for (int st : status) all_ok = all_ok && st == 0;
+    TEST_ASSERT(all_ok, "Every item should succeed");
+    
+    /* Without results, chunks still run (into scratch space) */
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run_batch(names.data(), n, nullptr, nullptr), "Batch without outputs");
+    int after = 0;
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run("soa_counter", &after), "Scalar call");
+    TEST_ASSERT_EQUAL(first + 2 + static_cast<int>(2 * n), after, "Every item should have run once");
+    
+    /* A failing batch entry point fails its whole chunk */
+    clear_logs();
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_register("batch_fail", batch_fail_scalar), "Should register batch_fail");
+    TEST_ASSERT_EQUAL(-1, bu_plugin_cmd_set_batch("no_such_command", batch_fail_batch), "Unknown names are rejected");
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_set_batch("batch_fail", batch_fail_batch), "Built-ins can get a batch entry point");
+    const char *fail_names[] = { "batch_fail", "batch_fail", "batch_fail", "version", "batch_fail" };
+    int fail_status[5];
+    int fail_results[5] = { 0, 0, 0, 0, 0 };
+    TEST_ASSERT_EQUAL(3, bu_plugin_cmd_run_batch(fail_names, 5, fail_results, fail_status), "The chunk should fail");
+    TEST_ASSERT(fail_status[0] == -2 && fail_status[1] == -2 && fail_status[2] == -2, "Chunk items report -2");
+    TEST_ASSERT(fail_status[3] == 0 && fail_status[4] == 0 && fail_results[4] == 7, "Other items still run");
+    TEST_ASSERT(log_contains(BU_LOG_ERR, "3 of 5 command(s) threw"), "The failure should be summarized");
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_set_batch("batch_fail", nullptr), "Batch entry points can be removed");
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run_batch(fail_names, 5, nullptr, nullptr), "Scalar calls again");
+    
+    /* Split across the executor, each range batches its own chunks */
+    TEST_ASSERT_EQUAL(0, bu_plugin_exec_start(4), "Executor should start");
+    const size_t m = 20000;
+    std::vector<const char *> many(m, "soa_counter");
+    std::vector<int> many_results(m, 0);
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run_batch(many.data(), m, many_results.data(), nullptr), "Parallel SoA batch");
+    bu_plugin_exec_stop();
+    std::sort(many_results.begin(), many_results.end());
+    TEST_ASSERT(consecutive(many_results, 0, m, after + 1), "Every item should get its own value");
+    
+    TEST_PASS();
+}
+
+static std::atomic<int> s_dag_unsafe_active(0);
+static std::atomic<int> s_dag_unsafe_max(0);
+
+static int dag_slow() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    return 1;
+}
+
+static int dag_fast() {
+    return 2;
+}
+
+static int dag_fail() {
+    TEST_CMD_FAIL("dag test exception");
+}
+
+/* Not thread-safe: records how many instances ever overlapped */
+static int dag_unsafe() {
+    int active = ++s_dag_unsafe_active;
+    int seen = s_dag_unsafe_max.load();
+    while (active > seen && !s_dag_unsafe_max.compare_exchange_weak(seen, active)) {}
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    --s_dag_unsafe_active;
+    return 3;
+}
+
+static bool test_dag() {
+    TEST_START("Command DAG");
+    
+    clear_logs();
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_register("dag_slow", dag_slow), "Should register dag_slow");
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_register("dag_fast", dag_fast), "Should register dag_fast");
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_register("dag_fail", dag_fail), "Should register dag_fail");
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_register("dag_unsafe", dag_unsafe), "Should register dag_unsafe");
+    bu_plugin_cmd_set_flags("dag_slow", BU_PLUGIN_CMD_THREADSAFE);
+    bu_plugin_cmd_set_flags("dag_fast", BU_PLUGIN_CMD_THREADSAFE);
+    bu_plugin_cmd_set_flags("dag_fail", BU_PLUGIN_CMD_THREADSAFE);
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_set_strand("dag_unsafe", "dag_test"), "dag_unsafe should get a strand");
+    TEST_ASSERT_EQUAL(0, bu_plugin_exec_start(4), "Executor should start");
+    
+    /*
+     * slow ---> join -> tail
+     * fast --/
+     * fail -> cancelled1 -> cancelled2
+     * unsafe x4 (independent)
+     */
+    bu_plugin_dag *dag = bu_plugin_dag_create();
+    int slow = bu_plugin_dag_add(dag, "dag_slow");
+    int fast = bu_plugin_dag_add_handle(dag, bu_plugin_cmd_lookup("dag_fast"));
+    int join = bu_plugin_dag_add(dag, " dag_fast ");
+    int tail = bu_plugin_dag_add(dag, "dag_fast");
+    int fail = bu_plugin_dag_add(dag, "dag_fail");
+    int cancelled1 = bu_plugin_dag_add(dag, "dag_fast");
+    int cancelled2 = bu_plugin_dag_add(dag, "dag_slow");
+    for (int i = 0; i < 4; i++) bu_plugin_dag_add(dag, "dag_unsafe");
+    TEST_ASSERT(slow == 0 && fast == 1 && cancelled2 == 6, "Node ids should follow insertion order");
+    TEST_ASSERT_EQUAL(-1, bu_plugin_dag_add(dag, "   "), "Empty names are rejected");
+    TEST_ASSERT_EQUAL(-1, bu_plugin_dag_depend(dag, join, join), "Self dependencies are rejected");
+    TEST_ASSERT_EQUAL(-1, bu_plugin_dag_depend(dag, join, 99), "Unknown ids are rejected");
+    TEST_ASSERT_EQUAL(0, bu_plugin_dag_depend(dag, join, slow), "Dependency should be added");
+    TEST_ASSERT_EQUAL(0, bu_plugin_dag_depend(dag, join, fast), "Dependency should be added");
+    TEST_ASSERT_EQUAL(0, bu_plugin_dag_depend(dag, tail, join), "Dependency should be added");
+    TEST_ASSERT_EQUAL(0, bu_plugin_dag_depend(dag, cancelled1, fail), "Dependency should be added");
+    TEST_ASSERT_EQUAL(0, bu_plugin_dag_depend(dag, cancelled2, cancelled1), "Dependency should be added");
+    
+    bu_plugin_dag_report report;
+    std::memset(&report, 0, sizeof(report));
+    report.struct_size = sizeof(report);
+    TEST_ASSERT_EQUAL(3, bu_plugin_dag_run(dag, &report), "The failing node and its two dependents should not succeed");
+    TEST_ASSERT(report.nodes == 11 && report.succeeded == 8, "Every other node should succeed");
+    TEST_ASSERT(report.failed == 1 && report.cancelled == 2, "Failures should cancel only downstream nodes");
+    TEST_ASSERT_EQUAL(1, s_dag_unsafe_max.load(), "Non-thread-safe commands should never overlap");
+    TEST_ASSERT(log_contains(BU_LOG_ERR, "dag test exception"), "The exception should be logged");
+    
+    bu_plugin_dag_node_report info;
+    std::memset(&info, 0, sizeof(info));
+    info.struct_size = sizeof(info);
+    TEST_ASSERT_EQUAL(0, bu_plugin_dag_node_info(dag, tail, &info), "Node info should be available");
+    TEST_ASSERT(info.status == 0 && info.result == 2 && info.critical, "Tail should succeed on the critical path");
+    double tail_start = info.start_us;
+    bu_plugin_dag_node_info(dag, slow, &info);
+    TEST_ASSERT(info.end_us <= tail_start, "Tail should start after its dependencies finish");
+    bu_plugin_dag_node_info(dag, cancelled2, &info);
+    TEST_ASSERT_EQUAL(BU_PLUGIN_DAG_CANCELLED, info.status, "Downstream of a failure should be cancelled");
+    
+    int path[8];
+    TEST_ASSERT(bu_plugin_dag_critical_path(dag, path, 8) == 3, "Critical path should be slow -> join -> tail");
+    TEST_ASSERT(path[0] == slow && path[1] == join && path[2] == tail, "Critical path should start at the slow node");
+    TEST_ASSERT(report.critical_len == 3 && report.critical_us >= 20000.0, "Report should carry the critical path");
+    TEST_ASSERT(log_contains(BU_LOG_INFO, "dag_slow -> dag_fast -> dag_fast"), "Critical path should be logged");
+    
+    /* From inside an executor job the DAG runs inline instead of blocking the worker */
+    std::promise<int> inline_run;
+    bu_plugin_exec_post([](void *arg) {
+        bu_plugin_dag *inner = bu_plugin_dag_create();
+        int first = bu_plugin_dag_add(inner, "dag_unsafe");
+        bu_plugin_dag_depend(inner, bu_plugin_dag_add(inner, "dag_fast"), first);
+        int failed = bu_plugin_dag_run(inner, nullptr);
+        bu_plugin_dag_node_report r;
+        std::memset(&r, 0, sizeof(r));
+        r.struct_size = sizeof(r);
+        bu_plugin_dag_node_info(inner, 1, &r);
+        bu_plugin_dag_destroy(inner);
+        static_cast<std::promise<int> *>(arg)->set_value(failed == 0 ? r.result : -1);
+    }, &inline_run);
+    TEST_ASSERT_EQUAL(2, inline_run.get_future().get(), "A DAG run from a worker should complete inline");
+    
+    TEST_ASSERT_EQUAL(0, bu_plugin_dag_depend(dag, slow, tail), "Back edge should be accepted until the run");
+    TEST_ASSERT_EQUAL(-1, bu_plugin_dag_run(dag, nullptr), "Cycles should be rejected");
+    TEST_ASSERT(log_contains(BU_LOG_ERR, "dependency cycle"), "The cycle should be logged");
+    bu_plugin_dag_destroy(dag);
+    bu_plugin_exec_stop();
+    
+    TEST_PASS();
+}
+
+/* Strand jobs append their index; a strand must keep posting order */
+struct StrandLog {
+    std::vector<int> order;
+    std::atomic<int> active{0};
+    std::atomic<int> max_active{0};
+};
+
+struct StrandItem {
+    StrandLog *log;
+    int index;
+};
+
+static void strand_item_job(void *arg) {
+    StrandItem *item = static_cast<StrandItem *>(arg);
+    int active = ++item->log->active;
+    int seen = item->log->max_active.load();
+    while (active > seen && !item->log->max_active.compare_exchange_weak(seen, active)) {}
+    item->log->order.push_back(item->index);
+    --item->log->active;
+}
+
+static std::atomic<int> s_strand_cmd_done(0);
+
+static void strand_cmd_done(int status, int, void *) {
+    if (status == 0) s_strand_cmd_done++;
+}
+
+static bool test_strands() {
+    TEST_START("Executor Strands");
+    
+    clear_logs();
+    bu_plugin_strand *a = bu_plugin_strand_get("strand_a");
+    TEST_ASSERT(a != nullptr, "Strand should be created");
+    TEST_ASSERT(a == bu_plugin_strand_get(" strand_a "), "Strands should be interned by name");
+    TEST_ASSERT(a != bu_plugin_strand_get("strand_b"), "Different names are different strands");
+    TEST_ASSERT(std::strcmp(bu_plugin_strand_name(a), "strand_a") == 0, "Strand should know its name");
+    TEST_ASSERT(bu_plugin_strand_get("") == nullptr, "Empty names are rejected");
+    
+    /* Plugin commands that are not thread-safe get their plugin's strand */
+    bu_plugin_strand *services = bu_plugin_cmd_handle_strand(bu_plugin_cmd_lookup("services_call"));
+    TEST_ASSERT(services != nullptr, "Unflagged plugin command should have a strand");
+    TEST_ASSERT(std::strcmp(bu_plugin_strand_name(services), "bu-services-plugin") == 0, "Strand should be the plugin's");
+    TEST_ASSERT(bu_plugin_cmd_handle_strand(bu_plugin_cmd_lookup("services_answer")) == nullptr, "Thread-safe commands run freely");
+    TEST_ASSERT(bu_plugin_cmd_handle_strand(bu_plugin_cmd_lookup("dag_fast")) == nullptr, "Built-in commands run freely");
+    
+    /* Explicit groups, cleared by NULL or overridden by the thread-safe flag */
+    bu_plugin_cmd_handle unsafe = bu_plugin_cmd_lookup("dag_unsafe");
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_set_strand("dag_unsafe", "strand_a"), "Group should be settable");
+    TEST_ASSERT(bu_plugin_cmd_handle_strand(unsafe) == a, "Handle should follow the group");
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_set_flags("dag_unsafe", BU_PLUGIN_CMD_THREADSAFE), "Flag should be settable");
+    TEST_ASSERT(bu_plugin_cmd_handle_strand(unsafe) == nullptr, "Thread-safe commands ignore their group");
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_set_flags("dag_unsafe", 0), "Flag should be clearable");
+    TEST_ASSERT(bu_plugin_cmd_handle_strand(unsafe) == a, "Group should apply again");
+    TEST_ASSERT_EQUAL(-1, bu_plugin_cmd_set_strand("no_such_command", "strand_a"), "Unknown names are rejected");
+    
+    TEST_ASSERT_EQUAL(0, bu_plugin_exec_start(4), "Executor should start");
+    
+    /* Jobs on one strand run one at a time, in order */
+    StrandLog log;
+    std::vector<StrandItem> items(2000);
+    for (int i = 0; i < 2000; i++) {
+        items[static_cast<size_t>(i)].log = &log;
+        items[static_cast<size_t>(i)].index = i;
+        TEST_ASSERT_EQUAL(0, bu_plugin_strand_post(a, strand_item_job, &items[static_cast<size_t>(i)]), "Strand post should queue");
+    }
+    bu_plugin_exec_drain();
+    TEST_ASSERT_EQUAL(1, log.max_active.load(), "Strand jobs should never overlap");
+    bool in_order = log.order.size() == 2000;
+    for (size_t i = 0; in_order && i < log.order.size(); i++) in_order = log.order[i] == static_cast<int>(i);
+    TEST_ASSERT(in_order, "Strand jobs should run in posting order");
+    TEST_ASSERT_EQUAL(-1, bu_plugin_strand_post(nullptr, strand_item_job, nullptr), "NULL strands are rejected");
+    
+    /* Submitted commands are funneled through their group */
+    s_dag_unsafe_max = 0;
+    for (int i = 0; i < 50; i++) {
+        TEST_ASSERT_EQUAL(0, bu_plugin_cmd_submit(unsafe, strand_cmd_done, nullptr), "Submit should queue");
+    }
+    bu_plugin_exec_drain();
+    TEST_ASSERT_EQUAL(50, s_strand_cmd_done.load(), "Every submission should complete");
+    TEST_ASSERT_EQUAL(1, s_dag_unsafe_max.load(), "Grouped commands should never overlap");
+    
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_set_strand("dag_unsafe", nullptr), "Group should be clearable");
+    TEST_ASSERT(bu_plugin_cmd_handle_strand(unsafe) == nullptr, "Built-in without a group runs freely");
+    bu_plugin_exec_stop();
+    
+    TEST_PASS();
+}
+
+/* Lane commands hold their worker until the gate opens */
+static std::atomic<bool> s_lane_gate(false);
+static std::atomic<int> s_lane_started(0);
+static std::atomic<int> s_lane_ok(0);
+static std::atomic<int> s_lane_shed(0);
+static std::atomic<void *> s_lane_shed_user(nullptr);
+
+static int lane_gate_cmd() {
+    s_lane_started++;
+    while (!s_lane_gate.load()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    return 0;
+}
+
+static void lane_done(int status, int, void *user) {
+    if (status == 0) s_lane_ok++;
+    if (status == BU_PLUGIN_LANE_SHED) {
+        s_lane_shed++;
+        s_lane_shed_user = user;
+    }
+}
+
+static bool test_lanes() {
+    TEST_START("Priority Lanes");
+    
+    bu_plugin_lane_config cfg = { sizeof(bu_plugin_lane_config), 2, 1, BU_PLUGIN_ADMIT_REJECT };
+    TEST_ASSERT_EQUAL(-1, bu_plugin_lane_configure(BU_PLUGIN_LANE_COUNT, &cfg), "Unknown lanes are rejected");
+    TEST_ASSERT_EQUAL(-1, bu_plugin_lane_configure(BU_PLUGIN_LANE_BULK, nullptr), "NULL configs are rejected");
+    bu_plugin_lane_config bad = cfg;
+    bad.policy = 7;
+    TEST_ASSERT_EQUAL(-1, bu_plugin_lane_configure(BU_PLUGIN_LANE_BULK, &bad), "Unknown policies are rejected");
+    bad = cfg;
+    bad.struct_size = 1;
+    TEST_ASSERT_EQUAL(-1, bu_plugin_lane_configure(BU_PLUGIN_LANE_BULK, &bad), "Short configs are rejected");
+    /* A bounded lane sheds only jobs it holds back, so it needs 0 < max_running < capacity */
+    bad = cfg;
+    bad.policy = BU_PLUGIN_ADMIT_SHED;
+    bad.max_running = 0;
+    TEST_ASSERT_EQUAL(-1, bu_plugin_lane_configure(BU_PLUGIN_LANE_BULK, &bad), "Shedding without max_running is rejected");
+    bad.max_running = 2;
+    TEST_ASSERT_EQUAL(-1, bu_plugin_lane_configure(BU_PLUGIN_LANE_BULK, &bad), "Shedding with max_running >= capacity is rejected");
+    bad.capacity = 0;
+    bad.max_running = 0;
+    TEST_ASSERT_EQUAL(0, bu_plugin_lane_configure(BU_PLUGIN_LANE_BULK, &bad), "An unbounded lane may shed");
+    TEST_ASSERT_EQUAL(0, bu_plugin_lane_configure(BU_PLUGIN_LANE_BULK, &cfg), "Lane should be configurable");
+    bu_plugin_lane_reset_stats(BU_PLUGIN_LANE_BULK);
+    
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_register("lane_gate", lane_gate_cmd), "Gate command should register");
+    bu_plugin_cmd_handle gate = bu_plugin_cmd_lookup("lane_gate");
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_set_flags("lane_gate", BU_PLUGIN_CMD_THREADSAFE), "Flag should be settable");
+    TEST_ASSERT_EQUAL(-1, bu_plugin_cmd_submit_lane(gate, -1, lane_done, nullptr), "Unknown lanes are rejected");
+    TEST_ASSERT_EQUAL(0, bu_plugin_exec_start(2), "Executor should start");
+    
+    /* One job runs; the next two wait in the lane; the fourth finds it full */
+    int tags[3] = { 1, 2, 3 };
+    s_lane_gate = false;
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_submit_lane(gate, BU_PLUGIN_LANE_BULK, lane_done, &tags[0]), "First job should be admitted");
+    while (s_lane_started.load() < 1) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_submit_lane(gate, BU_PLUGIN_LANE_BULK, lane_done, &tags[1]), "Second job should be held");
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_submit_lane(gate, BU_PLUGIN_LANE_BULK, lane_done, &tags[2]), "Third job should be held");
+    TEST_ASSERT_EQUAL(BU_PLUGIN_LANE_REJECTED, bu_plugin_cmd_submit_lane(gate, BU_PLUGIN_LANE_BULK, lane_done, nullptr),
+                      "A full lane should reject");
+    bu_plugin_lane_stats stats = bu_plugin_lane_stats();
+    stats.struct_size = sizeof(stats);
+    TEST_ASSERT_EQUAL(0, bu_plugin_lane_get_stats(BU_PLUGIN_LANE_BULK, &stats), "Stats should be readable");
+    TEST_ASSERT_EQUAL(2, static_cast<int>(stats.depth), "Two jobs should be waiting");
+    TEST_ASSERT_EQUAL(1, static_cast<int>(stats.running), "max_running should hold back the rest");
+    TEST_ASSERT_EQUAL(1, static_cast<int>(s_lane_started.load()), "Held jobs should not start");
+    
+    /* Shedding drops the oldest waiting job */
+    cfg.policy = BU_PLUGIN_ADMIT_SHED;
+    TEST_ASSERT_EQUAL(0, bu_plugin_lane_configure(BU_PLUGIN_LANE_BULK, &cfg), "Policy should be changeable");
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_submit_lane(gate, BU_PLUGIN_LANE_BULK, lane_done, nullptr), "Shedding should admit");
+    TEST_ASSERT_EQUAL(1, s_lane_shed.load(), "The shed job should complete with BU_PLUGIN_LANE_SHED");
+    TEST_ASSERT(s_lane_shed_user.load() == &tags[1], "The oldest held job should be the one shed");
+    
+    /* Blocking holds the submitter until a waiting job starts */
+    cfg.policy = BU_PLUGIN_ADMIT_BLOCK;
+    TEST_ASSERT_EQUAL(0, bu_plugin_lane_configure(BU_PLUGIN_LANE_BULK, &cfg), "Policy should be changeable");
+    std::atomic<bool> submitted(false);
+    std::thread blocked([&submitted, gate]() {
+        bu_plugin_cmd_submit_lane(gate, BU_PLUGIN_LANE_BULK, lane_done, nullptr);
+        submitted = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    TEST_ASSERT(!submitted.load(), "A full blocking lane should hold the submitter");
+    s_lane_gate = true;
+    blocked.join();
+    bu_plugin_exec_drain();
+    TEST_ASSERT_EQUAL(4, s_lane_ok.load(), "Admitted jobs should all complete");
+    
+    TEST_ASSERT_EQUAL(0, bu_plugin_lane_get_stats(BU_PLUGIN_LANE_BULK, &stats), "Stats should be readable");
+    TEST_ASSERT_EQUAL(0, static_cast<int>(stats.depth), "Lane should be empty");
+    TEST_ASSERT_EQUAL(2, static_cast<int>(stats.max_depth), "Depth should never exceed capacity");
+    TEST_ASSERT_EQUAL(5, static_cast<int>(stats.admitted), "Five jobs were admitted");
+    TEST_ASSERT_EQUAL(1, static_cast<int>(stats.rejected), "One job was rejected");
+    TEST_ASSERT_EQUAL(1, static_cast<int>(stats.shed), "One job was shed");
+    TEST_ASSERT_EQUAL(4, static_cast<int>(stats.completed), "Four jobs ran");
+    TEST_ASSERT(stats.wait_p50_us > 0.0 && stats.wait_max_us >= stats.wait_p50_us * 0.5, "Wait times should be recorded");
+    
+    /* Plain submissions use the normal lane */
+    bu_plugin_lane_reset_stats(BU_PLUGIN_LANE_NORMAL);
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_submit(gate, lane_done, nullptr), "Submit should queue");
+    bu_plugin_exec_drain();
+    TEST_ASSERT_EQUAL(0, bu_plugin_lane_get_stats(BU_PLUGIN_LANE_NORMAL, &stats), "Stats should be readable");
+    TEST_ASSERT_EQUAL(1, static_cast<int>(stats.completed), "bu_plugin_cmd_submit should use the normal lane");
+    bu_plugin_exec_stop();
+    
+    bu_plugin_lane_config defaults = { sizeof(bu_plugin_lane_config), 0, 0, BU_PLUGIN_ADMIT_BLOCK };
+    bu_plugin_lane_configure(BU_PLUGIN_LANE_BULK, &defaults);
+    bu_plugin_lane_reset_stats(BU_PLUGIN_LANE_BULK);
+    bu_plugin_lane_reset_stats(BU_PLUGIN_LANE_NORMAL);
+    
+    TEST_PASS();
+}
+
+/* Call context commands: count runs, cancel the current context, report it */
+static std::atomic<int> s_ctx_count(0);
+static bu_plugin_call_ctx *s_ctx_expected = nullptr;
+
+static int ctx_count_cmd() {
+    return ++s_ctx_count;
+}
+
+static int ctx_cancel_cmd() {
+    bu_plugin_call_ctx_cancel(bu_plugin_call_ctx_current());
+    return 7;
+}
+
+static int ctx_check_cmd() {
+    return bu_plugin_call_ctx_current() == s_ctx_expected ? 1 : 0;
+}
+
+static bool test_call_ctx() {
+    TEST_START("Call Contexts");
+    
+    bu_plugin_cmd_register("ctx_count", ctx_count_cmd);
+    bu_plugin_cmd_register("ctx_cancel", ctx_cancel_cmd);
+    bu_plugin_cmd_register("ctx_check", ctx_check_cmd);
+    TEST_ASSERT(bu_plugin_call_ctx_current() == nullptr, "No context is current by default");
+    TEST_ASSERT(!bu_plugin_call_ctx_stopped(nullptr), "A NULL context never stops");
+    TEST_ASSERT_EQUAL(-1, bu_plugin_call_ctx_set_deadline(nullptr, 10), "NULL contexts are rejected");
+    
+    /* Synchronous runs are skipped once the context has stopped */
+    bu_plugin_call_ctx *ctx = bu_plugin_call_ctx_create();
+    TEST_ASSERT(ctx != nullptr && !bu_plugin_call_ctx_stopped(ctx), "New contexts are live");
+    int result = 0;
+    {
+        bu_plugin::call_scope scope(ctx);
+        TEST_ASSERT(bu_plugin_call_ctx_current() == ctx, "Scope should make the context current");
+        TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run("ctx_cancel", &result), "Live context should run");
+        TEST_ASSERT(bu_plugin_call_ctx_stopped(ctx), "Command should have cancelled its context");
+        TEST_ASSERT_EQUAL(BU_PLUGIN_CALL_CANCELLED, bu_plugin_cmd_run("ctx_count", &result), "Stopped context should skip the run");
+        TEST_ASSERT_EQUAL(BU_PLUGIN_CALL_CANCELLED, bu_plugin_cmd_invoke(bu_plugin_cmd_lookup("ctx_count"), &result),
+                          "Stopped context should skip the invoke");
+    }
+    TEST_ASSERT(bu_plugin_call_ctx_current() == nullptr, "Scope should restore the previous context");
+    TEST_ASSERT_EQUAL(0, s_ctx_count.load(), "Skipped commands should not run");
+    bu_plugin_call_ctx_destroy(ctx);
+    
+    /* A deadline stops a command polling through the host services table */
+    ctx = bu_plugin_call_ctx_create();
+    TEST_ASSERT_EQUAL(0, bu_plugin_call_ctx_set_deadline(ctx, 20000), "Deadline should be settable");
+    auto t0 = std::chrono::steady_clock::now();
+    {
+        bu_plugin::call_scope scope(ctx);
+        TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run("services_poll", &result), "Polling command should run");
+    }
+    long waited_ms = static_cast<long>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count());
+    TEST_ASSERT_EQUAL(1, result, "Polling command should see its context stop");
+    TEST_ASSERT(waited_ms >= 15, "The deadline should not fire early");
+    bu_plugin_call_ctx_destroy(ctx);
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run("services_poll", &result), "Polling command should run");
+    TEST_ASSERT_EQUAL(-1, result, "Without a context there is nothing to poll");
+    
+    ctx = bu_plugin_call_ctx_create();
+    bu_plugin_call_ctx_set_deadline(ctx, 5000);
+    bu_plugin_call_ctx_set_deadline(ctx, 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    TEST_ASSERT(!bu_plugin_call_ctx_stopped(ctx), "A removed deadline should not fire");
+    bu_plugin_call_ctx_destroy(ctx);
+    
+    /* Batch items after the cancellation are not started */
+    ctx = bu_plugin_call_ctx_create();
+    const char *names[] = { "ctx_count", "ctx_cancel", "ctx_count", "ctx_count" };
+    int status[4] = { 1, 1, 1, 1 };
+    int failed = 0;
+    {
+        bu_plugin::call_scope scope(ctx);
+        failed = bu_plugin_cmd_run_batch(names, 4, nullptr, status);
+    }
+    TEST_ASSERT_EQUAL(2, failed, "Two items should be cancelled");
+    TEST_ASSERT(status[0] == 0 && status[1] == 0, "Items before the cancellation should run");
+    TEST_ASSERT(status[2] == BU_PLUGIN_CALL_CANCELLED && status[3] == BU_PLUGIN_CALL_CANCELLED, "Later items should be cancelled");
+    TEST_ASSERT_EQUAL(1, s_ctx_count.load(), "Cancelled items should not run");
+    TEST_ASSERT(log_contains(BU_LOG_WARN, "cancelled before they started"), "The cancellation should be summarized");
+    
+    /* DAG nodes are cancelled too */
+    TEST_ASSERT_EQUAL(0, bu_plugin_exec_start(2), "Executor should start");
+    bu_plugin_dag *dag = bu_plugin_dag_create();
+    bu_plugin_dag_add(dag, "ctx_count");
+    bu_plugin_dag_add(dag, "ctx_count");
+    {
+        bu_plugin::call_scope scope(ctx);
+        TEST_ASSERT_EQUAL(2, bu_plugin_dag_run(dag, nullptr), "Every node should be cancelled");
+    }
+    bu_plugin_dag_node_report info = bu_plugin_dag_node_report();
+    info.struct_size = sizeof(info);
+    bu_plugin_dag_node_info(dag, 0, &info);
+    TEST_ASSERT_EQUAL(BU_PLUGIN_DAG_CANCELLED, info.status, "Node should report cancellation");
+    bu_plugin_dag_destroy(dag);
+    
+    /* Submitted commands keep the context alive and see it as current */
+    {
+        bu_plugin::call_scope scope(ctx);
+        bool threw = false;
+        try {
+            bu_plugin::submit("ctx_count").get();
+        } catch (const bu_plugin::cmd_error &e) {
+            threw = e.status() == BU_PLUGIN_CALL_CANCELLED;
+        }
+        TEST_ASSERT(threw, "A submit under a stopped context should complete as cancelled");
+    }
+    bu_plugin_call_ctx_destroy(ctx);
+    
+    ctx = bu_plugin_call_ctx_create();
+    s_ctx_expected = ctx;
+    std::future<int> seen;
+    {
+        bu_plugin::call_scope scope(ctx);
+        seen = bu_plugin::submit("ctx_check");
+    }
+    bu_plugin_call_ctx_destroy(ctx);
+    TEST_ASSERT_EQUAL(1, seen.get(), "The job should run under the submitter's context");
+    bu_plugin_exec_stop();
+    s_ctx_expected = nullptr;
+    TEST_ASSERT_EQUAL(1, s_ctx_count.load(), "Cancelled submissions should not run");
+    
+    TEST_PASS();
+}
+
+/* Output writer that keeps each flush as one chunk */
+struct OutputChunks {
+    std::mutex m;
+    std::vector<std::string> chunks;
+};
+
+static void collect_output(void *user, const char *data, size_t len) {
+    OutputChunks *c = static_cast<OutputChunks *>(user);
+    std::lock_guard<std::mutex> lock(c->m);
+    c->chunks.push_back(std::string(data, len));
+}
+
+/* Writers that count flushes handed another writer's user pointer */
+static std::atomic<int> s_writer_mismatches(0);
+static int s_writer_a_tag = 0;
+static int s_writer_b_tag = 0;
+
+static void writer_a(void *user, const char *, size_t) {
+    if (user != &s_writer_a_tag) s_writer_mismatches++;
+}
+
+static void writer_b(void *user, const char *, size_t) {
+    if (user != &s_writer_b_tag) s_writer_mismatches++;
+}
+
+static int output_nested() {
+    bu_plugin_output_printf("outer %d\n", 1);
+    bu_plugin_cmd_run("help", nullptr);
+    bu_plugin_output_write("outer 2\n", 8);
+    return 0;
+}
+
+static int output_lines() {
+    for (int i = 0; i < 3; i++) bu_plugin_output_printf("line %d of 3\n", i);
+    return 0;
+}
+
+static int output_long() {
+    std::string word(1000, 'x');
+    bu_plugin_output_printf("[%s]", word.c_str());
+    return 0;
+}
+
+static int stage_throws() {
+    TEST_CMD_FAIL("stage failed");
+}
+
+static bool test_channels(const char* plugin_dir) {
+    TEST_START("Record Channels");
+    
+    TEST_ASSERT(bu_plugin_channel_create("int", 0, 4) == nullptr, "Zero-size records are rejected");
+    TEST_ASSERT(bu_plugin_channel_create("int", sizeof(int), 0) == nullptr, "Zero capacity is rejected");
+    bu_plugin_channel *ch = bu_plugin_channel_create("int", sizeof(int), 3);
+    TEST_ASSERT(ch != nullptr, "Channel should be created");
+    TEST_ASSERT_EQUAL(0, bu_plugin_channel_check(ch, "int", sizeof(int)), "Type and size should match");
+    TEST_ASSERT_EQUAL(-1, bu_plugin_channel_check(ch, "float", sizeof(int)), "Other types should not");
+    TEST_ASSERT_EQUAL(-1, bu_plugin_channel_check(ch, "int", sizeof(long long)), "Other sizes should not");
+    bu_plugin_channel_stats stats;
+    stats.struct_size = sizeof(stats);
+    TEST_ASSERT_EQUAL(0, bu_plugin_channel_get_stats(ch, &stats), "Stats should be readable");
+    TEST_ASSERT_EQUAL(4, static_cast<int>(stats.capacity), "Capacity rounds up to a power of two");
+    
+    /* Reserved runs stop at the end of the ring */
+    for (int v = 1; v <= 3; v++) bu_plugin_channel_push(ch, &v);
+    int v = 0;
+    TEST_ASSERT_EQUAL(1, bu_plugin_channel_pop(ch, &v), "A record should be there");
+    TEST_ASSERT_EQUAL(1, v, "Records come out in order");
+    size_t got = 0;
+    int *slots = static_cast<int *>(bu_plugin_channel_reserve(ch, 8, &got));
+    TEST_ASSERT(slots != nullptr && got == 1, "Only the slot before the wrap is contiguous");
+    slots[0] = 4;
+    bu_plugin_channel_commit(ch, 1);
+    slots = static_cast<int *>(bu_plugin_channel_reserve(ch, 8, &got));
+    TEST_ASSERT(slots != nullptr && got == 1, "One slot is free after the wrap");
+    slots[0] = 5;
+    bu_plugin_channel_commit(ch, 1);
+    bu_plugin_channel_close(ch);
+    TEST_ASSERT_EQUAL(-1, bu_plugin_channel_push(ch, &v), "A closed channel takes no more records");
+    const int *recs = static_cast<const int *>(bu_plugin_channel_peek(ch, 8, &got));
+    TEST_ASSERT(recs != nullptr && got == 2 && recs[0] == 2 && recs[1] == 3, "Peek returns the run up to the wrap");
+    bu_plugin_channel_release(ch, got);
+    int sum = 0;
+    while (bu_plugin_channel_pop(ch, &v) == 1) sum += v;
+    TEST_ASSERT_EQUAL(9, sum, "Records committed before the close are delivered");
+    TEST_ASSERT_EQUAL(0, bu_plugin_channel_pop(ch, &v), "Then the stream ends");
+    bu_plugin_channel_destroy(ch);
+    
+    /* Backpressure: a small ring between two threads */
+    ch = bu_plugin_channel_create("int", sizeof(int), 8);
+    const int total = 100000;
+    std::thread producer([ch, total]() {
+        for (int i = 1; i <= total; i++) bu_plugin_channel_push(ch, &i);
+        bu_plugin_channel_close(ch);
+    });
+    long long consumed = 0;
+    int count = 0;
+    while (const int *r = static_cast<const int *>(bu_plugin_channel_peek(ch, 64, &got))) {
+        for (size_t i = 0; i < got; i++) consumed += r[i];
+        count += static_cast<int>(got);
+        bu_plugin_channel_release(ch, got);
+    }
+    producer.join();
+    TEST_ASSERT_EQUAL(total, count, "Every record should arrive");
+    TEST_ASSERT(consumed == static_cast<long long>(total) * (total + 1) / 2, "Records should arrive intact");
+    bu_plugin_channel_destroy(ch);
+    
+    /* Cancelling wakes a producer blocked on a full ring */
+    ch = bu_plugin_channel_create("int", sizeof(int), 2);
+    std::atomic<int> pushed(0);
+    std::thread blocked([ch, &pushed]() {
+        int x = 7;
+        while (bu_plugin_channel_push(ch, &x) == 0) pushed++;
+    });
+    while (pushed.load() < 2) std::this_thread::yield();
+    bu_plugin_channel_cancel(ch);
+    blocked.join();
+    TEST_ASSERT_EQUAL(2, pushed.load(), "The producer stops once cancelled");
+    TEST_ASSERT_EQUAL(-1, bu_plugin_channel_pop(ch, &v), "A cancelled channel reports it");
+    bu_plugin_channel_destroy(ch);
+    
+    /* A stopped call context ends a wait */
+    ch = bu_plugin_channel_create("int", sizeof(int), 2);
+    bu_plugin_call_ctx *ctx = bu_plugin_call_ctx_create();
+    bu_plugin_call_ctx_set_deadline(ctx, 20000);
+    bu_plugin_call_ctx *prev = bu_plugin_call_ctx_set_current(ctx);
+    TEST_ASSERT(bu_plugin_channel_peek(ch, 1, &got) == nullptr, "The deadline should end the wait");
+    bu_plugin_call_ctx_set_current(prev);
+    bu_plugin_call_ctx_destroy(ctx);
+    bu_plugin_channel_destroy(ch);
+    
+    /* A three-stage pipeline through the stream plugin */
+    std::string path = get_plugin_path(plugin_dir, "tests/plugin/stream_plugin", "bu-stream-plugin");
+    TEST_ASSERT_EQUAL(3, bu_plugin_load(path.c_str()), "Stream plugin should load");
+    bu_plugin_channel *links[4] = {
+        bu_plugin_channel_create(STREAM_JOB_TYPE, sizeof(stream_job), 4),
+        bu_plugin_channel_create(STREAM_SEGMENT_TYPE, sizeof(stream_segment), 64),
+        bu_plugin_channel_create(STREAM_SAMPLE_TYPE, sizeof(stream_sample), 64),
+        nullptr
+    };
+    for (uint32_t j = 0; j < 3; j++) {
+        stream_job job = { 10000, 17 + j };
+        bu_plugin_channel_push(links[0], &job);
+    }
+    bu_plugin_channel_close(links[0]);
+    const char *stages[] = { "stream_draw", "stream_render", "stream_volume" };
+    int results[3] = { 0, 0, 0 };
+    int status[3] = { 1, 1, 1 };
+    bu_plugin_output *out = bu_plugin_output_create();
+    bu_plugin_output *prev_out = bu_plugin_output_set_current(out);
+    TEST_ASSERT_EQUAL(0, bu_plugin_pipeline_run(stages, 3, links, results, status), "Pipeline should run");
+    bu_plugin_output_set_current(prev_out);
+    TEST_ASSERT(status[0] == 0 && status[1] == 0 && status[2] == 0, "Every stage should succeed");
+    TEST_ASSERT(results[0] == 30000 && results[1] == 30000 && results[2] == 30000, "Every record should pass every stage");
+    TEST_ASSERT(std::strstr(bu_plugin_output_data(out, nullptr), "30000 sample(s)") != nullptr,
+                "The last stage runs on the caller's thread");
+    bu_plugin_output_destroy(out);
+    bu_plugin_channel_get_stats(links[1], &stats);
+    TEST_ASSERT(stats.records == 30000, "Stats should count committed records");
+    for (bu_plugin_channel *l : links) bu_plugin_channel_destroy(l);
+    
+    /* Wrong record types are refused by the stages */
+    links[0] = bu_plugin_channel_create(STREAM_JOB_TYPE, sizeof(stream_job), 4);
+    links[1] = bu_plugin_channel_create(STREAM_SAMPLE_TYPE, sizeof(stream_sample), 64);
+    links[2] = bu_plugin_channel_create(STREAM_SAMPLE_TYPE, sizeof(stream_sample), 64);
+    bu_plugin_channel_close(links[0]);
+    TEST_ASSERT_EQUAL(0, bu_plugin_pipeline_run(stages, 3, links, results, status), "Stages still return");
+    TEST_ASSERT(results[0] == -1 && results[1] == -1, "Mismatched links are refused");
+    
+    /* A throwing stage cancels every link, so the others return */
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_register("stage_throws", stage_throws), "Should register stage_throws");
+    for (bu_plugin_channel *&l : links) {
+        bu_plugin_channel_destroy(l);
+        l = nullptr;
+    }
+    links[0] = bu_plugin_channel_create(STREAM_JOB_TYPE, sizeof(stream_job), 4);
+    links[1] = bu_plugin_channel_create(STREAM_SEGMENT_TYPE, sizeof(stream_segment), 8);
+    stream_job big = { 1000000, 3 };
+    bu_plugin_channel_push(links[0], &big);
+    bu_plugin_channel_close(links[0]);
+    const char *failing[] = { "stream_draw", "stage_throws" };
+    clear_logs();
+    TEST_ASSERT_EQUAL(1, bu_plugin_pipeline_run(failing, 2, links, results, status), "One stage should fail");
+    TEST_ASSERT(status[0] == 0 && status[1] == -2, "The throwing stage reports -2");
+    TEST_ASSERT(results[0] < 1000000, "The producer stops early");
+    TEST_ASSERT(bu_plugin_channel_cancelled(links[1]), "Links are cancelled");
+    
+    const char *missing[] = { "stream_draw", "no_such_stage" };
+    TEST_ASSERT_EQUAL(-1, bu_plugin_pipeline_run(missing, 2, links, nullptr, nullptr), "Unknown stages are rejected");
+    for (bu_plugin_channel *l : links) bu_plugin_channel_destroy(l);
+    
+    TEST_PASS();
+}
+
+static bool test_output(const char* plugin_dir) {
+    TEST_START("Command Output");
+    
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_register("output_nested", output_nested), "Should register output_nested");
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_register("output_lines", output_lines), "Should register output_lines");
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_register("output_long", output_long), "Should register output_long");
+    
+    /* Each outermost invocation reaches the writer in one piece, nested output in call order */
+    OutputChunks chunks;
+    bu_plugin_set_output_writer(collect_output, &chunks);
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run("output_nested", nullptr), "Nested output command should run");
+    TEST_ASSERT_EQUAL(1, static_cast<int>(chunks.chunks.size()), "One flush per outermost invocation");
+    TEST_ASSERT(chunks.chunks[0] == "outer 1\nBuilt-in help command\nouter 2\n", "Nested output should stay in order");
+    bu_plugin_output_printf("direct\n");
+    TEST_ASSERT(chunks.chunks.size() == 2 && chunks.chunks[1] == "direct\n", "Output outside commands goes straight out");
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run("output_long", nullptr), "Long output command should run");
+    TEST_ASSERT(chunks.chunks.size() == 3 && chunks.chunks[2] == "[" + std::string(1000, 'x') + "]",
+                "Long formatted output should not be truncated");
+    
+    /* Plugins write through the host services table */
+    std::string path = get_plugin_path(plugin_dir, "tests/plugin/math_plugin", "bu-math-plugin");
+    TEST_ASSERT(bu_plugin_load(path.c_str()) >= 0, "Math plugin should load");
+    chunks.chunks.clear();
+    int result = 0;
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run("math_add", &result), "math_add should run");
+    TEST_ASSERT(chunks.chunks.size() == 1 && chunks.chunks[0] == "Math plugin: add command (2+3=5)\n",
+                "Plugin output should reach the writer");
+    
+    /* Capture on this thread; the writer sees nothing */
+    bu_plugin_output *out = bu_plugin_output_create();
+    TEST_ASSERT(out != nullptr, "Capture buffer should be created");
+    TEST_ASSERT(bu_plugin_output_set_current(out) == nullptr, "No buffer was current");
+    bu_plugin_cmd_run("help", nullptr);
+    bu_plugin_cmd_run("math_add", nullptr);
+    TEST_ASSERT(bu_plugin_output_set_current(nullptr) == out, "The capture buffer was current");
+    size_t len = 0;
+    const char *data = bu_plugin_output_data(out, &len);
+    TEST_ASSERT(std::string(data, len) == "Built-in help command\nMath plugin: add command (2+3=5)\n",
+                "Output should be captured in order");
+    TEST_ASSERT_EQUAL(1, static_cast<int>(chunks.chunks.size()), "Captured output is not flushed");
+    bu_plugin_output_clear(out);
+    bu_plugin_output_data(out, &len);
+    TEST_ASSERT_EQUAL(0, static_cast<int>(len), "Clear should empty the buffer");
+    bu_plugin_output_destroy(out);
+    
+    /* Run wrappers of custom signatures bracket their calls */
+    bu_plugin_output_begin();
+    bu_plugin_output_write("a", 1);
+    bu_plugin_output_write("b", 1);
+    TEST_ASSERT_EQUAL(1, static_cast<int>(chunks.chunks.size()), "Output is held until the scope ends");
+    bu_plugin_output_end();
+    TEST_ASSERT(chunks.chunks.size() == 2 && chunks.chunks[1] == "ab", "Ending the scope flushes");
+    
+    /* Concurrent commands never interleave their output */
+    chunks.chunks.clear();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([]() {
+            for (int i = 0; i < 250; i++) bu_plugin_cmd_run("output_lines", nullptr);
+        });
+    }
+    for (auto &th : threads) th.join();
+    bool whole = chunks.chunks.size() == 1000;
+    for (const auto &c : chunks.chunks) whole = whole && c == "line 0 of 3\nline 1 of 3\nline 2 of 3\n";
+    TEST_ASSERT(whole, "Every invocation's output should arrive whole");
+    
+    /* A writer replaced while commands flush is always called with its own user pointer */
+    std::atomic<bool> swapping(true);
+    std::thread swapper([&swapping]() {
+        for (int i = 0; swapping.load(); i++) {
+            if (i % 2) {
+                bu_plugin_set_output_writer(writer_a, &s_writer_a_tag);
+            } else {
+                bu_plugin_set_output_writer(writer_b, &s_writer_b_tag);
+            }
+        }
+    });
+    threads.clear();
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([]() {
+            for (int i = 0; i < 250; i++) bu_plugin_cmd_run("output_lines", nullptr);
+        });
+    }
+    for (auto &th : threads) th.join();
+    swapping = false;
+    swapper.join();
+    TEST_ASSERT_EQUAL(0, s_writer_mismatches.load(), "Writer and user pointer should be swapped together");
+    
+    /* Discarding drops output without buffering it */
+    bu_plugin_set_output_writer(bu_plugin_output_discard, nullptr);
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run("output_nested", nullptr), "Commands still run");
+    bu_plugin_set_output_writer(nullptr, nullptr);
+    
+    TEST_PASS();
+}
+
+static std::atomic<int> s_memo_calls(0);
+
+static int memo_pure() {
+    s_memo_calls++;
+    return 42;
+}
+
+static bu_plugin_memo_stats memo_stats() {
+    bu_plugin_memo_stats st;
+    st.struct_size = sizeof(st);
+    bu_plugin_memo_get_stats(&st);
+    return st;
+}
+
+/**
+ * Test: Result cache
+ * Pure commands run once per key; the cache is bounded and dropped on unload.
+ * Shuts the registry down, so it runs last.
+ */
+static bool test_memo(const char* plugin_dir) {
+    TEST_START("Result Cache");
+    
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_register("memo_pure", memo_pure), "Should register memo_pure");
+    int result = 0;
+    bu_plugin_cmd_run("memo_pure", &result);
+    bu_plugin_cmd_run("memo_pure", &result);
+    TEST_ASSERT_EQUAL(2, s_memo_calls.load(), "Nothing is cached until the cache has a capacity");
+    bu_plugin_memo_set_capacity(64);
+    bu_plugin_cmd_run("memo_pure", &result);
+    TEST_ASSERT_EQUAL(3, s_memo_calls.load(), "Commands not flagged pure are not cached");
+    
+    /* Run, invoke and submit share the entry */
+    bu_plugin_memo_stats before = memo_stats();
+    bu_plugin_cmd_set_flags("memo_pure", BU_PLUGIN_CMD_PURE | BU_PLUGIN_CMD_THREADSAFE);
+    TEST_ASSERT(memo_stats().invalidations == before.invalidations + 1, "Gaining the pure flag drops the cache");
+    result = 0;
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run("memo_pure", &result), "First pure run should succeed");
+    TEST_ASSERT_EQUAL(42, result, "First pure run returns the result");
+    bu_plugin_cmd_handle h = bu_plugin_cmd_lookup("memo_pure");
+    TEST_ASSERT(bu_plugin_cmd_handle_flags(h) == (BU_PLUGIN_CMD_PURE | BU_PLUGIN_CMD_THREADSAFE), "Handle reports the flags");
+    result = 0;
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_invoke(h, &result), "Invoke should hit");
+    TEST_ASSERT_EQUAL(42, result, "A hit returns the cached result");
+    result = 0;
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run("memo_pure", &result), "Run should hit");
+    std::future<int> f = bu_plugin::submit(h);
+    TEST_ASSERT_EQUAL(42, f.get(), "Submitted call should hit");
+    TEST_ASSERT_EQUAL(4, s_memo_calls.load(), "The pure command ran once");
+    bu_plugin_memo_stats st = memo_stats();
+    TEST_ASSERT(st.hits == before.hits + 3 && st.misses == before.misses + 1, "Three hits and one miss");
+    TEST_ASSERT_EQUAL(1, static_cast<int>(st.entries), "One entry cached");
+    TEST_ASSERT_EQUAL(64, static_cast<int>(st.capacity), "Capacity as set");
+    
+    /* Clearing and dropping the flag both stop hits */
+    bu_plugin_memo_clear();
+    bu_plugin_cmd_run("memo_pure", nullptr);
+    TEST_ASSERT_EQUAL(5, s_memo_calls.load(), "A cleared cache misses");
+    bu_plugin_cmd_set_flags("memo_pure", BU_PLUGIN_CMD_THREADSAFE);
+    bu_plugin_cmd_run("memo_pure", nullptr);
+    bu_plugin_cmd_run("memo_pure", nullptr);
+    TEST_ASSERT_EQUAL(7, s_memo_calls.load(), "Commands no longer pure run every time");
+    bu_plugin_cmd_set_flags("memo_pure", BU_PLUGIN_CMD_PURE);
+    
+    /* Wrappers for other signatures key entries by argument bytes, storing with the token of their miss */
+    int cached = 0;
+    bu_plugin_memo_token ta = 0, tb = 0;
+    TEST_ASSERT_EQUAL(0, bu_plugin_memo_lookup(h, "a", 1, &cached, &ta), "Unknown arguments miss");
+    TEST_ASSERT(ta != 0, "A miss hands out a token");
+    TEST_ASSERT_EQUAL(0, bu_plugin_memo_lookup(h, "b", 1, &cached, &tb), "Unknown arguments miss");
+    int seven = 7, eight = 8, nine = 9, ten = 10;
+    bu_plugin_memo_store(h, "a", 1, &seven, ta);
+    bu_plugin_memo_store(h, "b", 1, &eight, tb);
+    bu_plugin_memo_token hit_token = 1;
+    TEST_ASSERT(bu_plugin_memo_lookup(h, "a", 1, &cached, &hit_token) == 1 && cached == 7, "Stored result for 'a'");
+    TEST_ASSERT(hit_token == 0, "A hit hands out no token");
+    TEST_ASSERT(bu_plugin_memo_lookup(h, "b", 1, &cached, nullptr) == 1 && cached == 8, "Stored result for 'b'");
+    TEST_ASSERT_EQUAL(0, bu_plugin_memo_lookup(h, "ab", 2, &cached, nullptr), "Keys compare by bytes");
+    bu_plugin_memo_store(h, "c", 1, &nine, 0);
+    TEST_ASSERT_EQUAL(0, bu_plugin_memo_lookup(h, "c", 1, &cached, nullptr), "A store without a token is ignored");
+    bu_plugin_cmd_handle help = bu_plugin_cmd_lookup("help");
+    bu_plugin_memo_token th = 0;
+    TEST_ASSERT_EQUAL(0, bu_plugin_memo_lookup(help, "a", 1, &cached, &th), "Commands that are not pure miss");
+    TEST_ASSERT(th == 0, "Commands that are not pure get no token");
+    bu_plugin_memo_store(help, "a", 1, &nine, ta);
+    TEST_ASSERT_EQUAL(0, bu_plugin_memo_lookup(help, "a", 1, &cached, nullptr), "Commands that are not pure are never cached");
+    
+    /* A result computed across an invalidation is not stored */
+    bu_plugin_memo_token stale = 0;
+    TEST_ASSERT_EQUAL(0, bu_plugin_memo_lookup(h, "d", 1, &cached, &stale), "Unknown arguments miss");
+    bu_plugin_memo_clear();
+    bu_plugin_memo_store(h, "d", 1, &ten, stale);
+    TEST_ASSERT_EQUAL(0, bu_plugin_memo_lookup(h, "d", 1, &cached, nullptr), "A store from before an invalidation is dropped");
+    
+    /* Bounded: distinct keys evict old ones */
+    bu_plugin_memo_set_capacity(16);
+    for (int i = 0; i < 200; i++) {
+        bu_plugin_memo_token t = 0;
+        bu_plugin_memo_lookup(h, &i, sizeof(i), nullptr, &t);
+        bu_plugin_memo_store(h, &i, sizeof(i), &i, t);
+    }
+    st = memo_stats();
+    TEST_ASSERT(st.entries <= 16 && st.entries > 0, "Entries stay within the capacity");
+    TEST_ASSERT(st.evictions > before.evictions, "Full shards evict");
+    int hits = 0;
+    for (int i = 0; i < 200; i++) {
+        if (bu_plugin_memo_lookup(h, &i, sizeof(i), &cached, nullptr) == 1) {
+            hits++;
+            if (cached != i) hits = -1000;
+        }
+    }
+    TEST_ASSERT(hits > 0 && static_cast<size_t>(hits) == st.entries, "Surviving entries return their own results");
+    
+    /* Cached results from a plugin do not survive its unload */
+    std::string path = get_plugin_path(plugin_dir, "tests/plugin/soa_plugin", "bu-soa-plugin");
+    bu_plugin_cmd_set_flags("soa_counter", BU_PLUGIN_CMD_PURE);
+    int first = 0, second = 0;
+    bu_plugin_cmd_run("soa_counter", &first);
+    bu_plugin_cmd_run("soa_counter", &second);
+    TEST_ASSERT_EQUAL(first, second, "A counter flagged pure returns its cached value");
+    before = memo_stats();
+    bu_plugin_shutdown();
+    st = memo_stats();
+    TEST_ASSERT(st.invalidations > before.invalidations && st.entries == 0, "Shutdown drops every entry");
+    TEST_ASSERT(bu_plugin_load(path.c_str()) > 0, "SOA plugin should load again");
+    bu_plugin_cmd_set_flags("soa_counter", BU_PLUGIN_CMD_PURE);
+    bu_plugin_cmd_run("soa_counter", nullptr);
+    TEST_ASSERT(memo_stats().misses == st.misses + 1, "The reloaded command misses");
+    bu_plugin_memo_set_capacity(0);
+    
+    TEST_PASS();
+}
+
+namespace bu_plugin {
+template <>
+struct signature<double(double)> {
+    static const char *name() { return "double(double)"; }
+};
+}
+
+static double sig_twice(double x) {
+    return 2.0 * x;
+}
+
+static int sig_count_foreign(const char *name, bu_plugin_cmd_impl, void *user) {
+    if (std::strcmp(name, "sum") == 0 || std::strcmp(name, "sig_twice") == 0) ++*static_cast<int *>(user);
+    return 0;
+}
+
+/**
+ * Test: Commands of several signatures in one registry
+ * The default-signature host loads the argc/argv plugin from
+ * tests/alt_signature next to its own commands; typed lookups and
+ * invoke<Sig>() reach them, the untyped API passes them by.
+ */
+static bool test_signatures(const char* plugin_dir) {
+    TEST_START("Multiple command signatures");
+    typedef int argv_sig(int, const char **);
+    
+    unsigned int argv_id = bu_plugin_sig_id(BU_PLUGIN_SIG_ARGV);
+    TEST_ASSERT(argv_id != BU_PLUGIN_SIG_NATIVE, "argc/argv is not the host's signature");
+    TEST_ASSERT_EQUAL(BU_PLUGIN_SIG_NATIVE, bu_plugin_sig_id(nullptr), "NULL names the host's signature");
+    TEST_ASSERT_EQUAL(BU_PLUGIN_SIG_NATIVE, bu_plugin_sig_id(" int ( ) "), "int() is int(void)");
+    TEST_ASSERT_EQUAL(argv_id, bu_plugin_sig_id("int (int argc, const char **argv)"), "Parameter names are ignored");
+    TEST_ASSERT(std::strcmp(bu_plugin_sig_name(argv_id), "int(int,const char**)") == 0, "Names are kept in compared form");
+    TEST_ASSERT(std::strcmp(bu_plugin_sig_name(bu_plugin_sig_id("unsigned long (unsigned long n, struct foo)")),
+                            "unsigned long(unsigned long,struct foo)") == 0, "Type words are kept");
+    unsigned int str_id = bu_plugin_sig_id("int(std::string)");
+    TEST_ASSERT(std::strcmp(bu_plugin_sig_name(str_id), "int(std::string)") == 0, "Unnamed qualified types keep their name");
+    TEST_ASSERT_EQUAL(str_id, bu_plugin_sig_id("int(std::string s)"), "A named qualified type matches the unnamed one");
+    TEST_ASSERT(str_id != bu_plugin_sig_id("int(std::wstring)"), "Two types of one namespace are different signatures");
+    TEST_ASSERT(bu_plugin_sig_id("int(ns::Foo)") != bu_plugin_sig_id("int(ns::Bar)"), "ns::Foo and ns::Bar differ");
+    TEST_ASSERT_EQUAL(bu_plugin_sig_id("int(ns::Foo)"), bu_plugin_sig_id("int(ns::Foo f)"), "ns::Foo f is ns::Foo");
+    TEST_ASSERT_EQUAL(bu_plugin_sig_id("int(const T)"), bu_plugin_sig_id("int(const T x)"), "const T x is const T");
+    TEST_ASSERT(std::strcmp(bu_plugin_sig_name(bu_plugin_sig_id("int(std::map<int, int> m)")),
+                            "int(std::map<int,int>)") == 0, "Commas inside template arguments do not split parameters");
+    TEST_ASSERT(bu_plugin_sig_name(1000) == nullptr, "Unknown IDs have no name");
+    
+    std::string path = get_plugin_path(plugin_dir, "tests/alt_signature", "alt-args-plugin");
+    TEST_ASSERT_EQUAL(3, bu_plugin_load(path.c_str()), "The argc/argv plugin should load into this host");
+    TEST_ASSERT(bu_plugin_cmd_exists("sum") && bu_plugin_cmd_get("sum") == nullptr,
+                "A command of another signature exists but has no untyped implementation");
+    int r = 0;
+    TEST_ASSERT_EQUAL(-1, bu_plugin_cmd_run("sum", &r), "Untyped runs pass it by");
+    bu_plugin_cmd_handle h = bu_plugin_cmd_lookup("sum");
+    TEST_ASSERT(h && bu_plugin_cmd_handle_sig(h) == argv_id && !bu_plugin_cmd_handle_impl(h), "The handle carries the tag");
+    clear_logs();
+    TEST_ASSERT(bu_plugin_cmd_lookup_sig("sum", BU_PLUGIN_SIG_NATIVE) == nullptr, "Typed lookup checks the tag");
+    TEST_ASSERT(log_contains(BU_LOG_WARN, "has signature int(int,const char**)"), "The mismatch is logged");
+    TEST_ASSERT(bu_plugin_cmd_lookup_sig("sum", argv_id) == h, "The matching lookup returns the handle");
+    
+    const char *args[] = { "1", "2", "3" };
+    bu_plugin_output *out = bu_plugin_output_create();
+    bu_plugin_output *prev_out = bu_plugin_output_set_current(out);
+    int by_name = bu_plugin::invoke<argv_sig>("sum", 3, args);
+    bu_plugin::cmd<argv_sig> c(h);
+    int direct = c ? c(2, args) : -1;
+    int resolved = bu_plugin::invoke(c, 1, args);
+    bu_plugin_output_set_current(prev_out);
+    size_t len = 0;
+    const char *text = bu_plugin_output_data(out, &len);
+    bool printed = std::string(text, len).find("Sum = 6") != std::string::npos;
+    bu_plugin_output_destroy(out);
+    TEST_ASSERT_EQUAL(6, by_name, "invoke<Sig>() runs it by name");
+    TEST_ASSERT(printed, "Its output goes through this host");
+    TEST_ASSERT_EQUAL(3, direct, "cmd<Sig> resolves it once");
+    TEST_ASSERT_EQUAL(1, resolved, "By resolved cmd");
+    TEST_ASSERT(!bu_plugin::cmd<int()>(h), "cmd<Sig> of another signature stays empty");
+    TEST_ASSERT_EQUAL(-1, (bu_plugin::invoke<int(), bu_plugin::return_status>("sum").status),
+                      "invoke() of another signature reports -1");
+    
+    /* Built-in commands of any signature, sharing one namespace */
+    unsigned int dbl_id = bu_plugin_sig_id("double (double x)");
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_register_sig("sig_twice", dbl_id, reinterpret_cast<bu_plugin_any_fn>(sig_twice)),
+                      "Should register a double(double) command");
+    TEST_ASSERT(bu_plugin::invoke<double(double)>("sig_twice", 1.25) == 2.5, "invoke<double(double)>()");
+    TEST_ASSERT_EQUAL(1, bu_plugin_cmd_register("sig_twice", invoke_count), "Names are shared across signatures");
+    TEST_ASSERT_EQUAL(-1, bu_plugin_cmd_register_sig("sig_bad", 1000, reinterpret_cast<bu_plugin_any_fn>(sig_twice)),
+                      "Unknown signature IDs are rejected");
+    TEST_ASSERT_EQUAL(-1, bu_plugin_cmd_set_batch("sum", nullptr), "Batched entry points take the host's signature");
+    int listed = 0;
+    bu_plugin_cmd_foreach(sig_count_foreign, &listed);
+    TEST_ASSERT_EQUAL(0, listed, "foreach lists the host's signature only");
+    
+    const bu_plugin_host_services *host = bu_plugin_get_host_services();
+    bu_plugin_cmd_handle hh = host->cmd_lookup_sig("sig_twice", host->sig_id("double(double)"));
+    TEST_ASSERT(hh && host->cmd_handle_fn(hh, dbl_id) == reinterpret_cast<bu_plugin_any_fn>(sig_twice),
+                "Plugins reach typed lookups through the services table");
+    
+    TEST_PASS();
+}
+
+static int ctx_one() { return 1; }
+static int ctx_two() { return 2; }
+
+/* Whether the context a command runs in has tp1_draw */
+static int ctx_probe() {
+    return bu_plugin_cmd_exists("tp1_draw");
+}
+
+static void ctx_probe_done(int status, int result, void *user) {
+    static_cast<std::atomic<int> *>(user)->store(status == 0 ? result : -1);
+}
+
+/**
+ * Test: Registry contexts
+ * Two contexts in the namespaces of tests/multilib_stress load that test's
+ * plugins into one host build; same-named commands stay apart, the
+ * default context is untouched, and work started in a context (runs,
+ * submitted commands) sees that context.
+ */
+static bool test_contexts(const char* plugin_dir) {
+    TEST_START("Registry contexts");
+    
+    clear_logs();
+    TEST_ASSERT(bu_plugin_ctx_create("") == nullptr && bu_plugin_ctx_create("1tp") == nullptr &&
+                bu_plugin_ctx_create("tp-1") == nullptr, "A namespace must be an identifier");
+    TEST_ASSERT(log_contains(BU_LOG_ERR, "Invalid context namespace"), "Invalid namespaces are logged");
+    bu_plugin_ctx *def = bu_plugin_ctx_default();
+    TEST_ASSERT(def && bu_plugin_ctx_current() == def, "The default context is current");
+    TEST_ASSERT(std::strcmp(bu_plugin_ctx_ns(def), "bu") == 0, "The default namespace is BU_PLUGIN_NAME");
+    
+    bu_plugin_ctx *c1 = bu_plugin_ctx_create("testplugins1");
+    bu_plugin_ctx *c2 = bu_plugin_ctx_create("testplugins2");
+    TEST_ASSERT(c1 && c2 && c1 != def && c1 != c2, "Should create two contexts");
+    TEST_ASSERT(std::strcmp(bu_plugin_ctx_ns(c2), "testplugins2") == 0, "A context keeps its namespace");
+    
+    /* Plugins load by their context's namespace */
+    size_t def_count = bu_plugin_cmd_count();
+    size_t def_modules = bu_plugin_loaded_modules_count();
+    std::string tp1 = get_plugin_path(plugin_dir, "tests/multilib_stress/plugins/testplugins1", "tp1-draw-plugin");
+    std::string tp2 = get_plugin_path(plugin_dir, "tests/multilib_stress/plugins/testplugins2", "tp2-render-plugin");
+    clear_logs();
+    TEST_ASSERT_EQUAL(-1, bu_plugin_load(tp1.c_str()), "The default context does not load another namespace");
+    TEST_ASSERT(log_contains(BU_LOG_ERR, "does not export bu_plugin_info"), "The missing symbol is logged");
+    TEST_ASSERT_EQUAL(-1, bu_plugin_ctx_load(c2, tp1.c_str()), "Nor does a context of another namespace");
+    TEST_ASSERT_EQUAL(3, bu_plugin_ctx_load(c1, tp1.c_str()), "Should load tp1-draw-plugin into its context");
+    TEST_ASSERT_EQUAL(2, bu_plugin_ctx_load(c2, tp2.c_str()), "Should load tp2-render-plugin into its context");
+#if !defined(_WIN32)
+    bu_plugin_load_opts opts = bu_plugin_load_opts();
+    opts.struct_size = sizeof(opts);
+    opts.flags = BU_PLUGIN_LOAD_OUT_OF_PROCESS;
+    TEST_ASSERT_EQUAL(-1, bu_plugin_ctx_load_ex(c2, tp2.c_str(), &opts), "Pooled plugins load into the default context only");
+#endif
+    TEST_ASSERT_EQUAL(1, bu_plugin_ctx_loaded_modules_count(c1), "Each context retains its modules");
+    TEST_ASSERT_EQUAL(def_modules, bu_plugin_loaded_modules_count(), "The default context's modules are untouched");
+    TEST_ASSERT_EQUAL(def_count, bu_plugin_cmd_count(), "The default registry is untouched");
+    TEST_ASSERT(bu_plugin_ctx_cmd_exists(c1, "tp1_draw") && !bu_plugin_ctx_cmd_exists(c2, "tp1_draw") &&
+                !bu_plugin_cmd_exists("tp1_draw"), "Commands stay in their context");
+    
+    /* The same name in several contexts */
+    TEST_ASSERT_EQUAL(0, bu_plugin_ctx_cmd_register(c1, "ctx_same", ctx_one), "Should register in c1");
+    TEST_ASSERT_EQUAL(0, bu_plugin_ctx_cmd_register(c2, "ctx_same", ctx_two), "The name is free in c2");
+    int r1 = 0, r2 = 0;
+    TEST_ASSERT(bu_plugin_ctx_cmd_run(c1, "ctx_same", &r1) == 0 && bu_plugin_ctx_cmd_run(c2, "ctx_same", &r2) == 0,
+                "Should run in both contexts");
+    TEST_ASSERT(r1 == 1 && r2 == 2, "Each context runs its own command");
+    TEST_ASSERT_EQUAL(-1, bu_plugin_cmd_run("ctx_same", &r1), "The default context has none");
+    TEST_ASSERT_EQUAL(0, bu_plugin_ctx_cmd_set_flags(c1, "ctx_same", BU_PLUGIN_CMD_PURE), "Flags are per context");
+    TEST_ASSERT(bu_plugin_ctx_cmd_get_flags(c1, "ctx_same") == BU_PLUGIN_CMD_PURE &&
+                bu_plugin_ctx_cmd_get_flags(c2, "ctx_same") == 0, "Flags of one context do not leak");
+    bu_plugin_cmd_handle h2 = bu_plugin_ctx_cmd_lookup(c2, "ctx_same");
+    TEST_ASSERT(h2 && h2 != bu_plugin_ctx_cmd_lookup(c1, "ctx_same"), "Each context has its handles");
+    TEST_ASSERT(bu_plugin_cmd_invoke(h2, &r2) == 0 && r2 == 2, "A handle runs from any current context");
+    
+    /* The current context */
+    bu_plugin_ctx *prev = bu_plugin_ctx_set_current(c2);
+    TEST_ASSERT(prev == def && bu_plugin_ctx_current() == c2, "set_current returns the previous context");
+    r2 = 0;
+    TEST_ASSERT(bu_plugin_cmd_run("ctx_same", &r2) == 0 && r2 == 2, "Functions without a context use the current one");
+    bu_plugin_ctx_set_current(nullptr);
+    TEST_ASSERT(bu_plugin_ctx_current() == def, "NULL makes the default current");
+    {
+        bu_plugin::ctx_scope scope(c1);
+        TEST_ASSERT(bu_plugin_cmd_exists("tp1_make") == 1, "ctx_scope makes a context current");
+    }
+    TEST_ASSERT(bu_plugin_ctx_current() == def, "ctx_scope restores the previous context");
+    
+    /* Work started in a context sees it */
+    TEST_ASSERT_EQUAL(0, bu_plugin_ctx_cmd_register(c1, "ctx_probe", ctx_probe), "Should register the probe");
+    int seen = 0;
+    TEST_ASSERT(bu_plugin_ctx_cmd_run(c1, "ctx_probe", &seen) == 0 && seen == 1, "A command runs in its context");
+    std::atomic<int> queued(-2);
+    TEST_ASSERT_EQUAL(0, bu_plugin_ctx_cmd_submit_name(c1, "ctx_probe", ctx_probe_done, &queued), "Should submit in c1");
+    bu_plugin_exec_drain();
+    TEST_ASSERT_EQUAL(1, queued.load(), "A submitted command runs in the submitting context");
+    
+    /* Freezing and shutting down are per context */
+    bu_plugin_cmd_handle probe = bu_plugin_ctx_cmd_lookup(c1, "ctx_probe");
+    TEST_ASSERT_EQUAL(0, bu_plugin_ctx_freeze(c1), "Should freeze c1");
+    TEST_ASSERT(bu_plugin_ctx_cmd_lookup(c1, " ctx_probe ") == probe, "A frozen lookup returns the earlier handle");
+    bu_plugin_cmd_handle erase = bu_plugin_ctx_cmd_lookup(c1, "tp1_erase");
+    TEST_ASSERT(erase && bu_plugin_cmd_handle_impl(erase) == bu_plugin_ctx_cmd_get(c1, "tp1_erase"),
+                "Freezing creates the handles of every command");
+    TEST_ASSERT(bu_plugin_ctx_cmd_lookup(c1, "ctx_late") == nullptr, "Unknown names have no frozen handle");
+    TEST_ASSERT(bu_plugin_ctx_is_frozen(c1) && !bu_plugin_is_frozen() && !bu_plugin_ctx_is_frozen(c2),
+                "Only c1 is frozen");
+    TEST_ASSERT_EQUAL(-1, bu_plugin_ctx_cmd_register(c1, "ctx_late", ctx_one), "A frozen context rejects registration");
+    TEST_ASSERT_EQUAL(0, bu_plugin_ctx_cmd_register(c2, "ctx_late", ctx_one), "Others still register");
+    TEST_ASSERT(bu_plugin_ctx_cmd_get(c1, "tp1_erase") != nullptr, "Frozen lookups work");
+    bu_plugin_ctx_shutdown(c2);
+    TEST_ASSERT(bu_plugin_ctx_cmd_count(c2) == 0 && bu_plugin_ctx_loaded_modules_count(c2) == 0,
+                "Shutdown unloads and clears the context");
+    TEST_ASSERT(bu_plugin_cmd_handle_impl(h2) == nullptr, "Its handles resolve to nothing");
+    TEST_ASSERT_EQUAL(2, bu_plugin_ctx_load(c2, tp2.c_str()), "A shut down context can load again");
+    
+    clear_logs();
+    bu_plugin_ctx_destroy(def);
+    TEST_ASSERT(log_contains(BU_LOG_WARN, "default context cannot be destroyed"), "The default context stays");
+    bu_plugin_ctx_destroy(c1);
+    bu_plugin_ctx_destroy(c2);
+    bu_plugin_ctx_destroy(nullptr);
+    TEST_ASSERT_EQUAL(def_count, bu_plugin_cmd_count(), "The default registry is unaffected");
+    
+    TEST_PASS();
+}
+
+#if !defined(_WIN32)
+/* Zygote worker: run the requested command and reply "<status> <result>" */
+static std::atomic<int> s_zygote_release(0);
+
+static void zygote_strand_block(void *) {
+    while (!s_zygote_release.load()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+static void zygote_strand_mark(void *arg) {
+    static_cast<std::atomic<int> *>(arg)->store(1);
+}
+
+static int zygote_worker(int fd, const char *request, void *) {
+    int status = 0;
+    int result = 0;
+    if (std::strcmp(request, "register") == 0) {
+        status = bu_plugin_cmd_register("zygote_late_cmd", []() -> int { return 0; });
+    } else if (std::strcmp(request, "deadline") == 0) {
+        /* The worker's own timer must stop a context of its own */
+        bu_plugin_call_ctx *ctx = bu_plugin_call_ctx_create();
+        status = bu_plugin_call_ctx_set_deadline(ctx, 20000);
+        for (int i = 0; i < 200 && !bu_plugin_call_ctx_stopped(ctx); i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        result = bu_plugin_call_ctx_stopped(ctx);
+        bu_plugin_call_ctx_destroy(ctx);
+    } else if (std::strcmp(request, "strand") == 0) {
+        /* The strand was busy in the parent; the worker's jobs must still run on it */
+        std::atomic<int> ran(0);
+        status = bu_plugin_strand_post(bu_plugin_strand_get("zygote_strand"), zygote_strand_mark, &ran);
+        for (int i = 0; i < 200 && !ran.load(); i++) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        result = ran.load();
+    } else {
+        status = bu_plugin_cmd_run(request, &result);
+    }
+    char reply[64];
+    int len = snprintf(reply, sizeof(reply), "%d %d\n", status, result);
+    return (write(fd, reply, static_cast<size_t>(len)) == len) ? 0 : 1;
+}
+
+/* Spawn a worker (retrying until the server is listening) and collect its reply */
+static std::string zygote_request(const char *sock, const char *request) {
+    int fd = -1;
+    for (int i = 0; i < 400 && fd < 0; i++) {
+        fd = bu_plugin_zygote_spawn(sock, request);
+        if (fd < 0) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    std::string reply;
+    if (fd < 0) return reply;
+    char buf[128];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        reply.append(buf, static_cast<size_t>(n));
+    }
+    close(fd);
+    return reply;
+}
+
+/**
+ * Test: Zygote fork server
+ * Workers forked from a frozen registry run commands immediately and cannot register.
+ */
+static bool test_zygote() {
+    TEST_START("Zygote Fork Server");
+    
+    char sock[64];
+    snprintf(sock, sizeof(sock), "/tmp/bu_plugin_zygote_test_%d.sock", static_cast<int>(getpid()));
+    
+    /* A deadline pending in the parent keeps its timer thread busy across the forks */
+    bu_plugin_call_ctx *pending = bu_plugin_call_ctx_create();
+    bu_plugin_call_ctx_set_deadline(pending, 60000000);
+    
+    /* So does a strand with a job running and another queued */
+    bu_plugin_strand *strand = bu_plugin_strand_get("zygote_strand");
+    std::atomic<int> queued(0);
+    bu_plugin_strand_post(strand, zygote_strand_block, nullptr);
+    bu_plugin_strand_post(strand, zygote_strand_mark, &queued);
+    
+    fflush(nullptr);
+    pid_t server = fork();
+    if (server == 0) {
+        int spawned = bu_plugin_zygote_serve(sock, zygote_worker, nullptr);
+        _exit(spawned == 5 ? 0 : 1);
+    }
+    /* The server has its copy of the busy strand; let the parent's run on */
+    s_zygote_release.store(1);
+    bu_plugin_exec_drain();
+    TEST_ASSERT(server > 0, "fork() should succeed");
+    
+    std::string reply = zygote_request(sock, "example");
+    printf("  'example' worker replied: %s", reply.c_str());
+    TEST_ASSERT(reply == "0 42\n", "Worker should run 'example' and return 42");
+    
+    reply = zygote_request(sock, "nonexistent_command");
+    TEST_ASSERT(reply == "-1 0\n", "Worker should report a missing command");
+    
+    reply = zygote_request(sock, "register");
+    TEST_ASSERT(reply == "-1 0\n", "Registration should fail in a frozen registry");
+    
+    reply = zygote_request(sock, "deadline");
+    TEST_ASSERT(reply == "0 1\n", "A deadline set in a worker should fire");
+    
+    reply = zygote_request(sock, "strand");
+    TEST_ASSERT(reply == "0 1\n", "A job posted to a strand in a worker should run");
+    
+    int fd = bu_plugin_zygote_spawn(sock, BU_PLUGIN_ZYGOTE_QUIT);
+    TEST_ASSERT(fd >= 0, "Quit request should be accepted");
+    close(fd);
+    
+    int wstatus = 0;
+    TEST_ASSERT(waitpid(server, &wstatus, 0) == server, "Server should exit");
+    TEST_ASSERT(WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0, "Server should have spawned 5 workers");
+    bu_plugin_call_ctx_set_deadline(pending, 0);
+    bu_plugin_call_ctx_destroy(pending);
+    TEST_ASSERT_EQUAL(1, queued.load(), "The parent's queued strand job should run");
+    TEST_ASSERT(bu_plugin_is_frozen() == 0, "Parent registry should not be frozen");
+    
+    TEST_PASS();
+}
+
+static bool wait_for_log(int level, const char *substr) {
+    for (int i = 0; i < 500; i++) {
+        if (log_contains(level, substr)) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+/**
+ * Test: Out-of-process worker pool
+ * Pooled commands run in worker processes; a crash fails only the call in
+ * flight and the worker is started again.
+ */
+static bool test_worker_pool(const char *plugin_dir) {
+    TEST_START("Out-of-Process Worker Pool");
+    
+    std::string path = get_plugin_path(plugin_dir, "tests/plugin/edge_cases", "bu-worker-plugin");
+    
+    /* The spawner is forked from this process, so no library thread may be running */
+    clear_logs();
+    bu_plugin_exec_start(2);
+    TEST_ASSERT_EQUAL(-1, bu_plugin_worker_pool_start(2), "The pool should not start beside the executor");
+    TEST_ASSERT(log_contains(BU_LOG_ERR, "bu_plugin threads are running"), "The refusal should be logged");
+    bu_plugin_exec_stop();
+    
+    TEST_ASSERT_EQUAL(0, bu_plugin_worker_pool_start(2), "Pool should start");
+    TEST_ASSERT_EQUAL(1, bu_plugin_worker_pool_start(2), "A second start should report the running pool");
+    
+    bu_plugin_load_opts opts = bu_plugin_load_opts();
+    opts.struct_size = sizeof(opts);
+    opts.flags = BU_PLUGIN_LOAD_OUT_OF_PROCESS;
+    TEST_ASSERT_EQUAL(3, bu_plugin_load_ex(path.c_str(), &opts), "All three commands should get proxies");
+    TEST_ASSERT(bu_plugin_cmd_get_flags("worker_pid") & BU_PLUGIN_CMD_THREADSAFE, "Proxies should be thread-safe");
+    
+    int pid = 0;
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run("worker_pid", &pid), "Pooled command should run");
+    printf("  worker_pid ran in pid %d (host %d)\n", pid, static_cast<int>(getpid()));
+    TEST_ASSERT(pid > 0 && pid != static_cast<int>(getpid()), "Pooled command should run in another process");
+    
+    int result = 0;
+    TEST_ASSERT_EQUAL(-2, bu_plugin_cmd_run("worker_throw", &result), "A throw in the worker should return -2");
+#ifndef BU_PLUGIN_HOST_NO_EXCEPTIONS
+    TEST_ASSERT(log_contains(BU_LOG_ERR, "worker plugin failure"), "The worker's exception text should be logged");
+#endif
+    
+    /* Several host threads share the workers */
+    std::atomic<int> ok(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&ok]() {
+            for (int i = 0; i < 200; i++) {
+                int r = 0;
+                if (bu_plugin_cmd_run("worker_pid", &r) == 0 && r != static_cast<int>(getpid())) ok++;
+            }
+        });
+    }
+    for (auto &t : threads) t.join();
+    TEST_ASSERT_EQUAL(800, ok.load(), "Every concurrent pooled call should succeed");
+    
+    /* A crash fails the call in flight; the other worker keeps serving and the dead one comes back */
+    TEST_ASSERT_EQUAL(-2, bu_plugin_cmd_run("worker_abort", &result), "A crashed worker should fail the call");
+    TEST_ASSERT(log_contains(BU_LOG_ERR, "killed by signal"), "The crash should be logged");
+    for (int i = 0; i < 50; i++) {
+        TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run("worker_pid", &result), "Calls should keep working after a crash");
+    }
+    TEST_ASSERT(wait_for_log(BU_LOG_INFO, "restarted"), "The dead worker should be restarted");
+    
+    bu_plugin_worker_pool_stats st = bu_plugin_worker_pool_stats();
+    st.struct_size = sizeof(st);
+    TEST_ASSERT_EQUAL(0, bu_plugin_worker_pool_get_stats(&st), "Stats should be available");
+    TEST_ASSERT_EQUAL(2, st.workers, "Two workers");
+    TEST_ASSERT_EQUAL(3, st.commands, "Three pooled commands");
+#ifdef BU_PLUGIN_HOST_NO_EXCEPTIONS
+    /* A worker without exceptions cannot catch worker_throw: it dies instead of answering */
+    const int throw_crashes = 1;
+#else
+    const int throw_crashes = 0;
+#endif
+    TEST_ASSERT_EQUAL(1 + throw_crashes, st.crashes, "One crash");
+    TEST_ASSERT_EQUAL(1 + throw_crashes, st.restarts, "One restart");
+    TEST_ASSERT(st.calls >= static_cast<unsigned long long>(852 - throw_crashes), "Answered calls should be counted");
+    
+    bu_plugin_worker_pool_stop();
+    TEST_ASSERT(!bu_plugin_cmd_exists("worker_pid"), "Stopping the pool should unregister its proxies");
+    TEST_ASSERT_EQUAL(0, bu_plugin_worker_pool_get_stats(&st), "Stats should be available without a pool");
+    TEST_ASSERT_EQUAL(0, st.workers, "No workers after stop");
+    
+    /* The global flag moves plain loads out of process and starts the pool on demand */
+    bu_plugin_set_load_flags(BU_PLUGIN_LOAD_OUT_OF_PROCESS);
+    TEST_ASSERT_EQUAL(3, bu_plugin_load(path.c_str()), "The first pooled load should start the pool");
+    TEST_ASSERT_EQUAL(0, bu_plugin_cmd_run("worker_pid", &pid), "Pooled command should run");
+    TEST_ASSERT(pid != static_cast<int>(getpid()), "Pooled command should run in another process");
+    const char *paths[] = { path.c_str() };
+    TEST_ASSERT_EQUAL(-1, bu_plugin_load_graph(paths, 1, 1), "Graph loading should refuse out-of-process loads");
+    bu_plugin_set_load_flags(0);
+    bu_plugin_worker_pool_stop();
+    
+    TEST_PASS();
+}
+#endif
+
 /* Main test runner */
 int main(int argc, char* argv[]) {
     printf("========================================\n");
@@ -593,6 +2713,8 @@ int main(int argc, char* argv[]) {
     test_name_scrubbing();
     test_cmd_run();
     test_cmd_run_throwing();
+    test_cmd_fail();
+    test_invoke();
     test_buffered_logging();
     test_path_allow_policy(plugin_dir);
     test_abi_validation_correct(plugin_dir);
@@ -601,7 +2723,30 @@ int main(int argc, char* argv[]) {
     test_missing_plugin_info(plugin_dir);
     test_manifest_duplicate_detection(plugin_dir);
     test_invalid_paths_logging();
+    test_dependency_single_load(plugin_dir);
+    test_dependency_graph(plugin_dir);
+    test_dependency_cycle(plugin_dir);
+    test_prefault_load(plugin_dir);
+    test_load_ex(plugin_dir);
+    test_host_services(plugin_dir);
+    test_allocator();
+    test_executor();
+    test_batch();
+    test_batch_soa(plugin_dir);
+    test_dag();
+    test_strands();
+    test_lanes();
+    test_call_ctx();
+    test_output(plugin_dir);
+    test_channels(plugin_dir);
+#if !defined(_WIN32)
+    test_zygote();
+    test_worker_pool(plugin_dir);
+#endif
     test_concurrency_foreach();
+    test_memo(plugin_dir);
+    test_signatures(plugin_dir);
+    test_contexts(plugin_dir);
     
     /* Reset logger */
     bu_plugin_set_logger(nullptr);
@@ -0,0 +1,283 @@
+/**
+ * test_script.cpp - Tests for the run_bu_plugin script mode (POSIX only).
+ *
+ * Runs `run_bu_plugin --script` and its argc/argv twin run_alt_script on
+ * generated scripts and covers:
+ *   - Comments, blank lines and quoting
+ *   - Per-line timing output and the summary
+ *   - Unknown commands and malformed lines rejected before anything runs
+ *   - Thread-safe segments split across threads, with barriers in between
+ *   - Arguments passed to alternative signature commands
+ *   - Lines failing through bu_plugin_cmd_fail() with the argc/argv signature
+ *
+ * Usage: test_script <run_bu_plugin> <run_alt_script> <build_dir>
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* Test statistics */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test assertion macros */
+#define TEST_START(name) \
+    do { \
+        printf("\n=== TEST: %s ===\n", name); \
+        tests_run++; \
+    } while(0)
+
+#define TEST_ASSERT(condition, msg) \
+    do { \
+        if (!(condition)) { \
+            printf("  FAIL: %s\n", msg); \
+            tests_failed++; \
+            return false; \
+        } \
+    } while(0)
+
+#define TEST_ASSERT_EQUAL(expected, actual, msg) \
+    do { \
+        if ((expected) != (actual)) { \
+            printf("  FAIL: %s (expected %d, got %d)\n", msg, static_cast<int>(expected), static_cast<int>(actual)); \
+            tests_failed++; \
+            return false; \
+        } \
+    } while(0)
+
+#define TEST_PASS() \
+    do { \
+        printf("  PASS\n"); \
+        tests_passed++; \
+        return true; \
+    } while(0)
+
+static std::string g_exe;
+static std::string g_alt_exe;
+static std::string g_build;
+static char g_script[64];
+
+static std::string plugin_path(const char *dir, const char *name) {
+    return g_build + "/" + dir + "/lib" + name +
+#if defined(__APPLE__)
+        ".dylib";
+#else
+        ".so";
+#endif
+}
+
+static bool write_script(const std::string &text) {
+    FILE *f = fopen(g_script, "wb");
+    if (!f) return false;
+    bool ok = fwrite(text.data(), 1, text.size(), f) == text.size();
+    return (fclose(f) == 0) && ok;
+}
+
+/* Run a shell command; output gets its stdout and stderr, returns the exit status */
+static int run(const std::string &cmd, std::string &output) {
+    output.clear();
+    fflush(nullptr);
+    FILE *p = popen((cmd + " 2>&1").c_str(), "r");
+    if (!p) return -1;
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), p)) > 0) output.append(buf, n);
+    int status = pclose(p);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static bool contains(const std::string &output, const char *text) {
+    return output.find(text) != std::string::npos;
+}
+
+/* Status and result of script line `number` in --time output */
+static bool timing_row(const std::string &output, unsigned int number, const char *command, int &status, int &result) {
+    size_t p = 0;
+    while (p < output.size()) {
+        size_t end = output.find('\n', p);
+        if (end == std::string::npos) end = output.size();
+        std::string row = output.substr(p, end - p);
+        unsigned int n;
+        char name[64];
+        double us;
+        if (sscanf(row.c_str(), "%u %63s %d %d %lf", &n, name, &status, &result, &us) == 5 &&
+            n == number && std::strcmp(name, command) == 0) {
+            return true;
+        }
+        p = end + 1;
+    }
+    return false;
+}
+
+/**
+ * Test: Basic script
+ * Comments, blank lines and quoted names are handled; --time reports every line.
+ */
+static bool test_basic() {
+    TEST_START("Basic Script");
+
+    TEST_ASSERT(write_script("# A comment\n"
+                             "example\n"
+                             "\n"
+                             "   'example'   # trailing comment\n"
+                             "\"version\"\r\n"
+                             "ex\\ample"), "Write script");
+    std::string out;
+    int rc = run(g_exe + " --script -p " + plugin_path("tests/plugin/example", "bu-example-plugin") + " --time " + g_script, out);
+    TEST_ASSERT_EQUAL(0, rc, "Script should succeed");
+    TEST_ASSERT(contains(out, "Hello from the example plugin!"), "Commands ran");
+    TEST_ASSERT(contains(out, "Script: 4 line(s), 2 command(s), 0 failed"), "Summary");
+
+    int status = -9, result = 0;
+    TEST_ASSERT(timing_row(out, 2, "example", status, result), "Row for line 2");
+    TEST_ASSERT_EQUAL(42, result, "'example' returns 42");
+    TEST_ASSERT(timing_row(out, 4, "example", status, result), "Row for the quoted name");
+    TEST_ASSERT(timing_row(out, 5, "version", status, result), "Row for line 5");
+    TEST_ASSERT_EQUAL(1, result, "'version' returns 1");
+    TEST_ASSERT(timing_row(out, 6, "example", status, result), "Row for the escaped name without a newline");
+    TEST_ASSERT_EQUAL(0, status, "Status");
+    TEST_PASS();
+}
+
+/**
+ * Test: Rejected scripts
+ * Bad lines are all reported with their line numbers and nothing runs.
+ */
+static bool test_rejected() {
+    TEST_START("Rejected Script");
+
+    TEST_ASSERT(write_script("example\n"
+                             "no_such_command\n"
+                             "example extra\n"
+                             "example 'unterminated\n"), "Write script");
+    std::string out;
+    int rc = run(g_exe + " --script -p " + plugin_path("tests/plugin/example", "bu-example-plugin") + " " + g_script, out);
+    TEST_ASSERT_EQUAL(1, rc, "Script should fail");
+    TEST_ASSERT(contains(out, "line 2: unknown command 'no_such_command'"), "Unknown command reported");
+    TEST_ASSERT(contains(out, "line 3: 'example' takes no arguments"), "Arguments reported");
+    TEST_ASSERT(contains(out, "line 4: unterminated quote"), "Quote reported");
+    TEST_ASSERT(!contains(out, "Hello from the example plugin!"), "Nothing should run");
+
+    rc = run(g_exe + " --script " + g_script + " extra_file", out);
+    TEST_ASSERT_EQUAL(2, rc, "Usage error");
+    TEST_PASS();
+}
+
+/**
+ * Test: Parallel segments
+ * Runs of thread-safe lines are split across threads; other lines are barriers.
+ */
+static bool test_parallel() {
+    TEST_START("Parallel Segments");
+
+    std::string text;
+    for (int i = 0; i < 5000; i++) text += "services_answer\n";
+    text += "services_call\n";
+    for (int i = 0; i < 5000; i++) text += "services_answer\n";
+    text += "services_alloc\nservices_answer\n";
+    TEST_ASSERT(write_script(text), "Write script");
+
+    std::string out;
+    std::string cmd = g_exe + " --script -j 4 -p " + plugin_path("tests/plugin/services_plugin", "bu-services-plugin");
+    int rc = run(cmd + " - < " + g_script, out);
+    TEST_ASSERT_EQUAL(0, rc, "Script from stdin should succeed");
+    TEST_ASSERT(contains(out, "Script: 10003 line(s), 3 command(s), 0 failed"), "Summary");
+    TEST_ASSERT(contains(out, "2 parallel segment(s) on 4 thread(s)"), "Two parallel segments");
+
+    rc = run(cmd + " --time " + g_script, out);
+    TEST_ASSERT_EQUAL(0, rc, "Timed script should succeed");
+    int status = -9, result = 0;
+    TEST_ASSERT(timing_row(out, 5001, "services_call", status, result), "Row for the barrier line");
+    TEST_ASSERT_EQUAL(43, result, "'services_call' returns 43");
+    TEST_ASSERT(timing_row(out, 5002, "services_answer", status, result), "Row for a parallel line");
+    TEST_ASSERT_EQUAL(42, result, "'services_answer' returns 42");
+    TEST_ASSERT(timing_row(out, 10003, "services_answer", status, result), "Row for the last line");
+    TEST_ASSERT_EQUAL(42, result, "'services_answer' returns 42");
+
+    rc = run(g_exe + " --script -j 1 -p " + plugin_path("tests/plugin/services_plugin", "bu-services-plugin") + " " + g_script, out);
+    TEST_ASSERT_EQUAL(0, rc, "Serial script should succeed");
+    TEST_ASSERT(contains(out, "0 parallel segment(s) on 1 thread(s)"), "Serial run");
+    TEST_PASS();
+}
+
+/**
+ * Test: Arguments
+ * With the argc/argv signature the words after the name are the command's arguments.
+ */
+static bool test_arguments() {
+    TEST_START("Alternative Signature Arguments");
+
+    TEST_ASSERT(write_script("sum 1 2 '3'\n"
+                             "args_test \"a \\\"b\\\" c\" d\\ e\n"
+                             "args_test\n"), "Write script");
+    std::string out;
+    int rc = run(g_alt_exe + " -p " + plugin_path("tests/alt_signature", "alt-args-plugin") + " --time " + g_script, out);
+    TEST_ASSERT_EQUAL(0, rc, "Script should succeed");
+    int status = -9, result = 0;
+    TEST_ASSERT(timing_row(out, 1, "sum", status, result), "Row for line 1");
+    TEST_ASSERT_EQUAL(6, result, "'sum' of three arguments");
+    TEST_ASSERT(timing_row(out, 2, "args_test", status, result), "Row for line 2");
+    TEST_ASSERT_EQUAL(2, result, "Quoted words are single arguments");
+    TEST_ASSERT(contains(out, "argv[0] = a \"b\" c"), "Double-quote escapes");
+    TEST_ASSERT(contains(out, "argv[1] = d e"), "Backslash escape");
+    TEST_ASSERT(timing_row(out, 3, "args_test", status, result), "Row for line 3");
+    TEST_ASSERT_EQUAL(0, result, "No arguments");
+    TEST_PASS();
+}
+
+/**
+ * Test: Failed lines
+ * A command failing through bu_plugin_cmd_fail() fails its line with -2,
+ * and the failure does not carry over to the next line.
+ */
+static bool test_failures() {
+    TEST_START("Alternative Signature Failures");
+
+    TEST_ASSERT(write_script("fail oops\n"
+                             "sum 1 2\n"), "Write script");
+    std::string out;
+    int rc = run(g_alt_exe + " -p " + plugin_path("tests/alt_signature", "alt-args-plugin") + " --time " + g_script, out);
+    TEST_ASSERT_EQUAL(1, rc, "A failed line fails the script");
+    int status = 0, result = 0;
+    TEST_ASSERT(timing_row(out, 1, "fail", status, result), "Row for line 1");
+    TEST_ASSERT_EQUAL(-2, status, "bu_plugin_cmd_fail() reports -2");
+    TEST_ASSERT(timing_row(out, 2, "sum", status, result), "Row for line 2");
+    TEST_ASSERT_EQUAL(0, status, "The next line does not see the failure");
+    TEST_ASSERT_EQUAL(3, result, "The next line's result");
+    TEST_PASS();
+}
+
+int main(int argc, char *argv[]) {
+    printf("========================================\n");
+    printf("    Script Mode Test Suite\n");
+    printf("========================================\n");
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s <run_bu_plugin> <run_alt_script> <build_dir>\n", argv[0]);
+        return 1;
+    }
+    g_exe = argv[1];
+    g_alt_exe = argv[2];
+    g_build = argv[3];
+    snprintf(g_script, sizeof(g_script), "/tmp/bu_plugin_script_test_%d.txt", static_cast<int>(getpid()));
+
+    test_basic();
+    test_rejected();
+    test_parallel();
+    test_arguments();
+    test_failures();
+    unlink(g_script);
+
+    printf("\n========================================\n");
+    printf("    Test Summary\n");
+    printf("========================================\n");
+    printf("Tests run:    %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_failed);
+    printf("========================================\n");
+    return (tests_failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,414 @@
+/**
+ * test_serve.cpp - Tests for the run_bu_plugin command server (POSIX only).
+ *
+ * Starts `run_bu_plugin --serve` with the example plugin and covers:
+ *   - Name resolution, including unknown names
+ *   - Calls by id, batched calls and calls by name
+ *   - Pipelined frames answered in order
+ *   - A client that does not read its replies, then half-closes
+ *   - Malformed frames (unknown op, oversized payload) closing the connection
+ *   - The --bench load generator against the server
+ *   - Shutdown requests
+ *
+ * Usage: test_serve <run_bu_plugin> <build_dir>
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "host/serve.h"
+
+/* Test statistics */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test assertion macros */
+#define TEST_START(name) \
+    do { \
+        printf("\n=== TEST: %s ===\n", name); \
+        tests_run++; \
+    } while(0)
+
+#define TEST_ASSERT(condition, msg) \
+    do { \
+        if (!(condition)) { \
+            printf("  FAIL: %s\n", msg); \
+            tests_failed++; \
+            return false; \
+        } \
+    } while(0)
+
+#define TEST_ASSERT_EQUAL(expected, actual, msg) \
+    do { \
+        if ((expected) != (actual)) { \
+            printf("  FAIL: %s (expected %d, got %d)\n", msg, static_cast<int>(expected), static_cast<int>(actual)); \
+            tests_failed++; \
+            return false; \
+        } \
+    } while(0)
+
+#define TEST_PASS() \
+    do { \
+        printf("  PASS\n"); \
+        tests_passed++; \
+        return true; \
+    } while(0)
+
+static std::string g_exe;
+static std::string g_plugin;
+static char g_sock[64];
+
+/* Run run_bu_plugin with the given arguments; stdout goes to /dev/null */
+static pid_t spawn(const std::vector<std::string> &args) {
+    fflush(nullptr);
+    pid_t pid = fork();
+    if (pid == 0) {
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull >= 0) dup2(devnull, STDOUT_FILENO);
+        std::vector<char *> argv;
+        argv.push_back(const_cast<char *>(g_exe.c_str()));
+        for (const auto &a : args) argv.push_back(const_cast<char *>(a.c_str()));
+        argv.push_back(nullptr);
+        execv(g_exe.c_str(), argv.data());
+        _exit(127);
+    }
+    return pid;
+}
+
+static int wait_exit(pid_t pid) {
+    int status = 0;
+    if (waitpid(pid, &status, 0) != pid) return -1;
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/* Connect, retrying while the server starts */
+static int connect_server() {
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, g_sock, sizeof(addr.sun_path) - 1);
+    for (int i = 0; i < 400; i++) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        if (connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) == 0) return fd;
+        close(fd);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return -1;
+}
+
+static bool send_all(int fd, const std::string &buf) {
+    return send(fd, buf.data(), buf.size(), 0) == static_cast<ssize_t>(buf.size());
+}
+
+static bool recv_all(int fd, void *dst, size_t len) {
+    char *p = static_cast<char *>(dst);
+    while (len) {
+        ssize_t n = recv(fd, p, len, 0);
+        if (n <= 0) return false;
+        p += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+/* Read one reply frame */
+static bool read_reply(int fd, serve_frame &f, std::string &payload) {
+    if (!recv_all(fd, &f, sizeof(f))) return false;
+    payload.resize(f.len);
+    return f.len == 0 || recv_all(fd, &payload[0], f.len);
+}
+
+/* A request frame carrying names */
+static std::string named_frame(uint16_t op, uint32_t tag, const std::vector<const char *> &names) {
+    std::string body;
+    for (const char *n : names) serve_put_name(body, n);
+    std::string frame;
+    serve_put_frame(frame, op, tag, static_cast<uint16_t>(names.size()), body.size());
+    return frame + body;
+}
+
+/* A SERVE_OP_CALL frame carrying ids */
+static std::string call_frame(uint32_t tag, const std::vector<uint32_t> &ids) {
+    std::string frame;
+    serve_put_frame(frame, SERVE_OP_CALL, tag, static_cast<uint16_t>(ids.size()), ids.size() * sizeof(uint32_t));
+    frame.append(reinterpret_cast<const char *>(ids.data()), ids.size() * sizeof(uint32_t));
+    return frame;
+}
+
+static serve_result result_at(const std::string &payload, size_t i) {
+    serve_result r;
+    std::memcpy(&r, payload.data() + i * sizeof(r), sizeof(r));
+    return r;
+}
+
+/**
+ * Test: Resolution and calls
+ * Names resolve to ids once; calls by id, batches and calls by name return the command's result.
+ */
+static bool test_calls() {
+    TEST_START("Resolve and Call");
+
+    int fd = connect_server();
+    TEST_ASSERT(fd >= 0, "Should connect to the server");
+
+    serve_frame f;
+    std::string payload;
+    TEST_ASSERT(send_all(fd, named_frame(SERVE_OP_RESOLVE, 7, {"example", "no_such_command"})), "Send resolve");
+    TEST_ASSERT(read_reply(fd, f, payload), "Resolve reply");
+    TEST_ASSERT_EQUAL(SERVE_OP_RESOLVE, f.op, "Reply op");
+    TEST_ASSERT_EQUAL(7, f.tag, "Reply tag");
+    TEST_ASSERT_EQUAL(2, f.count, "Reply count");
+    serve_resolved ids[2];
+    TEST_ASSERT(payload.size() == sizeof(ids), "Resolve payload size");
+    std::memcpy(ids, payload.data(), sizeof(ids));
+    TEST_ASSERT_EQUAL(0, ids[0].status, "'example' should resolve");
+    TEST_ASSERT_EQUAL(-1, ids[1].status, "Unknown name should not resolve");
+
+    TEST_ASSERT(send_all(fd, call_frame(8, {ids[0].id, ids[0].id, ids[0].id, 9999})), "Send batched call");
+    TEST_ASSERT(read_reply(fd, f, payload), "Call reply");
+    TEST_ASSERT_EQUAL(4, f.count, "One result per call");
+    for (size_t i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL(0, result_at(payload, i).status, "Call status");
+        TEST_ASSERT_EQUAL(42, result_at(payload, i).result, "'example' returns 42");
+    }
+    TEST_ASSERT_EQUAL(-1, result_at(payload, 3).status, "Unknown id should fail");
+
+    TEST_ASSERT(send_all(fd, named_frame(SERVE_OP_CALL_NAMED, 9, {"example", "no_such_command", "version"})), "Send named call");
+    TEST_ASSERT(read_reply(fd, f, payload), "Named call reply");
+    TEST_ASSERT_EQUAL(3, f.count, "One result per name");
+    TEST_ASSERT_EQUAL(42, result_at(payload, 0).result, "'example' by name");
+    TEST_ASSERT_EQUAL(-1, result_at(payload, 1).status, "Unknown name should fail");
+    TEST_ASSERT_EQUAL(1, result_at(payload, 2).result, "'version' returns 1");
+
+    close(fd);
+    TEST_PASS();
+}
+
+/**
+ * Test: Pipelining
+ * Many frames written at once are all answered, in order.
+ */
+static bool test_pipelining() {
+    TEST_START("Pipelined Frames");
+
+    int fd = connect_server();
+    TEST_ASSERT(fd >= 0, "Should connect to the server");
+    serve_frame f;
+    std::string payload;
+    TEST_ASSERT(send_all(fd, named_frame(SERVE_OP_RESOLVE, 0, {"example"})), "Send resolve");
+    TEST_ASSERT(read_reply(fd, f, payload), "Resolve reply");
+    serve_resolved id;
+    std::memcpy(&id, payload.data(), sizeof(id));
+
+    const uint32_t frames = 500;
+    std::string burst;
+    for (uint32_t t = 0; t < frames; t++) burst += call_frame(t, {id.id, id.id});
+    TEST_ASSERT(send_all(fd, burst), "Send the burst");
+    for (uint32_t t = 0; t < frames; t++) {
+        TEST_ASSERT(read_reply(fd, f, payload), "Every frame should get a reply");
+        TEST_ASSERT_EQUAL(t, f.tag, "Replies should come in request order");
+        TEST_ASSERT_EQUAL(42, result_at(payload, 1).result, "Pipelined call result");
+    }
+
+    close(fd);
+    TEST_PASS();
+}
+
+#if defined(__linux__)
+/* CPU time of a process so far, in clock ticks */
+static long cpu_ticks(pid_t pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", static_cast<int>(pid));
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+    char buf[1024];
+    size_t n = fread(buf, 1, sizeof(buf) - 1, fp);
+    fclose(fp);
+    buf[n] = '\0';
+    const char *p = std::strrchr(buf, ')');
+    unsigned long utime = 0, stime = 0;
+    if (!p || sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2) return -1;
+    return static_cast<long>(utime + stime);
+}
+#endif
+
+/**
+ * Test: Backpressure
+ * A client that pipelines megabytes of frames without reading, then shuts
+ * down its side, stalls only itself: other connections are served, the
+ * server idles while it waits, and every reply arrives once it reads.
+ */
+static bool test_backpressure(pid_t server) {
+    TEST_START("Backpressure and Half-Close");
+
+    int fd = connect_server();
+    TEST_ASSERT(fd >= 0, "Should connect to the server");
+    serve_frame f;
+    std::string payload;
+    TEST_ASSERT(send_all(fd, named_frame(SERVE_OP_RESOLVE, 0, {"example"})), "Send resolve");
+    TEST_ASSERT(read_reply(fd, f, payload), "Resolve reply");
+    serve_resolved id;
+    std::memcpy(&id, payload.data(), sizeof(id));
+
+    /* About 4 MiB of replies, well past what the server buffers */
+    const uint32_t frames = 50000;
+    std::string burst;
+    std::vector<uint32_t> ids(8, id.id);
+    for (uint32_t t = 0; t < frames; t++) burst += call_frame(t, ids);
+    bool sent = false;
+    std::thread writer([&]() {
+        sent = send_all(fd, burst);
+        shutdown(fd, SHUT_WR);
+    });
+
+    /* Checked once the writer is joined; an early return would leave it running */
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    bool served = false;
+    int other = connect_server();
+    if (other >= 0) {
+        served = send_all(other, named_frame(SERVE_OP_CALL_NAMED, 1, {"example"})) &&
+            read_reply(other, f, payload) && result_at(payload, 0).result == 42;
+        close(other);
+    }
+
+    bool idle = true;
+#if defined(__linux__)
+    long before = cpu_ticks(server);
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    long after = cpu_ticks(server);
+    idle = before >= 0 && after - before < sysconf(_SC_CLK_TCK) / 10;
+#else
+    (void)server;
+#endif
+
+    bool ordered = true;
+    uint32_t got = 0;
+    while (got < frames && read_reply(fd, f, payload)) {
+        if (f.tag != got || result_at(payload, 7).result != 42) ordered = false;
+        got++;
+    }
+    if (got < frames) shutdown(fd, SHUT_RDWR);
+    writer.join();
+    TEST_ASSERT(served, "Another connection is served while the first client is stalled");
+    TEST_ASSERT(idle, "The server idles while the client does not read");
+    TEST_ASSERT(sent, "The whole burst should be accepted");
+    TEST_ASSERT_EQUAL(frames, got, "Every frame should get a reply");
+    TEST_ASSERT(ordered, "Replies should come in request order");
+    char byte;
+    TEST_ASSERT(recv(fd, &byte, 1, 0) == 0, "The server closes after the last reply");
+    close(fd);
+
+    TEST_PASS();
+}
+
+/**
+ * Test: Malformed frames
+ * An unknown op or an oversized payload gets an error reply and the connection is closed.
+ */
+static bool test_malformed() {
+    TEST_START("Malformed Frames");
+
+    serve_frame f;
+    std::string payload;
+    char byte;
+
+    int fd = connect_server();
+    TEST_ASSERT(fd >= 0, "Should connect to the server");
+    std::string bad;
+    serve_put_frame(bad, 77, 5, 0, 0);
+    TEST_ASSERT(send_all(fd, bad), "Send unknown op");
+    TEST_ASSERT(read_reply(fd, f, payload), "Error reply");
+    TEST_ASSERT_EQUAL(SERVE_OP_ERROR, f.op, "Unknown op should be an error");
+    TEST_ASSERT_EQUAL(5, f.tag, "Error reply tag");
+    TEST_ASSERT(recv(fd, &byte, 1, 0) == 0, "Connection should be closed");
+    close(fd);
+
+    fd = connect_server();
+    TEST_ASSERT(fd >= 0, "Should connect to the server");
+    bad.clear();
+    serve_put_frame(bad, SERVE_OP_CALL, 6, 1, SERVE_MAX_PAYLOAD + 1);
+    TEST_ASSERT(send_all(fd, bad), "Send oversized frame");
+    TEST_ASSERT(read_reply(fd, f, payload), "Error reply");
+    TEST_ASSERT_EQUAL(SERVE_OP_ERROR, f.op, "Oversized payload should be an error");
+    TEST_ASSERT(recv(fd, &byte, 1, 0) == 0, "Connection should be closed");
+    close(fd);
+
+    fd = connect_server();
+    TEST_ASSERT(fd >= 0, "The server should keep serving other connections");
+    TEST_ASSERT(send_all(fd, named_frame(SERVE_OP_CALL_NAMED, 1, {"example"})), "Send call");
+    TEST_ASSERT(read_reply(fd, f, payload), "Call reply");
+    TEST_ASSERT_EQUAL(42, result_at(payload, 0).result, "Call after errors");
+    close(fd);
+
+    TEST_PASS();
+}
+
+/**
+ * Test: Load generator and shutdown
+ * --bench drives the server over several connections and stops it afterwards.
+ */
+static bool test_bench_and_shutdown(pid_t server) {
+    TEST_START("Load Generator and Shutdown");
+
+    pid_t bench = spawn({"--bench", g_sock, "-c", "2", "-d", "8", "-b", "4", "-n", "500", "--stop", "example"});
+    TEST_ASSERT(bench > 0, "fork() should succeed");
+    TEST_ASSERT_EQUAL(0, wait_exit(bench), "Load generator should succeed");
+    TEST_ASSERT_EQUAL(0, wait_exit(server), "Server should exit cleanly after --stop");
+    TEST_ASSERT(access(g_sock, F_OK) != 0, "Server should remove its socket");
+
+    TEST_PASS();
+}
+
+int main(int argc, char *argv[]) {
+    printf("========================================\n");
+    printf("    Command Server Test Suite\n");
+    printf("========================================\n");
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <run_bu_plugin> <build_dir>\n", argv[0]);
+        return 1;
+    }
+    g_exe = argv[1];
+    g_plugin = std::string(argv[2]) + "/tests/plugin/example/libbu-example-plugin" +
+#if defined(__APPLE__)
+        ".dylib";
+#else
+        ".so";
+#endif
+    snprintf(g_sock, sizeof(g_sock), "/tmp/bu_plugin_serve_test_%d.sock", static_cast<int>(getpid()));
+    signal(SIGPIPE, SIG_IGN);
+
+    pid_t server = spawn({"--serve", g_sock, g_plugin});
+    if (server < 0) {
+        fprintf(stderr, "Cannot start the server\n");
+        return 1;
+    }
+    test_calls();
+    test_pipelining();
+    test_backpressure(server);
+    test_malformed();
+    if (!test_bench_and_shutdown(server)) {
+        kill(server, SIGTERM);
+        waitpid(server, nullptr, 0);
+    }
+
+    printf("\n========================================\n");
+    printf("    Test Summary\n");
+    printf("========================================\n");
+    printf("Tests run:    %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_failed);
+    printf("========================================\n");
+    return (tests_failed == 0) ? 0 : 1;
+}